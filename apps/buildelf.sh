@@ -7,6 +7,10 @@
 # Set LINK_LIBGCC=1 to statically link libgcc (soft-float / 64-bit / long
 # divide helpers). Off by default: most apps get those symbols resolved from
 # the firmware's elf_loader symbol table at load time.
+#
+# BREEZY_APP is defined and the BreezyBox include dir is on the include
+# path (override with BREEZY_SDK=<dir>). Apps that include breezy_abi.h
+# call firmware functions through its slot table instead of by name.
 set -e
 
 SRC=${1:?usage: buildelf.sh <source.c> [extra gcc args...]}
@@ -21,7 +25,9 @@ NM="$TC/xtensa-esp32s3-elf-nm"
 LIBGCC=
 [ "$LINK_LIBGCC" = 1 ] && LIBGCC="$HOME/.espressif/tools/xtensa-esp-elf/esp-14.2.0_20241119/xtensa-esp-elf/lib/gcc/xtensa-esp-elf/14.2.0/esp32s3/libgcc.a"
 
-DIST="$(CDPATH= cd -- "$(dirname -- "$0")" && pwd)/dist"
+APPS="$(CDPATH= cd -- "$(dirname -- "$0")" && pwd)"
+DIST="$APPS/dist"
+SDK="${BREEZY_SDK:-$APPS/../src/components/breezybox/include}"
 mkdir -p "$DIST"
 OUT="$DIST/$NAME.xtensa.elf"
 
@@ -33,6 +39,7 @@ OUT="$DIST/$NAME.xtensa.elf"
   -fvisibility=hidden \
   -Wl,-e,app_main \
   -Wl,--gc-sections \
+  -DBREEZY_APP -I"$SDK" \
   "$@" "$SRC" $LIBGCC -o "$OUT"
 
 "$STRIP" --strip-all --remove-section=.xt.prop "$OUT"
@@ -7,6 +7,10 @@
 # Set LINK_LIBGCC=1 to statically link libgcc (soft-float / 64-bit / long
 # divide helpers). Off by default: most apps get those symbols resolved from
 # the firmware's elf_loader symbol table at load time.
+#
+# BREEZY_APP is defined and the BreezyBox include dir is on the include
+# path (override with BREEZY_SDK=<dir>). Apps that include breezy_abi.h
+# call firmware functions through its slot table instead of by name.
 set -e
 
 SRC=${1:?usage: buildelf_rv32.sh <source.c> [extra gcc args...]}
@@ -25,7 +29,9 @@ MABI=ilp32f
 LIBGCC=
 [ "$LINK_LIBGCC" = 1 ] && LIBGCC=$("$GCC" -march=$MARCH -mabi=$MABI -print-libgcc-file-name)
 
-DIST="$(CDPATH= cd -- "$(dirname -- "$0")" && pwd)/dist"
+APPS="$(CDPATH= cd -- "$(dirname -- "$0")" && pwd)"
+DIST="$APPS/dist"
+SDK="${BREEZY_SDK:-$APPS/../src/components/breezybox/include}"
 mkdir -p "$DIST"
 OUT="$DIST/$NAME.rv32.elf"
 
@@ -38,6 +44,7 @@ OUT="$DIST/$NAME.rv32.elf"
   -fvisibility=hidden \
   -Wl,-e,app_main \
   -Wl,--gc-sections \
+  -DBREEZY_APP -I"$SDK" \
   "$@" "$SRC" $LIBGCC -o "$OUT"
 
 "$STRIP" --strip-all "$OUT"
@@ -1,7 +1,11 @@
 // Plasma Effect - Portable: POSIX & ESP32-S3 BreezyBox
+//
+// plasma -b [frames]: render frames as fast as possible without drawing
+// them, then print the time per frame (compare loader placements with it)
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <math.h>
 #include <fcntl.h>
 #include <unistd.h>
@@ -13,6 +17,12 @@
 
 #if defined(__XTENSA__) || defined(__riscv) /* ESP32-S3 / ESP32-P4 */
 
+#ifdef BREEZY_APP
+    #include "breezy_app.h"
+    /* Inner loop, sine table and column caches in internal RAM */
+    BREEZY_APP_PLACE(BREEZY_PLACE_TEXT | BREEZY_PLACE_DATA);
+#endif
+
     typedef uint32_t TickType_t;
     TickType_t xTaskGetTickCount(void);
     void vTaskDelayUntil(TickType_t *pxPreviousWakeTime, TickType_t xTimeIncrement);
@@ -101,16 +111,25 @@
 
 #endif // ESP (XTENSA/RISCV) / POSIX
 
+#define BENCH_FRAMES 200
+
 static char s_out_buf[BUF_SIZE];
 static int  s_buf_pos = 0;
+static int  s_discard = 0;   /* Benchmark: render but don't draw */
 
 static void flush_buf(void) {
     if (s_buf_pos > 0) {
-        write(STDOUT_FILENO, s_out_buf, s_buf_pos);
+        if (!s_discard) write(STDOUT_FILENO, s_out_buf, s_buf_pos);
         s_buf_pos = 0;
     }
 }
 
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
 static void push_str(const char *s) {
     int len = strlen(s);
     if (s_buf_pos + len >= BUF_SIZE) flush_buf();
@@ -151,8 +170,15 @@ static void init_sin_lut(void) {
 
 int main(int argc, char **argv) {
     int rows, cols;
+    int bench = 0;
 
-    plat_init();
+    if (argc >= 2 && strcmp(argv[1], "-b") == 0) {
+        bench = argc >= 3 ? atoi(argv[2]) : BENCH_FRAMES;
+        if (bench <= 0) bench = BENCH_FRAMES;
+        s_discard = 1;
+    }
+
+    if (!bench) plat_init();
     init_sin_lut();
     plat_get_size(&rows, &cols);
     if (cols > CACHE_W) cols = CACHE_W;
@@ -164,8 +190,10 @@ int main(int argc, char **argv) {
     float r2 = (float)rand() / RAND_MAX * 10.0f;
     float r3 = (float)rand() / RAND_MAX * 10.0f;
     float t = 0.0f;
+    int frames = 0;
+    uint64_t start = now_us();
 
-    while (!has_input_should_exit()) {
+    while (bench ? frames < bench : !has_input_should_exit()) {
         push_str("\033[H");
         int last_color = -1;
 
@@ -207,7 +235,15 @@ int main(int argc, char **argv) {
 
         flush_buf();
         t += 0.08f;
-        plat_sync_frame();
+        frames++;
+        if (!bench) plat_sync_frame();
+    }
+
+    if (bench) {
+        uint64_t us = now_us() - start;
+        printf("%d frames of %dx%d in %u ms: %u us/frame\n", frames, cols, rows,
+               (unsigned)(us / 1000), (unsigned)(us / frames));
+        return 0;
     }
 
     plat_cleanup();
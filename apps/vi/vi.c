@@ -29,7 +29,12 @@
 /* ========== Platform Abstraction ========== */
 #if defined(__XTENSA__) || defined(__riscv)
     /* ESP32-S3 / ESP32-P4 */
+#ifdef BREEZY_APP
+    #include "breezy_abi.h"     /* firmware calls through the ABI slot table */
+#else
     void vterm_get_size(int *rows, int *cols);
+    void vTaskDelay(unsigned int);
+#endif
 
     static int s_orig_fcntl;
 
@@ -47,7 +52,6 @@
     }
 
     static void plat_delay_ms(int ms) {
-        extern void vTaskDelay(unsigned int);
         vTaskDelay(ms / 10);  /* portTICK_PERIOD_MS = 10 */
     }
 
@@ -4,17 +4,19 @@
  * A USB-console BreezyBox shell that also accepts SSH logins over WiFi.
  * No display, no Bluetooth. At the local USB prompt:
  *     wifi connect <ssid> <password>
- *     sshd start
+ *     sshd start            (or: svc start sshd, supervised)
  * then `ssh breezy@<ip>` (password: breezy).
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include "esp_log.h"
 #include "nvs_flash.h"
 #include "esp_console.h"
 
 #include "breezybox.h"
 #include "breezy_exec.h"   // breezybox_exec()
+#include "breezy_svc.h"    // breezy_svc_register()
 #include "ssh_server.h"    // breezy_ssh
 #include "my_console_io.h"
 
@@ -44,6 +46,21 @@ static void host_set_io(ssh_io_write_fn w, ssh_io_read_fn r)
     my_console_set_io_override(&ovr);
 }
 
+// ---- sshd as a supervised service: `svc start sshd [port]` ---- //
+
+static esp_err_t sshd_svc_start(int argc, char **argv)
+{
+    return ssh_server_start(argc > 1 ? atoi(argv[1]) : 22);
+}
+
+static const breezy_svc_def_t sshd_service = {
+    .name    = "sshd",
+    .start   = sshd_svc_start,
+    .stop    = ssh_server_stop,
+    .running = ssh_server_running,
+    .task    = "ssh_srv",
+};
+
 void app_main(void)
 {
     esp_err_t err = nvs_flash_init();
@@ -77,6 +94,10 @@ void app_main(void)
         .func    = &cmd_sshd,
     };
 
+    // Also as a service, so `svc` restarts it if it dies. Registered before
+    // init.sh runs for the same reason as the command.
+    breezy_svc_register(&sshd_service);
+
     // Local shell on USB. This also inits the filesystem, esp_console, and
     // registers the built-in commands (including `wifi`) plus our extras,
     // then runs init.sh.
@@ -0,0 +1,372 @@
+/*
+ * bench.c - breezybox-bench: shell performance on a Linux host
+ *
+ * Usage: breezybox-bench [-n scale] [-b baseline] [-t percent] [-w file]
+ *   -n scale     Multiply iteration counts and data sizes (default 1)
+ *   -b baseline  Compare with a file written by -w; exit 1 on regressions
+ *   -t percent   How much worse than the baseline still passes (default 25)
+ *   -w file      Save the results as a baseline
+ *
+ * Prints one "name value unit" line per benchmark; units ending in "/s"
+ * are better when higher, the rest when lower. Each benchmark keeps its
+ * best of BENCH_ROUNDS runs, which is what the comparison uses.
+ *
+ * Host numbers are not device numbers. They are for spotting changes:
+ * compare runs on the same machine, not against the ESP32.
+ */
+
+#define _GNU_SOURCE  // fopencookie
+
+#include "sim.h"
+#include "breezy_exec.h"
+#include "breezy_vfs.h"
+#include "vterm.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_ROUNDS    5
+#define BENCH_MAX       16
+#define BENCH_DIR       "/root/bench"
+
+// Work per round at scale 1: roughly 0.1 s each on a desktop machine
+#define BUILTIN_ITERS   200000
+#define REDIRECT_ITERS  2000
+#define PIPELINE_ITERS  4000
+#define PIPE_BYTES      (16 * 1024 * 1024)
+#define LOOP_ITERS      200000
+#define SCRIPT_ITERS    40000
+#define VTERM_BYTES     (32 * 1024 * 1024)
+#define PATH_ITERS      200000
+#define LIST_FILES      500
+#define LIST_ITERS      200
+
+// Host paths, bypassing the shell's path wrappers (see sim_fs.c)
+FILE *__real_fopen(const char *path, const char *mode);
+int __real_rmdir(const char *path);
+
+typedef struct {
+    const char *name;
+    const char *unit;
+    double value;
+} result_t;
+
+static result_t s_results[BENCH_MAX];
+static int s_count = 0;
+static int s_scale = 1;
+static char s_root[] = "/tmp/breezybox-bench-XXXXXX";
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool higher_is_better(const char *unit)
+{
+    size_t len = strlen(unit);
+    return len >= 2 && strcmp(unit + len - 2, "/s") == 0;
+}
+
+static void record(const char *name, const char *unit, double value)
+{
+    if (s_count == BENCH_MAX) return;
+    s_results[s_count++] = (result_t){ name, unit, value };
+}
+
+// Output of the commands under test goes nowhere
+static ssize_t sink_write(void *cookie, const char *data, size_t size)
+{
+    (void)cookie; (void)data;
+    return size;
+}
+
+// Remove the scratch directory
+static void cleanup(void)
+{
+    breezybox_exec("rm -r " BENCH_DIR);
+
+    char host[sizeof(s_root) + 8];
+    if (sim_fs_host_path("/root", host, sizeof(host))) __real_rmdir(host);
+    __real_rmdir(s_root);
+}
+
+static void fail(const char *what, const char *arg)
+{
+    fprintf(stderr, "bench: %s%s\n", what, arg);
+    cleanup();
+    exit(2);
+}
+
+static void exec_or_die(const char *cmdline)
+{
+    if (breezybox_exec(cmdline) != 0) fail("failed: ", cmdline);
+}
+
+// Best wall time of BENCH_ROUNDS runs of `iters` executions of cmdline
+static double time_exec(const char *cmdline, int iters)
+{
+    double best = 0;
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        double t0 = now_sec();
+        for (int i = 0; i < iters; i++) exec_or_die(cmdline);
+        double t = now_sec() - t0;
+        if (r == 0 || t < best) best = t;
+    }
+    return best;
+}
+
+// Best time per call of BENCH_ROUNDS runs of `iters` calls of fn
+static double time_calls(void (*fn)(void), int iters)
+{
+    double best = 0;
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        double t0 = now_sec();
+        for (int i = 0; i < iters; i++) fn();
+        double t = now_sec() - t0;
+        if (r == 0 || t < best) best = t;
+    }
+    return best / iters;
+}
+
+static void write_file(const char *path, const char *data, size_t len, size_t total)
+{
+    FILE *f = fopen(path, "w");
+    if (!f) fail("cannot create ", path);
+    for (size_t done = 0; done < total; done += len) {
+        fwrite(data, 1, total - done < len ? total - done : len, f);
+    }
+    fclose(f);
+}
+
+// ============ Benchmarks ============
+
+static void bench_exec(void)
+{
+    int iters = BUILTIN_ITERS * s_scale;
+    record("exec_builtin", "us", time_exec("true", iters) * 1e6 / iters);
+
+    iters = REDIRECT_ITERS * s_scale;
+    record("exec_redirect", "us",
+           time_exec("echo hello > " BENCH_DIR "/out.txt", iters) * 1e6 / iters);
+
+    iters = PIPELINE_ITERS * s_scale;
+    record("exec_pipeline", "us", time_exec("echo hello | wc -c", iters) * 1e6 / iters);
+}
+
+static void bench_pipe(void)
+{
+    char block[4096];
+    for (size_t i = 0; i < sizeof(block); i++) block[i] = (i % 64 == 63) ? '\n' : 'a' + i % 26;
+
+    size_t total = (size_t)PIPE_BYTES * s_scale;
+    write_file(BENCH_DIR "/big.txt", block, sizeof(block), total);
+
+    double t = time_exec("cat " BENCH_DIR "/big.txt | wc -c", 1);
+    record("pipe_2stage", "MB/s", total / t / 1e6);
+
+    t = time_exec("cat " BENCH_DIR "/big.txt | cat | cat | wc -l", 1);
+    record("pipe_4stage", "MB/s", total / t / 1e6);
+}
+
+static void bench_script(void)
+{
+    int loops = LOOP_ITERS * s_scale;
+    char script[256];
+    snprintf(script, sizeof(script),
+             "i=0\n"
+             "while [ $i -lt %d ]; do\n"
+             "    i=$((i + 1))\n"
+             "done\n", loops);
+    write_file(BENCH_DIR "/loop.sh", script, strlen(script), strlen(script));
+    double t = time_exec("sh " BENCH_DIR "/loop.sh", 1);
+    record("script_loop", "us", t * 1e6 / loops);
+
+    // Starting a short, already cached script
+    const char *small = "x=1\nif [ $x -eq 1 ]; then true; fi\n";
+    write_file(BENCH_DIR "/small.sh", small, strlen(small), strlen(small));
+    int iters = SCRIPT_ITERS * s_scale;
+    record("script_start", "us", time_exec("sh " BENCH_DIR "/small.sh", iters) * 1e6 / iters);
+}
+
+static void resolve_relative(void)
+{
+    char buf[BREEZYBOX_MAX_PATH * 2 + 2];
+    if (!breezybox_resolve_path("stat.txt", buf, sizeof(buf))) fail("cannot resolve ", "stat.txt");
+}
+
+static void stat_absolute(void)
+{
+    struct stat st;
+    if (stat(BENCH_DIR "/stat.txt", &st) != 0) fail("cannot stat ", BENCH_DIR "/stat.txt");
+}
+
+static void stat_relative(void)
+{
+    struct stat st;
+    if (stat("stat.txt", &st) != 0) fail("cannot stat ", "stat.txt");
+}
+
+// The shell's part of a path lookup; the host stat() is the same in both
+static void bench_path(void)
+{
+    write_file(BENCH_DIR "/stat.txt", "x", 1, 1);
+    if (breezybox_set_cwd(BENCH_DIR) != 0) fail("cannot cd to ", BENCH_DIR);
+
+    int iters = PATH_ITERS * s_scale;
+    record("path_resolve", "ns", time_calls(resolve_relative, iters) * 1e9);
+    record("stat_absolute", "ns", time_calls(stat_absolute, iters) * 1e9);
+    record("stat_relative", "ns", time_calls(stat_relative, iters) * 1e9);
+
+    breezybox_set_cwd(BREEZYBOX_MOUNT_POINT);
+}
+
+// Directory-heavy commands: one stat() per entry
+static void bench_list(void)
+{
+    exec_or_die("mkdir " BENCH_DIR "/list");
+    for (int i = 0; i < LIST_FILES; i++) {
+        char path[64];
+        snprintf(path, sizeof(path), BENCH_DIR "/list/file%03d.txt", i);
+        write_file(path, "data\n", 5, 5 + i % 64);
+        if (i % 50 == 0) {
+            snprintf(path, sizeof(path), "mkdir " BENCH_DIR "/list/dir%03d", i);
+            exec_or_die(path);
+        }
+    }
+
+    int iters = LIST_ITERS * s_scale;
+    record("ls_500", "us", time_exec("ls " BENCH_DIR "/list", iters) * 1e6 / iters);
+    record("du_tree", "us", time_exec("du -s " BENCH_DIR, iters) * 1e6 / iters);
+}
+
+static void bench_vterm(void)
+{
+    if (vterm_init() != ESP_OK) fail("vterm_init failed", "");
+
+    // Mostly text, with the colour changes and cursor moves of a busy TUI
+    static const char *const pieces[] = {
+        "The quick brown fox jumps over the lazy dog. ",
+        "\x1b[1;32m", "ok", "\x1b[0m", "\r\n",
+        "\x1b[31mERROR\x1b[0m ", "\x1b[10;20H", "status: 42%  ",
+        "\x1b[K", "\t", "\x1b[2;1H", "\x1b[7m inverse \x1b[27m\r\n",
+    };
+    char chunk[4096];
+    size_t len = 0;
+    for (size_t i = 0; len < sizeof(chunk) - 64; i++) {
+        const char *p = pieces[i % (sizeof(pieces) / sizeof(pieces[0]))];
+        size_t n = strlen(p);
+        memcpy(chunk + len, p, n);
+        len += n;
+    }
+
+    size_t total = (size_t)VTERM_BYTES * s_scale;
+    double best = 0;
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        double t0 = now_sec();
+        for (size_t done = 0; done < total; done += len) vterm_write(0, chunk, len);
+        double t = now_sec() - t0;
+        if (r == 0 || t < best) best = t;
+    }
+    record("vterm_parse", "MB/s", total / best / 1e6);
+}
+
+// ============ Baselines ============
+
+static int compare(const char *path, double tolerance, FILE *out)
+{
+    FILE *f = __real_fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "bench: cannot read %s\n", path);
+        return 2;
+    }
+
+    int failed = 0;
+    char name[64], unit[16];
+    double base;
+    while (fscanf(f, "%63s %lf %15s", name, &base, unit) == 3) {
+        for (int i = 0; i < s_count; i++) {
+            const result_t *r = &s_results[i];
+            if (strcmp(r->name, name) != 0) continue;
+
+            bool worse = higher_is_better(r->unit)
+                ? r->value * (1 + tolerance) < base
+                : r->value > base * (1 + tolerance);
+            if (worse) {
+                fprintf(out, "REGRESSION %s: %.2f %s (baseline %.2f)\n",
+                        r->name, r->value, r->unit, base);
+                failed = 1;
+            }
+        }
+    }
+    fclose(f);
+    return failed;
+}
+
+int main(int argc, char **argv)
+{
+    const char *baseline = NULL;
+    const char *save = NULL;
+    double tolerance = 0.25;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:b:t:w:")) != -1) {
+        switch (opt) {
+        case 'n': s_scale = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+        case 'b': baseline = optarg; break;
+        case 't': tolerance = atof(optarg) / 100; break;
+        case 'w': save = optarg; break;
+        default:
+            fprintf(stderr, "Usage: %s [-n scale] [-b baseline] [-t percent] [-w file]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // The simulated filesystem lives in a scratch directory
+    if (!mkdtemp(s_root)) {
+        perror("bench: mkdtemp");
+        return 2;
+    }
+    sim_fs_set_root(s_root);
+
+    FILE *out = stdout;
+    cookie_io_functions_t sink_fns = { .write = sink_write };
+    stdout = fopencookie(NULL, "w", sink_fns);
+
+    sim_init_shell();
+    exec_or_die("mkdir " BENCH_DIR);
+
+    bench_exec();
+    bench_pipe();
+    bench_script();
+    bench_path();
+    bench_list();
+    bench_vterm();
+
+    cleanup();
+    fclose(stdout);
+    stdout = out;
+
+    for (int i = 0; i < s_count; i++) {
+        printf("%-16s %10.2f %s\n", s_results[i].name, s_results[i].value, s_results[i].unit);
+    }
+
+    if (save) {
+        FILE *f = __real_fopen(save, "w");
+        if (!f) {
+            fprintf(stderr, "bench: cannot write %s\n", save);
+            return 2;
+        }
+        for (int i = 0; i < s_count; i++) {
+            fprintf(f, "%s %.3f %s\n", s_results[i].name, s_results[i].value, s_results[i].unit);
+        }
+        fclose(f);
+    }
+
+    return baseline ? compare(baseline, tolerance, stdout) : 0;
+}
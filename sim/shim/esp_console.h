@@ -0,0 +1,44 @@
+#pragma once
+
+/*
+ * Host shim: esp_console.h
+ *
+ * The command table, argv splitting and `help` work like esp_console;
+ * there is no REPL object (breezybox_start_stdio() runs on linenoise).
+ */
+
+#include "esp_err.h"
+#include <stddef.h>
+
+typedef struct linenoiseCompletions linenoiseCompletions;
+
+typedef int (*esp_console_cmd_func_t)(int argc, char **argv);
+
+typedef struct {
+    const char *command;
+    const char *help;
+    const char *hint;
+    esp_console_cmd_func_t func;
+    void *argtable;
+} esp_console_cmd_t;
+
+typedef struct {
+    size_t max_cmdline_length;
+    size_t max_cmdline_args;
+    int hint_color;
+    int hint_bold;
+} esp_console_config_t;
+
+#define ESP_CONSOLE_CONFIG_DEFAULT() \
+    { .max_cmdline_length = 256, .max_cmdline_args = 32, .hint_color = 39, .hint_bold = 0 }
+
+typedef struct esp_console_repl_s esp_console_repl_t;
+
+esp_err_t esp_console_init(const esp_console_config_t *config);
+esp_err_t esp_console_deinit(void);
+esp_err_t esp_console_cmd_register(const esp_console_cmd_t *cmd);
+esp_err_t esp_console_run(const char *cmdline, int *cmd_ret);
+size_t esp_console_split_argv(char *line, char **argv, size_t argv_size);
+void esp_console_get_completion(const char *buf, linenoiseCompletions *lc);
+const char *esp_console_get_hint(const char *buf, int *color, int *bold);
+esp_err_t esp_console_register_help_command(void);
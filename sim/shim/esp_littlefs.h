@@ -0,0 +1,26 @@
+#pragma once
+
+/*
+ * Host shim: esp_littlefs.h
+ *
+ * "Mounting" creates the mount point under the simulator's host root
+ * directory (see sim.h); files are plain host files.
+ */
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct {
+    const char *base_path;
+    const char *partition_label;
+    void *partition;
+    bool format_if_mount_failed;
+    bool read_only;
+    bool dont_mount;
+    bool grow_on_mount;
+} esp_vfs_littlefs_conf_t;
+
+esp_err_t esp_vfs_littlefs_register(const esp_vfs_littlefs_conf_t *conf);
+esp_err_t esp_vfs_littlefs_unregister(const char *partition_label);
+esp_err_t esp_littlefs_info(const char *partition_label, size_t *total_bytes, size_t *used_bytes);
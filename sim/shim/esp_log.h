@@ -0,0 +1,20 @@
+#pragma once
+
+/*
+ * Host shim: esp_log.h
+ */
+
+#include <stdarg.h>
+
+typedef int (*vprintf_like_t)(const char *fmt, va_list args);
+
+/** Set the log output function; returns the previous one */
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func);
+void esp_log_write(int level, const char *tag, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+#define ESP_LOGE(tag, fmt, ...) esp_log_write(1, tag, "E (%s) " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) esp_log_write(2, tag, "W (%s) " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) esp_log_write(3, tag, "I (%s) " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) do { } while (0)
+#define ESP_LOGV(tag, fmt, ...) do { } while (0)
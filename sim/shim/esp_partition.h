@@ -0,0 +1,9 @@
+#pragma once
+
+/*
+ * Host shim: esp_partition.h (types only; there is no flash)
+ */
+
+#include <stdint.h>
+
+typedef uint32_t esp_partition_mmap_handle_t;
@@ -0,0 +1,11 @@
+#pragma once
+
+/*
+ * Host shim: esp_rom_sys.h
+ *
+ * The simulated CPU counts one cycle per nanosecond (elf_get_cycle_count in sim_stubs.c).
+ */
+
+#include <stdint.h>
+
+uint32_t esp_rom_get_cpu_ticks_per_us(void);
@@ -0,0 +1,11 @@
+#pragma once
+
+/*
+ * Host shim: esp_timer.h
+ *
+ * Microseconds of CLOCK_MONOTONIC, like the device's time since boot.
+ */
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
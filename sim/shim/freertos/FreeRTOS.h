@@ -0,0 +1,41 @@
+#pragma once
+
+/*
+ * Host shim: FreeRTOS on POSIX threads.
+ *
+ * Tasks are threads, ticks are milliseconds. Priorities and core affinity
+ * are recorded but not enforced; stack sizes are raised to a host minimum.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int32_t BaseType_t;
+typedef uint32_t UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE                 ((BaseType_t)0)
+#define pdTRUE                  ((BaseType_t)1)
+#define pdFAIL                  pdFALSE
+#define pdPASS                  pdTRUE
+
+#define portMAX_DELAY           ((TickType_t)0xffffffffUL)
+#define configTICK_RATE_HZ      1000
+#define configMAX_PRIORITIES    25
+#define portTICK_PERIOD_MS      (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)       ((TickType_t)((uint64_t)(ms) * configTICK_RATE_HZ / 1000))
+#define portNUM_PROCESSORS      2
+
+// One process-wide lock stands in for every spinlock
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portMUX_INITIALIZE(mux)      (*(mux) = 0)
+
+void sim_enter_critical(portMUX_TYPE *mux);
+void sim_exit_critical(portMUX_TYPE *mux);
+
+#define portENTER_CRITICAL(mux)      sim_enter_critical(mux)
+#define portEXIT_CRITICAL(mux)       sim_exit_critical(mux)
+#define taskENTER_CRITICAL(mux)      sim_enter_critical(mux)
+#define taskEXIT_CRITICAL(mux)       sim_exit_critical(mux)
@@ -0,0 +1,19 @@
+#pragma once
+
+/*
+ * Host shim: freertos/queue.h
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"  // As in FreeRTOS
+
+typedef struct sim_queue *QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t ticks);
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks);
+BaseType_t xQueueReset(QueueHandle_t q);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q);
+void vQueueDelete(QueueHandle_t q);
+
+#define xQueueSendToBack(q, item, ticks) xQueueSend(q, item, ticks)
@@ -0,0 +1,20 @@
+#pragma once
+
+/*
+ * Host shim: freertos/semphr.h
+ *
+ * Every kind of semaphore is a counting semaphore; a mutex starts at 1.
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"  // As in FreeRTOS
+
+typedef struct sim_sem *SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+void vSemaphoreDelete(SemaphoreHandle_t sem);
+
+#define xSemaphoreCreateBinary()    xSemaphoreCreateCounting(1, 0)
+#define xSemaphoreCreateMutex()     xSemaphoreCreateCounting(1, 1)
@@ -0,0 +1,28 @@
+#pragma once
+
+/*
+ * Host shim: freertos/task.h
+ */
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct sim_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *arg);
+
+#define tskNO_AFFINITY  ((BaseType_t)0x7fffffff)
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_size,
+                                   void *arg, UBaseType_t prio, TaskHandle_t *handle,
+                                   BaseType_t core);
+
+#define xTaskCreate(fn, name, stack_size, arg, prio, handle) \
+    xTaskCreatePinnedToCore(fn, name, stack_size, arg, prio, handle, tskNO_AFFINITY)
+
+/** Only a task deleting itself (NULL) is supported */
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task);
+void vTaskPrioritySet(TaskHandle_t task, UBaseType_t prio);
+const char *pcTaskGetName(TaskHandle_t task);
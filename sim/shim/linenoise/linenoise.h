@@ -0,0 +1,29 @@
+#pragma once
+
+/*
+ * Host shim: linenoise/linenoise.h
+ *
+ * Plain line input without editing. The simulator's console is usually a
+ * pipe or a file, so end of input ends the session instead of returning
+ * NULL forever.
+ */
+
+#include <stddef.h>
+
+typedef struct linenoiseCompletions {
+    size_t len;
+    char **cvec;
+} linenoiseCompletions;
+
+typedef void (linenoiseCompletionCallback)(const char *buf, linenoiseCompletions *lc);
+typedef char *(linenoiseHintsCallback)(const char *buf, int *color, int *bold);
+
+char *linenoise(const char *prompt);
+void linenoiseFree(void *ptr);
+int linenoiseHistoryAdd(const char *line);
+int linenoiseHistorySetMaxLen(int len);
+void linenoiseSetMultiLine(int ml);
+void linenoiseSetDumbMode(int set);
+void linenoiseSetCompletionCallback(linenoiseCompletionCallback *fn);
+void linenoiseSetHintsCallback(linenoiseHintsCallback *fn);
+void linenoiseAddCompletion(linenoiseCompletions *lc, const char *str);
@@ -0,0 +1,37 @@
+#pragma once
+
+/*
+ * Host shim: per-task stdin/stdout/stderr.
+ *
+ * ESP-IDF newlib gives every task its own stdin/stdout/stderr, and the
+ * shell relies on it: a pipeline stage swaps its streams without
+ * affecting anyone else. glibc has one global set, so this header (force-
+ * included into every simulator source) turns them into per-thread slots
+ * and routes the implicit-stdout functions through them. A new task
+ * starts with the process's real streams, as on the device.
+ */
+
+// newlib declares these without asking: GNU extensions such as
+// fopencookie(), and the fixed-width types via <sys/types.h>
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+
+FILE **sim_stdio_slot(int fd);
+int sim_puts(const char *s);
+
+#undef stdin
+#undef stdout
+#undef stderr
+#define stdin   (*sim_stdio_slot(0))
+#define stdout  (*sim_stdio_slot(1))
+#define stderr  (*sim_stdio_slot(2))
+
+#define printf(...)     fprintf(stdout, __VA_ARGS__)
+#define vprintf(f, a)   vfprintf(stdout, f, a)
+#define puts(s)         sim_puts(s)
+#define putchar(c)      fputc(c, stdout)
+#define getchar()       fgetc(stdin)
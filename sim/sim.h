@@ -0,0 +1,25 @@
+#pragma once
+
+/*
+ * sim.h - Host simulator internals
+ */
+
+#include <stddef.h>
+
+/**
+ * @brief Set the host directory that stands in for "/" (call before init)
+ *
+ * The device's /root lives in <dir>/root.
+ */
+void sim_fs_set_root(const char *dir);
+
+/**
+ * @brief Map a device path to the host file behind it
+ * @return buf, or NULL if the result doesn't fit
+ */
+char *sim_fs_host_path(const char *path, char *buf, size_t size);
+
+/**
+ * @brief Initialize everything breezybox_start_stdio() would, without the REPL
+ */
+void sim_init_shell(void);
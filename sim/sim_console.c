@@ -0,0 +1,313 @@
+/*
+ * sim_console.c - esp_console, linenoise and esp_log for the host
+ *
+ * The command table and argv splitting follow esp_console, including its
+ * quoting rules, so commands parse the same way as on the device.
+ */
+
+#include "sim.h"
+#include "breezybox.h"
+#include "breezy_vfs.h"
+#include "breezy_exec.h"
+#include "esp_console.h"
+#include "esp_log.h"
+#include "linenoise/linenoise.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CONSOLE_MAX_CMDS 128
+
+static esp_console_cmd_t s_cmds[CONSOLE_MAX_CMDS];
+static size_t s_cmd_count = 0;
+static esp_console_config_t s_config = ESP_CONSOLE_CONFIG_DEFAULT();
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK:                return "ESP_OK";
+    case ESP_FAIL:              return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:        return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:   return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:  return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:     return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:       return "ESP_ERR_TIMEOUT";
+    }
+    return "UNKNOWN ERROR";
+}
+
+// ============ esp_log ============
+
+// Like newlib's vprintf on the device: the calling task's stdout
+static int log_vprintf(const char *fmt, va_list args)
+{
+    return vfprintf(stdout, fmt, args);
+}
+
+static vprintf_like_t s_log_vprintf = log_vprintf;
+
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func)
+{
+    vprintf_like_t prev = s_log_vprintf;
+    s_log_vprintf = func;
+    return prev;
+}
+
+void esp_log_write(int level, const char *tag, const char *fmt, ...)
+{
+    (void)level; (void)tag;
+    va_list args;
+    va_start(args, fmt);
+    s_log_vprintf(fmt, args);
+    va_end(args);
+}
+
+// ============ esp_console ============
+
+esp_err_t esp_console_init(const esp_console_config_t *config)
+{
+    if (config) s_config = *config;
+    return ESP_OK;
+}
+
+esp_err_t esp_console_deinit(void)
+{
+    s_cmd_count = 0;
+    return ESP_OK;
+}
+
+static esp_console_cmd_t *find_cmd(const char *name)
+{
+    for (size_t i = 0; i < s_cmd_count; i++) {
+        if (strcmp(s_cmds[i].command, name) == 0) return &s_cmds[i];
+    }
+    return NULL;
+}
+
+esp_err_t esp_console_cmd_register(const esp_console_cmd_t *cmd)
+{
+    if (!cmd || !cmd->command || strchr(cmd->command, ' ')) return ESP_ERR_INVALID_ARG;
+
+    esp_console_cmd_t *slot = find_cmd(cmd->command);
+    if (!slot) {
+        if (s_cmd_count == CONSOLE_MAX_CMDS) return ESP_ERR_NO_MEM;
+        slot = &s_cmds[s_cmd_count++];
+    }
+    *slot = *cmd;
+    return ESP_OK;
+}
+
+// Same rules as esp_console: double quotes group, backslash escapes
+// a quote, space or backslash; single quotes are ordinary characters
+size_t esp_console_split_argv(char *line, char **argv, size_t argv_size)
+{
+    enum { SPACE, ARG, QUOTED, ARG_ESC, QUOTED_ESC } state = SPACE;
+    size_t argc = 0;
+    char *start = line;
+    char *out = line;
+
+    for (char *in = line; *in && argc < argv_size - 1; in++) {
+        int c = (unsigned char)*in;
+        int emit = -1;
+
+        switch (state) {
+        case SPACE:
+            if (c == ' ') break;
+            start = out;
+            if (c == '"') {
+                state = QUOTED;
+            } else if (c == '\\') {
+                state = ARG_ESC;
+            } else {
+                state = ARG;
+                emit = c;
+            }
+            break;
+        case ARG:
+        case QUOTED:
+            if ((state == ARG && c == ' ') || (state == QUOTED && c == '"')) {
+                emit = 0;
+                argv[argc++] = start;
+                state = SPACE;
+            } else if (c == '\\') {
+                state = state == ARG ? ARG_ESC : QUOTED_ESC;
+            } else {
+                emit = c;
+            }
+            break;
+        case ARG_ESC:
+        case QUOTED_ESC:
+            if (c == '\\' || c == '"' || c == ' ') emit = c;
+            state = state == ARG_ESC ? ARG : QUOTED;
+            break;
+        }
+        if (emit >= 0) *out++ = (char)emit;
+    }
+
+    *out = '\0';
+    if (state != SPACE && argc < argv_size - 1) argv[argc++] = start;
+    argv[argc] = NULL;
+    return argc;
+}
+
+esp_err_t esp_console_run(const char *cmdline, int *cmd_ret)
+{
+    size_t size = s_config.max_cmdline_length;
+    size_t max_args = s_config.max_cmdline_args;
+    char *buf = malloc(size);
+    char **argv = calloc(max_args + 1, sizeof(char *));
+    if (!buf || !argv) {
+        free(buf);
+        free(argv);
+        return ESP_ERR_NO_MEM;
+    }
+
+    strncpy(buf, cmdline, size - 1);
+    buf[size - 1] = '\0';
+    size_t argc = esp_console_split_argv(buf, argv, max_args + 1);
+
+    esp_err_t err = ESP_OK;
+    const esp_console_cmd_t *cmd = argc > 0 ? find_cmd(argv[0]) : NULL;
+    if (argc == 0) {
+        err = ESP_ERR_INVALID_ARG;
+    } else if (!cmd || !cmd->func) {
+        err = ESP_ERR_NOT_FOUND;
+    } else {
+        *cmd_ret = cmd->func((int)argc, argv);
+    }
+
+    free(argv);
+    free(buf);
+    return err;
+}
+
+static int cmd_help(int argc, char **argv)
+{
+    (void)argc; (void)argv;
+    for (size_t i = 0; i < s_cmd_count; i++) {
+        const esp_console_cmd_t *cmd = &s_cmds[i];
+        printf("%s %s\n", cmd->command, cmd->hint ? cmd->hint : "");
+        if (cmd->help) printf("  %s\n", cmd->help);
+        printf("\n");
+    }
+    return 0;
+}
+
+esp_err_t esp_console_register_help_command(void)
+{
+    const esp_console_cmd_t cmd = {
+        .command = "help",
+        .help = "Print the list of registered commands",
+        .func = &cmd_help,
+    };
+    return esp_console_cmd_register(&cmd);
+}
+
+void esp_console_get_completion(const char *buf, linenoiseCompletions *lc)
+{
+    size_t len = strlen(buf);
+    for (size_t i = 0; i < s_cmd_count; i++) {
+        if (strncmp(buf, s_cmds[i].command, len) == 0) {
+            linenoiseAddCompletion(lc, s_cmds[i].command);
+        }
+    }
+}
+
+const char *esp_console_get_hint(const char *buf, int *color, int *bold)
+{
+    const esp_console_cmd_t *cmd = find_cmd(buf);
+    *color = s_config.hint_color;
+    *bold = s_config.hint_bold;
+    return cmd ? cmd->hint : NULL;
+}
+
+// ============ linenoise ============
+
+char *linenoise(const char *prompt)
+{
+    bool tty = isatty(fileno(stdin));
+    if (tty) {
+        fputs(prompt, stdout);
+        fflush(stdout);
+    }
+
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len = getline(&line, &cap, stdin);
+    if (len < 0) {
+        // No more input: the session is over
+        free(line);
+        if (tty) fputc('\n', stdout);
+        fflush(stdout);
+        exit(0);
+    }
+    if (len > 0 && line[len - 1] == '\n') line[--len] = '\0';
+    return line;
+}
+
+void linenoiseFree(void *ptr)
+{
+    free(ptr);
+}
+
+int linenoiseHistoryAdd(const char *line)
+{
+    (void)line;
+    return 0;
+}
+
+int linenoiseHistorySetMaxLen(int len)
+{
+    (void)len;
+    return 1;
+}
+
+void linenoiseSetMultiLine(int ml)
+{
+    (void)ml;
+}
+
+void linenoiseSetDumbMode(int set)
+{
+    (void)set;
+}
+
+void linenoiseSetCompletionCallback(linenoiseCompletionCallback *fn)
+{
+    (void)fn;
+}
+
+void linenoiseSetHintsCallback(linenoiseHintsCallback *fn)
+{
+    (void)fn;
+}
+
+void linenoiseAddCompletion(linenoiseCompletions *lc, const char *str)
+{
+    char **cvec = realloc(lc->cvec, (lc->len + 1) * sizeof(char *));
+    char *copy = strdup(str);
+    if (!cvec || !copy) {
+        free(copy);
+        if (cvec) lc->cvec = cvec;
+        return;
+    }
+    lc->cvec = cvec;
+    lc->cvec[lc->len++] = copy;
+}
+
+// ============ Shell ============
+
+void sim_init_shell(void)
+{
+    breezybox_vfs_init();
+    breezybox_exec_init();
+
+    esp_console_config_t config = ESP_CONSOLE_CONFIG_DEFAULT();
+    esp_console_init(&config);
+    breezybox_register_commands();
+    esp_console_register_help_command();
+}
@@ -0,0 +1,299 @@
+/*
+ * sim_fs.c - Device paths on a host directory, LittleFS and heap_caps
+ *
+ * breezy_wrap.c is built with its __real_* calls renamed to the
+ * sim_real_* functions below (see CMakeLists.txt), which prefix the host
+ * root before calling the C library. Everything else - CWD, the virtual
+ * "/" listing, cache invalidation - is the device code unchanged.
+ */
+
+#define _GNU_SOURCE
+
+#include "sim.h"
+#include "esp_littlefs.h"
+#include "esp_heap_caps.h"
+#include "breezy_tmpfs.h"
+#include "breezy_bcache.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+#define SIM_SRAM_TOTAL  (512 * 1024)
+#define SIM_PSRAM_TOTAL (8 * 1024 * 1024)
+
+// The C library's versions (-Wl,--wrap turns __real_x into x)
+FILE *__real_fopen(const char *path, const char *mode);
+int __real_open(const char *path, int flags, int mode);
+int __real_mkdir(const char *path, mode_t mode);
+int __real_stat(const char *path, struct stat *st);
+int __real_rename(const char *oldpath, const char *newpath);
+int __real_remove(const char *path);
+int __real_rmdir(const char *path);
+int __real_unlink(const char *path);
+DIR *__real_opendir(const char *name);
+struct dirent *__real_readdir(DIR *dirp);
+int __real_closedir(DIR *dirp);
+void __real_rewinddir(DIR *dirp);
+char *__real_realpath(const char *path, char *resolved_path);
+
+static char s_root[PATH_MAX] = "sim_root";
+
+void sim_fs_set_root(const char *dir)
+{
+    strncpy(s_root, dir, sizeof(s_root) - 1);
+    s_root[sizeof(s_root) - 1] = '\0';
+
+    // Trailing slashes would double up in host paths
+    size_t len = strlen(s_root);
+    while (len > 1 && s_root[len - 1] == '/') s_root[--len] = '\0';
+}
+
+char *sim_fs_host_path(const char *path, char *buf, size_t size)
+{
+    int n = snprintf(buf, size, "%s%s%s", s_root, path[0] == '/' ? "" : "/", path);
+    if (n < 0 || (size_t)n >= size) {
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
+    return buf;
+}
+
+// mkdir -p on a host path
+static int make_dirs(const char *host)
+{
+    char tmp[PATH_MAX];
+    strncpy(tmp, host, sizeof(tmp) - 1);
+    tmp[sizeof(tmp) - 1] = '\0';
+
+    for (char *p = tmp + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (__real_mkdir(tmp, 0755) != 0 && errno != EEXIST) return -1;
+        *p = '/';
+    }
+    return (__real_mkdir(tmp, 0755) != 0 && errno != EEXIST) ? -1 : 0;
+}
+
+// ============ C Library Calls, Relocated ============
+
+#define HOST_PATH(var, path, fail)                                  \
+    char var[PATH_MAX];                                             \
+    if (!sim_fs_host_path(path, var, sizeof(var))) return fail
+
+FILE *sim_real_fopen(const char *path, const char *mode)
+{
+    HOST_PATH(host, path, NULL);
+    return __real_fopen(host, mode);
+}
+
+int sim_real_open(const char *path, int flags, int mode)
+{
+    HOST_PATH(host, path, -1);
+    return __real_open(host, flags, mode);
+}
+
+int sim_real_mkdir(const char *path, mode_t mode)
+{
+    HOST_PATH(host, path, -1);
+    return __real_mkdir(host, mode);
+}
+
+int sim_real_stat(const char *path, struct stat *st)
+{
+    HOST_PATH(host, path, -1);
+    return __real_stat(host, st);
+}
+
+int sim_real_rename(const char *oldpath, const char *newpath)
+{
+    HOST_PATH(host_old, oldpath, -1);
+    HOST_PATH(host_new, newpath, -1);
+    return __real_rename(host_old, host_new);
+}
+
+int sim_real_remove(const char *path)
+{
+    HOST_PATH(host, path, -1);
+    return __real_remove(host);
+}
+
+int sim_real_rmdir(const char *path)
+{
+    HOST_PATH(host, path, -1);
+    return __real_rmdir(host);
+}
+
+DIR *sim_real_opendir(const char *name)
+{
+    HOST_PATH(host, name, NULL);
+    return __real_opendir(host);
+}
+
+// LittleFS doesn't list "." and ".."
+struct dirent *sim_real_readdir(DIR *dirp)
+{
+    struct dirent *e;
+    do {
+        e = __real_readdir(dirp);
+    } while (e && (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0));
+    return e;
+}
+
+int sim_real_closedir(DIR *dirp)
+{
+    return __real_closedir(dirp);
+}
+
+void sim_real_rewinddir(DIR *dirp)
+{
+    __real_rewinddir(dirp);
+}
+
+char *sim_real_realpath(const char *path, char *resolved_path)
+{
+    HOST_PATH(host, path, NULL);
+    char *full = __real_realpath(host, NULL);
+    if (!full) return NULL;
+
+    // Back to a device path
+    size_t root_len = strlen(s_root);
+    const char *dev = full;
+    if (strncmp(full, s_root, root_len) == 0) {
+        dev = full[root_len] ? full + root_len : "/";
+    }
+
+    char *ret = resolved_path ? strcpy(resolved_path, dev) : strdup(dev);
+    free(full);
+    return ret;
+}
+
+int sim_real_unlink(const char *path)
+{
+    HOST_PATH(host, path, -1);
+    return __real_unlink(host);
+}
+
+// ============ LittleFS ============
+
+esp_err_t esp_vfs_littlefs_register(const esp_vfs_littlefs_conf_t *conf)
+{
+    char host[PATH_MAX];
+    if (!sim_fs_host_path(conf->base_path, host, sizeof(host))) return ESP_ERR_INVALID_ARG;
+    if (make_dirs(host) != 0) return ESP_FAIL;
+
+    // Absolute from here on, so realpath() results can be mapped back
+    char *abs = __real_realpath(s_root, NULL);
+    if (abs) {
+        sim_fs_set_root(abs);
+        free(abs);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_vfs_littlefs_unregister(const char *partition_label)
+{
+    (void)partition_label;
+    return ESP_OK;
+}
+
+esp_err_t esp_littlefs_info(const char *partition_label, size_t *total_bytes, size_t *used_bytes)
+{
+    (void)partition_label;
+
+    struct statvfs vfs;
+    if (statvfs(s_root, &vfs) != 0) return ESP_FAIL;
+    *total_bytes = (size_t)vfs.f_blocks * vfs.f_frsize;
+    *used_bytes = (size_t)(vfs.f_blocks - vfs.f_bfree) * vfs.f_frsize;
+    return ESP_OK;
+}
+
+// No block cache: the host has its own
+esp_err_t breezy_bcache_sync(void)
+{
+    sync();
+    return ESP_OK;
+}
+
+void breezy_bcache_stats(breezy_bcache_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+}
+
+// ============ tmpfs ============
+
+// A plain host directory beside the others; unlike the device's, it
+// survives a restart
+esp_err_t breezy_tmpfs_init(void)
+{
+    char host[PATH_MAX];
+    if (!sim_fs_host_path(BREEZYBOX_TMP_DIR, host, sizeof(host))) return ESP_ERR_INVALID_ARG;
+    return make_dirs(host) == 0 ? ESP_OK : ESP_FAIL;
+}
+
+// Same host filesystem as /root
+void breezy_tmpfs_info(size_t *total, size_t *used)
+{
+    size_t t = 0, u = 0;
+    esp_littlefs_info(NULL, &t, &u);
+    if (total) *total = t;
+    if (used) *used = u;
+}
+
+// ============ heap_caps ============
+
+void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+    (void)caps;
+    return malloc(size);
+}
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps)
+{
+    (void)caps;
+    return calloc(n, size);
+}
+
+void *heap_caps_realloc(void *ptr, size_t size, uint32_t caps)
+{
+    (void)caps;
+    return realloc(ptr, size);
+}
+
+void *heap_caps_aligned_alloc(size_t alignment, size_t size, uint32_t caps)
+{
+    (void)caps;
+    void *p = NULL;
+    return posix_memalign(&p, alignment, size) == 0 ? p : NULL;
+}
+
+void heap_caps_free(void *ptr)
+{
+    free(ptr);
+}
+
+size_t heap_caps_get_total_size(uint32_t caps)
+{
+    return (caps & MALLOC_CAP_SPIRAM) ? SIM_PSRAM_TOTAL : SIM_SRAM_TOTAL;
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    return heap_caps_get_total_size(caps);
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps)
+{
+    return heap_caps_get_total_size(caps);
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+    return heap_caps_get_total_size(caps);
+}
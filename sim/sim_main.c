@@ -0,0 +1,54 @@
+/*
+ * sim_main.c - breezybox-sim: the shell on a Linux host
+ *
+ * Usage: breezybox-sim [-r dir] [-c cmdline]
+ *   -r dir      Host directory that stands in for "/" (default: ./sim_root)
+ *   -c cmdline  Run one command line and exit with its status
+ *
+ * Without -c, runs /root/init.sh like the device does, then reads command
+ * lines from stdin until end of input.
+ */
+
+#include "sim.h"
+#include "breezybox.h"
+#include "breezy_exec.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdio.h>
+#include <unistd.h>
+
+#define SIM_REPL_STACK  8192
+#define SIM_REPL_PRIO   5
+
+int main(int argc, char **argv)
+{
+    const char *cmdline = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:c:")) != -1) {
+        switch (opt) {
+        case 'r':
+            sim_fs_set_root(optarg);
+            break;
+        case 'c':
+            cmdline = optarg;
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-r dir] [-c cmdline]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (cmdline) {
+        sim_init_shell();
+        int ret = breezybox_exec(cmdline);
+        fflush(stdout);
+        return ret < 0 ? 1 : ret;
+    }
+
+    if (breezybox_start_stdio(SIM_REPL_STACK, SIM_REPL_PRIO) != ESP_OK) return 1;
+
+    // The REPL task ends the process at end of input
+    vTaskDelete(NULL);
+    return 0;
+}
@@ -0,0 +1,389 @@
+/*
+ * sim_rtos.c - FreeRTOS tasks, semaphores and queues on POSIX threads
+ *
+ * Just enough of the kernel for the shell: tasks are detached threads,
+ * every semaphore is a counting semaphore on a mutex + condition variable,
+ * and ticks are milliseconds of CLOCK_MONOTONIC. Also keeps each task's
+ * stdin/stdout/stderr (see shim/sim_stdio.h).
+ */
+
+#define _GNU_SOURCE
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+// Host libc needs far more stack than newlib; device sizes would overflow
+#define SIM_MIN_STACK (256 * 1024)
+
+// ============ Per-task stdio ============
+
+#undef stdin
+#undef stdout
+#undef stderr
+
+static __thread FILE *s_stdio[3];
+
+FILE **sim_stdio_slot(int fd)
+{
+    if (!s_stdio[fd]) {
+        s_stdio[fd] = fd == 0 ? stdin : fd == 1 ? stdout : stderr;
+    }
+    return &s_stdio[fd];
+}
+
+int sim_puts(const char *s)
+{
+    FILE *out = *sim_stdio_slot(1);
+    if (fputs(s, out) == EOF) return EOF;
+    return fputc('\n', out) == EOF ? EOF : 1;
+}
+
+// ============ Time ============
+
+static uint64_t now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Absolute CLOCK_MONOTONIC deadline, ticks from now
+static struct timespec deadline(TickType_t ticks)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t ms = (uint64_t)ticks * portTICK_PERIOD_MS;
+    ts.tv_sec += ms / 1000;
+    ts.tv_nsec += (ms % 1000) * 1000000;
+    if (ts.tv_nsec >= 1000000000) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+    }
+    return ts;
+}
+
+static void cond_init(pthread_cond_t *cond)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+// Wait on cond until woken or the deadline passes; false on timeout
+static bool cond_wait(pthread_cond_t *cond, pthread_mutex_t *lock,
+                      TickType_t ticks, const struct timespec *until)
+{
+    if (ticks == portMAX_DELAY) {
+        pthread_cond_wait(cond, lock);
+        return true;
+    }
+    return pthread_cond_timedwait(cond, lock, until) != ETIMEDOUT;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Matches elf_get_cycle_count() in sim_stubs.c
+uint32_t esp_rom_get_cpu_ticks_per_us(void)
+{
+    return 1000;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    static uint64_t start;
+    if (!start) start = now_ms();
+    return (TickType_t)((now_ms() - start) / portTICK_PERIOD_MS);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    if (ticks == 0) {
+        sched_yield();
+        return;
+    }
+    uint64_t ms = (uint64_t)ticks * portTICK_PERIOD_MS;
+    struct timespec ts = { .tv_sec = ms / 1000, .tv_nsec = (ms % 1000) * 1000000 };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) { }
+}
+
+// ============ Critical Sections ============
+
+static pthread_mutex_t s_critical = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+void sim_enter_critical(portMUX_TYPE *mux)
+{
+    (void)mux;
+    pthread_mutex_lock(&s_critical);
+}
+
+void sim_exit_critical(portMUX_TYPE *mux)
+{
+    (void)mux;
+    pthread_mutex_unlock(&s_critical);
+}
+
+// ============ Tasks ============
+
+struct sim_task {
+    pthread_t thread;
+    TaskFunction_t fn;
+    void *arg;
+    UBaseType_t prio;
+    char name[16];
+};
+
+static __thread struct sim_task *s_self;
+
+static void *task_entry(void *arg)
+{
+    s_self = arg;
+    s_self->fn(s_self->arg);
+
+    // A FreeRTOS task must not return; be lenient
+    vTaskDelete(NULL);
+    return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_size,
+                                   void *arg, UBaseType_t prio, TaskHandle_t *handle,
+                                   BaseType_t core)
+{
+    (void)core;
+
+    struct sim_task *t = calloc(1, sizeof(*t));
+    if (!t) return pdFAIL;
+    t->fn = fn;
+    t->arg = arg;
+    t->prio = prio;
+    strncpy(t->name, name ? name : "", sizeof(t->name) - 1);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstacksize(&attr, stack_size > SIM_MIN_STACK ? stack_size : SIM_MIN_STACK);
+
+    // The handle must be valid before the task can look itself up
+    if (handle) *handle = t;
+    int err = pthread_create(&t->thread, &attr, task_entry, t);
+    pthread_attr_destroy(&attr);
+
+    if (err != 0) {
+        if (handle) *handle = NULL;
+        free(t);
+        return pdFAIL;
+    }
+    return pdPASS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    // Threads the shim didn't create (main) get a handle on first use
+    if (!s_self) {
+        s_self = calloc(1, sizeof(*s_self));
+        if (!s_self) abort();
+        s_self->thread = pthread_self();
+        s_self->prio = 1;
+        strcpy(s_self->name, "main");
+    }
+    return s_self;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task && task != s_self) {
+        fprintf(stderr, "sim: vTaskDelete() of another task is not supported\n");
+        abort();
+    }
+    free(s_self);
+    s_self = NULL;
+    pthread_exit(NULL);
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task)
+{
+    return (task ? task : xTaskGetCurrentTaskHandle())->prio;
+}
+
+void vTaskPrioritySet(TaskHandle_t task, UBaseType_t prio)
+{
+    (task ? task : xTaskGetCurrentTaskHandle())->prio = prio;
+}
+
+const char *pcTaskGetName(TaskHandle_t task)
+{
+    return (task ? task : xTaskGetCurrentTaskHandle())->name;
+}
+
+// ============ Semaphores ============
+
+struct sim_sem {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    UBaseType_t count;
+    UBaseType_t max;
+};
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial)
+{
+    struct sim_sem *s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    pthread_mutex_init(&s->lock, NULL);
+    cond_init(&s->cond);
+    s->count = initial;
+    s->max = max;
+    return s;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t ticks)
+{
+    struct timespec until = deadline(ticks);
+    BaseType_t ok = pdTRUE;
+
+    pthread_mutex_lock(&s->lock);
+    while (s->count == 0) {
+        if (ticks == 0 || !cond_wait(&s->cond, &s->lock, ticks, &until)) {
+            ok = s->count > 0;
+            break;
+        }
+    }
+    if (ok) s->count--;
+    pthread_mutex_unlock(&s->lock);
+    return ok;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s)
+{
+    pthread_mutex_lock(&s->lock);
+    bool ok = s->count < s->max;
+    if (ok) {
+        s->count++;
+        pthread_cond_signal(&s->cond);
+    }
+    pthread_mutex_unlock(&s->lock);
+    return ok ? pdTRUE : pdFALSE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t s)
+{
+    if (!s) return;
+    pthread_cond_destroy(&s->cond);
+    pthread_mutex_destroy(&s->lock);
+    free(s);
+}
+
+// ============ Queues ============
+
+struct sim_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    uint8_t *items;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    struct sim_queue *q = calloc(1, sizeof(*q));
+    if (!q) return NULL;
+    q->items = calloc(length, item_size);
+    if (!q->items) {
+        free(q);
+        return NULL;
+    }
+    pthread_mutex_init(&q->lock, NULL);
+    cond_init(&q->not_empty);
+    cond_init(&q->not_full);
+    q->length = length;
+    q->item_size = item_size;
+    return q;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t ticks)
+{
+    struct timespec until = deadline(ticks);
+
+    pthread_mutex_lock(&q->lock);
+    while (q->count == q->length) {
+        if (ticks == 0 || !cond_wait(&q->not_full, &q->lock, ticks, &until)) {
+            if (q->count == q->length) {
+                pthread_mutex_unlock(&q->lock);
+                return pdFALSE;
+            }
+        }
+    }
+    UBaseType_t tail = (q->head + q->count) % q->length;
+    memcpy(q->items + tail * q->item_size, item, q->item_size);
+    q->count++;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks)
+{
+    struct timespec until = deadline(ticks);
+
+    pthread_mutex_lock(&q->lock);
+    while (q->count == 0) {
+        if (ticks == 0 || !cond_wait(&q->not_empty, &q->lock, ticks, &until)) {
+            if (q->count == 0) {
+                pthread_mutex_unlock(&q->lock);
+                return pdFALSE;
+            }
+        }
+    }
+    memcpy(item, q->items + q->head * q->item_size, q->item_size);
+    q->head = (q->head + 1) % q->length;
+    q->count--;
+    pthread_cond_signal(&q->not_full);
+    pthread_mutex_unlock(&q->lock);
+    return pdTRUE;
+}
+
+BaseType_t xQueueReset(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->lock);
+    q->head = 0;
+    q->count = 0;
+    pthread_cond_broadcast(&q->not_full);
+    pthread_mutex_unlock(&q->lock);
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->lock);
+    UBaseType_t n = q->count;
+    pthread_mutex_unlock(&q->lock);
+    return n;
+}
+
+void vQueueDelete(QueueHandle_t q)
+{
+    if (!q) return;
+    pthread_cond_destroy(&q->not_empty);
+    pthread_cond_destroy(&q->not_full);
+    pthread_mutex_destroy(&q->lock);
+    free(q->items);
+    free(q);
+}
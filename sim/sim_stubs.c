@@ -0,0 +1,105 @@
+/*
+ * sim_stubs.c - Device-only parts of BreezyBox
+ *
+ * The ELF loader, the flash app store, networking and symbol exports need
+ * the real hardware. Their commands exist in the simulator (so `help` and
+ * scripts see the same table) but only say so.
+ */
+
+#include "breezybox.h"
+#include "breezy_cmd.h"
+#include "breezy_elf.h"
+#include "breezy_appfs.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define ELF_MAGIC "\x7f" "ELF"
+
+// ============ ELF Loader ============
+
+void breezy_elf_init(void)
+{
+}
+
+int breezy_elf_is_elf(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
+
+    char magic[4];
+    size_t n = fread(magic, 1, 4, f);
+    fclose(f);
+    return n == 4 && memcmp(magic, ELF_MAGIC, 4) == 0;
+}
+
+int breezy_elf_run(const char *path, int argc, char **argv)
+{
+    (void)argc; (void)argv;
+    printf("%s: ELF programs can't run in the simulator\n", path);
+    return -1;
+}
+
+int breezy_elf_kill_job(int job)
+{
+    (void)job;
+    return 0;
+}
+
+// ============ App Store ============
+
+esp_err_t breezy_appfs_init(void)
+{
+    return ESP_ERR_NOT_FOUND;
+}
+
+const char *breezy_appfs_name(const char *path)
+{
+    size_t len = strlen(BREEZY_APPFS_PREFIX);
+    return strncmp(path, BREEZY_APPFS_PREFIX, len) == 0 ? path + len : NULL;
+}
+
+int breezy_appfs_stat(const char *name, size_t *size, uint32_t *gen)
+{
+    (void)name; (void)size; (void)gen;
+    return -1;
+}
+
+// ============ Exports and Commands ============
+
+void breezybox_export_symbols(void)
+{
+}
+
+// Nanoseconds stand in for CPU cycles; wraps every 4.3 s like a 1 GHz core
+uint32_t elf_get_cycle_count(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec);
+}
+
+static int unavailable(const char *name)
+{
+    printf("%s: not available in the simulator\n", name);
+    return 1;
+}
+
+int cmd_eget(int argc, char **argv)     { (void)argc; return unavailable(argv[0]); }
+int cmd_hash(int argc, char **argv)     { (void)argc; return unavailable(argv[0]); }
+int cmd_appfs(int argc, char **argv)    { (void)argc; return unavailable(argv[0]); }
+int cmd_elfbench(int argc, char **argv) { (void)argc; return unavailable(argv[0]); }
+int cmd_wifi(int argc, char **argv)     { (void)argc; return unavailable(argv[0]); }
+int cmd_httpd(int argc, char **argv)    { (void)argc; return unavailable(argv[0]); }
+
+static esp_err_t httpd_unavailable(int argc, char **argv)
+{
+    (void)argc;
+    unavailable(argv[0]);
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+const breezy_svc_def_t httpd_service = {
+    .name = "httpd",
+    .start = httpd_unavailable,
+};
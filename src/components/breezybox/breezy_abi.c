@@ -0,0 +1,141 @@
+/*
+ * breezy_abi.c - Firmware side of the BreezyBox app ABI table
+ *
+ * The table also keeps every slotted function linked into the firmware,
+ * the way breezy_exports.c does for by-name imports.
+ */
+
+#include "breezy_abi.h"
+#include "breezy_arena.h"
+#include "breezy_stop.h"
+#include "breezybox.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "vterm.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+_Static_assert(BREEZY_ABI_COUNT == BREEZY_ABI_LEVEL,
+               "breezy_abi_slots.h changed: update BREEZY_ABI_LEVEL");
+
+static const char *TAG = "abi";
+
+// breezy_exports.c
+uint32_t elf_get_cycle_count(void);
+
+// breezy_rgb_lcd, when the firmware links it
+__attribute__((weak)) uint8_t *rgb_display_get_framebuffer(void);
+__attribute__((weak)) int rgb_display_set_mode(int mode);
+__attribute__((weak)) int rgb_display_get_fb_width(void);
+__attribute__((weak)) int rgb_display_get_fb_height(void);
+__attribute__((weak)) void rgb_display_set_vga_palette(const uint16_t palette[256]);
+__attribute__((weak)) void rgb_display_wait_vsync(void);
+__attribute__((weak)) void rgb_gfx_clear(uint8_t color);
+__attribute__((weak)) void rgb_gfx_pixel(int x, int y, uint8_t color);
+__attribute__((weak)) void rgb_gfx_rectfill(int x, int y, int w, int h, uint8_t color);
+__attribute__((weak)) void rgb_gfx_blit(const uint8_t *data, int x, int y, int w, int h,
+                                        int src_stride, int transparent_color);
+__attribute__((weak)) void rgb_gfx_blit_flip(const uint8_t *data, int x, int y, int w, int h,
+                                             int src_stride, int transparent_color,
+                                             bool flip_x, bool flip_y);
+
+// App allocations come from the per-app arena (breezy_arena.c)
+#define malloc  breezy_arena_malloc
+#define calloc  breezy_arena_calloc
+#define realloc breezy_arena_realloc
+#define free    breezy_arena_free
+
+// Blocking and file-opening calls are stop points (breezy_stop.h)
+#define printf breezy_stop_printf
+#define fprintf breezy_stop_fprintf
+#define vprintf breezy_stop_vprintf
+#define vfprintf breezy_stop_vfprintf
+#define puts breezy_stop_puts
+#define fputs breezy_stop_fputs
+#define fputc breezy_stop_fputc
+#define fgets breezy_stop_fgets
+#define fgetc breezy_stop_fgetc
+#define fread breezy_stop_fread
+#define fwrite breezy_stop_fwrite
+#define fflush breezy_stop_fflush
+#define fopen breezy_stop_fopen
+#define fdopen breezy_stop_fdopen
+#define freopen breezy_stop_freopen
+#define fclose breezy_stop_fclose
+#define open breezy_stop_open
+#define read breezy_stop_read
+#define write breezy_stop_write
+#define close breezy_stop_close
+#define usleep breezy_stop_usleep
+#define sleep breezy_stop_sleep
+#define vTaskDelay breezy_stop_vTaskDelay
+
+static const breezy_abi_t s_abi = {
+    .magic = BREEZY_ABI_MAGIC,
+    .major = BREEZY_ABI_MAJOR,
+    .count = BREEZY_ABI_COUNT,
+    .fn = {
+#define BREEZY_ABI_SLOT(name) (const void *)&name,
+#define BREEZY_ABI_OPT(name) (const void *)&name,
+#include "breezy_abi_slots.h"
+#undef BREEZY_ABI_SLOT
+#undef BREEZY_ABI_OPT
+    },
+};
+
+#undef malloc
+#undef calloc
+#undef realloc
+#undef free
+#undef printf
+#undef fprintf
+#undef vprintf
+#undef vfprintf
+#undef puts
+#undef fputs
+#undef fputc
+#undef fgets
+#undef fgetc
+#undef fread
+#undef fwrite
+#undef fflush
+#undef fopen
+#undef fdopen
+#undef freopen
+#undef fclose
+#undef open
+#undef read
+#undef write
+#undef close
+#undef usleep
+#undef sleep
+#undef vTaskDelay
+
+const breezy_abi_t *breezy_abi_find(const char *name)
+{
+    static const char prefix[] = "breezy_abi_v";
+    if (strncmp(name, prefix, sizeof(prefix) - 1) != 0) return NULL;
+
+    char *end;
+    unsigned long major = strtoul(name + sizeof(prefix) - 1, &end, 10);
+    if (*end != '_') return NULL;
+    unsigned long level = strtoul(end + 1, &end, 10);
+    if (*end != '\0') return NULL;
+
+    if (major != BREEZY_ABI_MAJOR || level > BREEZY_ABI_COUNT) {
+        ESP_LOGE(TAG, "App needs ABI v%lu level %lu, firmware has v%d level %d",
+                 major, level, BREEZY_ABI_MAJOR, BREEZY_ABI_COUNT);
+        return NULL;
+    }
+    return &s_abi;
+}
@@ -0,0 +1,465 @@
+/*
+ * breezy_appfs.c - App store in a raw flash partition
+ *
+ * Layout of the "apps" partition:
+ *   sector 0, 1   Two copies of the index; the valid one with the higher
+ *                 sequence number wins, so a torn index write is survivable
+ *   sector 2...   Images, each starting on a sector boundary, in index order
+ *
+ * Images are appended after the last one. Removing or replacing a program
+ * leaves a gap, which is squeezed out (images moved down) before the next
+ * install, as long as nothing is mapped at that moment. An image is only
+ * ever copied into free space and the index committed before its old copy
+ * counts as free, so a reset mid-move loses nothing. Index changes are
+ * made in a copy that replaces the live index only once it is on flash, so
+ * a failed write leaves RAM matching the newest good copy.
+ *
+ * Note on execute-in-place: elf_loader patches relocations into .text
+ * (Xtensa literal pools, RISC-V GOT-relative code), so .text can't stay in
+ * read-only flash. What we do save is the whole-file RAM buffer: the
+ * loader relocates straight out of memory-mapped flash.
+ */
+
+#include "breezy_appfs.h"
+#include "breezy_cmdtab.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "zlib.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define APPFS_PARTITION     "apps"
+#define APPFS_SUBTYPE       0x40
+#define APPFS_MAGIC         0x53505041  // "APPS"
+#define APPFS_SECTOR        4096
+#define APPFS_DATA_START    (2 * APPFS_SECTOR)
+#define APPFS_MAX_ENTRIES   100
+
+static const char *TAG = "appfs";
+
+typedef struct {
+    char name[BREEZY_APPFS_NAME_LEN];
+    uint32_t offset;            // From partition start, sector aligned
+    uint32_t size;
+    uint32_t gen;               // Index sequence number at install time
+} appfs_entry_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t count;
+    uint32_t crc;               // Over entries[0..count)
+    appfs_entry_t entries[APPFS_MAX_ENTRIES];
+} appfs_index_t;
+
+_Static_assert(sizeof(appfs_index_t) <= APPFS_SECTOR, "appfs index must fit one sector");
+
+struct breezy_appfs_writer {
+    char name[BREEZY_APPFS_NAME_LEN];
+    uint32_t start;             // Partition offset of the image
+    uint32_t len;               // Bytes written so far
+    uint32_t erased;            // Bytes from start that are erased
+};
+
+static const esp_partition_t *s_part = NULL;
+static appfs_index_t *s_index = NULL;
+static SemaphoreHandle_t s_lock = NULL;
+static int s_maps = 0;          // Live mappings; images can't move while > 0
+static bool s_writing = false;
+
+static uint32_t sector_align(uint32_t n)
+{
+    return (n + APPFS_SECTOR - 1) & ~(uint32_t)(APPFS_SECTOR - 1);
+}
+
+static uint32_t index_crc(const appfs_index_t *idx)
+{
+    return crc32(0, (const Bytef *)idx->entries, idx->count * sizeof(appfs_entry_t));
+}
+
+static bool index_valid(const appfs_index_t *idx)
+{
+    return idx->magic == APPFS_MAGIC &&
+           idx->count <= APPFS_MAX_ENTRIES &&
+           idx->crc == index_crc(idx);
+}
+
+// Copy of the live index to change and pass to index_commit(), or NULL
+static appfs_index_t *index_edit(void)
+{
+    appfs_index_t *next = malloc(sizeof(appfs_index_t));
+    if (next) {
+        memcpy(next, s_index, sizeof(appfs_index_t));
+    } else {
+        ESP_LOGE(TAG, "Out of memory");
+    }
+    return next;
+}
+
+// Write next to the older of the two copies, then make it the live index.
+// On failure the live index stays as it was, so RAM never gets ahead of
+// flash. Takes next. Call with the lock held.
+static int index_commit(appfs_index_t *next)
+{
+    next->seq = s_index->seq + 1;
+    next->crc = index_crc(next);
+
+    uint32_t sector = (next->seq & 1) * APPFS_SECTOR;
+    if (esp_partition_erase_range(s_part, sector, APPFS_SECTOR) != ESP_OK ||
+        esp_partition_write(s_part, sector, next, sizeof(appfs_index_t)) != ESP_OK) {
+        ESP_LOGE(TAG, "Index write failed");
+        free(next);
+        return -1;
+    }
+    free(s_index);
+    s_index = next;
+    return 0;
+}
+
+static appfs_entry_t *index_find(appfs_index_t *idx, const char *name)
+{
+    for (uint32_t i = 0; i < idx->count; i++) {
+        if (strncmp(idx->entries[i].name, name, BREEZY_APPFS_NAME_LEN) == 0) {
+            return &idx->entries[i];
+        }
+    }
+    return NULL;
+}
+
+static void index_delete(appfs_index_t *idx, appfs_entry_t *e)
+{
+    size_t i = e - idx->entries;
+    memmove(e, e + 1, (idx->count - i - 1) * sizeof(appfs_entry_t));
+    idx->count--;
+}
+
+// First free byte after the last image. Entries are in offset order, except
+// after a reset in the middle of compact(), so look at all of them.
+static uint32_t data_end(void)
+{
+    uint32_t end = APPFS_DATA_START;
+    for (uint32_t i = 0; i < s_index->count; i++) {
+        const appfs_entry_t *e = &s_index->entries[i];
+        uint32_t e_end = sector_align(e->offset + e->size);
+        if (e_end > end) end = e_end;
+    }
+    return end;
+}
+
+// Copy size bytes of image from src to dst, which must not overlap
+static bool copy_image(uint32_t src, uint32_t dst, uint32_t size, uint8_t *buf)
+{
+    for (uint32_t pos = 0; pos < size; pos += APPFS_SECTOR) {
+        uint32_t n = size - pos < APPFS_SECTOR ? size - pos : APPFS_SECTOR;
+        if (esp_partition_read(s_part, src + pos, buf, n) != ESP_OK ||
+            esp_partition_erase_range(s_part, dst + pos, APPFS_SECTOR) != ESP_OK ||
+            esp_partition_write(s_part, dst + pos, buf, n) != ESP_OK) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Copy entry i into free space at dst and commit the index. Until the
+// commit the index still points at the old copy; after it, the old sectors
+// are free (and erased when something is next written there).
+static bool move_image(uint32_t i, uint32_t dst, uint8_t *buf)
+{
+    const appfs_entry_t *e = &s_index->entries[i];
+    if (!copy_image(e->offset, dst, e->size, buf)) return false;
+
+    appfs_index_t *next = index_edit();
+    if (!next) return false;
+    next->entries[i].offset = dst;
+    return index_commit(next) == 0;
+}
+
+// Move images down over the gaps left by removed ones. Call with the lock
+// held and no live mappings. An image whose gap is smaller than itself
+// goes through the free space at the end of the store, so no copy ever
+// overwrites sectors the committed index still uses.
+static void compact(void)
+{
+    // Offset order; a reset mid-move can leave an image at the end
+    for (uint32_t i = 1; i < s_index->count; i++) {
+        appfs_entry_t e = s_index->entries[i];
+        uint32_t j = i;
+        for (; j > 0 && s_index->entries[j - 1].offset > e.offset; j--) {
+            s_index->entries[j] = s_index->entries[j - 1];
+        }
+        s_index->entries[j] = e;
+    }
+
+    uint8_t *buf = NULL;
+    uint32_t dest = APPFS_DATA_START;
+
+    for (uint32_t i = 0; i < s_index->count; i++) {
+        const appfs_entry_t *e = &s_index->entries[i];
+        uint32_t span = sector_align(e->size);
+        if (e->offset > dest) {
+            if (!buf && !(buf = malloc(APPFS_SECTOR))) return;
+
+            ESP_LOGI(TAG, "Moving %s: 0x%x -> 0x%x", e->name,
+                     (unsigned)e->offset, (unsigned)dest);
+            bool ok;
+            if (dest + span <= e->offset) {
+                ok = move_image(i, dest, buf);
+            } else if (data_end() + span <= s_part->size) {
+                ok = move_image(i, data_end(), buf) && move_image(i, dest, buf);
+            } else {
+                ESP_LOGW(TAG, "No room to move %s", e->name);
+                ok = true;
+            }
+            if (!ok) {
+                ESP_LOGE(TAG, "Compaction failed at %s", s_index->entries[i].name);
+                break;
+            }
+            e = &s_index->entries[i];   // A move replaces the index
+        }
+        dest = sector_align(e->offset + e->size);
+    }
+    free(buf);
+}
+
+esp_err_t breezy_appfs_init(void)
+{
+    if (s_part) return ESP_OK;
+
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                           APPFS_SUBTYPE, APPFS_PARTITION);
+    if (!part) return ESP_ERR_NOT_FOUND;
+
+    appfs_index_t *copies = malloc(2 * sizeof(appfs_index_t));
+    if (!copies) return ESP_ERR_NO_MEM;
+
+    int best = -1;
+    for (int i = 0; i < 2; i++) {
+        if (esp_partition_read(part, i * APPFS_SECTOR, &copies[i], sizeof(appfs_index_t)) == ESP_OK &&
+            index_valid(&copies[i]) &&
+            (best < 0 || copies[i].seq > copies[best].seq)) {
+            best = i;
+        }
+    }
+
+    s_index = malloc(sizeof(appfs_index_t));
+    s_lock = xSemaphoreCreateMutex();
+    if (!s_index || !s_lock) {
+        free(copies);
+        free(s_index);
+        s_index = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    s_part = part;
+    if (best >= 0) {
+        memcpy(s_index, &copies[best], sizeof(appfs_index_t));
+    } else {
+        // Blank or corrupt: start an empty store
+        memset(s_index, 0, sizeof(appfs_index_t));
+        s_index->magic = APPFS_MAGIC;
+        appfs_index_t *next = index_edit();
+        if (next) index_commit(next);
+    }
+    free(copies);
+
+    ESP_LOGI(TAG, "%u programs, %uK partition", (unsigned)s_index->count,
+             (unsigned)(s_part->size / 1024));
+    return ESP_OK;
+}
+
+bool breezy_appfs_available(void)
+{
+    return s_part != NULL;
+}
+
+const char *breezy_appfs_name(const char *path)
+{
+    size_t len = strlen(BREEZY_APPFS_PREFIX);
+    if (strncmp(path, BREEZY_APPFS_PREFIX, len) != 0) return NULL;
+    return path + len;
+}
+
+int breezy_appfs_stat(const char *name, size_t *size, uint32_t *gen)
+{
+    if (!s_part) return -1;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    appfs_entry_t *e = index_find(s_index, name);
+    if (e) {
+        if (size) *size = e->size;
+        if (gen) *gen = e->gen;
+    }
+    xSemaphoreGive(s_lock);
+    return e ? 0 : -1;
+}
+
+const void *breezy_appfs_mmap(const char *name, size_t *size,
+                              esp_partition_mmap_handle_t *handle)
+{
+    if (!s_part) return NULL;
+
+    const void *ptr = NULL;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    appfs_entry_t *e = index_find(s_index, name);
+    if (e && esp_partition_mmap(s_part, e->offset, e->size, ESP_PARTITION_MMAP_DATA,
+                                &ptr, handle) == ESP_OK) {
+        if (size) *size = e->size;
+        s_maps++;
+    } else {
+        ptr = NULL;
+    }
+    xSemaphoreGive(s_lock);
+    return ptr;
+}
+
+void breezy_appfs_munmap(esp_partition_mmap_handle_t handle)
+{
+    esp_partition_munmap(handle);
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_maps--;
+    xSemaphoreGive(s_lock);
+}
+
+size_t breezy_appfs_list(breezy_appfs_info_t *out, size_t max)
+{
+    if (!s_part) return 0;
+
+    size_t n = 0;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (uint32_t i = 0; i < s_index->count && n < max; i++, n++) {
+        memcpy(out[n].name, s_index->entries[i].name, BREEZY_APPFS_NAME_LEN);
+        out[n].size = s_index->entries[i].size;
+    }
+    xSemaphoreGive(s_lock);
+    return n;
+}
+
+void breezy_appfs_usage(size_t *used, size_t *total)
+{
+    size_t u = 0, t = 0;
+    if (s_part) {
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        for (uint32_t i = 0; i < s_index->count; i++) {
+            u += sector_align(s_index->entries[i].size);
+        }
+        t = s_part->size - APPFS_DATA_START;
+        xSemaphoreGive(s_lock);
+    }
+    if (used) *used = u;
+    if (total) *total = t;
+}
+
+int breezy_appfs_remove(const char *name)
+{
+    if (!s_part) return -1;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int ret = -1;
+    if (index_find(s_index, name)) {
+        appfs_index_t *next = index_edit();
+        if (next) {
+            index_delete(next, index_find(next, name));
+            ret = index_commit(next);
+        }
+    }
+    xSemaphoreGive(s_lock);
+    if (ret == 0) breezy_cmdtab_invalidate(NULL);
+    return ret;
+}
+
+// ============ Install ============
+
+breezy_appfs_writer_t *breezy_appfs_begin(const char *name)
+{
+    if (!s_part || !name[0] || strchr(name, '/') ||
+        strlen(name) >= BREEZY_APPFS_NAME_LEN) {
+        return NULL;
+    }
+
+    breezy_appfs_writer_t *w = calloc(1, sizeof(breezy_appfs_writer_t));
+    if (!w) return NULL;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_writing) {
+        xSemaphoreGive(s_lock);
+        free(w);
+        return NULL;
+    }
+    if (s_maps == 0) compact();
+    s_writing = true;
+    w->start = data_end();
+    xSemaphoreGive(s_lock);
+
+    strcpy(w->name, name);
+    return w;
+}
+
+int breezy_appfs_write(breezy_appfs_writer_t *w, const void *data, size_t len)
+{
+    if (w->start + w->len + len > s_part->size) {
+        ESP_LOGE(TAG, "Store full");
+        return -1;
+    }
+
+    // Erase ahead of the write position one sector at a time
+    while (w->erased < w->len + len) {
+        if (esp_partition_erase_range(s_part, w->start + w->erased, APPFS_SECTOR) != ESP_OK) {
+            return -1;
+        }
+        w->erased += APPFS_SECTOR;
+    }
+
+    if (esp_partition_write(s_part, w->start + w->len, data, len) != ESP_OK) {
+        return -1;
+    }
+    w->len += len;
+    return 0;
+}
+
+int breezy_appfs_commit(breezy_appfs_writer_t *w)
+{
+    static const uint8_t elf_magic[4] = {0x7f, 'E', 'L', 'F'};
+    uint8_t magic[4] = {0};
+    int ret = -1;
+
+    if (w->len >= sizeof(magic)) {
+        esp_partition_read(s_part, w->start, magic, sizeof(magic));
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (memcmp(magic, elf_magic, sizeof(magic)) != 0) {
+        ESP_LOGE(TAG, "%s: not an ELF file", w->name);
+    } else if (!index_find(s_index, w->name) && s_index->count >= APPFS_MAX_ENTRIES) {
+        ESP_LOGE(TAG, "Index full");
+    } else {
+        // The old entry goes in the same commit that adds the new one
+        appfs_index_t *next = index_edit();
+        if (next) {
+            appfs_entry_t *old = index_find(next, w->name);
+            if (old) index_delete(next, old);
+
+            appfs_entry_t *e = &next->entries[next->count++];
+            memset(e, 0, sizeof(*e));
+            strcpy(e->name, w->name);
+            e->offset = w->start;
+            e->size = w->len;
+            e->gen = s_index->seq + 1;
+            ret = index_commit(next);
+        }
+    }
+    s_writing = false;
+    xSemaphoreGive(s_lock);
+
+    if (ret == 0) breezy_cmdtab_invalidate(NULL);
+    free(w);
+    return ret;
+}
+
+void breezy_appfs_abort(breezy_appfs_writer_t *w)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_writing = false;
+    xSemaphoreGive(s_lock);
+    free(w);
+}
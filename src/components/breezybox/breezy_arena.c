@@ -0,0 +1,407 @@
+/*
+ * breezy_arena.c - Per-app heap arenas
+ *
+ * An arena is a list of large chunks taken from the system heap. Requests
+ * are rounded up to a size class (16-byte steps up to 256, then powers of
+ * two up to a quarter chunk) and carved off the newest chunk; freed blocks
+ * go on a per-class free list for reuse. Anything bigger gets its own
+ * system allocation, still owned by the arena. Teardown frees the chunks,
+ * so nothing an app allocates outlives it and the system heap only ever
+ * sees a handful of same-sized chunks come and go.
+ *
+ * Every block starts with a header naming its arena, so free() goes
+ * straight to the one arena that can own it, and then checks that the
+ * pointer lies in one of that arena's chunks or big blocks before trusting
+ * the header. Pointers that an app frees but did not get from an arena
+ * (e.g. from libc's strdup, which uses the system malloc) fail one of the
+ * checks and are passed on to free().
+ */
+
+#include "breezy_arena.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef CONFIG_BREEZYBOX_ELF_ARENA_CHUNK_KB
+#define ARENA_CHUNK_SIZE (CONFIG_BREEZYBOX_ELF_ARENA_CHUNK_KB * 1024)
+#else
+#define ARENA_CHUNK_SIZE (32 * 1024)
+#endif
+
+#if defined(CONFIG_BREEZYBOX_ELF_ARENA_INTERNAL)
+#define ARENA_CAPS (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+#else
+#define ARENA_CAPS (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+#endif
+
+#define ARENA_MAX_ACTIVE    8           // Apps running at once
+#define ARENA_ALIGN         8
+#define ARENA_SMALL_MAX     256
+#define ARENA_CLASS_MAX     (ARENA_CHUNK_SIZE / 4)
+#define ARENA_NUM_CLASSES   32
+#define BLOCK_MAGIC         0x41524e41  // "ARNA"
+#define BIG_MAGIC           0x41524e42  // "ARNB"
+
+static const char *TAG = "arena";
+
+typedef struct {
+    struct breezy_arena *owner;
+    uint32_t cap;               // Usable bytes (the size class, or the size)
+    uint32_t magic;             // BLOCK_MAGIC, or BIG_MAGIC after a big_t
+} __attribute__((aligned(ARENA_ALIGN))) block_hdr_t;
+
+typedef struct chunk {
+    struct chunk *next;
+    uint8_t *top;               // Next free byte
+    uint8_t *end;
+} __attribute__((aligned(ARENA_ALIGN))) chunk_t;
+
+typedef struct big {
+    struct big *next;
+    struct big *prev;
+} __attribute__((aligned(ARENA_ALIGN))) big_t;
+
+#define BIG_OVERHEAD (sizeof(big_t) + sizeof(block_hdr_t))
+
+struct breezy_arena {
+    TaskHandle_t task;
+    portMUX_TYPE lock;
+    chunk_t *chunks;            // Newest first; blocks are carved from it
+    big_t *bigs;
+    void *free_lists[ARENA_NUM_CLASSES];
+    size_t reserved;
+    breezy_arena_stats_t stats;
+};
+
+static breezy_arena_t *s_active[ARENA_MAX_ACTIVE];
+static portMUX_TYPE s_active_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// ============ Lookup ============
+
+static breezy_arena_t *current_arena(void)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    breezy_arena_t *found = NULL;
+
+    portENTER_CRITICAL(&s_active_lock);
+    for (int i = 0; i < ARENA_MAX_ACTIVE; i++) {
+        if (s_active[i] && s_active[i]->task == self) {
+            found = s_active[i];
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_active_lock);
+    return found;
+}
+
+// Whether ptr is inside memory a holds: a block's payload in one of its
+// chunks, or one of its big blocks. Chunks and big blocks are few (each is
+// at least a quarter chunk), so the walk is short.
+static bool arena_owns(breezy_arena_t *a, const void *ptr)
+{
+    const uint8_t *p = ptr;
+    bool found = false;
+
+    portENTER_CRITICAL(&a->lock);
+    for (chunk_t *c = a->chunks; c && !found; c = c->next) {
+        found = p >= (const uint8_t *)(c + 1) + sizeof(block_hdr_t) && p < c->top;
+    }
+    for (big_t *b = a->bigs; b && !found; b = b->next) {
+        found = p == (const uint8_t *)((block_hdr_t *)(b + 1) + 1);
+    }
+    portEXIT_CRITICAL(&a->lock);
+    return found;
+}
+
+// Arena a pointer came from, if it came from one still running. A system
+// heap pointer also has a block header in front, so the read is safe; if
+// its bytes happen to look like ours, arena_owns() still says no.
+static breezy_arena_t *owner_of(const void *ptr)
+{
+    const block_hdr_t *h = (const block_hdr_t *)ptr - 1;
+    if (h->magic != BLOCK_MAGIC && h->magic != BIG_MAGIC) return NULL;
+
+    // Held until the check is done, so the arena can't end meanwhile
+    breezy_arena_t *found = NULL;
+    portENTER_CRITICAL(&s_active_lock);
+    for (int i = 0; i < ARENA_MAX_ACTIVE; i++) {
+        if (s_active[i] && s_active[i] == h->owner) {
+            if (arena_owns(s_active[i], ptr)) found = s_active[i];
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_active_lock);
+    return found;
+}
+
+// ============ Allocation ============
+
+// Size class index for a request, and its capacity. -1 if too big for a class.
+static int size_class(size_t size, uint32_t *cap)
+{
+    if (size <= ARENA_SMALL_MAX) {
+        int c = size ? (int)((size + 15) / 16) : 1;
+        *cap = c * 16;
+        return c - 1;
+    }
+
+    uint32_t n = ARENA_SMALL_MAX * 2;
+    int c = ARENA_SMALL_MAX / 16;
+    while (n < size) {
+        n <<= 1;
+        c++;
+    }
+    if (n > ARENA_CLASS_MAX || c >= ARENA_NUM_CLASSES) return -1;
+    *cap = n;
+    return c;
+}
+
+static void *system_alloc(size_t size)
+{
+    void *p = heap_caps_aligned_alloc(ARENA_ALIGN, size, ARENA_CAPS);
+    if (!p) p = heap_caps_aligned_alloc(ARENA_ALIGN, size, MALLOC_CAP_8BIT);
+    return p;
+}
+
+// Call with the arena lock held
+static void account_alloc(breezy_arena_t *a, size_t size)
+{
+    a->stats.allocs++;
+    a->stats.bytes += size;
+    a->stats.in_use += size;
+    if (a->stats.in_use > a->stats.peak) a->stats.peak = a->stats.in_use;
+    if (a->reserved > a->stats.reserved) a->stats.reserved = a->reserved;
+}
+
+// Try to serve a class from the free list or the newest chunk
+static block_hdr_t *class_take(breezy_arena_t *a, int c, uint32_t cap)
+{
+    block_hdr_t *h = NULL;
+
+    portENTER_CRITICAL(&a->lock);
+    if (a->free_lists[c]) {
+        void *p = a->free_lists[c];
+        a->free_lists[c] = *(void **)p;
+        h = (block_hdr_t *)p - 1;
+    } else if (a->chunks && a->chunks->top + sizeof(block_hdr_t) + cap <= a->chunks->end) {
+        h = (block_hdr_t *)a->chunks->top;
+        a->chunks->top += sizeof(block_hdr_t) + cap;
+        h->owner = a;
+        h->cap = cap;
+        h->magic = BLOCK_MAGIC;
+    }
+    if (h) account_alloc(a, cap);
+    portEXIT_CRITICAL(&a->lock);
+    return h;
+}
+
+static void *arena_alloc(breezy_arena_t *a, size_t size)
+{
+    uint32_t cap;
+    int c = size_class(size, &cap);
+
+    if (c < 0) {
+        // Too big for a class: a system allocation the arena keeps track of
+        if (size > UINT32_MAX - BIG_OVERHEAD) return NULL;
+        big_t *b = system_alloc(BIG_OVERHEAD + size);
+        if (!b) return NULL;
+        b->prev = NULL;
+        block_hdr_t *h = (block_hdr_t *)(b + 1);
+        h->owner = a;
+        h->cap = size;
+        h->magic = BIG_MAGIC;
+
+        portENTER_CRITICAL(&a->lock);
+        b->next = a->bigs;
+        if (a->bigs) a->bigs->prev = b;
+        a->bigs = b;
+        a->reserved += BIG_OVERHEAD + size;
+        account_alloc(a, size);
+        portEXIT_CRITICAL(&a->lock);
+        return h + 1;
+    }
+
+    block_hdr_t *h = class_take(a, c, cap);
+    if (!h) {
+        // Newest chunk is full: start another
+        chunk_t *chunk = system_alloc(ARENA_CHUNK_SIZE);
+        if (!chunk) return NULL;
+        chunk->top = (uint8_t *)(chunk + 1);
+        chunk->end = (uint8_t *)chunk + ARENA_CHUNK_SIZE;
+
+        portENTER_CRITICAL(&a->lock);
+        chunk->next = a->chunks;
+        a->chunks = chunk;
+        a->reserved += ARENA_CHUNK_SIZE;
+        portEXIT_CRITICAL(&a->lock);
+
+        h = class_take(a, c, cap);
+        if (!h) return NULL;
+    }
+    return h + 1;
+}
+
+static void arena_release(breezy_arena_t *a, void *ptr)
+{
+    block_hdr_t *h = (block_hdr_t *)ptr - 1;
+    if (h->magic == BIG_MAGIC) {
+        big_t *b = (big_t *)h - 1;
+
+        portENTER_CRITICAL(&a->lock);
+        if (b->prev) b->prev->next = b->next;
+        else a->bigs = b->next;
+        if (b->next) b->next->prev = b->prev;
+        a->reserved -= BIG_OVERHEAD + h->cap;
+        a->stats.in_use -= h->cap;
+        portEXIT_CRITICAL(&a->lock);
+
+        heap_caps_free(b);
+        return;
+    }
+
+    uint32_t cap;
+    int c = size_class(h->cap, &cap);
+    if (h->magic != BLOCK_MAGIC || c < 0) {
+        ESP_LOGE(TAG, "Bad free %p", ptr);
+        return;
+    }
+
+    portENTER_CRITICAL(&a->lock);
+    *(void **)ptr = a->free_lists[c];
+    a->free_lists[c] = ptr;
+    a->stats.in_use -= h->cap;
+    portEXIT_CRITICAL(&a->lock);
+}
+
+// Usable size of an arena block
+static size_t arena_block_size(void *ptr)
+{
+    return ((block_hdr_t *)ptr - 1)->cap;
+}
+
+// ============ Allocator Entry Points ============
+
+void *breezy_arena_malloc(size_t size)
+{
+    breezy_arena_t *a = current_arena();
+    return a ? arena_alloc(a, size) : malloc(size);
+}
+
+void *breezy_arena_calloc(size_t n, size_t size)
+{
+    breezy_arena_t *a = current_arena();
+    if (!a) return calloc(n, size);
+
+    size_t total;
+    if (__builtin_mul_overflow(n, size, &total)) return NULL;
+    void *p = arena_alloc(a, total);
+    if (p) memset(p, 0, total);
+    return p;
+}
+
+void *breezy_arena_realloc(void *ptr, size_t size)
+{
+    if (!ptr) return breezy_arena_malloc(size);
+
+    breezy_arena_t *a = owner_of(ptr);
+    if (!a) return realloc(ptr, size);
+
+    if (size == 0) {
+        arena_release(a, ptr);
+        return NULL;
+    }
+
+    size_t old = arena_block_size(ptr);
+    if (size <= old && old - size < ARENA_CHUNK_SIZE / 4) return ptr;
+
+    void *p = arena_alloc(a, size);
+    if (!p) return NULL;
+    memcpy(p, ptr, old < size ? old : size);
+    arena_release(a, ptr);
+    return p;
+}
+
+void breezy_arena_free(void *ptr)
+{
+    if (!ptr) return;
+
+    breezy_arena_t *a = owner_of(ptr);
+    if (a) {
+        arena_release(a, ptr);
+    } else {
+        free(ptr);
+    }
+}
+
+void *breezy_arena_symbol(const char *name)
+{
+#ifndef CONFIG_BREEZYBOX_ELF_ARENA_NONE
+    if (strcmp(name, "malloc") == 0) return (void *)breezy_arena_malloc;
+    if (strcmp(name, "calloc") == 0) return (void *)breezy_arena_calloc;
+    if (strcmp(name, "realloc") == 0) return (void *)breezy_arena_realloc;
+    if (strcmp(name, "free") == 0) return (void *)breezy_arena_free;
+#endif
+    return NULL;
+}
+
+// ============ Lifetime ============
+
+breezy_arena_t *breezy_arena_begin(void)
+{
+#ifdef CONFIG_BREEZYBOX_ELF_ARENA_NONE
+    return NULL;
+#else
+    breezy_arena_t *a = heap_caps_calloc(1, sizeof(breezy_arena_t), MALLOC_CAP_INTERNAL);
+    if (!a) return NULL;
+
+    a->task = xTaskGetCurrentTaskHandle();
+    portMUX_INITIALIZE(&a->lock);
+
+    bool registered = false;
+    portENTER_CRITICAL(&s_active_lock);
+    for (int i = 0; i < ARENA_MAX_ACTIVE; i++) {
+        if (!s_active[i]) {
+            s_active[i] = a;
+            registered = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_active_lock);
+
+    if (!registered) {
+        // Too many apps at once; this one uses the system heap
+        heap_caps_free(a);
+        return NULL;
+    }
+    return a;
+#endif
+}
+
+void breezy_arena_end(breezy_arena_t *a, breezy_arena_stats_t *stats)
+{
+    if (!a) return;
+
+    portENTER_CRITICAL(&s_active_lock);
+    for (int i = 0; i < ARENA_MAX_ACTIVE; i++) {
+        if (s_active[i] == a) s_active[i] = NULL;
+    }
+    portEXIT_CRITICAL(&s_active_lock);
+
+    while (a->chunks) {
+        chunk_t *c = a->chunks;
+        a->chunks = c->next;
+        heap_caps_free(c);
+    }
+    while (a->bigs) {
+        big_t *b = a->bigs;
+        a->bigs = b->next;
+        heap_caps_free(b);
+    }
+
+    if (stats) *stats = a->stats;
+    heap_caps_free(a);
+}
@@ -0,0 +1,453 @@
+/*
+ * breezy_bcache.c - Sector cache and write-behind for the LittleFS partition
+ *
+ * LittleFS reads and programs in small units (CONFIG_LITTLEFS_READ_SIZE,
+ * usually 128 bytes), and every esp_partition_* call is a flash access
+ * with its own setup cost. The partition calls are wrapped (-Wl,-wrap) and,
+ * for the one cached partition, served from whole sectors in PSRAM.
+ *
+ * Writes and single-sector erases are applied to the cached sectors and
+ * queued in order; a flush replays the queue, writing each range from its
+ * cached sector. A sector with queued changes stays cached until then, so
+ * reads always see the latest data. A write only merges into the queue
+ * entry before it when it continues it, and anything that would need a
+ * different order (a second write to the same bytes, an erase under a
+ * queued write) flushes first.
+ */
+
+#include "breezy_bcache.h"
+#include "esp_partition.h"
+#include "esp_heap_caps.h"
+#include "esp_system.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef CONFIG_BREEZYBOX_FS_CACHE_KB
+#define CACHE_KB        CONFIG_BREEZYBOX_FS_CACHE_KB
+#define READAHEAD       CONFIG_BREEZYBOX_FS_CACHE_READAHEAD
+#define DIRTY_KB        CONFIG_BREEZYBOX_FS_CACHE_DIRTY_KB
+#define FLUSH_MS        CONFIG_BREEZYBOX_FS_CACHE_FLUSH_MS
+#else
+#define CACHE_KB        128
+#define READAHEAD       4
+#define DIRTY_KB        32
+#define FLUSH_MS        500
+#endif
+
+#define SECTOR          BREEZY_BCACHE_SECTOR
+#define NO_SECTOR       UINT32_MAX
+#define QUEUE_MAX       64
+#define FLUSHER_STACK   3072
+
+static const char *TAG = "bcache";
+
+typedef struct {
+    uint32_t sector;            // NO_SECTOR if the slot is free
+    uint32_t used;              // LRU stamp
+    bool dirty;                 // Queued changes; not evictable
+} slot_t;
+
+typedef struct {
+    uint32_t off;
+    uint32_t len;
+    bool erase;
+} queued_t;
+
+static const esp_partition_t *s_part = NULL;
+static slot_t *s_slots = NULL;
+static uint8_t *s_data = NULL;          // One sector per slot
+static uint8_t *s_ahead = NULL;         // Read-ahead landing area
+static uint32_t s_nslots = 0;
+static uint32_t s_readahead = 1;
+static uint32_t s_dirty_max = 1;
+static uint32_t s_clock = 0;
+static uint32_t s_last = NO_SECTOR;     // Last sector read
+static queued_t s_queue[QUEUE_MAX];
+static int s_queued = 0;
+static bool s_failed = false;           // A flush failed since the last sync
+static breezy_bcache_stats_t s_stats;
+static SemaphoreHandle_t s_lock = NULL;
+static TaskHandle_t s_flusher = NULL;
+
+#define LOCK()   xSemaphoreTake(s_lock, portMAX_DELAY)
+#define UNLOCK() xSemaphoreGive(s_lock)
+
+esp_err_t __real_esp_partition_read(const esp_partition_t *part, size_t off, void *dst, size_t size);
+esp_err_t __real_esp_partition_write(const esp_partition_t *part, size_t off, const void *src, size_t size);
+esp_err_t __real_esp_partition_erase_range(const esp_partition_t *part, size_t off, size_t size);
+int __real_fsync(int fd);
+
+static bool is_cached(const esp_partition_t *part)
+{
+    return s_part && part && part->address == s_part->address &&
+           part->flash_chip == s_part->flash_chip;
+}
+
+static inline uint8_t *slot_data(int k)
+{
+    return s_data + (size_t)k * SECTOR;
+}
+
+// ============ Slots ============
+
+static int find_slot(uint32_t sector)
+{
+    for (uint32_t i = 0; i < s_nslots; i++) {
+        if (s_slots[i].sector == sector) return i;
+    }
+    return -1;
+}
+
+static void mark_dirty(int k)
+{
+    if (!s_slots[k].dirty) {
+        s_slots[k].dirty = true;
+        s_stats.dirty++;
+    }
+}
+
+static void flush(void)
+{
+    if (s_queued == 0) return;
+
+    for (int i = 0; i < s_queued; i++) {
+        const queued_t *q = &s_queue[i];
+        if (q->erase) {
+            if (__real_esp_partition_erase_range(s_part, q->off, q->len) != ESP_OK) {
+                s_failed = true;
+                s_stats.errors++;
+            }
+            continue;
+        }
+
+        // Write each sector's part from the cached copy
+        uint32_t off = q->off, end = q->off + q->len;
+        while (off < end) {
+            uint32_t sector = off / SECTOR;
+            uint32_t n = (sector + 1) * SECTOR < end ? (sector + 1) * SECTOR - off : end - off;
+            int k = find_slot(sector);
+            if (k < 0 || __real_esp_partition_write(s_part, off, slot_data(k) + off % SECTOR, n) != ESP_OK) {
+                s_failed = true;
+                s_stats.errors++;
+            }
+            s_stats.flash_writes++;
+            s_stats.flushed_bytes += n;
+            off += n;
+        }
+    }
+    s_queued = 0;
+
+    for (uint32_t i = 0; i < s_nslots; i++) s_slots[i].dirty = false;
+    s_stats.dirty = 0;
+    s_stats.flushes++;
+}
+
+// Least recently used clean slot, flushing if every slot is dirty
+static int take_slot(uint32_t sector)
+{
+    int victim = -1;
+    for (uint32_t i = 0; i < s_nslots; i++) {
+        if (s_slots[i].sector == NO_SECTOR) {
+            victim = i;
+            break;
+        }
+        if (!s_slots[i].dirty && (victim < 0 || s_slots[i].used < s_slots[victim].used)) {
+            victim = i;
+        }
+    }
+    if (victim < 0) {
+        flush();
+        return take_slot(sector);
+    }
+    s_slots[victim].sector = sector;
+    s_slots[victim].dirty = false;
+    s_slots[victim].used = ++s_clock;
+    return victim;
+}
+
+// Read a missing sector. Right after the sector before it, read up to
+// s_readahead sectors in one access.
+static esp_err_t load(uint32_t sector, bool ahead, int *slot)
+{
+    uint32_t total = s_part->size / SECTOR;
+    uint32_t n = 1;
+    if (ahead && sector == s_last + 1) {
+        while (n < s_readahead && sector + n < total && find_slot(sector + n) < 0) n++;
+    }
+
+    if (n == 1) {
+        int k = take_slot(sector);
+        esp_err_t err = __real_esp_partition_read(s_part, sector * SECTOR, slot_data(k), SECTOR);
+        if (err != ESP_OK) {
+            s_slots[k].sector = NO_SECTOR;
+            return err;
+        }
+        s_stats.misses++;
+        *slot = k;
+        return ESP_OK;
+    }
+
+    esp_err_t err = __real_esp_partition_read(s_part, sector * SECTOR, s_ahead, n * SECTOR);
+    if (err != ESP_OK) return err;
+
+    // Last first, so the sector asked for has the newest stamp
+    for (uint32_t i = n; i-- > 0;) {
+        int k = take_slot(sector + i);
+        memcpy(slot_data(k), s_ahead + i * SECTOR, SECTOR);
+        if (i == 0) *slot = k;
+    }
+    s_stats.misses++;
+    s_stats.readahead += n - 1;
+    return ESP_OK;
+}
+
+// ============ Queue ============
+
+static bool queued_write_overlaps(uint32_t off, uint32_t len)
+{
+    for (int i = 0; i < s_queued; i++) {
+        const queued_t *q = &s_queue[i];
+        if (!q->erase && q->off < off + len && off < q->off + q->len) return true;
+    }
+    return false;
+}
+
+static void enqueue(uint32_t off, uint32_t len, bool erase)
+{
+    queued_t *last = s_queued > 0 ? &s_queue[s_queued - 1] : NULL;
+    if (!erase && last && !last->erase && last->off + last->len == off) {
+        last->len += len;
+    } else {
+        s_queue[s_queued++] = (queued_t){ .off = off, .len = len, .erase = erase };
+    }
+
+    if (FLUSH_MS == 0 || s_stats.dirty > s_dirty_max || s_queued == QUEUE_MAX) {
+        flush();
+    } else if (s_queued == 1 && s_flusher) {
+        xTaskNotifyGive(s_flusher);
+    }
+}
+
+static void flusher_task(void *arg)
+{
+    (void)arg;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        vTaskDelay(pdMS_TO_TICKS(FLUSH_MS));
+        LOCK();
+        flush();
+        UNLOCK();
+    }
+}
+
+static void shutdown_flush(void)
+{
+    breezy_bcache_sync();
+}
+
+// ============ Partition Calls ============
+
+esp_err_t __wrap_esp_partition_read(const esp_partition_t *part, size_t off, void *dst, size_t size)
+{
+    if (!is_cached(part) || off + size > part->size) {
+        return __real_esp_partition_read(part, off, dst, size);
+    }
+
+    LOCK();
+    esp_err_t err = ESP_OK;
+    uint8_t *out = dst;
+    while (size > 0) {
+        uint32_t sector = off / SECTOR, at = off % SECTOR;
+        size_t n = size < SECTOR - at ? size : SECTOR - at;
+        int k = find_slot(sector);
+        if (k >= 0) {
+            s_stats.hits++;
+        } else if ((err = load(sector, true, &k)) != ESP_OK) {
+            break;
+        }
+        s_slots[k].used = ++s_clock;
+        memcpy(out, slot_data(k) + at, n);
+        s_last = sector;
+        out += n;
+        off += n;
+        size -= n;
+    }
+    UNLOCK();
+    return err;
+}
+
+esp_err_t __wrap_esp_partition_write(const esp_partition_t *part, size_t off, const void *src, size_t size)
+{
+    if (!is_cached(part) || size == 0 || off + size > part->size) {
+        return __real_esp_partition_write(part, off, src, size);
+    }
+
+    LOCK();
+    s_stats.writes++;
+    uint32_t sector = off / SECTOR, at = off % SECTOR;
+
+    // LittleFS never programs across a block (one sector); write such
+    // calls through, after everything queued
+    if (at + size > SECTOR) {
+        flush();
+        esp_err_t err = __real_esp_partition_write(part, off, src, size);
+        for (uint32_t s = sector; s * SECTOR < off + size; s++) {
+            int k = find_slot(s);
+            if (k >= 0) s_slots[k].sector = NO_SECTOR;
+        }
+        UNLOCK();
+        return err;
+    }
+
+    if (queued_write_overlaps(off, size) || s_queued == QUEUE_MAX) flush();
+
+    int k = find_slot(sector);
+    if (k < 0) {
+        if (size == SECTOR) {
+            // LittleFS only programs erased flash
+            k = take_slot(sector);
+            memset(slot_data(k), 0xFF, SECTOR);
+        } else {
+            esp_err_t err = load(sector, false, &k);
+            if (err != ESP_OK) {
+                UNLOCK();
+                return err;
+            }
+        }
+    }
+
+    // Programming only clears bits
+    uint8_t *d = slot_data(k) + at;
+    const uint8_t *in = src;
+    for (size_t i = 0; i < size; i++) d[i] &= in[i];
+    s_slots[k].used = ++s_clock;
+    mark_dirty(k);
+    enqueue(off, size, false);
+    UNLOCK();
+    return ESP_OK;
+}
+
+esp_err_t __wrap_esp_partition_erase_range(const esp_partition_t *part, size_t off, size_t size)
+{
+    if (!is_cached(part) || off % SECTOR != 0 || size % SECTOR != 0 || off + size > part->size) {
+        return __real_esp_partition_erase_range(part, off, size);
+    }
+
+    LOCK();
+    s_stats.erases++;
+    esp_err_t err = ESP_OK;
+
+    if (size == SECTOR) {
+        // LittleFS erases one block at a time and writes it next: keep it
+        // cached and queue the erase
+        if (queued_write_overlaps(off, size) || s_queued == QUEUE_MAX) flush();
+        int k = find_slot(off / SECTOR);
+        if (k < 0) k = take_slot(off / SECTOR);
+        memset(slot_data(k), 0xFF, SECTOR);
+        s_slots[k].used = ++s_clock;
+        mark_dirty(k);
+        enqueue(off, size, true);
+    } else {
+        // Formatting: straight through
+        flush();
+        err = __real_esp_partition_erase_range(part, off, size);
+        for (uint32_t i = 0; i < s_nslots; i++) {
+            uint32_t s = s_slots[i].sector;
+            if (s != NO_SECTOR && s * SECTOR >= off && s * SECTOR < off + size) {
+                s_slots[i].sector = NO_SECTOR;
+            }
+        }
+    }
+    UNLOCK();
+    return err;
+}
+
+// fsync() means on flash
+int __wrap_fsync(int fd)
+{
+    int ret = __real_fsync(fd);
+    if (ret == 0 && breezy_bcache_sync() != ESP_OK) {
+        errno = EIO;
+        return -1;
+    }
+    return ret;
+}
+
+// ============ Public API ============
+
+esp_err_t breezy_bcache_init(const char *label)
+{
+    if (s_part) return ESP_OK;
+
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                           ESP_PARTITION_SUBTYPE_ANY, label);
+    if (!part) return ESP_ERR_NOT_FOUND;
+
+    uint32_t n = CACHE_KB * 1024 / SECTOR;
+    if (n < 4) n = 4;
+    uint32_t ahead = READAHEAD < n / 2 ? READAHEAD : n / 2;
+
+    s_slots = calloc(n, sizeof(slot_t));
+    s_data = heap_caps_malloc((size_t)n * SECTOR, MALLOC_CAP_SPIRAM);
+    s_ahead = ahead > 1 ? heap_caps_malloc((size_t)ahead * SECTOR, MALLOC_CAP_SPIRAM) : NULL;
+    s_lock = xSemaphoreCreateMutex();
+    if (!s_slots || !s_data || (ahead > 1 && !s_ahead) || !s_lock) {
+        free(s_slots);
+        heap_caps_free(s_data);
+        heap_caps_free(s_ahead);
+        if (s_lock) vSemaphoreDelete(s_lock);
+        s_slots = NULL;
+        s_data = s_ahead = NULL;
+        s_lock = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (uint32_t i = 0; i < n; i++) s_slots[i].sector = NO_SECTOR;
+    s_nslots = n;
+    s_readahead = ahead > 1 ? ahead : 1;
+    s_dirty_max = DIRTY_KB * 1024 / SECTOR;
+    if (s_dirty_max > n / 2) s_dirty_max = n / 2;
+    if (s_dirty_max < 1) s_dirty_max = 1;
+
+    if (FLUSH_MS > 0) {
+        xTaskCreate(flusher_task, "bcache_flush", FLUSHER_STACK, NULL,
+                    tskIDLE_PRIORITY + 1, &s_flusher);
+    }
+    esp_register_shutdown_handler(shutdown_flush);
+
+    s_stats.enabled = true;
+    s_stats.sectors = n;
+    s_part = part;  // Last: the wraps cache from here on
+
+    ESP_LOGI(TAG, "%s: %u KB, read-ahead %u sectors, flush after %u ms",
+             label, (unsigned)(n * SECTOR / 1024), (unsigned)s_readahead, (unsigned)FLUSH_MS);
+    return ESP_OK;
+}
+
+esp_err_t breezy_bcache_sync(void)
+{
+    if (!s_part) return ESP_OK;
+
+    LOCK();
+    flush();
+    bool failed = s_failed;
+    s_failed = false;
+    UNLOCK();
+    return failed ? ESP_FAIL : ESP_OK;
+}
+
+void breezy_bcache_stats(breezy_bcache_stats_t *stats)
+{
+    if (!s_part) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    LOCK();
+    *stats = s_stats;
+    UNLOCK();
+}
@@ -0,0 +1,225 @@
+/*
+ * breezy_cmdtab.c - Hashed command table
+ *
+ * Two tables, both keyed by command name:
+ *
+ * Builtins. esp_console_run() parses into a single shared line buffer, so
+ * two tasks must never run commands through it at once. Pipeline stages
+ * run concurrently, so we keep our own name -> handler table and call
+ * handlers directly with a private argv. Builtins are looked up first and
+ * never touch the filesystem.
+ *
+ * External programs. Resolving a bare name costs a stat() per search
+ * directory plus an open() to check the ELF magic. Results, including
+ * "not found", are remembered until the filesystem wrappers report a
+ * change to that name in the CWD or /root/bin, or the CWD moves.
+ */
+
+#include "breezy_cmdtab.h"
+#include "breezy_exec.h"
+#include "breezy_elf.h"
+#include "breezy_vfs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define CMDTAB_BUCKETS      64
+#define PATH_CACHE_MAX      64
+
+typedef struct cmdtab_entry {
+    struct cmdtab_entry *next;
+    const char *name;
+    esp_console_cmd_func_t func;
+} cmdtab_entry_t;
+
+typedef struct path_entry {
+    struct path_entry *next;
+    char *path;                 // Absolute path of the ELF, NULL if none
+    char name[];
+} path_entry_t;
+
+static cmdtab_entry_t *s_builtins[CMDTAB_BUCKETS];
+
+static path_entry_t *s_paths[CMDTAB_BUCKETS];
+static size_t s_path_count = 0;
+static uint32_t s_path_gen = 0;  // Bumped by every invalidation
+static SemaphoreHandle_t s_path_lock = NULL;
+
+// FNV-1a
+static uint32_t name_hash(const char *s, size_t len)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (uint8_t)s[i]) * 16777619u;
+    }
+    return h % CMDTAB_BUCKETS;
+}
+
+void breezy_cmdtab_init(void)
+{
+    if (!s_path_lock) {
+        s_path_lock = xSemaphoreCreateMutex();
+    }
+}
+
+// ============ Builtins ============
+
+esp_err_t __real_esp_console_cmd_register(const esp_console_cmd_t *cmd);
+
+esp_err_t __wrap_esp_console_cmd_register(const esp_console_cmd_t *cmd)
+{
+    esp_err_t err = __real_esp_console_cmd_register(cmd);
+    if (err != ESP_OK || !cmd->func) return err;
+
+    uint32_t h = name_hash(cmd->command, strlen(cmd->command));
+
+    // Re-registration replaces the handler, same as esp_console
+    for (cmdtab_entry_t *e = s_builtins[h]; e; e = e->next) {
+        if (strcmp(e->name, cmd->command) == 0) {
+            e->func = cmd->func;
+            return ESP_OK;
+        }
+    }
+
+    cmdtab_entry_t *e = malloc(sizeof(cmdtab_entry_t));
+    if (!e) return ESP_OK;  // Still usable via esp_console_run()
+
+    // esp_console keeps a pointer to the name too; it must outlive us
+    e->name = cmd->command;
+    e->func = cmd->func;
+    e->next = s_builtins[h];
+    s_builtins[h] = e;
+    return ESP_OK;
+}
+
+esp_console_cmd_func_t breezy_cmdtab_find(const char *name)
+{
+    for (cmdtab_entry_t *e = s_builtins[name_hash(name, strlen(name))]; e; e = e->next) {
+        if (strcmp(e->name, name) == 0) {
+            return e->func;
+        }
+    }
+    return NULL;
+}
+
+// ============ External Programs ============
+
+static char *resolve_external(const char *name)
+{
+    char *path = breezybox_find_executable(name);
+    if (path && !breezy_elf_is_elf(path)) {
+        free(path);
+        path = NULL;
+    }
+    return path;
+}
+
+// Call with the lock held
+static void path_flush(void)
+{
+    for (int i = 0; i < CMDTAB_BUCKETS; i++) {
+        while (s_paths[i]) {
+            path_entry_t *e = s_paths[i];
+            s_paths[i] = e->next;
+            free(e->path);
+            free(e);
+        }
+    }
+    s_path_count = 0;
+}
+
+// Call with the lock held
+static void path_drop(const char *name, size_t len)
+{
+    for (path_entry_t **pp = &s_paths[name_hash(name, len)]; *pp; pp = &(*pp)->next) {
+        path_entry_t *e = *pp;
+        if (strncmp(e->name, name, len) == 0 && e->name[len] == '\0') {
+            *pp = e->next;
+            free(e->path);
+            free(e);
+            s_path_count--;
+            return;
+        }
+    }
+}
+
+char *breezy_cmdtab_find_external(const char *name)
+{
+    // Paths are not cached: they are already explicit, and ./foo
+    // depends on the CWD of the moment
+    if (strchr(name, '/') || !s_path_lock) {
+        return resolve_external(name);
+    }
+
+    size_t len = strlen(name);
+    uint32_t h = name_hash(name, len);
+
+    xSemaphoreTake(s_path_lock, portMAX_DELAY);
+    for (path_entry_t *e = s_paths[h]; e; e = e->next) {
+        if (strcmp(e->name, name) == 0) {
+            char *path = e->path ? strdup(e->path) : NULL;
+            xSemaphoreGive(s_path_lock);
+            return path;
+        }
+    }
+    uint32_t gen = s_path_gen;
+    xSemaphoreGive(s_path_lock);
+
+    // Search without the lock held; the fs wrappers take it to invalidate
+    char *path = resolve_external(name);
+
+    xSemaphoreTake(s_path_lock, portMAX_DELAY);
+    if (gen != s_path_gen) {
+        // Something changed while we searched; the answer may be stale
+        xSemaphoreGive(s_path_lock);
+        return path;
+    }
+    path_drop(name, len);  // Lost a race with another lookup
+    if (s_path_count >= PATH_CACHE_MAX) {
+        path_flush();
+    }
+    path_entry_t *e = malloc(sizeof(path_entry_t) + len + 1);
+    if (e) {
+        e->path = path ? strdup(path) : NULL;
+        if (path && !e->path) {
+            free(e);
+        } else {
+            memcpy(e->name, name, len + 1);
+            e->next = s_paths[h];
+            s_paths[h] = e;
+            s_path_count++;
+        }
+    }
+    xSemaphoreGive(s_path_lock);
+    return path;
+}
+
+void breezy_cmdtab_invalidate(const char *path)
+{
+    if (!s_path_lock) return;
+
+    xSemaphoreTake(s_path_lock, portMAX_DELAY);
+    s_path_gen++;
+    if (!path) {
+        path_flush();
+        xSemaphoreGive(s_path_lock);
+        return;
+    }
+
+    const char *cwd = breezybox_cwd();
+    const char *slash = strrchr(path, '/');
+    size_t dir_len = slash ? (size_t)(slash - path) : 0;
+
+    if (strcmp(path, BREEZYBOX_EXEC_PATH) == 0 || strcmp(path, cwd) == 0) {
+        // A search directory itself was created, removed or renamed
+        path_flush();
+    } else if (slash &&
+               ((strncmp(path, BREEZYBOX_EXEC_PATH, dir_len) == 0 &&
+                 BREEZYBOX_EXEC_PATH[dir_len] == '\0') ||
+                (strncmp(path, cwd, dir_len) == 0 && cwd[dir_len] == '\0') ||
+                (dir_len == 0 && strcmp(cwd, "/") == 0))) {
+        path_drop(slash + 1, strlen(slash + 1));
+    }
+    xSemaphoreGive(s_path_lock);
+}
@@ -0,0 +1,902 @@
+/*
+ * breezy_elf.c - Load and run ELF programs, with a resident image cache
+ *
+ * Loading an app reads the whole file from flash, then elf_loader
+ * allocates, copies and relocates its sections and resolves every
+ * undefined symbol by name. Scripts that call the same tool in a loop
+ * pay that on every call, so relocated images stay in an LRU cache keyed
+ * by path, size and mtime, within a PSRAM budget.
+ *
+ * A cached image is re-run by restoring .data from a snapshot taken right
+ * after relocation and zeroing .bss, which gives the program the same
+ * starting state as a fresh load. An image runs in one task at a time;
+ * a concurrent second run of the same path loads a private copy.
+ *
+ * Programs in the app store (BREEZY_APPFS_PREFIX paths) are relocated
+ * straight from memory-mapped flash instead of being read into RAM first.
+ *
+ * An app's BREEZY_APP_PLACE note moves its sections into internal RAM:
+ * elf_loader allocates them through esp_elf_malloc(), which is wrapped
+ * (-Wl,-wrap) to serve the relocation in progress from internal RAM.
+ *
+ * Each run gets its own task, with the stack size from the app's
+ * BREEZY_APP_STACK note (breezy_app.h) or CONFIG_BREEZYBOX_ELF_STACK_SIZE,
+ * and allocates from its own arena (breezy_arena.c), which is freed as a
+ * whole when main() returns or the run is killed. A kill is cooperative
+ * (breezy_stop.h): it breaks the run's pipes and the app unwinds at its
+ * next stdio, file or sleep call, through the same teardown as a return.
+ */
+
+#include "breezy_elf.h"
+#include "breezy_app.h"
+#include "breezy_appfs.h"
+#include "breezy_arena.h"
+#include "breezy_gz.h"
+#include "breezy_jobs.h"
+#include "breezy_log.h"
+#include "breezy_pipe.h"
+#include "breezy_profile.h"
+#include "breezy_stop.h"
+#include "esp_log.h"
+#include "esp_elf.h"
+#include "esp_heap_caps.h"
+#include "esp_memory_utils.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#ifdef CONFIG_BREEZYBOX_ELF_CACHE_KB
+#define ELF_CACHE_BUDGET (CONFIG_BREEZYBOX_ELF_CACHE_KB * 1024)
+#else
+#define ELF_CACHE_BUDGET (512 * 1024)
+#endif
+
+#ifdef CONFIG_BREEZYBOX_ELF_STACK_SIZE
+#define APP_STACK_SIZE CONFIG_BREEZYBOX_ELF_STACK_SIZE
+#else
+#define APP_STACK_SIZE 8192
+#endif
+
+#ifdef CONFIG_BREEZYBOX_ELF_CORE
+#define APP_CORE CONFIG_BREEZYBOX_ELF_CORE
+#else
+#define APP_CORE -1
+#endif
+
+#ifdef CONFIG_BREEZYBOX_JOB_CORE
+#define JOB_CORE CONFIG_BREEZYBOX_JOB_CORE
+#else
+#define JOB_CORE -1
+#endif
+
+#ifdef CONFIG_BREEZYBOX_ELF_PLACE
+#define PLACE_RESERVE (CONFIG_BREEZYBOX_ELF_PLACE_RESERVE_KB * 1024)
+#endif
+
+// On Xtensa targets elf_loader remaps code onto the instruction bus
+// itself, so code it did not allocate its own way would be mapped wrong
+#if defined(__riscv)
+#define PLACE_FLAGS (BREEZY_PLACE_TEXT | BREEZY_PLACE_DATA)
+#else
+#define PLACE_FLAGS BREEZY_PLACE_DATA
+#endif
+
+// Smallest stack a note may ask for
+#define APP_STACK_MIN 2048
+
+// Exit status of a killed run, like a shell's for SIGKILL
+#define APP_KILLED_STATUS (128 + 9)
+
+// ELF magic bytes
+static const uint8_t ELF_MAGIC[4] = {0x7f, 'E', 'L', 'F'};
+
+static const char *TAG = "elf";
+
+// breezy_exports.c
+uint32_t elf_get_cycle_count(void);
+
+// What an image's notes ask for
+typedef struct {
+    uint32_t stack;             // BREEZY_APP_STACK, 0 for the default
+    uint32_t place;             // BREEZY_APP_PLACE flags
+} image_hints_t;
+
+typedef struct elf_cache_entry {
+    struct elf_cache_entry *next;
+    char *path;
+    off_t size;                 // Key: file size and mtime at load time
+    time_t mtime;
+    esp_elf_t elf;
+    void *data_snapshot;        // Pristine .data, restored before each run
+    size_t mem_size;            // Bytes charged against the budget
+    size_t heap_peak;           // Largest arena use over all runs
+    uint32_t stack_size;        // From the app's note, 0 for the default
+    uint32_t hits;
+    bool pinned;
+    bool in_use;
+} elf_cache_entry_t;
+
+// Most recently used first
+static elf_cache_entry_t *s_cache = NULL;
+static size_t s_cache_used = 0;
+static SemaphoreHandle_t s_cache_lock = NULL;
+
+// One run of a program in its own task; lives on the waiting caller's stack
+typedef struct app_run {
+    struct app_run *next;
+    esp_elf_t *elf;
+    int argc;
+    char **argv;
+    FILE *in;                   // Caller's stdio, handed to the app task
+    FILE *out;
+    FILE *err;
+    int job;                    // Background job it belongs to, 0 if none
+    bool quiet;                 // Logs kept off the console, like its caller
+    TaskHandle_t task;
+    breezy_arena_t *arena;
+    int ret;
+    bool finished;              // Returned or unwound; done has been given
+    SemaphoreHandle_t done;
+    breezy_stop_t stop;         // Kill request, and files to close after
+} app_run_t;
+
+// Runs in progress, guarded by s_run_lock
+static app_run_t *s_runs = NULL;
+static SemaphoreHandle_t s_run_lock = NULL;
+
+// Placement for the relocation running in s_place_task. Relocations with
+// hints take turns under s_place_lock; the rest never look at these.
+static SemaphoreHandle_t s_place_lock = NULL;
+static TaskHandle_t s_place_task = NULL;
+static uint32_t s_place = 0;
+
+void breezy_elf_init(void)
+{
+    if (!s_cache_lock) {
+        s_cache_lock = xSemaphoreCreateMutex();
+    }
+    if (!s_run_lock) {
+        s_run_lock = xSemaphoreCreateMutex();
+    }
+    if (!s_place_lock) {
+        s_place_lock = xSemaphoreCreateMutex();
+    }
+}
+
+// stat() for cache keying. App store programs have no mtime; their
+// install generation stands in for it.
+static int image_stat(const char *path, struct stat *st)
+{
+    const char *app = breezy_appfs_name(path);
+    if (!app) return stat(path, st);
+
+    size_t size;
+    uint32_t gen;
+    if (breezy_appfs_stat(app, &size, &gen) != 0) return -1;
+
+    memset(st, 0, sizeof(*st));
+    st->st_size = size;
+    st->st_mtime = gen;
+    return 0;
+}
+
+int breezy_elf_is_elf(const char *path)
+{
+    // The store only accepts ELF images
+    const char *app = breezy_appfs_name(path);
+    if (app) return breezy_appfs_stat(app, NULL, NULL) == 0;
+
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
+
+    uint8_t magic[4];
+    size_t n = fread(magic, 1, 4, f);
+
+    // A gzipped program: look at the start of what it inflates to
+    if (breezy_gz_is_gzip(magic, n)) {
+        rewind(f);
+        n = breezy_gz_peek(f, magic, 4) == 0 ? 4 : 0;
+    }
+    fclose(f);
+
+    return (n == 4 && memcmp(magic, ELF_MAGIC, 4) == 0);
+}
+
+static uint32_t read_u32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint16_t read_u16(const uint8_t *p)
+{
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// Read the image's breezy_app.h notes; hints are 0 where it has none.
+// Walks the section headers of the (little-endian, 32-bit) file image.
+static void image_hints(const uint8_t *data, size_t len, image_hints_t *hints)
+{
+    memset(hints, 0, sizeof(*hints));
+    if (len < 0x34) return;
+
+    uint32_t shoff = read_u32(data + 0x20);
+    uint16_t shentsize = read_u16(data + 0x2e);
+    uint16_t shnum = read_u16(data + 0x30);
+    if (shentsize < 0x28 || shoff > len || (size_t)shnum * shentsize > len - shoff) {
+        return;
+    }
+
+    for (uint16_t i = 0; i < shnum; i++) {
+        const uint8_t *sh = data + shoff + (size_t)i * shentsize;
+        if (read_u32(sh + 0x04) != 7) continue;  // SHT_NOTE
+
+        uint32_t off = read_u32(sh + 0x10);
+        uint32_t size = read_u32(sh + 0x14);
+        if (off > len || size > len - off) continue;
+
+        // Notes: namesz, descsz, type, then name and desc, each 4-aligned
+        const uint8_t *p = data + off;
+        const uint8_t *end = p + size;
+        while (end - p >= 12) {
+            uint32_t namesz = read_u32(p);
+            uint32_t descsz = read_u32(p + 4);
+            uint32_t type = read_u32(p + 8);
+            const uint8_t *name = p + 12;
+            const uint8_t *desc = name + ((namesz + 3) & ~3u);
+            if (namesz > (size_t)(end - name) || descsz > (size_t)(end - desc)) break;
+
+            if (descsz == 4 && namesz == sizeof(BREEZY_NOTE_NAME) &&
+                memcmp(name, BREEZY_NOTE_NAME, namesz) == 0) {
+                if (type == BREEZY_NOTE_STACK) hints->stack = read_u32(desc);
+                if (type == BREEZY_NOTE_PLACE) hints->place = read_u32(desc);
+            }
+            p = desc + ((descsz + 3) & ~3u);
+        }
+    }
+}
+
+// Called by elf_loader for each block of an image it loads
+void *__real_esp_elf_malloc(uint32_t n, bool exec);
+
+void *__wrap_esp_elf_malloc(uint32_t n, bool exec)
+{
+#ifdef CONFIG_BREEZYBOX_ELF_PLACE
+    uint32_t want = exec ? BREEZY_PLACE_TEXT : BREEZY_PLACE_DATA;
+    if (s_place_task == xTaskGetCurrentTaskHandle() && (s_place & want)) {
+        uint32_t caps = exec ? MALLOC_CAP_EXEC | MALLOC_CAP_32BIT
+                             : MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+        if (heap_caps_get_free_size(caps) >= n + PLACE_RESERVE) {
+            void *p = heap_caps_malloc(n, caps);
+            if (p) return p;
+        }
+        ESP_LOGI(TAG, "No internal RAM for %u bytes, using the default",
+                 (unsigned)n);
+    }
+#endif
+    return __real_esp_elf_malloc(n, exec);
+}
+
+static const char *const SEC_NAMES[ELF_SECS] = {
+    [ELF_SEC_TEXT] = ".text",
+    [ELF_SEC_BSS] = ".bss",
+    [ELF_SEC_DATA] = ".data",
+    [ELF_SEC_RODATA] = ".rodata",
+    [ELF_SEC_DRLRO] = ".data.rel.ro",
+};
+
+static size_t image_sections(const esp_elf_t *elf, breezy_elf_sec_info_t *out, size_t max)
+{
+    size_t n = 0;
+    for (int i = 0; i < ELF_SECS && n < max; i++) {
+        if (elf->sec[i].size == 0) continue;
+        out[n].name = SEC_NAMES[i];
+        out[n].addr = elf->sec[i].addr;
+        out[n].size = elf->sec[i].size;
+        out[n].internal = esp_ptr_internal((const void *)elf->sec[i].addr);
+        n++;
+    }
+    return n;
+}
+
+// Initialize and relocate an image already in memory, and read its hints
+static int relocate_image(esp_elf_t *elf, const uint8_t *elf_data, size_t len,
+                          image_hints_t *hints)
+{
+    image_hints(elf_data, len, hints);
+#ifdef CONFIG_BREEZYBOX_ELF_PLACE
+    uint32_t place = hints->place & PLACE_FLAGS;
+#else
+    uint32_t place = 0;
+#endif
+
+    uint32_t t0 = elf_get_cycle_count();
+    int ret = esp_elf_init(elf);
+    uint32_t t1 = elf_get_cycle_count();
+    breezy_profile_add(BREEZY_PROFILE_INIT, t1 - t0);
+    if (ret < 0) {
+        printf("ELF init failed: %d\n", ret);
+        return ret;
+    }
+
+    if (place) {
+        xSemaphoreTake(s_place_lock, portMAX_DELAY);
+        s_place_task = xTaskGetCurrentTaskHandle();
+        s_place = place;
+    }
+    ret = esp_elf_relocate(elf, elf_data);
+    if (place) {
+        s_place_task = NULL;
+        s_place = 0;
+        xSemaphoreGive(s_place_lock);
+    }
+    breezy_profile_add(BREEZY_PROFILE_RELOCATE, elf_get_cycle_count() - t1);
+    if (ret < 0) {
+        printf("ELF relocate failed: %d\n", ret);
+        esp_elf_deinit(elf);
+        return ret;
+    }
+
+    breezy_elf_sec_info_t secs[ELF_SECS];
+    size_t nsecs = image_sections(elf, secs, ELF_SECS);
+    for (size_t i = 0; i < nsecs; i++) {
+        ESP_LOGI(TAG, "%-12s %6u bytes at %p (%s)", secs[i].name, (unsigned)secs[i].size,
+                 (void *)secs[i].addr, secs[i].internal ? "internal" : "PSRAM");
+    }
+    return 0;
+}
+
+// Relocate an app store program from its flash mapping. The mapping is
+// released before returning; elf_loader has copied everything by then.
+static int load_app_image(const char *name, esp_elf_t *elf, image_hints_t *hints)
+{
+    ESP_LOGI(TAG, "Loading ELF from app store: %s", name);
+
+    esp_partition_mmap_handle_t handle;
+    size_t size;
+    uint32_t t0 = elf_get_cycle_count();
+    const uint8_t *elf_data = breezy_appfs_mmap(name, &size, &handle);
+    breezy_profile_add_read(elf_get_cycle_count() - t0, 0);
+    if (!elf_data) {
+        printf("Cannot map: %s%s\n", BREEZY_APPFS_PREFIX, name);
+        return -1;
+    }
+
+    int ret = relocate_image(elf, elf_data, size, hints);
+    breezy_appfs_munmap(handle);
+    return ret;
+}
+
+// Read, initialize and relocate an ELF file. The file buffer is freed
+// before returning; elf_loader has copied everything it needs by then.
+// hints gets what the app's notes ask for.
+static int load_image(const char *path, esp_elf_t *elf, image_hints_t *hints)
+{
+    const char *app = breezy_appfs_name(path);
+    if (app) return load_app_image(app, elf, hints);
+
+    ESP_LOGI(TAG, "Loading ELF: %s", path);
+
+    // Read entire file into memory
+    uint32_t t0 = elf_get_cycle_count();
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        printf("Cannot open: %s\n", path);
+        return -1;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long file_size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t head[2];
+    if (file_size <= 0 || fread(head, 1, sizeof(head), f) != sizeof(head)) {
+        printf("Invalid file: %s\n", path);
+        fclose(f);
+        return -1;
+    }
+    rewind(f);
+
+    // Compressed: inflated in one pass, no copy of the compressed file
+    if (breezy_gz_is_gzip(head, sizeof(head))) {
+        size_t size, bytes_read;
+        uint8_t *elf_data = breezy_gz_read_file(f, &size, &bytes_read);
+        fclose(f);
+        breezy_profile_add_read(elf_get_cycle_count() - t0, bytes_read);
+        if (!elf_data) return -1;
+
+        ESP_LOGI(TAG, "Inflated %u bytes to %u, initializing ELF loader",
+                 (unsigned)bytes_read, (unsigned)size);
+
+        int ret = relocate_image(elf, elf_data, size, hints);
+        free(elf_data);
+        return ret;
+    }
+
+    uint8_t *elf_data = heap_caps_malloc(file_size, MALLOC_CAP_SPIRAM);
+    if (!elf_data) {
+        printf("Out of memory (%ld bytes needed)\n", file_size);
+        fclose(f);
+        return -1;
+    }
+
+    size_t bytes_read = fread(elf_data, 1, file_size, f);
+    fclose(f);
+    breezy_profile_add_read(elf_get_cycle_count() - t0, bytes_read);
+
+    if (bytes_read != (size_t)file_size) {
+        printf("Read error\n");
+        free(elf_data);
+        return -1;
+    }
+
+    ESP_LOGI(TAG, "Loaded %ld bytes, initializing ELF loader", file_size);
+
+    int ret = relocate_image(elf, elf_data, file_size, hints);
+    free(elf_data);
+    return ret;
+}
+
+// Memory held by a relocated image, per elf_loader's section table
+static size_t image_size(const esp_elf_t *elf)
+{
+    size_t total = 0;
+    for (int i = 0; i < ELF_SECS; i++) {
+        total += elf->sec[i].size;
+    }
+    return total;
+}
+
+// Put .data/.bss back to their just-relocated state
+static void image_reset(elf_cache_entry_t *e)
+{
+    const esp_elf_sec_t *data = &e->elf.sec[ELF_SEC_DATA];
+    const esp_elf_sec_t *bss = &e->elf.sec[ELF_SEC_BSS];
+
+    if (e->data_snapshot && data->size) {
+        memcpy((void *)data->addr, e->data_snapshot, data->size);
+    }
+    if (bss->size) {
+        memset((void *)bss->addr, 0, bss->size);
+    }
+}
+
+static void entry_free(elf_cache_entry_t *e)
+{
+    esp_elf_deinit(&e->elf);
+    free(e->data_snapshot);
+    free(e->path);
+    free(e);
+}
+
+static void cache_unlink(elf_cache_entry_t *e)
+{
+    for (elf_cache_entry_t **pp = &s_cache; *pp; pp = &(*pp)->next) {
+        if (*pp == e) {
+            *pp = e->next;
+            s_cache_used -= e->mem_size;
+            return;
+        }
+    }
+}
+
+static void cache_push_front(elf_cache_entry_t *e)
+{
+    e->next = s_cache;
+    s_cache = e;
+    s_cache_used += e->mem_size;
+}
+
+static elf_cache_entry_t *cache_find(const char *path)
+{
+    for (elf_cache_entry_t *e = s_cache; e; e = e->next) {
+        if (strcmp(e->path, path) == 0) return e;
+    }
+    return NULL;
+}
+
+// Evict least recently used idle, unpinned entries until need bytes fit.
+// Call with the lock held. Returns true if the space is available.
+static bool cache_make_room(size_t need)
+{
+    while (s_cache_used + need > ELF_CACHE_BUDGET) {
+        elf_cache_entry_t *victim = NULL;
+        for (elf_cache_entry_t *e = s_cache; e; e = e->next) {
+            if (!e->pinned && !e->in_use) victim = e;
+        }
+        if (!victim) return false;
+
+        ESP_LOGI(TAG, "Evicting %s", victim->path);
+        cache_unlink(victim);
+        entry_free(victim);
+    }
+    return true;
+}
+
+// Wrap a freshly relocated image in a cache entry and insert it, unless it
+// can't fit the budget. Call with the lock held. On failure the image is
+// left untouched for the caller to run privately.
+static elf_cache_entry_t *cache_insert(const char *path, const struct stat *st,
+                                       esp_elf_t *elf, uint32_t stack)
+{
+    const esp_elf_sec_t *data = &elf->sec[ELF_SEC_DATA];
+
+    // Only section-loaded images have the layout needed to reset state
+    if (elf->sec[ELF_SEC_TEXT].size == 0) return NULL;
+
+    size_t mem_size = image_size(elf) + data->size;
+    if (mem_size > ELF_CACHE_BUDGET) return NULL;
+
+    elf_cache_entry_t *e = calloc(1, sizeof(elf_cache_entry_t));
+    if (!e) return NULL;
+
+    e->path = strdup(path);
+    if (data->size) {
+        e->data_snapshot = heap_caps_malloc(data->size, MALLOC_CAP_SPIRAM);
+    }
+    if (!e->path || (data->size && !e->data_snapshot) || !cache_make_room(mem_size)) {
+        free(e->data_snapshot);
+        free(e->path);
+        free(e);
+        return NULL;
+    }
+
+    if (data->size) {
+        memcpy(e->data_snapshot, (const void *)data->addr, data->size);
+    }
+    e->elf = *elf;
+    e->size = st->st_size;
+    e->mtime = st->st_mtime;
+    e->mem_size = mem_size;
+    e->stack_size = stack;
+    cache_push_front(e);
+    return e;
+}
+
+// Look up a usable cache entry for path and mark it in use. Stale entries
+// (file changed since it was cached) are dropped. Call with the lock held.
+static elf_cache_entry_t *cache_acquire(const char *path, const struct stat *st)
+{
+    elf_cache_entry_t *e = cache_find(path);
+    if (!e) return NULL;
+
+    if (e->size != st->st_size || e->mtime != st->st_mtime) {
+        if (e->in_use) return NULL;  // Dropped by a later run
+        ESP_LOGI(TAG, "Stale cache entry: %s", path);
+        cache_unlink(e);
+        entry_free(e);
+        return NULL;
+    }
+    if (e->in_use) return NULL;
+
+    e->in_use = true;
+    e->hits++;
+    cache_unlink(e);
+    cache_push_front(e);
+    return e;
+}
+
+static void cache_release(elf_cache_entry_t *e, size_t heap_peak)
+{
+    xSemaphoreTake(s_cache_lock, portMAX_DELAY);
+    e->in_use = false;
+    if (heap_peak > e->heap_peak) e->heap_peak = heap_peak;
+    xSemaphoreGive(s_cache_lock);
+}
+
+// ============ Running ============
+
+static void app_task(void *arg)
+{
+    app_run_t *r = (app_run_t *)arg;
+
+    // stdin/stdout are per-task in ESP-IDF newlib
+    FILE *saved_in = stdin;
+    FILE *saved_out = stdout;
+    FILE *saved_err = stderr;
+    stdin = r->in;
+    stdout = r->out;
+    stderr = r->err;
+
+    // NULL when arenas are off; the app then uses the global heap.
+    // Taken under the lock so a kill always sees it.
+    xSemaphoreTake(s_run_lock, portMAX_DELAY);
+    r->arena = breezy_arena_begin();
+    xSemaphoreGive(s_run_lock);
+    if (r->quiet) breezy_log_quiet_begin();
+
+    // Execute - pass argc/argv like a normal main(). A kill comes back
+    // here from the stop point the app reached.
+    int ret;
+    breezy_stop_begin(&r->stop);
+    if (setjmp(r->stop.unwind) == 0) {
+        ret = esp_elf_request(r->elf, 0, r->argc, r->argv);
+    } else {
+        ret = APP_KILLED_STATUS;
+    }
+    breezy_stop_end(&r->stop);
+    fflush(stdout);
+
+    stdin = saved_in;
+    stdout = saved_out;
+    stderr = saved_err;
+    if (r->quiet) breezy_log_quiet_end();
+
+    xSemaphoreTake(s_run_lock, portMAX_DELAY);
+    r->ret = ret;
+    r->finished = true;
+    xSemaphoreGive(s_run_lock);
+
+    // r belongs to the waiter, which may return as soon as done is given
+    xSemaphoreGive(r->done);
+    vTaskDelete(NULL);
+}
+
+static void run_unlink(app_run_t *r)
+{
+    for (app_run_t **pp = &s_runs; *pp; pp = &(*pp)->next) {
+        if (*pp == r) {
+            *pp = r->next;
+            return;
+        }
+    }
+}
+
+// Run an image in a task of its own and wait for it to return (or be
+// killed). stack is the size the app asked for, 0 for the default.
+// heap (optional) gets the run's arena stats, all 0 without an arena.
+static int run_image(esp_elf_t *elf, int argc, char **argv, uint32_t stack,
+                     breezy_arena_stats_t *heap)
+{
+    app_run_t r = {
+        .elf = elf,
+        .argc = argc,
+        .argv = argv,
+        .in = stdin,
+        .out = stdout,
+        .err = stderr,
+        .job = breezy_jobs_current(),
+        .quiet = breezy_log_is_quiet(),
+    };
+
+    if (stack == 0) stack = APP_STACK_SIZE;
+    if (stack < APP_STACK_MIN) stack = APP_STACK_MIN;
+
+    // Background jobs may be kept off the core the shell runs on
+    int core = r.job ? JOB_CORE : APP_CORE;
+    if (core < 0 || core >= portNUM_PROCESSORS) core = tskNO_AFFINITY;
+
+    r.done = xSemaphoreCreateBinary();
+    if (!r.done) {
+        printf("Out of memory\n");
+        return -1;
+    }
+
+    ESP_LOGI(TAG, "Executing with %d args, %u byte stack", argc, (unsigned)stack);
+
+    int64_t start = esp_timer_get_time();
+
+    // Registered before the task can finish, so it is always found
+    xSemaphoreTake(s_run_lock, portMAX_DELAY);
+    BaseType_t ok = xTaskCreatePinnedToCore(app_task, argv[0], stack, &r,
+                                            uxTaskPriorityGet(NULL), &r.task, core);
+    if (ok == pdPASS) {
+        r.next = s_runs;
+        s_runs = &r;
+    }
+    xSemaphoreGive(s_run_lock);
+
+    if (ok != pdPASS) {
+        printf("Cannot start: %s (%u byte stack)\n", argv[0], (unsigned)stack);
+        vSemaphoreDelete(r.done);
+        return -1;
+    }
+
+    xSemaphoreTake(r.done, portMAX_DELAY);
+
+    // Before the arena goes, so the heap peak sample includes it
+    breezy_profile_add_us(BREEZY_PROFILE_RUN, esp_timer_get_time() - start);
+
+    xSemaphoreTake(s_run_lock, portMAX_DELAY);
+    run_unlink(&r);
+    xSemaphoreGive(s_run_lock);
+    vSemaphoreDelete(r.done);
+
+    breezy_arena_stats_t st = {0};
+    if (r.arena) {
+        breezy_arena_end(r.arena, &st);
+        ESP_LOGI(TAG, "Heap: peak %u, reserved %u, %u allocs, %u leaked",
+                 (unsigned)st.peak, (unsigned)st.reserved,
+                 (unsigned)st.allocs, (unsigned)st.in_use);
+    }
+    if (heap) *heap = st;
+
+    ESP_LOGI(TAG, "ELF returned: %d", r.ret);
+    return r.ret;
+}
+
+int breezy_elf_kill_job(int job)
+{
+    int killed = 0;
+
+    xSemaphoreTake(s_run_lock, portMAX_DELAY);
+    for (app_run_t *r = s_runs; r; r = r->next) {
+        if (r->job != job || r->finished) continue;
+
+        // Never deleted from outside: it could be holding a stdio, heap
+        // or pipe lock. Broken pipes wake it if it is blocked on one.
+        breezy_stop_request(&r->stop);
+        breezy_pipe_break(r->in);
+        breezy_pipe_break(r->out);
+        killed++;
+    }
+    xSemaphoreGive(s_run_lock);
+    return killed;
+}
+
+int breezy_elf_run(const char *path, int argc, char **argv)
+{
+    struct stat st;
+    if (image_stat(path, &st) != 0) {
+        printf("Cannot open: %s\n", path);
+        return -1;
+    }
+
+    xSemaphoreTake(s_cache_lock, portMAX_DELAY);
+    elf_cache_entry_t *e = cache_acquire(path, &st);
+    xSemaphoreGive(s_cache_lock);
+
+    breezy_arena_stats_t heap = {0};
+
+    if (e) {
+        ESP_LOGI(TAG, "Cached ELF: %s", path);
+        image_reset(e);
+        int ret = run_image(&e->elf, argc, argv, e->stack_size, &heap);
+        cache_release(e, heap.peak);
+        breezy_profile_add_run(true, heap.bytes, heap.peak, heap.allocs);
+        return ret;
+    }
+
+    esp_elf_t elf;
+    image_hints_t hints;
+    int ret = load_image(path, &elf, &hints);
+    if (ret < 0) return ret;
+
+    // Cache it if there is room and nobody else holds this path
+    xSemaphoreTake(s_cache_lock, portMAX_DELAY);
+    if (!cache_find(path)) {
+        e = cache_insert(path, &st, &elf, hints.stack);
+        if (e) e->in_use = true;
+    }
+    xSemaphoreGive(s_cache_lock);
+
+    if (e) {
+        ret = run_image(&e->elf, argc, argv, hints.stack, &heap);
+        cache_release(e, heap.peak);
+    } else {
+        ret = run_image(&elf, argc, argv, hints.stack, &heap);
+        uint32_t t0 = elf_get_cycle_count();
+        esp_elf_deinit(&elf);
+        breezy_profile_add(BREEZY_PROFILE_DEINIT, elf_get_cycle_count() - t0);
+    }
+    breezy_profile_add_run(false, heap.bytes, heap.peak, heap.allocs);
+    return ret;
+}
+
+int breezy_elf_load_test(const char *path)
+{
+    esp_elf_t elf;
+    image_hints_t hints;
+    int ret = load_image(path, &elf, &hints);
+    if (ret < 0) return ret;
+
+    esp_elf_deinit(&elf);
+    return 0;
+}
+
+// ============ Cache Management ============
+
+size_t breezy_elf_cache_list(breezy_elf_cache_info_t *out, size_t max)
+{
+    size_t n = 0;
+
+    xSemaphoreTake(s_cache_lock, portMAX_DELAY);
+    for (elf_cache_entry_t *e = s_cache; e && n < max; e = e->next, n++) {
+        strncpy(out[n].path, e->path, sizeof(out[n].path) - 1);
+        out[n].path[sizeof(out[n].path) - 1] = '\0';
+        out[n].mem_size = e->mem_size;
+        out[n].heap_peak = e->heap_peak;
+        out[n].hits = e->hits;
+        out[n].pinned = e->pinned;
+        out[n].in_use = e->in_use;
+    }
+    xSemaphoreGive(s_cache_lock);
+    return n;
+}
+
+int breezy_elf_cache_sections(const char *path, breezy_elf_sec_info_t *out, size_t max)
+{
+    xSemaphoreTake(s_cache_lock, portMAX_DELAY);
+    elf_cache_entry_t *e = cache_find(path);
+    int n = e ? (int)image_sections(&e->elf, out, max) : -1;
+    xSemaphoreGive(s_cache_lock);
+    return n;
+}
+
+void breezy_elf_cache_usage(size_t *used, size_t *budget)
+{
+    xSemaphoreTake(s_cache_lock, portMAX_DELAY);
+    if (used) *used = s_cache_used;
+    if (budget) *budget = ELF_CACHE_BUDGET;
+    xSemaphoreGive(s_cache_lock);
+}
+
+int breezy_elf_cache_pin(const char *path, bool pin)
+{
+    struct stat st;
+    if (image_stat(path, &st) != 0) return -1;
+
+    xSemaphoreTake(s_cache_lock, portMAX_DELAY);
+    elf_cache_entry_t *e = cache_find(path);
+    if (e && e->size == st.st_size && e->mtime == st.st_mtime) {
+        e->pinned = pin;
+        xSemaphoreGive(s_cache_lock);
+        return 0;
+    }
+    xSemaphoreGive(s_cache_lock);
+
+    if (!pin) return 0;  // Nothing cached, nothing to unpin
+
+    // Not cached (or stale): load it now so the next run is instant
+    esp_elf_t elf;
+    image_hints_t hints;
+    if (load_image(path, &elf, &hints) < 0) return -1;
+
+    xSemaphoreTake(s_cache_lock, portMAX_DELAY);
+    e = cache_find(path);
+    if (e && !e->in_use) {
+        cache_unlink(e);
+        entry_free(e);
+        e = NULL;
+    }
+    if (!e) {
+        e = cache_insert(path, &st, &elf, hints.stack);
+        if (!e) {
+            xSemaphoreGive(s_cache_lock);
+            esp_elf_deinit(&elf);
+            return -1;
+        }
+    } else {
+        // Someone is running the old copy; keep theirs, drop ours
+        esp_elf_deinit(&elf);
+    }
+    e->pinned = true;
+    xSemaphoreGive(s_cache_lock);
+    return 0;
+}
+
+void breezy_elf_cache_flush(void)
+{
+    xSemaphoreTake(s_cache_lock, portMAX_DELAY);
+    elf_cache_entry_t **pp = &s_cache;
+    while (*pp) {
+        elf_cache_entry_t *e = *pp;
+        if (e->in_use) {
+            pp = &e->next;
+            continue;
+        }
+        *pp = e->next;
+        s_cache_used -= e->mem_size;
+        entry_free(e);
+    }
+    xSemaphoreGive(s_cache_lock);
+}
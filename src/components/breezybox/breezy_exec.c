@@ -1,8 +1,19 @@
 #include "breezy_exec.h"
 #include "breezy_vfs.h"
+#include "breezy_pipe.h"
+#include "breezy_cmdtab.h"
+#include "breezy_elf.h"
+#include "breezy_appfs.h"
+#include "breezy_jobs.h"
+#include "breezy_log.h"
+#include "breezy_parse.h"
+#include "breezy_profile.h"
+#include "breezy_script.h"
 #include "esp_console.h"
 #include "esp_log.h"
-#include "esp_elf.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,28 +22,40 @@
 #include <unistd.h>
 #include <sys/stat.h>
 
-#define TEMP_PIPE_FILE BREEZYBOX_MOUNT_POINT "/.pipe_tmp"
-#define TEMP_OUT_FILE  BREEZYBOX_MOUNT_POINT "/.out_tmp"
+#ifdef CONFIG_BREEZYBOX_STAGE_STACK_SIZE
+#define STAGE_STACK_SIZE CONFIG_BREEZYBOX_STAGE_STACK_SIZE
+#else
+#define STAGE_STACK_SIZE 8192
+#endif
 
-// PATH for executable search (colon-separated like Unix)
-#define EXEC_PATH "/root/bin"
+#ifdef CONFIG_BREEZYBOX_REDIRECT_BUF_SIZE
+#define REDIRECT_BUF_SIZE CONFIG_BREEZYBOX_REDIRECT_BUF_SIZE
+#else
+#define REDIRECT_BUF_SIZE 4096
+#endif
 
-// ELF magic bytes
-static const uint8_t ELF_MAGIC[4] = {0x7f, 'E', 'L', 'F'};
+// Suffix of the sibling file `>` writes to before renaming it into place
+#define REDIRECT_TMP_SUFFIX ".~tmp"
 
-static const char *TAG = "exec";
-static vprintf_like_t s_orig_vprintf = NULL;
+// breezy_exports.c
+uint32_t elf_get_cycle_count(void);
 
-// Custom log handler that suppresses logs during redirects
-static int null_vprintf(const char *fmt, va_list args)
-{
-    return 0;
-}
+// esp_console_run() is not reentrant; serializes the fallback path
+static SemaphoreHandle_t s_console_lock = NULL;
 
 void breezybox_exec_init(void)
 {
-    s_orig_vprintf = esp_log_set_vprintf(vprintf);
-    esp_log_set_vprintf(s_orig_vprintf);
+    breezy_log_init();
+
+    if (!s_console_lock) {
+        s_console_lock = xSemaphoreCreateMutex();
+    }
+
+    breezy_cmdtab_init();
+    breezy_jobs_init();
+    breezy_script_init();
+    breezy_elf_init();
+    breezy_appfs_init();  // Optional; ESP_ERR_NOT_FOUND without the partition
 }
 
 // Check if file exists
@@ -42,30 +65,18 @@ static int file_exists(const char *path)
     return stat(path, &st) == 0 && S_ISREG(st.st_mode);
 }
 
-// Check if file has ELF magic
-static int is_elf_file(const char *path)
-{
-    FILE *f = fopen(path, "rb");
-    if (!f) return 0;
-    
-    uint8_t magic[4];
-    size_t n = fread(magic, 1, 4, f);
-    fclose(f);
-    
-    return (n == 4 && memcmp(magic, ELF_MAGIC, 4) == 0);
-}
-
 // Search for executable in PATH and CWD
 // Returns allocated string with full path, or NULL if not found
-static char *find_executable(const char *name)
+char *breezybox_find_executable(const char *name)
 {
     char path[BREEZYBOX_MAX_PATH * 2];
     
     // If name contains '/', treat as path (absolute or relative)
     if (strchr(name, '/')) {
         if (name[0] == '/') {
-            // Absolute path
-            if (file_exists(name)) {
+            // Absolute path (app store programs live outside the VFS)
+            const char *app = breezy_appfs_name(name);
+            if (app ? breezy_appfs_stat(app, NULL, NULL) == 0 : file_exists(name)) {
                 return strdup(name);
             }
         } else {
@@ -85,401 +96,383 @@ static char *find_executable(const char *name)
     }
     
     // Search in PATH
-    snprintf(path, sizeof(path), "%s/%s", EXEC_PATH, name);
+    snprintf(path, sizeof(path), "%s/%s", BREEZYBOX_EXEC_PATH, name);
     if (file_exists(path)) {
         return strdup(path);
     }
     
+    // Then the app store
+    if (breezy_appfs_stat(name, NULL, NULL) == 0) {
+        snprintf(path, sizeof(path), "%s%s", BREEZY_APPFS_PREFIX, name);
+        return strdup(path);
+    }
+    
     return NULL;
 }
 
-// Argument parsing context
-typedef struct {
-    char *buffer;   // Original strdup'd buffer
-    char **argv;    // Argument pointers
-    int argc;       // Argument count
-} parsed_args_t;
-
-// Parse command line into argc/argv with basic quote support
-// Returns 0 on success, -1 on error
-static int parse_args(const char *cmdline, parsed_args_t *args)
+// PATH lookup of a program, timed for `time`
+static char *find_external(const char *name)
 {
-    args->buffer = NULL;
-    args->argv = NULL;
-    args->argc = 0;
-    
-    if (!cmdline || !*cmdline) return 0;
-    
-    // Make a working copy
-    char *buf = strdup(cmdline);
-    if (!buf) return -1;
-    
-    // First pass: count arguments
-    int argc = 0;
-    char *p = buf;
-    
-    while (*p) {
-        while (*p == ' ') p++;
-        if (!*p) break;
-        
-        argc++;
-        
-        // Handle quoted strings
-        if (*p == '"' || *p == '\'') {
-            char quote = *p++;
-            while (*p && *p != quote) p++;
-            if (*p) p++;
-        } else {
-            while (*p && *p != ' ') p++;
-        }
-    }
-    
-    if (argc == 0) {
-        free(buf);
-        return 0;
-    }
-    
-    // Allocate argv array
-    char **argv = malloc((argc + 1) * sizeof(char *));
-    if (!argv) {
-        free(buf);
-        return -1;
-    }
-    
-    // Second pass: extract arguments
-    p = buf;
-    int i = 0;
-    
-    while (*p && i < argc) {
-        while (*p == ' ') p++;
-        if (!*p) break;
-        
-        // Handle quoted strings
-        if (*p == '"' || *p == '\'') {
-            char quote = *p++;
-            argv[i++] = p;
-            while (*p && *p != quote) p++;
-            if (*p) *p++ = '\0';
-        } else {
-            argv[i++] = p;
-            while (*p && *p != ' ') p++;
-            if (*p) *p++ = '\0';
-        }
-    }
-    argv[argc] = NULL;
-    
-    args->buffer = buf;
-    args->argv = argv;
-    args->argc = argc;
-    
-    return 0;
+    uint32_t t0 = elf_get_cycle_count();
+    char *path = breezy_cmdtab_find_external(name);
+    breezy_profile_add(BREEZY_PROFILE_LOOKUP, elf_get_cycle_count() - t0);
+    return path;
 }
 
-// Free parsed args
-static void free_args(parsed_args_t *args)
+// Commands we don't know the handler of (e.g. "help") go through
+// esp_console_run() one at a time
+static int run_console(const char *cmdline)
 {
-    if (args) {
-        free(args->argv);
-        free(args->buffer);
-        args->argv = NULL;
-        args->buffer = NULL;
-        args->argc = 0;
-    }
+    int ret = 0;
+    xSemaphoreTake(s_console_lock, portMAX_DELAY);
+    esp_console_run(cmdline, &ret);
+    xSemaphoreGive(s_console_lock);
+    return ret;
 }
 
-// Run an ELF file
-static int run_elf(const char *path, int argc, char **argv)
+// Append arg as esp_console_split_argv() reads it back: in double quotes,
+// with " and \ escaped, if it is empty or has a space, quote or backslash
+static char *put_console_arg(char *p, const char *arg)
 {
-    ESP_LOGI(TAG, "Loading ELF: %s", path);
-    
-    // Read entire file into memory
-    FILE *f = fopen(path, "rb");
-    if (!f) {
-        printf("Cannot open: %s\n", path);
-        return -1;
-    }
-    
-    fseek(f, 0, SEEK_END);
-    long file_size = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    
-    if (file_size <= 0) {
-        printf("Invalid file: %s\n", path);
-        fclose(f);
-        return -1;
-    }
-    
-    uint8_t *elf_data = heap_caps_malloc(file_size, MALLOC_CAP_SPIRAM);// malloc(file_size);
-    if (!elf_data) {
-        printf("Out of memory (%ld bytes needed)\n", file_size);
-        fclose(f);
-        return -1;
+    size_t len = strlen(arg);
+    if (len > 0 && strcspn(arg, " \"\\") == len) {
+        memcpy(p, arg, len);
+        return p + len;
     }
-    
-    size_t bytes_read = fread(elf_data, 1, file_size, f);
-    fclose(f);
-    
-    if (bytes_read != (size_t)file_size) {
-        printf("Read error\n");
-        free(elf_data);
-        return -1;
+
+    *p++ = '"';
+    for (; *arg; arg++) {
+        if (*arg == '"' || *arg == '\\') *p++ = '\\';
+        *p++ = *arg;
     }
-    
-    ESP_LOGI(TAG, "Loaded %ld bytes, initializing ELF loader", file_size);
-    
-    // Initialize and relocate ELF
-    esp_elf_t elf;
-    int ret;
-    
-    ret = esp_elf_init(&elf);
-    if (ret < 0) {
-        printf("ELF init failed: %d\n", ret);
-        free(elf_data);
+    *p++ = '"';
+    return p;
+}
+
+int breezybox_exec_argv(int argc, char **argv)
+{
+    if (argc == 0) return 0;
+
+    esp_console_cmd_func_t func = breezy_cmdtab_find(argv[0]);
+    if (func) return func(argc, argv);
+
+    char *exe_path = find_external(argv[0]);
+    if (exe_path) {
+        int ret = breezy_elf_run(exe_path, argc, argv);
+        free(exe_path);
         return ret;
     }
-    
-    ret = esp_elf_relocate(&elf, elf_data);
-    if (ret < 0) {
-        printf("ELF relocate failed: %d\n", ret);
-        esp_elf_deinit(&elf);
-        free(elf_data);
-        return ret;
+
+    // Handler not in the table (e.g. "help", which esp_console registers
+    // itself): esp_console needs a line to split back into argv
+    size_t len = 1;
+    for (int i = 0; i < argc; i++) len += 2 * strlen(argv[i]) + 3;
+    char *line = malloc(len);
+    if (!line) return -1;
+
+    char *p = line;
+    for (int i = 0; i < argc; i++) {
+        if (i) *p++ = ' ';
+        p = put_console_arg(p, argv[i]);
     }
-    
-    ESP_LOGI(TAG, "Executing with %d args", argc);
-    
-    // Execute - pass argc/argv like a normal main()
-    ret = esp_elf_request(&elf, 0, argc, argv);
-    
-    ESP_LOGI(TAG, "ELF returned: %d", ret);
-    
-    esp_elf_deinit(&elf);
-    free(elf_data);
-    
+    *p = '\0';
+    int ret = run_console(line);
+    free(line);
     return ret;
 }
 
-// Sentinel value meaning "command not found as external"
-#define EXEC_NOT_FOUND INT_MIN
+// One pipeline stage: a simple command plus its own redirects.
+// Every stage runs in its own task when there is more than one.
+typedef struct {
+    int argc;
+    char **argv;                // In the caller's breezy_line_t
+    char *infile;               // < file
+    char *outfile;              // > or >> file
+    bool append;
+    char *out_path;             // Resolved target of `>` ...
+    char *tmp_path;             // ... written here, renamed over it on close
+    FILE *in;
+    FILE *out;
+    bool close_in;              // Stage owns in (file or pipe read end)
+    bool close_out;             // Stage owns out (file or pipe write end)
+    int ret;
+    int job;                    // Background job, carried into stage tasks
+    breezy_profile_t *profile;  // `time` profile, likewise
+    bool quiet;                 // Logs kept off the console (breezy_log.h)
+    SemaphoreHandle_t done;
+} exec_stage_t;
 
-// Try to run as external command (ELF binary)
-// Returns EXEC_NOT_FOUND if not found, otherwise returns ELF's return code
-static int try_run_external(const char *cmdline)
+// Move a finished `>` output into place. Readers of the target see either
+// the old contents or the complete new ones, never a partial write.
+static bool commit_output(exec_stage_t *st)
 {
-    parsed_args_t args;
-    
-    if (parse_args(cmdline, &args) != 0 || args.argc == 0) {
-        return EXEC_NOT_FOUND;
-    }
-    
-    // Find executable
-    char *exe_path = find_executable(args.argv[0]);
-    if (!exe_path) {
-        free_args(&args);
-        return EXEC_NOT_FOUND;  // Not found
+    if (rename(st->tmp_path, st->out_path) == 0) return true;
+
+    // FAT won't rename over an existing file
+    unlink(st->out_path);
+    return rename(st->tmp_path, st->out_path) == 0;
+}
+
+// ran: the command ran, so a pending `>` output should replace its target
+static void close_stage_io(exec_stage_t *st, bool ran)
+{
+    if (st->close_out && st->out) {
+        bool written = fclose(st->out) == 0;
+        if (st->tmp_path) {
+            bool committed = ran && written && commit_output(st);
+            if (!committed) unlink(st->tmp_path);
+            if (ran && !committed) {
+                printf("Cannot write: %s\n", st->outfile);
+                if (st->ret == 0) st->ret = 1;
+            }
+            free(st->tmp_path);
+            st->tmp_path = NULL;
+        }
     }
-    
-    // Check if it's an ELF
-    if (!is_elf_file(exe_path)) {
-        free(exe_path);
-        free_args(&args);
-        return EXEC_NOT_FOUND;  // Not an ELF
+    if (st->close_in && st->in) fclose(st->in);
+    st->close_out = st->close_in = false;
+}
+
+// Open the target of `>` or `>>`. `>>` appends in place (fopen "a" is
+// O_APPEND, so concurrent appenders don't overwrite each other). `>`
+// writes a sibling temp file that replaces the target once the command is
+// done; a device or other non-regular target is written directly.
+static FILE *open_output(exec_stage_t *st, const char *path)
+{
+    struct stat sb;
+    bool direct = st->append || (stat(path, &sb) == 0 && !S_ISREG(sb.st_mode));
+    FILE *f;
+
+    if (direct) {
+        f = fopen(path, st->append ? "a" : "w");
+    } else {
+        size_t len = strlen(path);
+        st->out_path = strdup(path);
+        st->tmp_path = malloc(len + sizeof(REDIRECT_TMP_SUFFIX));
+        if (!st->out_path || !st->tmp_path) {
+            free(st->tmp_path);
+            st->tmp_path = NULL;
+            return NULL;
+        }
+        memcpy(st->tmp_path, path, len);
+        memcpy(st->tmp_path + len, REDIRECT_TMP_SUFFIX, sizeof(REDIRECT_TMP_SUFFIX));
+
+        f = fopen(st->tmp_path, "w");
+        if (!f) {
+            free(st->tmp_path);
+            st->tmp_path = NULL;
+        }
     }
-    
-    int ret = run_elf(exe_path, args.argc, args.argv);
-    
-    free(exe_path);
-    free_args(&args);
-    
-    return ret;
+
+    // Flash prefers few large writes over many small ones
+    if (f) setvbuf(f, NULL, _IOFBF, REDIRECT_BUF_SIZE);
+    return f;
 }
 
-// Execute with output redirect using temp file
-static int exec_with_output_redirect(const char *cmd, const char *outfile, int append)
+// Connect every stage's stdin/stdout: redirect files win over pipes, and
+// the ends of the pipeline inherit the caller's stdin/stdout.
+static int open_stage_io(exec_stage_t *stages, int count)
 {
-    int ret = 0;
-    
-    esp_log_set_vprintf(null_vprintf);
-    
-    FILE *old_stdout = stdout;
-    FILE *tmp = fopen(TEMP_OUT_FILE, "w");
-    if (!tmp) {
-        esp_log_set_vprintf(s_orig_vprintf);
-        printf("Cannot create temp file\n");
-        return -1;
+    for (int i = 0; i < count; i++) {
+        stages[i].in = stdin;
+        stages[i].out = stdout;
     }
-    
-    // Swap stdout
-    stdout = tmp;
-    
-    // Try external first, then builtin
-    ret = try_run_external(cmd);
-    if (ret == EXEC_NOT_FOUND) {
-        esp_console_run(cmd, &ret);
+
+    for (int i = 0; i < count - 1; i++) {
+        FILE *rd, *wr;
+        if (breezy_pipe_open(&rd, &wr, 0) != 0) {
+            printf("Cannot create pipe\n");
+            goto fail;
+        }
+        stages[i].out = wr;
+        stages[i].close_out = true;
+        stages[i + 1].in = rd;
+        stages[i + 1].close_in = true;
     }
-    fflush(stdout);
-    
-    // Restore stdout
-    fclose(tmp);
-    stdout = old_stdout;
-    esp_log_set_vprintf(s_orig_vprintf);
-    
-    // Copy temp to destination
-    FILE *src = fopen(TEMP_OUT_FILE, "r");
-    if (!src) return ret;
-    
-    FILE *dst = fopen(outfile, append ? "a" : "w");
-    if (!dst) {
-        fclose(src);
-        unlink(TEMP_OUT_FILE);
-        return -1;
+
+    for (int i = 0; i < count; i++) {
+        exec_stage_t *st = &stages[i];
+        char resolved[BREEZYBOX_MAX_PATH * 2];
+
+        if (st->infile) {
+            const char *path = breezybox_resolve_path(st->infile, resolved, sizeof(resolved));
+            FILE *f = path ? fopen(path, "r") : NULL;
+            if (!f) {
+                printf("Cannot open: %s\n", st->infile);
+                goto fail;
+            }
+            // Upstream stage sees EPIPE, like a shell discarding its output
+            if (st->close_in) fclose(st->in);
+            st->in = f;
+            st->close_in = true;
+        }
+
+        if (st->outfile) {
+            const char *path = breezybox_resolve_path(st->outfile, resolved, sizeof(resolved));
+            FILE *f = path ? open_output(st, path) : NULL;
+            if (!f) {
+                printf("Cannot create: %s\n", st->outfile);
+                goto fail;
+            }
+            // Downstream stage sees EOF right away
+            if (st->close_out) fclose(st->out);  // A pipe end, never a temp file
+            st->out = f;
+            st->close_out = true;
+        }
     }
-    
-    char buf[128];
-    size_t n;
-    while ((n = fread(buf, 1, sizeof(buf), src)) > 0) {
-        fwrite(buf, 1, n, dst);
+    return 0;
+
+fail:
+    for (int i = 0; i < count; i++) {
+        close_stage_io(&stages[i], false);
     }
-    
-    fclose(src);
-    fclose(dst);
-    unlink(TEMP_OUT_FILE);
-    
-    return ret;
+    return -1;
 }
 
-static int exec_with_input_redirect(const char *cmd, const char *infile)
+// Run a stage on the current task with its stdin/stdout swapped in
+static void stage_run(exec_stage_t *st)
 {
-    int ret = 0;
-    
-    FILE *old_stdin = stdin;
-    FILE *in = fopen(infile, "r");
-    if (!in) {
-        printf("Cannot open: %s\n", infile);
-        return -1;
-    }
-    
-    stdin = in;
-    
-    // Try external first, then builtin
-    ret = try_run_external(cmd);
-    if (ret == EXEC_NOT_FOUND) {
-        esp_console_run(cmd, &ret);
-    }
-    
-    fclose(in);
-    stdin = old_stdin;
-    
-    return ret;
+    // stdin/stdout are per-task in ESP-IDF newlib
+    FILE *saved_in = stdin;
+    FILE *saved_out = stdout;
+    stdin = st->in;
+    stdout = st->out;
+
+    st->ret = breezybox_exec_argv(st->argc, st->argv);
+    fflush(stdout);
+
+    stdin = saved_in;
+    stdout = saved_out;
+
+    // Closing our pipe ends is what signals EOF/EPIPE to the neighbours
+    close_stage_io(st, true);
 }
 
-// Parse and execute a command with redirect support
-int breezybox_exec(const char *cmdline)
+static void stage_task(void *arg)
 {
-    if (!cmdline || !*cmdline) return 0;
-    
-    // Make a working copy
-    char *line = strdup(cmdline);
-    if (!line) return -1;
-    
-    char *cmd1 = NULL, *cmd2 = NULL;
-    char *infile = NULL, *outfile = NULL;
-    int append = 0;
-    int ret = 0;
-    
-    // Check for pipe first
-    char *pipe_pos = strchr(line, '|');
-    if (pipe_pos) {
-        *pipe_pos = '\0';
-        cmd1 = line;
-        cmd2 = pipe_pos + 1;
-        
-        // Trim whitespace
-        while (*cmd1 == ' ') cmd1++;
-        while (*cmd2 == ' ') cmd2++;
-        char *end1 = cmd1 + strlen(cmd1) - 1;
-        char *end2 = cmd2 + strlen(cmd2) - 1;
-        while (end1 > cmd1 && *end1 == ' ') *end1-- = '\0';
-        while (end2 > cmd2 && *end2 == ' ') *end2-- = '\0';
-        
-        // Execute: cmd1 > tmpfile; cmd2 < tmpfile
-        exec_with_output_redirect(cmd1, TEMP_PIPE_FILE, 0);
-        ret = exec_with_input_redirect(cmd2, TEMP_PIPE_FILE);
-        unlink(TEMP_PIPE_FILE);
-        
-        free(line);
-        return ret;
-    }
-    
-    // Check for output redirect (>> or >)
-    char *redir_out = strstr(line, ">>");
-    if (redir_out) {
-        append = 1;
-        *redir_out = '\0';
-        outfile = redir_out + 2;
+    exec_stage_t *st = (exec_stage_t *)arg;
+    breezy_jobs_enter(st->job);
+    if (st->profile) breezy_profile_attach(st->profile);
+    if (st->quiet) breezy_log_quiet_begin();
+    stage_run(st);
+    if (st->quiet) breezy_log_quiet_end();
+    if (st->profile) breezy_profile_attach(NULL);
+    breezy_jobs_leave();
+    xSemaphoreGive(st->done);
+    vTaskDelete(NULL);
+}
+
+// Returns 0 if the stage task started. On failure the stage's pipe ends
+// are closed here, so its neighbours still see EOF/EPIPE and finish.
+static int start_stage(exec_stage_t *st)
+{
+    BaseType_t ok = xTaskCreate(stage_task, "breezy_stage", STAGE_STACK_SIZE,
+                                st, uxTaskPriorityGet(NULL), NULL);
+    if (ok == pdPASS) return 0;
+
+    printf("Cannot start: %s\n", st->argv[0]);
+    st->ret = -1;
+    close_stage_io(st, false);
+    return -1;
+}
+
+// Run all stages concurrently; the exit status is the last stage's.
+// Pipes are bounded, so a slow consumer throttles its producer.
+static int exec_pipeline(exec_stage_t *stages, int count)
+{
+    if (open_stage_io(stages, count) != 0) return -1;
+
+    // Keep log lines out of pipes and redirect targets, for these
+    // commands only; other tasks keep logging
+    bool quiet = count > 1 || stages[0].outfile || breezy_log_is_quiet();
+
+    if (count == 1) {
+        // Single command: no task needed, run right here
+        bool entered = quiet && breezy_log_quiet_begin() == 0;
+        stage_run(&stages[0]);
+        if (entered) breezy_log_quiet_end();
     } else {
-        redir_out = strchr(line, '>');
-        if (redir_out) {
-            *redir_out = '\0';
-            outfile = redir_out + 1;
+        SemaphoreHandle_t done = xSemaphoreCreateCounting(count, 0);
+        int job = breezy_jobs_current();
+        breezy_profile_t *profile = breezy_profile_current();
+        int started = 0;
+
+        for (int i = 0; i < count; i++) {
+            if (!done) {
+                close_stage_io(&stages[i], false);
+                stages[i].ret = -1;
+                continue;
+            }
+            stages[i].done = done;
+            stages[i].job = job;
+            stages[i].profile = profile;
+            stages[i].quiet = quiet;
+            if (start_stage(&stages[i]) == 0) started++;
         }
+        for (int i = 0; i < started; i++) {
+            xSemaphoreTake(done, portMAX_DELAY);
+        }
+        if (done) vSemaphoreDelete(done);
     }
-    
-    // Check for input redirect
-    char *redir_in = strchr(line, '<');
-    if (redir_in) {
-        *redir_in = '\0';
-        infile = redir_in + 1;
-    }
-    
-    // Trim whitespace from all parts
-    cmd1 = line;
-    while (*cmd1 == ' ') cmd1++;
-    char *end = cmd1 + strlen(cmd1) - 1;
-    while (end > cmd1 && *end == ' ') *end-- = '\0';
-    
-    if (outfile) {
-        while (*outfile == ' ') outfile++;
-        end = outfile + strlen(outfile) - 1;
-        while (end > outfile && *end == ' ') *end-- = '\0';
+
+    return stages[count - 1].ret;
+}
+
+// Parse and execute a command line: cmd [< in] [> out] [| cmd ...] [&]
+int breezybox_exec(const char *cmdline)
+{
+    if (!cmdline || !*cmdline) return 0;
+
+    breezy_line_t line;
+    if (breezy_parse_line(cmdline, &line, NULL) != 0) {
+        printf("%s\n", line.error);
+        return -1;
     }
-    
-    if (infile) {
-        while (*infile == ' ') infile++;
-        end = infile + strlen(infile) - 1;
-        while (end > infile && *end == ' ') *end-- = '\0';
+    int ret = breezybox_exec_line(&line);
+    breezy_line_free(&line);
+    return ret;
+}
+
+int breezybox_exec_line(breezy_line_t *line)
+{
+    // Trailing '&': the whole line becomes a background job. It gets the
+    // words as expanded here, quoted so the job doesn't expand them again.
+    if (line->background) {
+        if (line->stages[0].argc == 0) return 0;
+        char *text = breezy_parse_format(line);
+        int id = text ? breezy_jobs_start(text) : -1;
+        if (id > 0) printf("[%d] %s\n", id, text);
+        free(text);
+        return id < 0 ? -1 : 0;
     }
-    
-    // Resolve relative paths for redirects
-    char resolved_in[BREEZYBOX_MAX_PATH * 2];
-    char resolved_out[BREEZYBOX_MAX_PATH * 2];
-    
-    if (infile && infile[0] != '/') {
-        breezybox_resolve_path(infile, resolved_in, sizeof(resolved_in));
-        infile = resolved_in;
+
+    if (line->stages[0].argc == 0 && line->nstages == 1) return 0;
+
+    // Room for a typical pipeline on the stack
+    exec_stage_t fixed[BREEZY_LINE_MAX_STAGES];
+    exec_stage_t *stages = fixed;
+    if (line->nstages > BREEZY_LINE_MAX_STAGES) {
+        stages = malloc(line->nstages * sizeof(exec_stage_t));
+        if (!stages) {
+            printf("Out of memory\n");
+            return -1;
+        }
     }
-    if (outfile && outfile[0] != '/') {
-        breezybox_resolve_path(outfile, resolved_out, sizeof(resolved_out));
-        outfile = resolved_out;
+    memset(stages, 0, line->nstages * sizeof(exec_stage_t));
+    for (int i = 0; i < line->nstages; i++) {
+        const breezy_line_stage_t *ls = &line->stages[i];
+        stages[i].argc = ls->argc;
+        stages[i].argv = ls->argv;
+        stages[i].infile = ls->infile;
+        stages[i].outfile = ls->outfile;
+        stages[i].append = ls->append;
     }
-    
-    // Execute with appropriate redirects
-    if (outfile && infile) {
-        // Both redirects - output takes precedence for now
-        ret = exec_with_output_redirect(cmd1, outfile, append);
-    } else if (outfile) {
-        ret = exec_with_output_redirect(cmd1, outfile, append);
-    } else if (infile) {
-        ret = exec_with_input_redirect(cmd1, infile);
-    } else {
-        // No redirects - try external first, then builtin
-        ret = try_run_external(cmd1);
-        if (ret == EXEC_NOT_FOUND) {
-            // Not found as external, try builtin
-            esp_console_run(cmd1, &ret);
-        }
+
+    int ret = exec_pipeline(stages, line->nstages);
+
+    for (int i = 0; i < line->nstages; i++) {
+        free(stages[i].out_path);
     }
-    
-    free(line);
+    if (stages != fixed) free(stages);
     return ret;
-}
\ No newline at end of file
+}
@@ -0,0 +1,112 @@
+/*
+ * breezy_gz.c - Inflating gzip-compressed programs
+ */
+
+#include "breezy_gz.h"
+#include "esp_heap_caps.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define GZ_CHUNK        4096
+#define GZ_PEEK_CHUNK   256
+#define GZ_MAX_SIZE     (16 * 1024 * 1024)  // Sanity bound on the trailer
+
+static voidpf gz_alloc(voidpf opaque, uInt items, uInt size)
+{
+    (void)opaque;
+    void *p = heap_caps_malloc((size_t)items * size, MALLOC_CAP_SPIRAM);
+    return p ? p : malloc((size_t)items * size);
+}
+
+static void gz_free(voidpf opaque, voidpf p)
+{
+    (void)opaque;
+    free(p);
+}
+
+bool breezy_gz_is_gzip(const uint8_t *head, size_t len)
+{
+    return len >= 2 && head[0] == 0x1f && head[1] == 0x8b;
+}
+
+void breezy_gz_stream_init(z_stream *zs)
+{
+    memset(zs, 0, sizeof(*zs));
+    zs->zalloc = gz_alloc;
+    zs->zfree = gz_free;
+}
+
+// ISIZE: the last 4 bytes, little-endian, uncompressed size mod 2^32
+static long trailer_size(FILE *f)
+{
+    uint8_t t[4];
+    if (fseek(f, -4, SEEK_END) != 0 || fread(t, 1, 4, f) != 4) return -1;
+    if (fseek(f, 0, SEEK_SET) != 0) return -1;
+    return (long)((uint32_t)t[0] | (uint32_t)t[1] << 8 |
+                  (uint32_t)t[2] << 16 | (uint32_t)t[3] << 24);
+}
+
+uint8_t *breezy_gz_read_file(FILE *f, size_t *size, size_t *bytes_read)
+{
+    long total = trailer_size(f);
+    if (total <= 0 || total > GZ_MAX_SIZE) {
+        printf("Invalid compressed file\n");
+        return NULL;
+    }
+
+    uint8_t *out = heap_caps_malloc(total, MALLOC_CAP_SPIRAM);
+    uint8_t *chunk = malloc(GZ_CHUNK);
+    z_stream zs;
+    breezy_gz_stream_init(&zs);
+    if (!out || !chunk || inflateInit2(&zs, BREEZY_GZ_WINDOW_BITS) != Z_OK) {
+        printf("Out of memory (%ld bytes needed)\n", total);
+        free(out);
+        free(chunk);
+        return NULL;
+    }
+
+    zs.next_out = out;
+    zs.avail_out = total;
+    size_t in = 0;
+    int zret = Z_OK;
+    while (zret == Z_OK) {
+        size_t n = fread(chunk, 1, GZ_CHUNK, f);
+        if (n == 0) break;
+        in += n;
+        zs.next_in = chunk;
+        zs.avail_in = n;
+        zret = inflate(&zs, Z_NO_FLUSH);
+    }
+    inflateEnd(&zs);
+    free(chunk);
+
+    if (zret != Z_STREAM_END || zs.total_out != (uLong)total) {
+        printf("Corrupt compressed file\n");
+        free(out);
+        return NULL;
+    }
+    *size = total;
+    *bytes_read = in;
+    return out;
+}
+
+int breezy_gz_peek(FILE *f, uint8_t *out, size_t len)
+{
+    uint8_t chunk[GZ_PEEK_CHUNK];
+    z_stream zs;
+    breezy_gz_stream_init(&zs);
+    if (inflateInit2(&zs, BREEZY_GZ_WINDOW_BITS) != Z_OK) return -1;
+
+    zs.next_out = out;
+    zs.avail_out = len;
+    int zret = Z_OK;
+    while (zret == Z_OK && zs.avail_out > 0) {
+        size_t n = fread(chunk, 1, sizeof(chunk), f);
+        if (n == 0) break;
+        zs.next_in = chunk;
+        zs.avail_in = n;
+        zret = inflate(&zs, Z_NO_FLUSH);
+    }
+    inflateEnd(&zs);
+    return zs.avail_out == 0 ? 0 : -1;
+}
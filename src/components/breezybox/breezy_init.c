@@ -0,0 +1,361 @@
+/*
+ * breezy_init.c - init.sh stanzas, started concurrently at boot
+ *
+ * The script is read once and cut into the lines before the first
+ * "# @stanza" header and one piece per stanza. Each piece is padded with
+ * the newlines before it, so compile errors give line numbers in the file.
+ * A stanza task waits on the done semaphores of its @after stanzas; every
+ * waiter gives a semaphore back after taking it, so any number of stanzas
+ * can wait on the same one.
+ */
+
+#include "breezy_init.h"
+#include "breezy_script.h"
+#include "breezy_pipe.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifdef CONFIG_BREEZYBOX_STAGE_STACK_SIZE
+#define STANZA_STACK_SIZE CONFIG_BREEZYBOX_STAGE_STACK_SIZE
+#else
+#define STANZA_STACK_SIZE 8192
+#endif
+
+#define INIT_FILE_MAX       (64 * 1024)
+#define STANZA_MAX_AFTER    4
+#define STANZA_HEADER       "@stanza"
+
+static const char *TAG = "init";
+
+typedef struct {
+    breezy_init_info_t info;    // Guarded by s_lock once tasks run
+    char *text;                 // Source, padded to its line in the file
+    int after[STANZA_MAX_AFTER];
+    int nafter;
+    int64_t start_us;
+    int64_t end_us;
+    FILE *in;                   // Read end of a closed pipe: always EOF
+    FILE *out;
+    FILE *err;
+    SemaphoreHandle_t done;
+} stanza_t;
+
+// [0] is the part before the first stanza
+static stanza_t s_stanzas[BREEZY_INIT_MAX_STANZAS + 1];
+static int s_count = 0;
+static char *s_path = NULL;
+static int64_t s_start_us = 0;
+static int64_t s_prompt_us = 0;
+static SemaphoreHandle_t s_lock = NULL;
+
+// ============ Parsing ============
+
+static int find_stanza(const char *name)
+{
+    for (int i = 1; i < s_count; i++) {
+        if (strcmp(s_stanzas[i].info.name, name) == 0) return i;
+    }
+    return -1;
+}
+
+// "# @stanza name [@after a b ...] [@background]". Returns false for any
+// other line; on true, st is filled in and the line is cut up.
+static bool parse_header(char *line, int lineno, stanza_t *st)
+{
+    char *p = line + strspn(line, " \t");
+    if (*p != '#') return false;
+    p += 1 + strspn(p + 1, " \t");
+    if (strncmp(p, STANZA_HEADER, sizeof(STANZA_HEADER) - 1) != 0) return false;
+    p += sizeof(STANZA_HEADER) - 1;
+    if (*p != ' ' && *p != '\t') return false;
+
+    bool in_after = false;
+    char *save = NULL;
+    for (char *w = strtok_r(p, " \t", &save); w; w = strtok_r(NULL, " \t", &save)) {
+        if (strcmp(w, "@after") == 0) {
+            in_after = true;
+        } else if (strcmp(w, "@background") == 0) {
+            st->info.background = true;
+            in_after = false;
+        } else if (*w == '@') {
+            printf("init: %s:%d: unknown annotation %s\n", s_path, lineno, w);
+        } else if (!st->info.name[0]) {
+            strncpy(st->info.name, w, sizeof(st->info.name) - 1);
+        } else if (!in_after) {
+            printf("init: %s:%d: unexpected %s\n", s_path, lineno, w);
+        } else {
+            int dep = find_stanza(w);
+            if (dep < 0) {
+                printf("init: %s:%d: @after %s: no such stanza above\n", s_path, lineno, w);
+            } else if (st->nafter < STANZA_MAX_AFTER) {
+                st->after[st->nafter++] = dep;
+                size_t len = strlen(st->info.after);
+                snprintf(st->info.after + len, sizeof(st->info.after) - len,
+                         "%s%s", len ? " " : "", w);
+            }
+        }
+    }
+
+    if (!st->info.name[0]) {
+        snprintf(st->info.name, sizeof(st->info.name), "line%d", lineno);
+    }
+    return true;
+}
+
+// Copy of text[begin, end) preceded by `lines` newlines
+static char *piece(const char *text, size_t begin, size_t end, int lines)
+{
+    char *p = malloc(lines + (end - begin) + 1);
+    if (!p) return NULL;
+    memset(p, '\n', lines);
+    memcpy(p + lines, text + begin, end - begin);
+    p[lines + (end - begin)] = '\0';
+    return p;
+}
+
+// Cut the script into s_stanzas. The text is not modified.
+static int split(const char *text)
+{
+    size_t len = strlen(text);
+    size_t begin = 0;           // Start of the current piece
+    int begin_line = 0;         // Lines before it
+    int lineno = 0;
+
+    s_count = 1;
+    for (size_t pos = 0; pos < len; ) {
+        const char *nl = memchr(text + pos, '\n', len - pos);
+        size_t next = nl ? (size_t)(nl - text) + 1 : len;
+
+        char line[128];
+        size_t n = next - pos < sizeof(line) - 1 ? next - pos : sizeof(line) - 1;
+        memcpy(line, text + pos, n);
+        line[n] = '\0';
+        line[strcspn(line, "\r\n")] = '\0';
+
+        stanza_t hdr = {0};
+        if (parse_header(line, lineno + 1, &hdr)) {
+            if (s_count > BREEZY_INIT_MAX_STANZAS) {
+                printf("init: %s:%d: too many stanzas\n", s_path, lineno + 1);
+                return -1;
+            }
+            if (find_stanza(hdr.info.name) > 0) {
+                printf("init: %s:%d: duplicate stanza %s\n", s_path, lineno + 1, hdr.info.name);
+            }
+            s_stanzas[s_count - 1].text = piece(text, begin, pos, begin_line);
+            s_stanzas[s_count] = hdr;
+            s_count++;
+            begin = pos;
+            begin_line = lineno;
+        }
+        pos = next;
+        lineno++;
+    }
+    s_stanzas[s_count - 1].text = piece(text, begin, len, begin_line);
+
+    for (int i = 0; i < s_count; i++) {
+        if (!s_stanzas[i].text) return -1;
+    }
+    return 0;
+}
+
+static char *read_file(const char *path)
+{
+    struct stat st;
+    if (stat(path, &st) != 0) return NULL;
+    if (st.st_size > INIT_FILE_MAX) {
+        printf("init: %s: script too large\n", path);
+        return NULL;
+    }
+
+    FILE *f = fopen(path, "r");
+    if (!f) return NULL;
+    char *text = malloc(st.st_size + 1);
+    size_t n = text ? fread(text, 1, st.st_size, f) : 0;
+    fclose(f);
+    if (text) text[n] = '\0';
+    return text;
+}
+
+// ============ Running ============
+
+static uint32_t ms_since_start(int64_t us)
+{
+    return (uint32_t)((us - s_start_us) / 1000);
+}
+
+static int run_text(stanza_t *st)
+{
+    char *argv[] = { s_path, NULL };
+    int64_t now = esp_timer_get_time();
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    st->start_us = now;
+    st->info.state = BREEZY_INIT_RUNNING;
+    xSemaphoreGive(s_lock);
+
+    int ret = breezy_script_run_text(st->text, 1, argv);
+    free(st->text);
+    st->text = NULL;
+
+    now = esp_timer_get_time();
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    st->end_us = now;
+    st->info.ret = ret;
+    st->info.state = BREEZY_INIT_DONE;
+    xSemaphoreGive(s_lock);
+    return ret;
+}
+
+static void stanza_task(void *arg)
+{
+    stanza_t *st = (stanza_t *)arg;
+
+    for (int i = 0; i < st->nafter; i++) {
+        SemaphoreHandle_t dep = s_stanzas[st->after[i]].done;
+        xSemaphoreTake(dep, portMAX_DELAY);
+        xSemaphoreGive(dep);
+    }
+
+    // stdin/stdout are per-task in ESP-IDF newlib
+    FILE *saved_in = stdin;
+    FILE *saved_out = stdout;
+    FILE *saved_err = stderr;
+    if (st->in) stdin = st->in;
+    stdout = st->out;
+    stderr = st->err;
+
+    int ret = run_text(st);
+    fflush(stdout);
+
+    stdin = saved_in;
+    stdout = saved_out;
+    stderr = saved_err;
+    if (st->in) fclose(st->in);
+
+    ESP_LOGI(TAG, "%s: status %d after %u ms", st->info.name, ret,
+             (unsigned)((st->end_us - st->start_us) / 1000));
+
+    xSemaphoreGive(st->done);
+    vTaskDelete(NULL);
+}
+
+static void start_stanza(stanza_t *st)
+{
+    // Stanzas get EOF instead of competing for the console
+    FILE *wr = NULL;
+    if (breezy_pipe_open(&st->in, &wr, 16) == 0) {
+        fclose(wr);
+    } else {
+        st->in = NULL;
+    }
+    st->out = stdout;
+    st->err = stderr;
+
+    // Background stanzas a notch below the shell, like jobs
+    UBaseType_t prio = uxTaskPriorityGet(NULL);
+    if (st->info.background && prio > 1) prio--;
+
+    if (xTaskCreate(stanza_task, st->info.name, STANZA_STACK_SIZE, st, prio, NULL) != pdPASS) {
+        printf("init: cannot start %s\n", st->info.name);
+        if (st->in) fclose(st->in);
+        free(st->text);
+        st->text = NULL;
+
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        st->info.state = BREEZY_INIT_DONE;
+        st->info.ret = -1;
+        xSemaphoreGive(s_lock);
+        xSemaphoreGive(st->done);
+    }
+}
+
+int breezy_init_run(const char *path)
+{
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutex();
+    }
+    if (s_count > 0) {
+        printf("init: already run\n");
+        return 2;
+    }
+
+    s_start_us = esp_timer_get_time();
+    s_path = strdup(path);
+    char *text = s_path ? read_file(path) : NULL;
+    if (!text) {
+        printf("init: cannot read %s\n", path);
+        return 2;
+    }
+
+    int err = split(text);
+    free(text);
+    if (err != 0) {
+        for (int i = 0; i < s_count; i++) free(s_stanzas[i].text);
+        s_count = 0;
+        return 2;
+    }
+
+    strcpy(s_stanzas[0].info.name, "main");
+    int ret = run_text(&s_stanzas[0]);
+
+    for (int i = 1; i < s_count; i++) {
+        s_stanzas[i].done = xSemaphoreCreateBinary();
+        if (!s_stanzas[i].done) {
+            printf("init: out of memory\n");
+            for (int j = i; j < s_count; j++) free(s_stanzas[j].text);
+            s_count = i;
+            break;
+        }
+    }
+    for (int i = 1; i < s_count; i++) {
+        start_stanza(&s_stanzas[i]);
+    }
+
+    // The prompt waits for the foreground stanzas only
+    for (int i = 1; i < s_count; i++) {
+        if (s_stanzas[i].info.background) continue;
+        xSemaphoreTake(s_stanzas[i].done, portMAX_DELAY);
+        xSemaphoreGive(s_stanzas[i].done);
+    }
+
+    int64_t now = esp_timer_get_time();
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_prompt_us = now;
+    xSemaphoreGive(s_lock);
+
+    if (s_count > 1) {
+        ESP_LOGI(TAG, "prompt after %u ms", (unsigned)ms_since_start(now));
+    }
+    return ret;
+}
+
+size_t breezy_init_list(breezy_init_info_t *out, size_t max, uint32_t *prompt_ms)
+{
+    if (!s_lock) return 0;
+
+    int64_t now = esp_timer_get_time();
+    size_t n = 0;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < s_count && n < max; i++, n++) {
+        const stanza_t *st = &s_stanzas[i];
+        out[n] = st->info;
+        out[n].start_ms = 0;
+        out[n].run_ms = 0;
+        if (st->info.state != BREEZY_INIT_WAITING) {
+            out[n].start_ms = ms_since_start(st->start_us);
+            int64_t end = st->info.state == BREEZY_INIT_DONE ? st->end_us : now;
+            out[n].run_ms = (uint32_t)((end - st->start_us) / 1000);
+        }
+    }
+    if (prompt_ms) *prompt_ms = s_prompt_us ? ms_since_start(s_prompt_us) : 0;
+    xSemaphoreGive(s_lock);
+    return n;
+}
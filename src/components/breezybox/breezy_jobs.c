@@ -0,0 +1,308 @@
+/*
+ * breezy_jobs.c - Background jobs
+ *
+ * Each job is a task running breezybox_exec() on its command line. The
+ * tasks it spawns for pipeline stages register themselves here too, so a
+ * program started anywhere in the job knows which job it belongs to and
+ * `kill` can find it.
+ */
+
+#include "breezy_jobs.h"
+#include "breezy_exec.h"
+#include "breezy_elf.h"
+#include "breezy_pipe.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef CONFIG_BREEZYBOX_STAGE_STACK_SIZE
+#define JOB_STACK_SIZE CONFIG_BREEZYBOX_STAGE_STACK_SIZE
+#else
+#define JOB_STACK_SIZE 8192
+#endif
+
+#ifdef CONFIG_BREEZYBOX_JOB_CORE
+#define JOB_CORE CONFIG_BREEZYBOX_JOB_CORE
+#else
+#define JOB_CORE -1
+#endif
+
+// Job tasks plus their pipeline stage tasks
+#define JOBS_MAX_TASKS (BREEZY_JOBS_MAX * 4)
+
+typedef struct {
+    int id;                     // 0 = free slot
+    uint32_t seq;               // Start order; 0 until started
+    char *cmd;
+    FILE *in;                   // Read end of a closed pipe: always EOF
+    FILE *out;
+    FILE *err;
+    bool done;
+    bool waited;                // fg owns it now; report leaves it alone
+    int ret;
+    SemaphoreHandle_t finished;
+} job_t;
+
+typedef struct {
+    TaskHandle_t task;
+    int job;
+} job_task_t;
+
+static job_t s_jobs[BREEZY_JOBS_MAX];
+static job_task_t s_tasks[JOBS_MAX_TASKS];
+static uint32_t s_seq = 0;
+static SemaphoreHandle_t s_lock = NULL;
+
+void breezy_jobs_init(void)
+{
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutex();
+    }
+}
+
+// ============ Task Membership ============
+
+int breezy_jobs_current(void)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    int job = 0;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < JOBS_MAX_TASKS; i++) {
+        if (s_tasks[i].task == self) {
+            job = s_tasks[i].job;
+            break;
+        }
+    }
+    xSemaphoreGive(s_lock);
+    return job;
+}
+
+void breezy_jobs_enter(int job)
+{
+    if (job == 0) return;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < JOBS_MAX_TASKS; i++) {
+        if (!s_tasks[i].task) {
+            s_tasks[i].task = xTaskGetCurrentTaskHandle();
+            s_tasks[i].job = job;
+            break;
+        }
+    }
+    // Table full: the task's programs just can't be killed
+    xSemaphoreGive(s_lock);
+}
+
+void breezy_jobs_leave(void)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < JOBS_MAX_TASKS; i++) {
+        if (s_tasks[i].task == self) {
+            s_tasks[i].task = NULL;
+            s_tasks[i].job = 0;
+        }
+    }
+    xSemaphoreGive(s_lock);
+}
+
+// ============ Jobs ============
+
+static job_t *find_job(int id)
+{
+    job_t *found = NULL;
+    for (int i = 0; i < BREEZY_JOBS_MAX; i++) {
+        job_t *j = &s_jobs[i];
+        if (!j->seq) continue;  // Free, or still starting
+        if (id ? j->id == id : (!found || j->seq > found->seq)) found = j;
+    }
+    return found;
+}
+
+// Call with the lock held, on a finished job
+static void job_free(job_t *j)
+{
+    free(j->cmd);
+    vSemaphoreDelete(j->finished);
+    memset(j, 0, sizeof(*j));
+}
+
+static void job_task(void *arg)
+{
+    job_t *j = (job_t *)arg;
+    breezy_jobs_enter(j->id);
+
+    // stdin/stdout are per-task in ESP-IDF newlib
+    FILE *saved_in = stdin;
+    FILE *saved_out = stdout;
+    FILE *saved_err = stderr;
+    stdin = j->in;
+    stdout = j->out;
+    stderr = j->err;
+
+    int ret = breezybox_exec(j->cmd);
+    fflush(stdout);
+
+    stdin = saved_in;
+    stdout = saved_out;
+    stderr = saved_err;
+    fclose(j->in);
+
+    breezy_jobs_leave();
+
+    // Given under the lock: once it is released, report or the waiter may
+    // free j at any moment
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    j->ret = ret;
+    j->done = true;
+    xSemaphoreGive(j->finished);
+    xSemaphoreGive(s_lock);
+
+    vTaskDelete(NULL);
+}
+
+int breezy_jobs_start(const char *cmdline)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    job_t *j = NULL;
+    for (int i = 0; i < BREEZY_JOBS_MAX; i++) {
+        if (!s_jobs[i].id) {
+            j = &s_jobs[i];
+            j->id = i + 1;  // Claimed; filled in below
+            break;
+        }
+    }
+    xSemaphoreGive(s_lock);
+
+    if (!j) {
+        printf("Too many jobs\n");
+        return -1;
+    }
+
+    // Background jobs get EOF instead of competing for the console
+    FILE *wr = NULL;
+    j->cmd = strdup(cmdline);
+    j->finished = xSemaphoreCreateBinary();
+    if (j->cmd && j->finished && breezy_pipe_open(&j->in, &wr, 16) == 0) {
+        fclose(wr);
+    } else {
+        j->in = NULL;
+    }
+    j->out = stdout;
+    j->err = stderr;
+
+    // A notch below the shell, so the prompt stays responsive
+    UBaseType_t prio = uxTaskPriorityGet(NULL);
+    if (prio > 1) prio--;
+    int core = JOB_CORE;
+    if (core < 0 || core >= portNUM_PROCESSORS) core = tskNO_AFFINITY;
+
+    if (!j->in || xTaskCreatePinnedToCore(job_task, "breezy_job", JOB_STACK_SIZE,
+                                          j, prio, NULL, core) != pdPASS) {
+        printf("Cannot start job\n");
+        if (j->in) fclose(j->in);
+        free(j->cmd);
+        if (j->finished) vSemaphoreDelete(j->finished);
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        memset(j, 0, sizeof(*j));
+        xSemaphoreGive(s_lock);
+        return -1;
+    }
+
+    // Visible to jobs/fg/kill from here on
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    j->seq = ++s_seq;
+    int id = j->id;
+    xSemaphoreGive(s_lock);
+    return id;
+}
+
+size_t breezy_jobs_list(breezy_job_info_t *out, size_t max)
+{
+    const job_t *sorted[BREEZY_JOBS_MAX];
+    size_t count = 0;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < BREEZY_JOBS_MAX; i++) {
+        const job_t *j = &s_jobs[i];
+        if (!j->seq) continue;
+
+        // Oldest first
+        size_t k = count++;
+        while (k > 0 && sorted[k - 1]->seq > j->seq) {
+            sorted[k] = sorted[k - 1];
+            k--;
+        }
+        sorted[k] = j;
+    }
+
+    size_t n;
+    for (n = 0; n < count && n < max; n++) {
+        memset(&out[n], 0, sizeof(out[n]));
+        out[n].id = sorted[n]->id;
+        out[n].done = sorted[n]->done;
+        out[n].ret = sorted[n]->ret;
+        strncpy(out[n].cmd, sorted[n]->cmd, sizeof(out[n].cmd) - 1);
+    }
+    xSemaphoreGive(s_lock);
+    return n;
+}
+
+int breezy_jobs_wait(int id, int *ret)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    job_t *j = find_job(id);
+    SemaphoreHandle_t finished = NULL;
+    if (j && !j->waited) {
+        // From here only this waiter frees the job
+        j->waited = true;
+        finished = j->finished;
+    }
+    xSemaphoreGive(s_lock);
+
+    if (!finished) return -1;
+
+    // Given once by the job task
+    xSemaphoreTake(finished, portMAX_DELAY);
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int waited = j->id;
+    if (ret) *ret = j->ret;
+    job_free(j);
+    xSemaphoreGive(s_lock);
+    return waited;
+}
+
+int breezy_jobs_kill(int id)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    job_t *j = find_job(id);
+    bool running = j && !j->done;
+    int found = j ? j->id : -1;
+    xSemaphoreGive(s_lock);
+
+    if (found < 0) return -1;
+    return running ? breezy_elf_kill_job(found) : 0;
+}
+
+void breezy_jobs_report(void)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < BREEZY_JOBS_MAX; i++) {
+        job_t *j = &s_jobs[i];
+        if (!j->seq || !j->done || j->waited) continue;
+
+        if (j->ret == 0) {
+            printf("[%d] Done  %s\n", j->id, j->cmd);
+        } else {
+            printf("[%d] Exit %d  %s\n", j->id, j->ret, j->cmd);
+        }
+        job_free(j);
+    }
+    xSemaphoreGive(s_lock);
+}
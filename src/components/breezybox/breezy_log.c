@@ -0,0 +1,213 @@
+/*
+ * breezy_log.c - Per-task log routing and the dmesg ring buffer
+ *
+ * The ring is indexed by a free-running byte count: a writer claims
+ * [head, head + len) with atomic_fetch_add and copies its line in, masking
+ * with the power-of-two size. Nothing orders writers against readers, so a
+ * line that is being written while `dmesg` reads may come out garbled.
+ *
+ * Quiet tasks are kept in a small table keyed by task handle, like the
+ * arena and profile tables. s_quiet_count lets the common case - nobody
+ * quiet - skip the table.
+ */
+
+#include "breezy_log.h"
+#include "esp_log.h"
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef CONFIG_BREEZYBOX_DMESG_SIZE
+#define DMESG_SIZE CONFIG_BREEZYBOX_DMESG_SIZE
+#else
+#define DMESG_SIZE 4096
+#endif
+
+#define LOG_LINE_MAX    256
+#define LOG_MAX_QUIET   16
+
+typedef struct {
+    TaskHandle_t task;
+    int depth;
+} quiet_slot_t;
+
+static char s_ring[DMESG_SIZE];
+static uint32_t s_mask = 0;         // Power-of-two size used, minus 1
+static atomic_uint s_head = 0;      // Bytes ever written
+static atomic_uint s_clear = 0;     // s_head at the last clear
+
+static vprintf_like_t s_next = NULL;
+
+static quiet_slot_t s_quiet[LOG_MAX_QUIET];
+static atomic_int s_quiet_count = 0;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// ============ Ring Buffer ============
+
+static void ring_write(const char *text, size_t len)
+{
+    if (len > s_mask + 1) {
+        text += len - (s_mask + 1);
+        len = s_mask + 1;
+    }
+
+    uint32_t pos = atomic_fetch_add(&s_head, (unsigned)len) & s_mask;
+    size_t first = s_mask + 1 - pos;
+    if (first > len) first = len;
+    memcpy(s_ring + pos, text, first);
+    memcpy(s_ring, text + first, len - first);
+}
+
+size_t breezy_log_read(char *out, size_t size)
+{
+    if (!s_mask) return 0;
+
+    uint32_t head = atomic_load(&s_head);
+    uint32_t clear = atomic_load(&s_clear);
+    uint32_t avail = head - clear;
+    bool cut = false;
+    if (avail > s_mask + 1) {
+        avail = s_mask + 1;
+        cut = true;
+    }
+    if (avail > size) {
+        avail = size;
+        cut = true;
+    }
+
+    uint32_t start = head - avail;
+    for (uint32_t i = 0; i < avail; i++) {
+        out[i] = s_ring[(start + i) & s_mask];
+    }
+
+    // The oldest line lost its beginning; start at the next one
+    if (!cut) return avail;
+    char *nl = memchr(out, '\n', avail);
+    if (!nl) return 0;
+    size_t skip = nl + 1 - out;
+    memmove(out, nl + 1, avail - skip);
+    return avail - skip;
+}
+
+size_t breezy_log_size(void)
+{
+    return s_mask ? s_mask + 1 : 0;
+}
+
+void breezy_log_clear(void)
+{
+    atomic_store(&s_clear, atomic_load(&s_head));
+}
+
+// ============ Quiet Tasks ============
+
+int breezy_log_quiet_begin(void)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    int ret = -1;
+
+    portENTER_CRITICAL(&s_lock);
+    quiet_slot_t *free_slot = NULL;
+    for (int i = 0; i < LOG_MAX_QUIET; i++) {
+        if (s_quiet[i].task == self) {
+            s_quiet[i].depth++;
+            ret = 0;
+            break;
+        }
+        if (!s_quiet[i].task && !free_slot) free_slot = &s_quiet[i];
+    }
+    if (ret != 0 && free_slot) {
+        free_slot->task = self;
+        free_slot->depth = 1;
+        atomic_fetch_add(&s_quiet_count, 1);
+        ret = 0;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return ret;
+}
+
+static void drop_task(TaskHandle_t task, bool all)
+{
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < LOG_MAX_QUIET; i++) {
+        if (s_quiet[i].task != task) continue;
+        if (all || --s_quiet[i].depth <= 0) {
+            s_quiet[i].task = NULL;
+            s_quiet[i].depth = 0;
+            atomic_fetch_sub(&s_quiet_count, 1);
+        }
+        break;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void breezy_log_quiet_end(void)
+{
+    drop_task(xTaskGetCurrentTaskHandle(), false);
+}
+
+void breezy_log_forget(TaskHandle_t task)
+{
+    if (task) drop_task(task, true);
+}
+
+bool breezy_log_is_quiet(void)
+{
+    if (atomic_load(&s_quiet_count) == 0) return false;
+
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    bool quiet = false;
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < LOG_MAX_QUIET; i++) {
+        if (s_quiet[i].task == self) {
+            quiet = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return quiet;
+}
+
+// ============ Filter ============
+
+static int call_next(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int ret = s_next(fmt, args);
+    va_end(args);
+    return ret;
+}
+
+static int log_vprintf(const char *fmt, va_list args)
+{
+    char line[LOG_LINE_MAX];
+    va_list copy;
+    va_copy(copy, args);
+    int len = vsnprintf(line, sizeof(line), fmt, copy);
+    va_end(copy);
+    if (len < 0) return len;
+
+    size_t kept = (size_t)len < sizeof(line) ? (size_t)len : sizeof(line) - 1;
+    ring_write(line, kept);
+
+    if (breezy_log_is_quiet()) return len;
+
+    // Formatted once unless the line didn't fit
+    if ((size_t)len == kept) return call_next("%s", line);
+    return s_next(fmt, args);
+}
+
+void breezy_log_init(void)
+{
+    if (s_next) return;
+
+    uint32_t size = 1;
+    while (size * 2 <= DMESG_SIZE) size *= 2;
+    s_mask = size - 1;
+
+    s_next = esp_log_set_vprintf(log_vprintf);
+    if (!s_next) s_next = vprintf;
+}
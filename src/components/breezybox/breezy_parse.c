@@ -0,0 +1,624 @@
+/*
+ * breezy_parse.c - Single-pass command-line tokenizer
+ *
+ * The source is read once, left to right. Word bytes, with quotes removed
+ * and variables expanded, are appended to the text buffer; each finished
+ * word is NUL-terminated there and becomes an argv entry or a redirect
+ * target. The argv arrays of all stages share the words buffer, each
+ * followed by its NULL.
+ *
+ * Past the end of a buffer the pass only counts, so when the line's fixed
+ * buffers are too small it has measured what a second pass needs.
+ */
+
+#include "breezy_parse.h"
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VAR_NAME_MAX    32
+#define ARITH_MAX       128     // Bytes of one $((...)) expression
+
+#define WORD_ENDS       " \t|<>&"
+#define DQ_ESCAPES      "\"\\$"         // What \ escapes inside "..."
+#define QUOTE_CHARS     " \t\n|<>&'\"\\$"  // Make a word need quoting
+
+typedef enum {
+    TARGET_NONE,
+    TARGET_IN,
+    TARGET_OUT,
+} target_t;
+
+typedef struct {
+    breezy_line_t *line;
+    const breezy_parse_opts_t *opts;
+    char *text;                 // Buffers being filled, and their sizes
+    size_t text_cap;
+    char **words;
+    int words_cap;
+    breezy_line_stage_t *stages;
+    int stages_cap;
+    breezy_line_stage_t spare;  // Stands in for stages past stages_cap
+    const char *p;              // Next source byte
+    size_t len;                 // Bytes of text so far, written or not
+    int nwords;                 // Entries of words so far, NULLs included
+    int nstages;
+    size_t word;                // Offset of the current word in text
+    target_t target;            // What the current word is for
+    bool quoted;                // The current word had quotes
+} parser_t;
+
+static int fail(parser_t *ps, const char *fmt, ...)
+{
+    if (!ps->line->error[0]) {
+        va_list ap;
+        va_start(ap, fmt);
+        vsnprintf(ps->line->error, sizeof(ps->line->error), fmt, ap);
+        va_end(ap);
+    }
+    return -1;
+}
+
+static void emit(parser_t *ps, char c)
+{
+    if (ps->len < ps->text_cap) ps->text[ps->len] = c;
+    ps->len++;
+}
+
+static bool fits(const parser_t *ps)
+{
+    return ps->len <= ps->text_cap && ps->nwords <= ps->words_cap &&
+           ps->nstages <= ps->stages_cap;
+}
+
+static breezy_line_stage_t *stage(parser_t *ps)
+{
+    return ps->nstages <= ps->stages_cap ? &ps->stages[ps->nstages - 1] : &ps->spare;
+}
+
+static void add_word(parser_t *ps, char *word)
+{
+    if (ps->nwords < ps->words_cap) ps->words[ps->nwords] = word;
+    ps->nwords++;
+}
+
+static void new_stage(parser_t *ps)
+{
+    ps->nstages++;
+    breezy_line_stage_t *st = stage(ps);
+    memset(st, 0, sizeof(*st));
+    st->argv = ps->nwords < ps->words_cap ? &ps->words[ps->nwords] : NULL;
+}
+
+static bool is_name_char(char c)
+{
+    return c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9');
+}
+
+static const char *lookup(parser_t *ps, const char *name, size_t len)
+{
+    if (ps->opts->lookup) return ps->opts->lookup(ps->opts->ctx, name, len);
+
+    // The prompt has no status or arguments
+    if (isdigit((unsigned char)*name) || !is_name_char(*name) || len >= VAR_NAME_MAX) {
+        return NULL;
+    }
+    char key[VAR_NAME_MAX];
+    memcpy(key, name, len);
+    key[len] = '\0';
+    return getenv(key);
+}
+
+// NUL-terminate the current word and file it as an argument or redirect
+// target, then start the next one
+static int end_word(parser_t *ps)
+{
+    emit(ps, '\0');
+    char *word = ps->len <= ps->text_cap ? ps->text + ps->word : NULL;
+    breezy_line_stage_t *st = stage(ps);
+
+    if (ps->target == TARGET_IN) {
+        st->infile = word;
+    } else if (ps->target == TARGET_OUT) {
+        st->outfile = word;
+    } else if (ps->len == ps->word + 1 && !ps->quoted) {
+        ps->len = ps->word;     // An unquoted empty expansion is no word at all
+    } else {
+        add_word(ps, word);
+        st->argc++;
+    }
+    ps->target = TARGET_NONE;
+    ps->word = ps->len;
+    ps->quoted = false;
+    return 0;
+}
+
+// Append an expansion's value; unquoted, with opts->split, blanks in it
+// end the word
+static int emit_value(parser_t *ps, const char *value, bool unquoted)
+{
+    bool split = unquoted && ps->opts->split;
+    for (; *value; value++) {
+        if (!split || !strchr(" \t\n", *value)) {
+            emit(ps, *value);
+        } else if (ps->len > ps->word || ps->quoted) {
+            if (ps->target != TARGET_NONE) return fail(ps, "Syntax error: ambiguous redirect");
+            if (end_word(ps) != 0) return -1;
+        }
+    }
+    return 0;
+}
+
+// ============ $((...)) ============
+
+typedef struct {
+    parser_t *ps;
+    const char *p;
+    bool failed;
+} arith_t;
+
+static long arith_expr(arith_t *a);
+
+static void arith_space(arith_t *a)
+{
+    while (isspace((unsigned char)*a->p)) a->p++;
+}
+
+static long arith_primary(arith_t *a)
+{
+    arith_space(a);
+    char ch = *a->p;
+
+    if (ch == '(') {
+        a->p++;
+        long v = arith_expr(a);
+        arith_space(a);
+        if (*a->p == ')') {
+            a->p++;
+        } else {
+            a->failed = true;
+        }
+        return v;
+    }
+    if (ch == '-' || ch == '+' || ch == '!') {
+        a->p++;
+        long v = arith_primary(a);
+        return ch == '-' ? -v : ch == '!' ? !v : v;
+    }
+    if (isdigit((unsigned char)ch)) {
+        char *end;
+        long v = strtol(a->p, &end, 10);
+        a->p = end;
+        return v;
+    }
+
+    if (ch == '$') a->p++;
+    const char *name = a->p;
+    while (is_name_char(*a->p)) a->p++;
+    if (a->p == name) {
+        a->failed = true;
+        return 0;
+    }
+    if (a->ps->opts->syntax_only) return 0;
+    const char *value = lookup(a->ps, name, a->p - name);
+    return value ? strtol(value, NULL, 10) : 0;
+}
+
+static long arith_mul(arith_t *a)
+{
+    long v = arith_primary(a);
+    for (;;) {
+        arith_space(a);
+        char op = *a->p;
+        if (op != '*' && op != '/' && op != '%') return v;
+        a->p++;
+        long rhs = arith_primary(a);
+        if (op == '*') {
+            v *= rhs;
+        } else if (rhs == 0) {
+            // Only known to be zero when it runs
+            if (!a->ps->opts->syntax_only) a->failed = true;
+        } else {
+            v = op == '/' ? v / rhs : v % rhs;
+        }
+    }
+}
+
+static long arith_add(arith_t *a)
+{
+    long v = arith_mul(a);
+    for (;;) {
+        arith_space(a);
+        char op = *a->p;
+        if (op != '+' && op != '-') return v;
+        a->p++;
+        long rhs = arith_mul(a);
+        v = op == '+' ? v + rhs : v - rhs;
+    }
+}
+
+static long arith_cmp(arith_t *a)
+{
+    static const char *const ops[] = { "==", "!=", "<=", ">=", "<", ">" };
+
+    long v = arith_add(a);
+    for (;;) {
+        arith_space(a);
+        int op = -1;
+        for (int i = 0; i < 6 && op < 0; i++) {
+            if (strncmp(a->p, ops[i], strlen(ops[i])) == 0) op = i;
+        }
+        if (op < 0) return v;
+        a->p += strlen(ops[op]);
+
+        long rhs = arith_add(a);
+        switch (op) {
+        case 0: v = v == rhs; break;
+        case 1: v = v != rhs; break;
+        case 2: v = v <= rhs; break;
+        case 3: v = v >= rhs; break;
+        case 4: v = v < rhs; break;
+        default: v = v > rhs; break;
+        }
+    }
+}
+
+static long arith_expr(arith_t *a)
+{
+    long v = arith_cmp(a);
+    for (;;) {
+        arith_space(a);
+        if (a->p[0] == '&' && a->p[1] == '&') {
+            a->p += 2;
+            long rhs = arith_cmp(a);
+            v = v && rhs;
+        } else if (a->p[0] == '|' && a->p[1] == '|') {
+            a->p += 2;
+            long rhs = arith_cmp(a);
+            v = v || rhs;
+        } else {
+            return v;
+        }
+    }
+}
+
+// The "))" ending the expression that starts at expr, or NULL
+static const char *arith_close(const char *expr)
+{
+    int depth = 0;
+    for (const char *q = expr; *q; q++) {
+        if (depth == 0 && q[0] == ')' && q[1] == ')') return q;
+        if (*q == '(') depth++;
+        if (*q == ')') depth--;
+    }
+    return NULL;
+}
+
+// At "$((": append the value of the expression
+static int expand_arith(parser_t *ps)
+{
+    const char *expr = ps->p + 3;
+    const char *close = arith_close(expr);
+    if (!close) return fail(ps, "Syntax error: unterminated $((");
+
+    char text[ARITH_MAX];
+    size_t len = close - expr;
+    if (len >= sizeof(text)) return fail(ps, "Expression too long");
+    memcpy(text, expr, len);
+    text[len] = '\0';
+
+    arith_t a = { .ps = ps, .p = text };
+    long v = arith_expr(&a);
+    arith_space(&a);
+    if (a.failed || *a.p) return fail(ps, "Bad expression: %.40s", text);
+    ps->p = close + 2;
+
+    if (!ps->opts->syntax_only) {
+        char num[24];
+        snprintf(num, sizeof(num), "%ld", v);
+        emit_value(ps, num, false);
+    }
+    return 0;
+}
+
+// ============ Words ============
+
+// At '$': append what it expands to, or the '$' itself if no name follows
+static int expand_dollar(parser_t *ps, bool unquoted)
+{
+    const char *p = ps->p + 1;
+    if (p[0] == '(') {
+        if (p[1] == '(') return expand_arith(ps);
+        return fail(ps, "Syntax error: $(...) is not supported");
+    }
+
+    bool braced = *p == '{';
+    if (braced) p++;
+
+    const char *name = p;
+    if (*p && strchr("?#@", *p)) {
+        p++;
+    } else if (!braced && isdigit((unsigned char)*p)) {
+        p++;                    // $10 is $1 then 0
+    } else {
+        while (is_name_char(*p)) p++;
+    }
+    size_t len = p - name;
+
+    if (len == 0 || (braced && *p != '}')) {
+        emit(ps, '$');
+        ps->p++;
+        return 0;
+    }
+    if (braced) p++;
+    ps->p = p;
+
+    if (ps->opts->syntax_only) return 0;
+    const char *value = lookup(ps, name, len);
+    return value ? emit_value(ps, value, unquoted) : 0;
+}
+
+// Append one word's bytes, up to an unquoted blank or operator
+static int scan_word(parser_t *ps)
+{
+    while (*ps->p && !strchr(WORD_ENDS, *ps->p)) {
+        char c = *ps->p;
+        if (c == '\\' && ps->p[1]) {
+            emit(ps, ps->p[1]);
+            ps->p += 2;
+        } else if (c == '\'') {
+            ps->quoted = true;
+            const char *close = strchr(ps->p + 1, '\'');
+            if (!close) return fail(ps, "Syntax error: unterminated quote");
+            for (const char *q = ps->p + 1; q < close; q++) emit(ps, *q);
+            ps->p = close + 1;
+        } else if (c == '"') {
+            ps->quoted = true;
+            ps->p++;
+            while (*ps->p != '"') {
+                if (!*ps->p) return fail(ps, "Syntax error: unterminated quote");
+                if (*ps->p == '\\' && ps->p[1] && strchr(DQ_ESCAPES, ps->p[1])) {
+                    emit(ps, ps->p[1]);
+                    ps->p += 2;
+                } else if (*ps->p == '$') {
+                    if (expand_dollar(ps, false) != 0) return -1;
+                } else {
+                    emit(ps, *ps->p++);
+                }
+            }
+            ps->p++;
+        } else if (c == '$') {
+            if (expand_dollar(ps, true) != 0) return -1;
+        } else {
+            emit(ps, c);
+            ps->p++;
+        }
+    }
+    return 0;
+}
+
+// One pass over src into ps's buffers. Returns -1 on a syntax error;
+// otherwise ps has counted what the line needs, whether or not it fit.
+static int parse_pass(parser_t *ps, const char *src)
+{
+    ps->p = src;
+    ps->len = 0;
+    ps->nwords = 0;
+    ps->nstages = 0;
+    ps->target = TARGET_NONE;
+    ps->line->background = false;
+    new_stage(ps);
+
+    while (true) {
+        char c = *ps->p;
+        if (c == ' ' || c == '\t') {
+            ps->p++;
+            continue;
+        }
+
+        if ((c == '&' || c == '|') && ps->p[1] == c) {
+            return fail(ps, "Syntax error: && and || are not supported");
+        }
+
+        if (c == '\0' || c == '|' || c == '&') {
+            if (ps->target != TARGET_NONE) goto missing_target;
+            if (stage(ps)->argc == 0 && (ps->nstages > 1 || c == '|')) {
+                return fail(ps, "Syntax error: empty command in pipeline");
+            }
+            add_word(ps, NULL);
+            if (c == '\0') break;
+
+            if (c == '&') {
+                ps->p += strspn(ps->p + 1, " \t") + 1;
+                if (*ps->p) return fail(ps, "Syntax error: & must end the line");
+                ps->line->background = true;
+                break;
+            }
+
+            new_stage(ps);
+            ps->p++;
+            continue;
+        }
+
+        if (c == '<' || c == '>') {
+            if (ps->target != TARGET_NONE) goto missing_target;
+            breezy_line_stage_t *st = stage(ps);
+            ps->target = c == '<' ? TARGET_IN : TARGET_OUT;
+            if (c == '>') st->append = ps->p[1] == '>';
+            ps->p += st->append && c == '>' ? 2 : 1;
+            continue;
+        }
+
+        // A word: argument or redirect target
+        ps->word = ps->len;
+        ps->quoted = false;
+        if (scan_word(ps) != 0 || end_word(ps) != 0) return -1;
+    }
+    return 0;
+
+missing_target:
+    return fail(ps, "Syntax error: missing file after %c", ps->target == TARGET_IN ? '<' : '>');
+}
+
+int breezy_parse_line(const char *src, breezy_line_t *line, const breezy_parse_opts_t *opts)
+{
+    static const breezy_parse_opts_t s_prompt = { 0 };
+    parser_t ps = {
+        .line = line,
+        .opts = opts ? opts : &s_prompt,
+        .text = line->text_buf,
+        .text_cap = sizeof(line->text_buf),
+        .words = line->word_buf,
+        .words_cap = sizeof(line->word_buf) / sizeof(line->word_buf[0]),
+        .stages = line->stage_buf,
+        .stages_cap = BREEZY_LINE_MAX_STAGES,
+    };
+
+    line->heap = NULL;
+    line->error[0] = '\0';
+    if (parse_pass(&ps, src) != 0) return -1;
+
+    if (!fits(&ps)) {
+        // Again, into one block of the size the first pass counted
+        size_t stages_size = ps.nstages * sizeof(breezy_line_stage_t);
+        size_t words_size = ps.nwords * sizeof(char *);
+        line->heap = malloc(stages_size + words_size + ps.len);
+        if (!line->heap) return fail(&ps, "Out of memory");
+
+        ps.stages = line->heap;
+        ps.stages_cap = ps.nstages;
+        ps.words = (char **)((char *)line->heap + stages_size);
+        ps.words_cap = ps.nwords;
+        ps.text = (char *)ps.words + words_size;
+        ps.text_cap = ps.len;
+
+        // Only a variable changed by another task can make it differ
+        if (parse_pass(&ps, src) != 0 || !fits(&ps)) {
+            breezy_line_free(line);
+            return fail(&ps, "Command line changed while parsing");
+        }
+    }
+
+    line->stages = ps.stages;
+    line->nstages = ps.nstages;
+    return 0;
+}
+
+void breezy_line_free(breezy_line_t *line)
+{
+    free(line->heap);
+    line->heap = NULL;
+}
+
+// Past one piece of source as scan_word() reads it: a byte, an escape, a
+// quoted string or a $((...))
+static const char *skip_piece(const char *p)
+{
+    if (p[0] == '\\' && p[1]) return p + 2;
+
+    if (p[0] == '\'') {
+        const char *close = strchr(p + 1, '\'');
+        return close ? close + 1 : p + strlen(p);
+    }
+    if (p[0] == '"') {
+        p++;
+        while (*p && *p != '"') {
+            p += *p == '\\' && p[1] && strchr(DQ_ESCAPES, p[1]) ? 2 : 1;
+        }
+        return *p ? p + 1 : p;
+    }
+    if (p[0] == '$' && p[1] == '(' && p[2] == '(') {
+        const char *close = arith_close(p + 3);
+        return close ? close + 2 : p + strlen(p);
+    }
+    return p + 1;
+}
+
+size_t breezy_parse_span(const char *src, const char *stops)
+{
+    const char *p = src;
+    while (*p && !strchr(stops, *p)) p = skip_piece(p);
+    return p - src;
+}
+
+// Append word, single-quoted if the tokenizer would read anything in it
+static char *put_word(char *p, const char *word)
+{
+    size_t len = strlen(word);
+    if (len > 0 && strcspn(word, QUOTE_CHARS) == len) {
+        memcpy(p, word, len);
+        return p + len;
+    }
+
+    *p++ = '\'';
+    for (; *word; word++) {
+        if (*word == '\'') {
+            memcpy(p, "'\\''", 4);
+            p += 4;
+        } else {
+            *p++ = *word;
+        }
+    }
+    *p++ = '\'';
+    return p;
+}
+
+char *breezy_parse_format(const breezy_line_t *line)
+{
+    // Worst case: every byte a quote, which takes 4
+    size_t cap = 1;
+    for (int i = 0; i < line->nstages; i++) {
+        const breezy_line_stage_t *st = &line->stages[i];
+        cap += 3;
+        for (int j = 0; j < st->argc; j++) cap += 4 * strlen(st->argv[j]) + 3;
+        if (st->infile) cap += 4 * strlen(st->infile) + 6;
+        if (st->outfile) cap += 4 * strlen(st->outfile) + 6;
+    }
+
+    char *text = malloc(cap);
+    if (!text) return NULL;
+
+    char *p = text;
+    for (int i = 0; i < line->nstages; i++) {
+        const breezy_line_stage_t *st = &line->stages[i];
+        if (i > 0) {
+            memcpy(p, " | ", 3);
+            p += 3;
+        }
+        for (int j = 0; j < st->argc; j++) {
+            if (j > 0) *p++ = ' ';
+            p = put_word(p, st->argv[j]);
+        }
+        if (st->infile) {
+            memcpy(p, " < ", 3);
+            p = put_word(p + 3, st->infile);
+        }
+        if (st->outfile) {
+            const char *op = st->append ? " >> " : " > ";
+            memcpy(p, op, strlen(op));
+            p = put_word(p + strlen(op), st->outfile);
+        }
+    }
+    *p = '\0';
+    return text;
+}
+
+char *breezy_parse_format_argv(int argc, char *const *argv)
+{
+    size_t cap = 1;
+    for (int i = 0; i < argc; i++) cap += 4 * strlen(argv[i]) + 3;
+
+    char *text = malloc(cap);
+    if (!text) return NULL;
+
+    char *p = text;
+    for (int i = 0; i < argc; i++) {
+        if (i > 0) *p++ = ' ';
+        p = put_word(p, argv[i]);
+    }
+    *p = '\0';
+    return text;
+}
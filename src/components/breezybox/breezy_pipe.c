@@ -0,0 +1,237 @@
+/*
+ * breezy_pipe.c - In-memory pipes for shell pipelines
+ *
+ * A pipe is a bounded ring buffer guarded by a mutex, with one binary
+ * semaphore per direction to wake a blocked reader or writer. Both ends
+ * are exposed as ordinary FILE streams (fopencookie), so a pipeline stage
+ * only has to swap its stdin/stdout to use them.
+ *
+ * One reader task and one writer task per pipe.
+ *
+ * Open pipes are listed so a killed program's pipes can be broken from
+ * outside (breezy_pipe_break): both ends then see EOF/EPIPE at once.
+ */
+
+#define _GNU_SOURCE  // fopencookie
+
+#include "breezy_pipe.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef CONFIG_BREEZYBOX_PIPE_BUF_SIZE
+#define PIPE_DEFAULT_CAPACITY CONFIG_BREEZYBOX_PIPE_BUF_SIZE
+#else
+#define PIPE_DEFAULT_CAPACITY 4096
+#endif
+
+typedef struct pipe {
+    struct pipe *next;            // s_pipes
+    FILE *rd_file;
+    FILE *wr_file;
+    SemaphoreHandle_t lock;
+    SemaphoreHandle_t can_read;   // Given when data arrives or writer closes
+    SemaphoreHandle_t can_write;  // Given when space frees up or reader closes
+    uint8_t *buf;
+    size_t cap;
+    size_t head;                  // Next byte to read
+    size_t count;                 // Bytes currently buffered
+    bool rd_closed;
+    bool wr_closed;
+    bool broken;                  // Reads see EOF, writes EPIPE
+} pipe_t;
+
+static pipe_t *s_pipes = NULL;
+static SemaphoreHandle_t s_pipes_lock = NULL;
+static portMUX_TYPE s_init_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static bool pipes_lock_init(void)
+{
+    if (s_pipes_lock) return true;
+
+    SemaphoreHandle_t m = xSemaphoreCreateMutex();
+    portENTER_CRITICAL(&s_init_mux);
+    if (!s_pipes_lock) {
+        s_pipes_lock = m;
+        m = NULL;
+    }
+    portEXIT_CRITICAL(&s_init_mux);
+    if (m) vSemaphoreDelete(m);
+    return s_pipes_lock != NULL;
+}
+
+static void pipe_free(pipe_t *p)
+{
+    if (p->lock) vSemaphoreDelete(p->lock);
+    if (p->can_read) vSemaphoreDelete(p->can_read);
+    if (p->can_write) vSemaphoreDelete(p->can_write);
+    free(p->buf);
+    free(p);
+}
+
+// Drop one end; free the pipe once both ends are gone
+static void pipe_release(pipe_t *p, bool reader)
+{
+    xSemaphoreTake(s_pipes_lock, portMAX_DELAY);
+    xSemaphoreTake(p->lock, portMAX_DELAY);
+    if (reader) {
+        p->rd_closed = true;
+    } else {
+        p->wr_closed = true;
+    }
+    bool last = p->rd_closed && p->wr_closed;
+    xSemaphoreGive(p->can_read);
+    xSemaphoreGive(p->can_write);
+    xSemaphoreGive(p->lock);
+
+    if (last) {
+        for (pipe_t **pp = &s_pipes; *pp; pp = &(*pp)->next) {
+            if (*pp == p) {
+                *pp = p->next;
+                break;
+            }
+        }
+    }
+    xSemaphoreGive(s_pipes_lock);
+
+    if (last) pipe_free(p);
+}
+
+static ssize_t pipe_read(void *cookie, char *data, size_t size)
+{
+    pipe_t *p = cookie;
+
+    xSemaphoreTake(p->lock, portMAX_DELAY);
+    while (p->count == 0 && !p->wr_closed && !p->broken) {
+        xSemaphoreGive(p->lock);
+        xSemaphoreTake(p->can_read, portMAX_DELAY);
+        xSemaphoreTake(p->lock, portMAX_DELAY);
+    }
+    if (p->broken) {
+        xSemaphoreGive(p->lock);
+        return 0;
+    }
+
+    // Copy out in at most two runs (before and after the wrap point)
+    size_t n = (size < p->count) ? size : p->count;
+    size_t first = p->cap - p->head;
+    if (first > n) first = n;
+    memcpy(data, p->buf + p->head, first);
+    memcpy(data + first, p->buf, n - first);
+    p->head = (p->head + n) % p->cap;
+    p->count -= n;
+
+    xSemaphoreGive(p->can_write);
+    xSemaphoreGive(p->lock);
+    return n;  // 0 means EOF
+}
+
+static ssize_t pipe_write(void *cookie, const char *data, size_t size)
+{
+    pipe_t *p = cookie;
+    size_t done = 0;
+
+    xSemaphoreTake(p->lock, portMAX_DELAY);
+    while (done < size) {
+        while (p->count == p->cap && !p->rd_closed && !p->broken) {
+            xSemaphoreGive(p->lock);
+            xSemaphoreTake(p->can_write, portMAX_DELAY);
+            xSemaphoreTake(p->lock, portMAX_DELAY);
+        }
+        if (p->rd_closed || p->broken) {
+            xSemaphoreGive(p->lock);
+            errno = EPIPE;
+            return done > 0 ? (ssize_t)done : -1;
+        }
+
+        size_t space = p->cap - p->count;
+        size_t n = (size - done < space) ? size - done : space;
+        size_t tail = (p->head + p->count) % p->cap;
+        size_t first = p->cap - tail;
+        if (first > n) first = n;
+        memcpy(p->buf + tail, data + done, first);
+        memcpy(p->buf, data + done + first, n - first);
+        p->count += n;
+        done += n;
+
+        xSemaphoreGive(p->can_read);
+    }
+    xSemaphoreGive(p->lock);
+    return done;
+}
+
+static int pipe_close_rd(void *cookie)
+{
+    pipe_release(cookie, true);
+    return 0;
+}
+
+static int pipe_close_wr(void *cookie)
+{
+    pipe_release(cookie, false);
+    return 0;
+}
+
+int breezy_pipe_open(FILE **rd, FILE **wr, size_t capacity)
+{
+    if (capacity == 0) capacity = PIPE_DEFAULT_CAPACITY;
+    if (!pipes_lock_init()) return -1;
+
+    pipe_t *p = calloc(1, sizeof(pipe_t));
+    if (!p) return -1;
+
+    p->cap = capacity;
+    p->buf = malloc(capacity);
+    p->lock = xSemaphoreCreateMutex();
+    p->can_read = xSemaphoreCreateBinary();
+    p->can_write = xSemaphoreCreateBinary();
+    if (!p->buf || !p->lock || !p->can_read || !p->can_write) {
+        pipe_free(p);
+        return -1;
+    }
+
+    cookie_io_functions_t rd_fns = { .read = pipe_read, .close = pipe_close_rd };
+    cookie_io_functions_t wr_fns = { .write = pipe_write, .close = pipe_close_wr };
+
+    *rd = fopencookie(p, "r", rd_fns);
+    if (!*rd) {
+        pipe_free(p);
+        return -1;
+    }
+    *wr = fopencookie(p, "w", wr_fns);
+    if (!*wr) {
+        // Closing the read end alone leaves the writer side marked open
+        p->wr_closed = true;
+        fclose(*rd);
+        *rd = NULL;
+        return -1;
+    }
+
+    p->rd_file = *rd;
+    p->wr_file = *wr;
+    xSemaphoreTake(s_pipes_lock, portMAX_DELAY);
+    p->next = s_pipes;
+    s_pipes = p;
+    xSemaphoreGive(s_pipes_lock);
+    return 0;
+}
+
+bool breezy_pipe_break(FILE *f)
+{
+    if (!f || !s_pipes_lock) return false;
+
+    xSemaphoreTake(s_pipes_lock, portMAX_DELAY);
+    pipe_t *p = s_pipes;
+    while (p && p->rd_file != f && p->wr_file != f) p = p->next;
+    if (p) {
+        xSemaphoreTake(p->lock, portMAX_DELAY);
+        p->broken = true;
+        xSemaphoreGive(p->can_read);
+        xSemaphoreGive(p->can_write);
+        xSemaphoreGive(p->lock);
+    }
+    xSemaphoreGive(s_pipes_lock);
+    return p != NULL;
+}
@@ -0,0 +1,151 @@
+/*
+ * breezy_profile.c - Per-command phase timings and heap use, for `time`
+ *
+ * Profiles are found by task in a small table, the same way arenas are
+ * (breezy_arena.c). Several pipeline stages can add to one profile at
+ * once, so updates go under a spinlock. The free heap is sampled at every
+ * phase boundary; the lowest sample gives the SRAM/PSRAM peaks, so a
+ * short spike inside a phase can be missed.
+ */
+
+#include "breezy_profile.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_sys.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <string.h>
+
+// `time` itself plus the stages of the pipeline it runs
+#define PROFILE_MAX_TASKS 8
+
+typedef struct {
+    TaskHandle_t task;
+    breezy_profile_t *profile;
+} profile_slot_t;
+
+static profile_slot_t s_slots[PROFILE_MAX_TASKS];
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *const PHASE_NAMES[BREEZY_PROFILE_PHASES] = {
+    [BREEZY_PROFILE_LOOKUP]   = "lookup",
+    [BREEZY_PROFILE_READ]     = "read",
+    [BREEZY_PROFILE_INIT]     = "init",
+    [BREEZY_PROFILE_RELOCATE] = "relocate",
+    [BREEZY_PROFILE_RUN]      = "run",
+    [BREEZY_PROFILE_DEINIT]   = "deinit",
+};
+
+void breezy_profile_start(breezy_profile_t *p)
+{
+    memset(p, 0, sizeof(*p));
+    p->sram_free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    p->psram_free = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+}
+
+int breezy_profile_attach(breezy_profile_t *p)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    int ret = p ? -1 : 0;
+
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < PROFILE_MAX_TASKS; i++) {
+        if (s_slots[i].task == self) {
+            s_slots[i].task = NULL;
+            s_slots[i].profile = NULL;
+        }
+    }
+    for (int i = 0; p && i < PROFILE_MAX_TASKS; i++) {
+        if (!s_slots[i].task) {
+            s_slots[i].task = self;
+            s_slots[i].profile = p;
+            ret = 0;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return ret;
+}
+
+breezy_profile_t *breezy_profile_current(void)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    breezy_profile_t *found = NULL;
+
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < PROFILE_MAX_TASKS; i++) {
+        if (s_slots[i].task == self) {
+            found = s_slots[i].profile;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return found;
+}
+
+static void add_cycles(breezy_profile_phase_t phase, uint64_t cycles)
+{
+    breezy_profile_t *p = breezy_profile_current();
+    if (!p) return;
+
+    // heap_caps takes locks of its own, so sample outside ours
+    size_t sram = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    size_t psram = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+
+    portENTER_CRITICAL(&s_lock);
+    p->cycles[phase] += cycles;
+    if (sram < p->sram_free && p->sram_free - sram > p->sram_peak) {
+        p->sram_peak = p->sram_free - sram;
+    }
+    if (psram < p->psram_free && p->psram_free - psram > p->psram_peak) {
+        p->psram_peak = p->psram_free - psram;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void breezy_profile_add(breezy_profile_phase_t phase, uint32_t cycles)
+{
+    add_cycles(phase, cycles);
+}
+
+void breezy_profile_add_us(breezy_profile_phase_t phase, int64_t us)
+{
+    if (us < 0) us = 0;
+    add_cycles(phase, (uint64_t)us * esp_rom_get_cpu_ticks_per_us());
+}
+
+void breezy_profile_add_read(uint32_t cycles, size_t bytes)
+{
+    breezy_profile_t *p = breezy_profile_current();
+    if (!p) return;
+
+    add_cycles(BREEZY_PROFILE_READ, cycles);
+    portENTER_CRITICAL(&s_lock);
+    p->file_bytes += bytes;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void breezy_profile_add_run(bool cached, size_t heap_bytes, size_t heap_peak,
+                            uint32_t allocs)
+{
+    breezy_profile_t *p = breezy_profile_current();
+    if (!p) return;
+
+    portENTER_CRITICAL(&s_lock);
+    p->runs++;
+    if (cached) p->cached++;
+    p->heap_bytes += heap_bytes;
+    p->heap_allocs += allocs;
+    if (heap_peak > p->heap_peak) p->heap_peak = heap_peak;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+double breezy_profile_us(uint64_t cycles)
+{
+    uint32_t per_us = esp_rom_get_cpu_ticks_per_us();
+    return per_us ? (double)cycles / per_us : 0;
+}
+
+const char *breezy_profile_phase_name(breezy_profile_phase_t phase)
+{
+    return phase < BREEZY_PROFILE_PHASES ? PHASE_NAMES[phase] : "?";
+}
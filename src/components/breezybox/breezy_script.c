@@ -0,0 +1,924 @@
+/*
+ * breezy_script.c - Compiled, cached shell scripts
+ *
+ * A script is read once and compiled into a flat list of operations, with
+ * if/while/for as jumps. Words are read by the command-line tokenizer
+ * (breezy_parse.h), so scripts and the prompt share one set of quoting
+ * rules, and its syntax errors come out at compile time. A command with
+ * nothing to expand is stored as its words and called directly. Any other
+ * is expanded by the tokenizer when it runs, with the script's variables,
+ * and run from the words that gives: values are never parsed again.
+ *
+ * Compiled scripts are cached by path, size and mtime (most recently used
+ * first), and shared by concurrent runs.
+ */
+
+#include "breezy_script.h"
+#include "breezy_exec.h"
+#include "breezy_parse.h"
+#include "breezy_vfs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#define SCRIPT_CACHE_MAX    8
+#define SCRIPT_FILE_MAX     (64 * 1024)
+#define SCRIPT_MAX_DEPTH    16          // Nested if/while/for
+#define SCRIPT_MAX_PATCHES  32          // elif/break jumps per block
+
+typedef enum {
+    OP_SIMPLE,          // Command with nothing to expand: argc words
+    OP_EXEC,            // Any other command, expanded when it runs
+    OP_ASSIGN,          // text: NAME\0word
+    OP_JUMP,
+    OP_JUMP_FALSE,      // Jump if the last status is non-zero, and make it 0
+    OP_FOR_INIT,        // Expand the word list in text into a new iterator
+    OP_FOR_NEXT,        // Next word into variable text, or jump when done
+    OP_FOR_POP,
+    OP_EXIT,            // Status from the word, if any
+} op_code_t;
+
+#define OPF_NEGATE  0x01    // ! cmd
+
+typedef struct {
+    uint8_t op;
+    uint8_t flags;
+    uint16_t argc;
+    uint32_t text;      // Pool offset
+    uint32_t target;    // Jump target
+} script_op_t;
+
+typedef struct script {
+    struct script *next;
+    char *path;
+    off_t size;                 // Key: file size and mtime at compile time
+    time_t mtime;
+    script_op_t *ops;
+    uint32_t nops;
+    char *pool;                 // Words and names, NUL-terminated
+    int refs;                   // Runs in progress
+    bool stale;                 // Out of the cache; freed by the last run
+} script_t;
+
+static script_t *s_scripts = NULL;
+static SemaphoreHandle_t s_lock = NULL;
+
+void breezy_script_init(void)
+{
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutex();
+    }
+}
+
+// ============ Words ============
+
+static bool is_name_start(char c)
+{
+    return isalpha((unsigned char)c) || c == '_';
+}
+
+static bool is_name_char(char c)
+{
+    return isalnum((unsigned char)c) || c == '_';
+}
+
+static const char *skip_blanks(const char *p)
+{
+    while (*p == ' ' || *p == '\t') p++;
+    return p;
+}
+
+// Length of the word at p, as the tokenizer would end it
+static size_t word_len(const char *p)
+{
+    return breezy_parse_span(p, " \t|<>&");
+}
+
+// ============ Compiler ============
+
+typedef enum { BLK_IF, BLK_WHILE, BLK_FOR } block_type_t;
+
+typedef struct {
+    block_type_t type;
+    bool open;                  // Still waiting for `then` / `do`
+    bool has_else;
+    uint32_t start;             // Loops: where `continue` goes
+    int32_t pending;            // JUMP_FALSE or FOR_NEXT to patch, or -1
+    uint32_t patches[SCRIPT_MAX_PATCHES];   // Jumps to the block's end
+    int npatches;
+    int line;
+} block_t;
+
+typedef struct {
+    const char *path;
+    int line;
+    script_op_t *ops;
+    uint32_t nops;
+    uint32_t ops_cap;
+    char *pool;
+    uint32_t pool_len;
+    uint32_t pool_cap;
+    block_t blocks[SCRIPT_MAX_DEPTH];
+    int depth;
+    bool failed;
+    breezy_line_t *tokens;      // Scratch for checking commands
+} compiler_t;
+
+static void compile_error(compiler_t *c, const char *msg, const char *what)
+{
+    if (!c->failed) {
+        printf("sh: %s:%d: %s%s%s\n", c->path, c->line, msg,
+               what ? ": " : "", what ? what : "");
+    }
+    c->failed = true;
+}
+
+static script_op_t *emit(compiler_t *c, uint8_t op)
+{
+    if (c->nops == c->ops_cap) {
+        uint32_t cap = c->ops_cap ? c->ops_cap * 2 : 32;
+        script_op_t *ops = realloc(c->ops, cap * sizeof(script_op_t));
+        if (!ops) {
+            compile_error(c, "out of memory", NULL);
+            return NULL;
+        }
+        c->ops = ops;
+        c->ops_cap = cap;
+    }
+    script_op_t *o = &c->ops[c->nops++];
+    memset(o, 0, sizeof(*o));
+    o->op = op;
+    return o;
+}
+
+// Append len bytes of s plus a NUL to the pool; returns the offset
+static uint32_t pool_add(compiler_t *c, const char *s, size_t len)
+{
+    if (c->pool_len + len + 1 > c->pool_cap) {
+        uint32_t cap = c->pool_cap ? c->pool_cap : 256;
+        while (cap < c->pool_len + len + 1) cap *= 2;
+        char *pool = realloc(c->pool, cap);
+        if (!pool) {
+            compile_error(c, "out of memory", NULL);
+            return 0;
+        }
+        c->pool = pool;
+        c->pool_cap = cap;
+    }
+    uint32_t off = c->pool_len;
+    memcpy(c->pool + off, s, len);
+    c->pool[off + len] = '\0';
+    c->pool_len += len + 1;
+    return off;
+}
+
+// Tokenize text the way it will run, but expanding nothing, to catch
+// syntax errors now. The words are left in c->tokens.
+static bool check(compiler_t *c, const char *text, bool split)
+{
+    breezy_parse_opts_t opts = { .split = split, .syntax_only = true };
+    if (breezy_parse_line(text, c->tokens, &opts) == 0) return true;
+    compile_error(c, c->tokens->error, NULL);
+    return false;
+}
+
+static void emit_jump(compiler_t *c, uint8_t op, uint32_t target)
+{
+    script_op_t *o = emit(c, op);
+    if (o) o->target = target;
+}
+
+static void patch(compiler_t *c, int32_t at, uint32_t target)
+{
+    if (at >= 0 && (uint32_t)at < c->nops) c->ops[at].target = target;
+}
+
+// Emit a jump to the end of block b, fixed up when the block closes
+static void emit_block_exit(compiler_t *c, block_t *b)
+{
+    if (b->npatches == SCRIPT_MAX_PATCHES) {
+        compile_error(c, "too many branches in block", NULL);
+        return;
+    }
+    b->patches[b->npatches++] = c->nops;
+    emit_jump(c, OP_JUMP, 0);
+}
+
+static void compile_command(compiler_t *c, const char *text)
+{
+    uint8_t flags = 0;
+    while (*text == ' ') text++;
+    if (text[0] == '!' && (text[1] == ' ' || text[1] == '\0')) {
+        flags |= OPF_NEGATE;
+        text++;
+        while (*text == ' ') text++;
+    }
+    if (!*text) {
+        compile_error(c, "missing command", NULL);
+        return;
+    }
+
+    if (!check(c, text, false)) return;
+
+    breezy_line_t *line = c->tokens;
+    const breezy_line_stage_t *st = &line->stages[0];
+    bool simple = !strchr(text, '$') && !line->heap && line->nstages == 1 &&
+                  !line->background && !st->infile && !st->outfile;
+    int argc = simple ? st->argc : 0;
+    uint32_t off;
+    if (simple) {
+        // Nothing to expand: keep the words themselves. They fit a line's
+        // fixed buffers, which is where run_simple() puts them.
+        off = c->pool_len;
+        for (int i = 0; i < argc; i++) {
+            pool_add(c, st->argv[i], strlen(st->argv[i]));
+        }
+    } else {
+        off = pool_add(c, text, strlen(text));
+    }
+    breezy_line_free(line);
+
+    script_op_t *o = emit(c, simple ? OP_SIMPLE : OP_EXEC);
+    if (!o) return;
+    o->flags = flags;
+    o->argc = argc;
+    o->text = off;
+}
+
+static block_t *push_block(compiler_t *c, block_type_t type)
+{
+    if (c->depth == SCRIPT_MAX_DEPTH) {
+        compile_error(c, "blocks nested too deep", NULL);
+        return NULL;
+    }
+    block_t *b = &c->blocks[c->depth++];
+    memset(b, 0, sizeof(*b));
+    b->type = type;
+    b->open = true;
+    b->pending = -1;
+    b->start = c->nops;
+    b->line = c->line;
+    return b;
+}
+
+static block_t *top_block(compiler_t *c)
+{
+    return c->depth ? &c->blocks[c->depth - 1] : NULL;
+}
+
+// Condition of if/elif/while/until, then the jump out when it fails
+static void compile_condition(compiler_t *c, block_t *b, const char *cond, bool until)
+{
+    compile_command(c, cond);
+    if (until && c->nops) c->ops[c->nops - 1].flags ^= OPF_NEGATE;
+    b->pending = c->nops;
+    emit_jump(c, OP_JUMP_FALSE, 0);
+}
+
+static void compile_statement(compiler_t *c, char *stmt);
+
+// then/do/else may be followed by a command on the same statement
+static void compile_rest(compiler_t *c, char *rest)
+{
+    while (*rest == ' ') rest++;
+    if (*rest) compile_statement(c, rest);
+}
+
+static void compile_for(compiler_t *c, char *rest)
+{
+    const char *w = skip_blanks(rest);
+    size_t len = word_len(w);
+    if (len == 0 || !is_name_start(*w)) {
+        compile_error(c, "bad for loop variable", NULL);
+        return;
+    }
+    for (size_t i = 1; i < len; i++) {
+        if (!is_name_char(w[i])) {
+            compile_error(c, "bad for loop variable", NULL);
+            return;
+        }
+    }
+    uint32_t name = pool_add(c, w, len);
+
+    // for NAME in words; without `in`, the script's arguments
+    const char *in = skip_blanks(w + len);
+    size_t in_len = word_len(in);
+    const char *list;
+    if (in_len == 2 && strncmp(in, "in", 2) == 0) {
+        list = in + 2;
+    } else if (*in == '\0') {
+        list = "$@";
+    } else {
+        compile_error(c, "expected 'in'", NULL);
+        return;
+    }
+
+    if (!check(c, list, true)) return;
+    const breezy_line_stage_t *st = &c->tokens->stages[0];
+    bool bad = c->tokens->nstages > 1 || c->tokens->background || st->infile || st->outfile;
+    breezy_line_free(c->tokens);
+    if (bad) {
+        compile_error(c, "bad for loop word list", NULL);
+        return;
+    }
+    uint32_t words = pool_add(c, list, strlen(list));
+
+    script_op_t *o = emit(c, OP_FOR_INIT);
+    if (!o) return;
+    o->text = words;
+
+    block_t *b = push_block(c, BLK_FOR);
+    if (!b) return;
+    b->pending = c->nops;
+    o = emit(c, OP_FOR_NEXT);
+    if (o) o->text = name;
+}
+
+static void close_loop(compiler_t *c, block_t *b)
+{
+    emit_jump(c, OP_JUMP, b->start);
+    uint32_t end = c->nops;
+    if (b->type == BLK_FOR) emit(c, OP_FOR_POP);
+
+    patch(c, b->pending, end);
+    for (int i = 0; i < b->npatches; i++) patch(c, b->patches[i], end);
+}
+
+static void compile_statement(compiler_t *c, char *stmt)
+{
+    const char *w = skip_blanks(stmt);
+    size_t len = word_len(w);
+    char *rest = (char *)w + len;
+    block_t *b = top_block(c);
+
+#define IS(kw) (len == sizeof(kw) - 1 && strncmp(w, kw, len) == 0)
+
+    if (b && b->open && !IS("then") && !IS("do")) {
+        compile_error(c, b->type == BLK_IF ? "expected 'then'" : "expected 'do'", NULL);
+        return;
+    }
+
+    if (IS("if")) {
+        b = push_block(c, BLK_IF);
+        if (b) compile_condition(c, b, rest, false);
+    } else if (IS("elif")) {
+        if (!b || b->type != BLK_IF || b->has_else) {
+            compile_error(c, "unexpected", "elif");
+            return;
+        }
+        emit_block_exit(c, b);
+        patch(c, b->pending, c->nops);
+        compile_condition(c, b, rest, false);
+        b->open = true;
+    } else if (IS("else")) {
+        if (!b || b->type != BLK_IF || b->has_else) {
+            compile_error(c, "unexpected", "else");
+            return;
+        }
+        emit_block_exit(c, b);
+        patch(c, b->pending, c->nops);
+        b->pending = -1;
+        b->has_else = true;
+        compile_rest(c, rest);
+    } else if (IS("fi")) {
+        if (!b || b->type != BLK_IF) {
+            compile_error(c, "unexpected", "fi");
+            return;
+        }
+        patch(c, b->pending, c->nops);
+        for (int i = 0; i < b->npatches; i++) patch(c, b->patches[i], c->nops);
+        c->depth--;
+    } else if (IS("then")) {
+        if (!b || b->type != BLK_IF || !b->open) {
+            compile_error(c, "unexpected", "then");
+            return;
+        }
+        b->open = false;
+        compile_rest(c, rest);
+    } else if (IS("while") || IS("until")) {
+        bool until = IS("until");
+        b = push_block(c, BLK_WHILE);
+        if (b) compile_condition(c, b, rest, until);
+    } else if (IS("for")) {
+        compile_for(c, rest);
+    } else if (IS("do")) {
+        if (!b || b->type == BLK_IF || !b->open) {
+            compile_error(c, "unexpected", "do");
+            return;
+        }
+        b->open = false;
+        compile_rest(c, rest);
+    } else if (IS("done")) {
+        if (!b || b->type == BLK_IF) {
+            compile_error(c, "unexpected", "done");
+            return;
+        }
+        close_loop(c, b);
+        c->depth--;
+    } else if (IS("break") || IS("continue")) {
+        block_t *loop = NULL;
+        for (int i = c->depth - 1; i >= 0 && !loop; i--) {
+            if (c->blocks[i].type != BLK_IF) loop = &c->blocks[i];
+        }
+        if (!loop) {
+            compile_error(c, "not in a loop", IS("break") ? "break" : "continue");
+            return;
+        }
+        if (IS("break")) {
+            emit_block_exit(c, loop);
+        } else {
+            emit_jump(c, OP_JUMP, loop->start);
+        }
+    } else if (IS("exit")) {
+        rest = (char *)skip_blanks(rest);
+        if (*rest && !check(c, rest, false)) return;
+        breezy_line_free(c->tokens);
+        uint32_t off = pool_add(c, rest, strlen(rest));
+        script_op_t *o = emit(c, OP_EXIT);
+        if (o) {
+            o->argc = *rest ? 1 : 0;
+            o->text = off;
+        }
+    } else {
+        // NAME=word on its own is an assignment
+        const char *eq = memchr(w, '=', len);
+        bool assign = eq && eq > w && is_name_start(*w) && !*skip_blanks(rest);
+        for (const char *p = w; assign && p < eq; p++) {
+            if (!is_name_char(*p)) assign = false;
+        }
+
+        if (assign) {
+            uint32_t name = pool_add(c, w, eq - w);
+            uint32_t value = pool_add(c, eq + 1, len - (eq - w) - 1);
+            if (c->failed || !check(c, c->pool + value, false)) return;
+            breezy_line_free(c->tokens);
+            script_op_t *o = emit(c, OP_ASSIGN);
+            if (o) o->text = name;
+        } else {
+            compile_command(c, stmt);
+        }
+    }
+#undef IS
+}
+
+// Split a line into statements on ';' outside quotes and $((...))
+static void compile_line(compiler_t *c, char *line)
+{
+    char *stmt = (char *)skip_blanks(line);
+    if (*stmt == '#' || *stmt == '\0') return;
+
+    while (!c->failed) {
+        char *end = stmt + breezy_parse_span(stmt, ";");
+        bool last = *end == '\0';
+        *end = '\0';
+        compile_rest(c, stmt);
+        if (last) break;
+        stmt = end + 1;
+    }
+}
+
+static script_t *compile(const char *path, char *text)
+{
+    compiler_t c = { .path = path };
+    c.tokens = calloc(1, sizeof(breezy_line_t));
+    if (!c.tokens) return NULL;
+
+    char *line = text;
+    while (line && !c.failed) {
+        char *nl = strchr(line, '\n');
+        if (nl) *nl = '\0';
+        c.line++;
+
+        size_t len = strlen(line);
+        while (len > 0 && (line[len - 1] == '\r' || line[len - 1] == ' ')) {
+            line[--len] = '\0';
+        }
+        compile_line(&c, line);
+        line = nl ? nl + 1 : NULL;
+    }
+
+    if (!c.failed && c.depth > 0) {
+        block_t *b = top_block(&c);
+        c.line = b->line;
+        compile_error(&c, b->type == BLK_IF ? "missing 'fi'" : "missing 'done'", NULL);
+    }
+
+    free(c.tokens);
+    script_t *s = c.failed ? NULL : calloc(1, sizeof(script_t));
+    if (!s) {
+        free(c.ops);
+        free(c.pool);
+        return NULL;
+    }
+    s->ops = c.ops;
+    s->nops = c.nops;
+    s->pool = c.pool;
+    return s;
+}
+
+// ============ Cache ============
+
+static void script_free(script_t *s)
+{
+    free(s->ops);
+    free(s->pool);
+    free(s->path);
+    free(s);
+}
+
+// Drop a script from the cache list. Call with the lock held.
+static void script_drop(script_t **pp)
+{
+    script_t *s = *pp;
+    *pp = s->next;
+    if (s->refs == 0) {
+        script_free(s);
+    } else {
+        s->stale = true;
+    }
+}
+
+static script_t *load_script(const char *path, const struct stat *st)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) return NULL;
+
+    if (st->st_size > SCRIPT_FILE_MAX) {
+        printf("sh: %s: script too large\n", path);
+        fclose(f);
+        return NULL;
+    }
+
+    char *text = malloc(st->st_size + 1);
+    size_t n = text ? fread(text, 1, st->st_size, f) : 0;
+    fclose(f);
+    if (!text) return NULL;
+    text[n] = '\0';
+
+    script_t *s = compile(path, text);
+    free(text);
+    if (!s) return NULL;
+
+    s->path = strdup(path);
+    if (!s->path) {
+        script_free(s);
+        return NULL;
+    }
+    s->size = st->st_size;
+    s->mtime = st->st_mtime;
+    s->refs = 1;
+    return s;
+}
+
+// Compiled script for path, compiling it if the cache has no current copy
+static script_t *script_get(const char *path)
+{
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) return NULL;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (script_t **pp = &s_scripts; *pp; pp = &(*pp)->next) {
+        script_t *s = *pp;
+        if (strcmp(s->path, path) != 0) continue;
+
+        if (s->size == st.st_size && s->mtime == st.st_mtime) {
+            s->refs++;
+            *pp = s->next;
+            s->next = s_scripts;
+            s_scripts = s;
+            xSemaphoreGive(s_lock);
+            return s;
+        }
+        script_drop(pp);
+        break;
+    }
+    xSemaphoreGive(s_lock);
+
+    script_t *s = load_script(path, &st);
+    if (!s) return NULL;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s->next = s_scripts;
+    s_scripts = s;
+
+    // Keep the newest SCRIPT_CACHE_MAX; older ones go when idle
+    int n = 0;
+    for (script_t **pp = &s_scripts; *pp;) {
+        if (++n > SCRIPT_CACHE_MAX) {
+            script_drop(pp);
+        } else {
+            pp = &(*pp)->next;
+        }
+    }
+    xSemaphoreGive(s_lock);
+    return s;
+}
+
+static void script_put(script_t *s)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (--s->refs == 0 && s->stale) script_free(s);
+    xSemaphoreGive(s_lock);
+}
+
+// ============ Runtime ============
+
+typedef struct var {
+    struct var *next;
+    char *value;
+    char name[];
+} var_t;
+
+typedef struct {
+    char *words;                // Expanded words, NUL-separated
+    char *next;
+    char *end;
+} iter_t;
+
+typedef struct {
+    int argc;
+    char **argv;
+    char *all_args;             // $@
+    var_t *vars;
+    int status;
+    char num[24];               // $? or $#, as text
+    iter_t iters[SCRIPT_MAX_DEPTH];
+    int niters;
+    breezy_line_t line;         // Words of the command being run
+} run_t;
+
+static const char *get_var(run_t *r, const char *name, size_t len)
+{
+    for (var_t *v = r->vars; v; v = v->next) {
+        if (strlen(v->name) == len && strncmp(v->name, name, len) == 0) return v->value;
+    }
+
+    char key[32];
+    if (len >= sizeof(key)) return NULL;
+    memcpy(key, name, len);
+    key[len] = '\0';
+    return getenv(key);
+}
+
+static int set_var(run_t *r, const char *name, const char *value)
+{
+    char *copy = strdup(value);
+    if (!copy) return -1;
+
+    for (var_t *v = r->vars; v; v = v->next) {
+        if (strcmp(v->name, name) == 0) {
+            free(v->value);
+            v->value = copy;
+            return 0;
+        }
+    }
+
+    var_t *v = malloc(sizeof(var_t) + strlen(name) + 1);
+    if (!v) {
+        free(copy);
+        return -1;
+    }
+    strcpy(v->name, name);
+    v->value = copy;
+    v->next = r->vars;
+    r->vars = v;
+    return 0;
+}
+
+// ---- Expansion ----
+
+// Variables as the tokenizer sees them (breezy_parse_lookup_t)
+static const char *lookup(void *ctx, const char *name, size_t len)
+{
+    run_t *r = ctx;
+
+    if (*name == '?' || *name == '#') {
+        snprintf(r->num, sizeof(r->num), "%d",
+                 *name == '?' ? r->status : r->argc > 0 ? r->argc - 1 : 0);
+        return r->num;
+    }
+    if (*name == '@') return r->all_args;
+
+    if (isdigit((unsigned char)*name)) {
+        int n = 0;
+        for (size_t i = 0; i < len && n < 1000; i++) {
+            if (!isdigit((unsigned char)name[i])) return NULL;
+            n = n * 10 + name[i] - '0';
+        }
+        return n < r->argc ? r->argv[n] : NULL;
+    }
+    return get_var(r, name, len);
+}
+
+// Tokenize and expand text into r->line; split for a for list. Returns
+// false (and prints a message) on an error, else breezy_line_free() it.
+static bool expand(run_t *r, const char *text, bool split)
+{
+    breezy_parse_opts_t opts = { .lookup = lookup, .ctx = r, .split = split };
+    if (breezy_parse_line(text, &r->line, &opts) == 0) return true;
+    printf("sh: %s\n", r->line.error);
+    return false;
+}
+
+// First word of r->line, or "" if there is none
+static const char *first_word(run_t *r)
+{
+    return r->line.stages[0].argc > 0 ? r->line.stages[0].argv[0] : "";
+}
+
+// The words were tokenized at compile time and fit a line. Commands may
+// write to their argv, so they get a copy, not the shared pool.
+static int run_simple(run_t *r, const script_op_t *op, const char *words)
+{
+    char **argv = r->line.word_buf;
+    char *p = r->line.text_buf;
+
+    for (int i = 0; i < op->argc; i++) {
+        size_t len = strlen(words) + 1;
+        memcpy(p, words, len);
+        argv[i] = p;
+        p += len;
+        words += len;
+    }
+    argv[op->argc] = NULL;
+
+    return breezybox_exec_argv(op->argc, argv);
+}
+
+// Expand a for loop's word list into a new iterator. Unquoted expansions
+// are split on blanks, so `for f in $@` sees each argument.
+static bool for_init(run_t *r, const char *list)
+{
+    if (!expand(r, list, true)) return false;
+
+    const breezy_line_stage_t *st = &r->line.stages[0];
+    size_t len = 0;
+    for (int i = 0; i < st->argc; i++) len += strlen(st->argv[i]) + 1;
+
+    char *buf = malloc(len ? len : 1);
+    if (buf) {
+        char *p = buf;
+        for (int i = 0; i < st->argc; i++) {
+            size_t n = strlen(st->argv[i]) + 1;
+            memcpy(p, st->argv[i], n);
+            p += n;
+        }
+    }
+    breezy_line_free(&r->line);
+    if (!buf) return false;
+
+    iter_t *it = &r->iters[r->niters++];
+    it->words = buf;
+    it->next = buf;
+    it->end = buf + len;
+    return true;
+}
+
+static int run_ops(run_t *r, const script_t *s)
+{
+    uint32_t pc = 0;
+    while (pc < s->nops) {
+        const script_op_t *op = &s->ops[pc++];
+        const char *text = s->pool + op->text;
+
+        switch (op->op) {
+        case OP_SIMPLE:
+            r->status = run_simple(r, op, text);
+            if (op->flags & OPF_NEGATE) r->status = !r->status;
+            break;
+
+        case OP_EXEC:
+            if (expand(r, text, false)) {
+                r->status = breezybox_exec_line(&r->line);
+                breezy_line_free(&r->line);
+            } else {
+                r->status = 1;
+            }
+            if (op->flags & OPF_NEGATE) r->status = !r->status;
+            break;
+
+        case OP_ASSIGN: {
+            const char *value = text + strlen(text) + 1;
+            r->status = 1;
+            if (expand(r, value, false)) {
+                if (set_var(r, text, first_word(r)) == 0) r->status = 0;
+                breezy_line_free(&r->line);
+            }
+            break;
+        }
+
+        case OP_JUMP:
+            pc = op->target;
+            break;
+
+        case OP_JUMP_FALSE:
+            // A failed condition is not the status of the if/loop
+            if (r->status != 0) {
+                pc = op->target;
+                r->status = 0;
+            }
+            break;
+
+        case OP_FOR_INIT:
+            if (!for_init(r, text)) return 2;
+            r->status = 0;
+            break;
+
+        case OP_FOR_NEXT: {
+            iter_t *it = &r->iters[r->niters - 1];
+            if (it->next < it->end) {
+                set_var(r, text, it->next);
+                it->next += strlen(it->next) + 1;
+            } else {
+                pc = op->target;
+            }
+            break;
+        }
+
+        case OP_FOR_POP:
+            free(r->iters[--r->niters].words);
+            break;
+
+        case OP_EXIT:
+            if (op->argc && expand(r, text, false)) {
+                r->status = atoi(first_word(r));
+                breezy_line_free(&r->line);
+            }
+            return r->status;
+        }
+    }
+    return r->status;
+}
+
+static int run_script(const script_t *s, int argc, char **argv)
+{
+    // Big scratch buffers: keep them off the caller's stack
+    run_t *r = calloc(1, sizeof(run_t));
+    if (!r) return 2;
+    r->argc = argc;
+    r->argv = argv;
+
+    size_t len = 1;
+    for (int i = 1; i < argc; i++) len += strlen(argv[i]) + 1;
+    r->all_args = malloc(len);
+    if (!r->all_args) {
+        free(r);
+        return 2;
+    }
+    char *p = r->all_args;
+    for (int i = 1; i < argc; i++) {
+        if (i > 1) *p++ = ' ';
+        p = stpcpy(p, argv[i]);
+    }
+    *p = '\0';
+
+    int ret = run_ops(r, s);
+
+    while (r->niters > 0) free(r->iters[--r->niters].words);
+    while (r->vars) {
+        var_t *v = r->vars;
+        r->vars = v->next;
+        free(v->value);
+        free(v);
+    }
+    free(r->all_args);
+    free(r);
+    return ret;
+}
+
+int breezy_script_run(int argc, char **argv)
+{
+    char path[BREEZYBOX_MAX_PATH * 2];
+    if (!breezybox_resolve_path(argv[0], path, sizeof(path))) {
+        printf("sh: %s: path too long\n", argv[0]);
+        return 2;
+    }
+
+    script_t *s = script_get(path);
+    if (!s) {
+        struct stat st;
+        if (stat(path, &st) != 0) printf("sh: %s: No such file\n", argv[0]);
+        return 2;
+    }
+
+    int ret = run_script(s, argc, argv);
+    script_put(s);
+    return ret;
+}
+
+int breezy_script_run_text(char *text, int argc, char **argv)
+{
+    script_t *s = compile(argv[0], text);
+    if (!s) return 2;
+
+    int ret = run_script(s, argc, argv);
+    script_free(s);
+    return ret;
+}
@@ -0,0 +1,232 @@
+/*
+ * breezy_statcache.c - stat() results by path
+ *
+ * A 4-way set-associative table keyed by a 64-bit hash of the canonical
+ * path. The path itself is not kept; a second, independent 64-bit hash is,
+ * and must match too, so a colliding path can't be served another file's
+ * stat. Clearing bumps a generation number
+ * instead of touching the table. Files open for writing are remembered by
+ * fd, so their entries stay out until the last write is done.
+ */
+
+#include "breezy_statcache.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef CONFIG_BREEZYBOX_STAT_CACHE_ENTRIES
+#define CACHE_ENTRIES   CONFIG_BREEZYBOX_STAT_CACHE_ENTRIES
+#else
+#define CACHE_ENTRIES   512
+#endif
+
+#define WAYS            4
+#define WRITER_FDS      64  // FD_SETSIZE on ESP-IDF
+
+typedef struct {
+    uint64_t key;           // Picks the set
+    uint64_t check;         // Tells paths with the same key apart
+} path_id_t;
+
+typedef struct {
+    path_id_t id;
+    uint32_t gen;           // Valid while equal to s_gen
+    uint32_t mode;
+    int64_t size;
+    time_t mtime;
+    time_t atime;
+    time_t ctime;
+    uint32_t blksize;
+    uint16_t nlink;
+} entry_t;
+
+static entry_t *s_table = NULL;
+static uint32_t s_sets = 0;             // Power of two
+static uint32_t s_gen = 1;
+static uint32_t s_epoch = 0;            // Bumped by every invalidation
+static uint8_t s_next[CACHE_ENTRIES / WAYS + 1];  // Round-robin way per set
+static path_id_t s_writers[WRITER_FDS]; // Path per fd open for writing
+static bool s_off = false;              // A writer fd was out of range
+static unsigned s_hits = 0, s_misses = 0;
+static SemaphoreHandle_t s_lock = NULL;
+
+#define LOCK()   xSemaphoreTake(s_lock, portMAX_DELAY)
+#define UNLOCK() xSemaphoreGive(s_lock)
+
+// FNV-1a and a multiply-xorshift hash of the first len bytes. The key is
+// never 0, which marks a free writer slot.
+static path_id_t path_id_n(const char *path, size_t len)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    uint64_t c = 0x9e3779b97f4a7c15ull;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (unsigned char)path[i]) * 0x100000001b3ull;
+        c = (c + (unsigned char)path[i]) * 0xbf58476d1ce4e5b9ull;
+        c ^= c >> 31;
+    }
+    return (path_id_t){ .key = h ? h : 1, .check = c };
+}
+
+static path_id_t path_id(const char *path)
+{
+    return path_id_n(path, strlen(path));
+}
+
+static bool same_path(path_id_t a, path_id_t b)
+{
+    return a.key == b.key && a.check == b.check;
+}
+
+static entry_t *find(path_id_t id)
+{
+    entry_t *set = &s_table[(id.key & (s_sets - 1)) * WAYS];
+    for (int i = 0; i < WAYS; i++) {
+        if (set[i].gen == s_gen && same_path(set[i].id, id)) return &set[i];
+    }
+    return NULL;
+}
+
+static bool is_writer(path_id_t id)
+{
+    for (int i = 0; i < WRITER_FDS; i++) {
+        if (same_path(s_writers[i], id)) return true;
+    }
+    return false;
+}
+
+void breezy_statcache_init(void)
+{
+    if (s_table || CACHE_ENTRIES < WAYS) return;
+
+    uint32_t sets = 1;
+    while (sets * 2 * WAYS <= CACHE_ENTRIES) sets *= 2;
+
+    s_lock = xSemaphoreCreateMutex();
+#ifdef CONFIG_SPIRAM
+    s_table = heap_caps_calloc(sets * WAYS, sizeof(entry_t), MALLOC_CAP_SPIRAM);
+#endif
+    if (!s_table) s_table = calloc(sets * WAYS, sizeof(entry_t));
+    if (!s_lock || !s_table) {
+        free(s_table);
+        s_table = NULL;
+        return;
+    }
+    s_sets = sets;
+}
+
+bool breezy_statcache_get(const char *path, struct stat *st, uint32_t *epoch)
+{
+    *epoch = 0;
+    if (!s_table) return false;
+
+    path_id_t id = path_id(path);
+    LOCK();
+    *epoch = s_epoch;
+    const entry_t *e = s_off ? NULL : find(id);
+    if (e) {
+        memset(st, 0, sizeof(*st));
+        st->st_mode = e->mode;
+        st->st_size = e->size;
+        st->st_mtime = e->mtime;
+        st->st_atime = e->atime;
+        st->st_ctime = e->ctime;
+        st->st_blksize = e->blksize;
+        st->st_nlink = e->nlink;
+        s_hits++;
+    } else {
+        s_misses++;
+    }
+    UNLOCK();
+    return e != NULL;
+}
+
+void breezy_statcache_put(const char *path, const struct stat *st, uint32_t epoch)
+{
+    if (!s_table) return;
+
+    path_id_t id = path_id(path);
+    LOCK();
+    // Nothing may have changed since the miss, or st could be stale
+    if (!s_off && epoch == s_epoch && !(S_ISREG(st->st_mode) && is_writer(id))) {
+        entry_t *e = find(id);
+        if (!e) {
+            uint32_t set = id.key & (s_sets - 1);
+            e = &s_table[set * WAYS + s_next[set]];
+            s_next[set] = (s_next[set] + 1) % WAYS;
+        }
+        *e = (entry_t){
+            .id = id,
+            .gen = s_gen,
+            .mode = st->st_mode,
+            .size = st->st_size,
+            .mtime = st->st_mtime,
+            .atime = st->st_atime,
+            .ctime = st->st_ctime,
+            .blksize = st->st_blksize,
+            .nlink = st->st_nlink,
+        };
+    }
+    UNLOCK();
+}
+
+void breezy_statcache_clear(void)
+{
+    if (!s_table) return;
+
+    LOCK();
+    s_epoch++;
+    if (++s_gen == 0) {
+        // Wrapped: entries from generation 0 would look valid again
+        memset(s_table, 0, s_sets * WAYS * sizeof(entry_t));
+        s_gen = 1;
+    }
+    UNLOCK();
+}
+
+void breezy_statcache_writer_open(int fd, const char *path)
+{
+    if (!s_table) return;
+
+    // Creating the file changes its directory's mtime too
+    const char *slash = strrchr(path, '/');
+    path_id_t parent = path_id_n(path, slash && slash != path ? (size_t)(slash - path) : 1);
+    path_id_t id = path_id(path);
+
+    LOCK();
+    s_epoch++;
+    entry_t *e = find(id);
+    if (e) e->gen = 0;
+    if ((e = find(parent)) != NULL) e->gen = 0;
+    if (fd >= 0 && fd < WRITER_FDS) {
+        s_writers[fd] = id;
+    } else {
+        // Can't tell when it closes: stop caching for good
+        s_off = true;
+    }
+    UNLOCK();
+}
+
+void breezy_statcache_fd_closed(int fd)
+{
+    if (!s_table || fd < 0 || fd >= WRITER_FDS) return;
+
+    LOCK();
+    path_id_t id = s_writers[fd];
+    if (id.key) {
+        s_epoch++;
+        s_writers[fd] = (path_id_t){ 0 };
+        entry_t *e = find(id);
+        if (e) e->gen = 0;
+    }
+    UNLOCK();
+}
+
+void breezy_statcache_counts(unsigned *hits, unsigned *misses)
+{
+    *hits = s_hits;
+    *misses = s_misses;
+}
@@ -0,0 +1,351 @@
+/*
+ * breezy_stop.c - Stop points for running apps
+ *
+ * Wrappers around the app's blocking and file-opening imports. See
+ * breezy_stop.h for how a stop unwinds.
+ */
+
+#include "breezy_stop.h"
+#include "freertos/task.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+// Longest a sleeping app goes without looking at its stop flag
+#define STOP_POLL_MS    50
+
+static pthread_key_t s_key;
+static pthread_once_t s_key_once = PTHREAD_ONCE_INIT;
+
+static void key_init(void)
+{
+    pthread_key_create(&s_key, NULL);
+}
+
+static breezy_stop_t *current(void)
+{
+    pthread_once(&s_key_once, key_init);
+    return pthread_getspecific(s_key);
+}
+
+static void stop_point(void)
+{
+    breezy_stop_t *s = current();
+    if (s && s->stop) longjmp(s->unwind, 1);
+}
+
+void breezy_stop_begin(breezy_stop_t *s)
+{
+    pthread_once(&s_key_once, key_init);
+    pthread_setspecific(s_key, s);
+}
+
+void breezy_stop_end(breezy_stop_t *s)
+{
+    pthread_setspecific(s_key, NULL);
+
+    for (int i = 0; i < BREEZY_STOP_FILES; i++) {
+        if (s->files[i]) fclose(s->files[i]);
+        if (s->fds[i]) close(s->fds[i] - 1);
+    }
+    memset(s->files, 0, sizeof(s->files));
+    memset(s->fds, 0, sizeof(s->fds));
+}
+
+void breezy_stop_request(breezy_stop_t *s)
+{
+    s->stop = true;
+}
+
+// ============ Open Files ============
+
+// Past BREEZY_STOP_FILES a file is just not closed for the app
+static void remember_file(FILE *f)
+{
+    breezy_stop_t *s = current();
+    if (!s || !f) return;
+    for (int i = 0; i < BREEZY_STOP_FILES; i++) {
+        if (!s->files[i]) {
+            s->files[i] = f;
+            return;
+        }
+    }
+}
+
+static void forget_file(FILE *f)
+{
+    breezy_stop_t *s = current();
+    if (!s || !f) return;
+    for (int i = 0; i < BREEZY_STOP_FILES; i++) {
+        if (s->files[i] == f) s->files[i] = NULL;
+    }
+}
+
+static void remember_fd(int fd)
+{
+    breezy_stop_t *s = current();
+    if (!s || fd < 0) return;
+    for (int i = 0; i < BREEZY_STOP_FILES; i++) {
+        if (!s->fds[i]) {
+            s->fds[i] = fd + 1;
+            return;
+        }
+    }
+}
+
+static void forget_fd(int fd)
+{
+    breezy_stop_t *s = current();
+    if (!s || fd < 0) return;
+    for (int i = 0; i < BREEZY_STOP_FILES; i++) {
+        if (s->fds[i] == fd + 1) s->fds[i] = 0;
+    }
+}
+
+FILE *breezy_stop_fopen(const char *path, const char *mode)
+{
+    stop_point();
+    FILE *f = fopen(path, mode);
+    remember_file(f);
+    return f;
+}
+
+// The FILE owns the fd from here on
+FILE *breezy_stop_fdopen(int fd, const char *mode)
+{
+    stop_point();
+    FILE *f = fdopen(fd, mode);
+    if (f) {
+        forget_fd(fd);
+        remember_file(f);
+    }
+    return f;
+}
+
+FILE *breezy_stop_freopen(const char *path, const char *mode, FILE *f)
+{
+    stop_point();
+    forget_file(f);
+    FILE *ret = freopen(path, mode, f);
+    remember_file(ret);
+    return ret;
+}
+
+int breezy_stop_fclose(FILE *f)
+{
+    forget_file(f);
+    return fclose(f);
+}
+
+int breezy_stop_open(const char *path, int flags, ...)
+{
+    int mode = 0;
+    if (flags & O_CREAT) {
+        va_list ap;
+        va_start(ap, flags);
+        mode = va_arg(ap, int);
+        va_end(ap);
+    }
+    stop_point();
+    int fd = open(path, flags, mode);
+    remember_fd(fd);
+    return fd;
+}
+
+int breezy_stop_close(int fd)
+{
+    forget_fd(fd);
+    return close(fd);
+}
+
+// ============ I/O ============
+
+// A read or write a stop broke off (the pipe returns EOF/EPIPE) ends in
+// the stop point after it
+
+int breezy_stop_vfprintf(FILE *f, const char *fmt, va_list ap)
+{
+    stop_point();
+    int n = vfprintf(f, fmt, ap);
+    stop_point();
+    return n;
+}
+
+int breezy_stop_vprintf(const char *fmt, va_list ap)
+{
+    return breezy_stop_vfprintf(stdout, fmt, ap);
+}
+
+int breezy_stop_printf(const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int n = breezy_stop_vfprintf(stdout, fmt, ap);
+    va_end(ap);
+    return n;
+}
+
+int breezy_stop_fprintf(FILE *f, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int n = breezy_stop_vfprintf(f, fmt, ap);
+    va_end(ap);
+    return n;
+}
+
+int breezy_stop_puts(const char *s)
+{
+    stop_point();
+    int n = puts(s);
+    stop_point();
+    return n;
+}
+
+int breezy_stop_fputs(const char *s, FILE *f)
+{
+    stop_point();
+    int n = fputs(s, f);
+    stop_point();
+    return n;
+}
+
+int breezy_stop_fputc(int c, FILE *f)
+{
+    stop_point();
+    int n = fputc(c, f);
+    stop_point();
+    return n;
+}
+
+char *breezy_stop_fgets(char *s, int size, FILE *f)
+{
+    stop_point();
+    char *ret = fgets(s, size, f);
+    stop_point();
+    return ret;
+}
+
+int breezy_stop_fgetc(FILE *f)
+{
+    stop_point();
+    int c = fgetc(f);
+    stop_point();
+    return c;
+}
+
+size_t breezy_stop_fread(void *ptr, size_t size, size_t n, FILE *f)
+{
+    stop_point();
+    size_t ret = fread(ptr, size, n, f);
+    stop_point();
+    return ret;
+}
+
+size_t breezy_stop_fwrite(const void *ptr, size_t size, size_t n, FILE *f)
+{
+    stop_point();
+    size_t ret = fwrite(ptr, size, n, f);
+    stop_point();
+    return ret;
+}
+
+int breezy_stop_fflush(FILE *f)
+{
+    stop_point();
+    int ret = fflush(f);
+    stop_point();
+    return ret;
+}
+
+ssize_t breezy_stop_read(int fd, void *buf, size_t n)
+{
+    stop_point();
+    ssize_t ret = read(fd, buf, n);
+    stop_point();
+    return ret;
+}
+
+ssize_t breezy_stop_write(int fd, const void *buf, size_t n)
+{
+    stop_point();
+    ssize_t ret = write(fd, buf, n);
+    stop_point();
+    return ret;
+}
+
+// ============ Sleeping ============
+
+// Long sleeps are cut into slices so a stop doesn't wait them out
+
+void breezy_stop_vTaskDelay(TickType_t ticks)
+{
+    TickType_t slice = pdMS_TO_TICKS(STOP_POLL_MS);
+    if (slice == 0) slice = 1;
+
+    stop_point();
+    while (ticks > 0) {
+        TickType_t t = ticks < slice ? ticks : slice;
+        vTaskDelay(t);
+        ticks -= t;
+        stop_point();
+    }
+}
+
+int breezy_stop_usleep(useconds_t us)
+{
+    stop_point();
+    while (us > 0) {
+        useconds_t t = us < STOP_POLL_MS * 1000 ? us : STOP_POLL_MS * 1000;
+        usleep(t);
+        us -= t;
+        stop_point();
+    }
+    return 0;
+}
+
+unsigned breezy_stop_sleep(unsigned s)
+{
+    for (unsigned i = 0; i < s; i++) breezy_stop_usleep(1000000);
+    return 0;
+}
+
+// ============ Binding ============
+
+void *breezy_stop_symbol(const char *name)
+{
+    static const struct {
+        const char *name;
+        void *fn;
+    } s_syms[] = {
+        { "printf", (void *)breezy_stop_printf },
+        { "fprintf", (void *)breezy_stop_fprintf },
+        { "vprintf", (void *)breezy_stop_vprintf },
+        { "vfprintf", (void *)breezy_stop_vfprintf },
+        { "puts", (void *)breezy_stop_puts },
+        { "fputs", (void *)breezy_stop_fputs },
+        { "fputc", (void *)breezy_stop_fputc },
+        { "fgets", (void *)breezy_stop_fgets },
+        { "fgetc", (void *)breezy_stop_fgetc },
+        { "fread", (void *)breezy_stop_fread },
+        { "fwrite", (void *)breezy_stop_fwrite },
+        { "fflush", (void *)breezy_stop_fflush },
+        { "fopen", (void *)breezy_stop_fopen },
+        { "fdopen", (void *)breezy_stop_fdopen },
+        { "freopen", (void *)breezy_stop_freopen },
+        { "fclose", (void *)breezy_stop_fclose },
+        { "open", (void *)breezy_stop_open },
+        { "read", (void *)breezy_stop_read },
+        { "write", (void *)breezy_stop_write },
+        { "close", (void *)breezy_stop_close },
+        { "usleep", (void *)breezy_stop_usleep },
+        { "sleep", (void *)breezy_stop_sleep },
+        { "vTaskDelay", (void *)breezy_stop_vTaskDelay },
+    };
+
+    for (size_t i = 0; i < sizeof(s_syms) / sizeof(s_syms[0]); i++) {
+        if (strcmp(name, s_syms[i].name) == 0) return s_syms[i].fn;
+    }
+    return NULL;
+}
@@ -0,0 +1,502 @@
+/*
+ * breezy_svc.c - Supervised services
+ *
+ * Services live in a fixed table guarded by one mutex, which is also held
+ * around start()/stop() so the supervisor and `svc` never start or stop
+ * the same service at once. The supervisor task starts with the first
+ * service and polls; restarts happen on its task.
+ *
+ * A command service's task joins job BREEZY_SVC_JOB_BASE + its slot
+ * (breezy_jobs_enter()), so the programs it runs can be stopped with
+ * breezy_elf_kill_job(), and carries a profile (breezy_profile.h) that
+ * records their heap use.
+ */
+
+#include "breezy_svc.h"
+#include "breezy_elf.h"
+#include "breezy_exec.h"
+#include "breezy_jobs.h"
+#include "breezy_pipe.h"
+#include "breezy_profile.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef CONFIG_BREEZYBOX_STAGE_STACK_SIZE
+#define SVC_STACK_SIZE CONFIG_BREEZYBOX_STAGE_STACK_SIZE
+#else
+#define SVC_STACK_SIZE 8192
+#endif
+
+#if defined(CONFIG_FREERTOS_USE_TRACE_FACILITY) && defined(CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS)
+#define SVC_CPU_STATS 1
+#ifndef configRUN_TIME_COUNTER_TYPE
+#define configRUN_TIME_COUNTER_TYPE uint32_t
+#endif
+#endif
+
+#define SVC_POLL_MS             500
+#define SVC_BACKOFF_MIN_MS      1000
+#define SVC_BACKOFF_MAX_MS      30000
+#define SVC_STABLE_MS           60000   // Up this long: failures start over
+#define SVC_STOP_WAIT_MS        3000
+#define SVC_MAX_ARGS            8
+#define SVC_SUPERVISOR_STACK    4096
+
+static const char *TAG = "svc";
+
+typedef struct {
+    bool in_use;
+    breezy_svc_def_t def;       // def.start is NULL for command services
+    char name[BREEZY_SVC_NAME_MAX];
+    char *cmdline;              // Command services
+    char *args;                 // Saved start() arguments, NUL-separated
+    int argc;
+    breezy_svc_state_t state;
+    bool task_done;             // Command task has returned
+    int task_ret;
+    int last_ret;
+    uint32_t restarts;
+    uint32_t fails;             // In a row, for the restart delay
+    int64_t started_us;
+    int64_t retry_us;
+    size_t mem;
+    breezy_profile_t profile;   // Command services: their programs' heap
+    uint64_t cpu_base;          // Run time counters when it started
+    uint64_t total_base;
+} svc_t;
+
+static svc_t s_svcs[BREEZY_SVC_MAX];
+static SemaphoreHandle_t s_lock = NULL;
+static TaskHandle_t s_supervisor = NULL;
+
+static void lock_init(void)
+{
+    // First use is at boot, before there are other tasks to race with
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutex();
+    }
+}
+
+static svc_t *find_svc(const char *name)
+{
+    for (int i = 0; i < BREEZY_SVC_MAX; i++) {
+        if (s_svcs[i].in_use && strcmp(s_svcs[i].name, name) == 0) return &s_svcs[i];
+    }
+    return NULL;
+}
+
+static svc_t *alloc_svc(const char *name)
+{
+    for (int i = 0; i < BREEZY_SVC_MAX; i++) {
+        svc_t *s = &s_svcs[i];
+        if (s->in_use) continue;
+        memset(s, 0, sizeof(*s));
+        s->in_use = true;
+        strncpy(s->name, name, sizeof(s->name) - 1);
+        return s;
+    }
+    return NULL;
+}
+
+static int svc_job(const svc_t *s)
+{
+    return BREEZY_SVC_JOB_BASE + (int)(s - s_svcs);
+}
+
+static size_t free_heap(void)
+{
+    return heap_caps_get_free_size(MALLOC_CAP_INTERNAL) +
+           heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+}
+
+// ============ CPU Use ============
+
+#ifdef SVC_CPU_STATS
+static bool name_matches(const char *task, const char *prefix, size_t len)
+{
+    return len > 0 && strncmp(task, prefix, len) == 0;
+}
+
+// Run time of the service's live tasks, and the total. Tasks are found by
+// name: def.task, or a command service's name and program.
+static bool cpu_sample(const svc_t *s, uint64_t *used, uint64_t *total)
+{
+    const char *a = s->def.start ? s->def.task : s->name;
+    const char *b = "";
+    size_t blen = 0;
+    if (!s->def.start && s->cmdline) {
+        size_t len = strcspn(s->cmdline, " ");
+        b = s->cmdline;
+        for (size_t i = 0; i < len; i++) {
+            if (s->cmdline[i] == '/') b = s->cmdline + i + 1;
+        }
+        blen = s->cmdline + len - b;
+    }
+    if (!a) return false;
+
+    UBaseType_t n = uxTaskGetNumberOfTasks() + 4;
+    TaskStatus_t *tasks = malloc(n * sizeof(TaskStatus_t));
+    if (!tasks) return false;
+
+    configRUN_TIME_COUNTER_TYPE all = 0;
+    n = uxTaskGetSystemState(tasks, n, &all);
+    uint64_t sum = 0;
+    for (UBaseType_t i = 0; i < n; i++) {
+        const char *name = tasks[i].pcTaskName;
+        if (name_matches(name, a, strlen(a)) || name_matches(name, b, blen)) {
+            sum += tasks[i].ulRunTimeCounter;
+        }
+    }
+    free(tasks);
+
+    *used = sum;
+    *total = all;
+    return all > 0;
+}
+#endif
+
+static int cpu_permille(const svc_t *s)
+{
+#ifdef SVC_CPU_STATS
+    uint64_t used, total;
+    if (s->state != BREEZY_SVC_RUNNING || !cpu_sample(s, &used, &total)) return -1;
+    if (total <= s->total_base || used < s->cpu_base) return 0;
+    return (int)((used - s->cpu_base) * 1000 / (total - s->total_base));
+#else
+    (void)s;
+    return -1;
+#endif
+}
+
+// ============ Starting and Stopping ============
+
+static void svc_task(void *arg)
+{
+    svc_t *s = (svc_t *)arg;
+    breezy_jobs_enter(svc_job(s));
+    breezy_profile_attach(&s->profile);
+
+    // Services get EOF instead of competing for the console
+    FILE *saved_in = stdin;
+    FILE *in = NULL, *wr = NULL;
+    if (breezy_pipe_open(&in, &wr, 16) == 0) {
+        fclose(wr);
+        stdin = in;
+    }
+
+    int ret = breezybox_exec(s->cmdline);
+    fflush(stdout);
+
+    stdin = saved_in;
+    if (in) fclose(in);
+    breezy_profile_attach(NULL);
+    breezy_jobs_leave();
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s->task_ret = ret;
+    s->task_done = true;
+    xSemaphoreGive(s_lock);
+    vTaskDelete(NULL);
+}
+
+// Call with the lock held
+static esp_err_t start_locked(svc_t *s)
+{
+    esp_err_t err;
+
+    if (s->def.start) {
+        char *argv[SVC_MAX_ARGS + 1];
+        argv[0] = s->name;
+        const char *p = s->args;
+        for (int i = 1; i < s->argc; i++) {
+            argv[i] = (char *)p;
+            p += strlen(p) + 1;
+        }
+        argv[s->argc] = NULL;
+
+        size_t before = free_heap();
+        err = s->def.start(s->argc, argv);
+        size_t after = free_heap();
+        s->mem = before > after ? before - after : 0;
+    } else {
+        s->task_done = false;
+        err = xTaskCreate(svc_task, s->name, SVC_STACK_SIZE, s,
+                          uxTaskPriorityGet(NULL), NULL) == pdPASS ? ESP_OK : ESP_ERR_NO_MEM;
+    }
+    if (err != ESP_OK) return err;
+
+    s->state = BREEZY_SVC_RUNNING;
+    s->started_us = esp_timer_get_time();
+#ifdef SVC_CPU_STATS
+    if (!cpu_sample(s, &s->cpu_base, &s->total_base)) {
+        s->cpu_base = s->total_base = 0;
+    }
+#endif
+    return ESP_OK;
+}
+
+// The service stopped by itself. Call with the lock held.
+static void fail_locked(svc_t *s, int ret)
+{
+    int64_t now = esp_timer_get_time();
+    if (now - s->started_us > (int64_t)SVC_STABLE_MS * 1000) s->fails = 0;
+
+    uint32_t delay = SVC_BACKOFF_MIN_MS << (s->fails < 5 ? s->fails : 5);
+    if (delay > SVC_BACKOFF_MAX_MS) delay = SVC_BACKOFF_MAX_MS;
+    s->fails++;
+
+    s->last_ret = ret;
+    s->state = BREEZY_SVC_BACKOFF;
+    s->retry_us = now + (int64_t)delay * 1000;
+    ESP_LOGW(TAG, "%s stopped (%d), restarting in %u ms", s->name, ret, (unsigned)delay);
+}
+
+static void supervisor_task(void *arg)
+{
+    (void)arg;
+    while (true) {
+        vTaskDelay(pdMS_TO_TICKS(SVC_POLL_MS));
+
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        int64_t now = esp_timer_get_time();
+        for (int i = 0; i < BREEZY_SVC_MAX; i++) {
+            svc_t *s = &s_svcs[i];
+            if (!s->in_use) continue;
+
+            switch (s->state) {
+            case BREEZY_SVC_RUNNING:
+                if (!s->def.start && s->task_done) {
+                    if (s->task_ret == 0) {
+                        s->last_ret = 0;
+                        s->state = BREEZY_SVC_STOPPED;
+                        ESP_LOGI(TAG, "%s finished", s->name);
+                    } else {
+                        fail_locked(s, s->task_ret);
+                    }
+                } else if (s->def.start && s->def.running && !s->def.running()) {
+                    if (s->def.stop) s->def.stop();
+                    fail_locked(s, -1);
+                }
+                break;
+
+            case BREEZY_SVC_STOPPING:
+                if (s->task_done) {
+                    s->last_ret = s->task_ret;
+                    s->state = BREEZY_SVC_STOPPED;
+                }
+                break;
+
+            case BREEZY_SVC_BACKOFF:
+                if (now < s->retry_us) break;
+                s->restarts++;
+                esp_err_t err = start_locked(s);
+                if (err != ESP_OK) fail_locked(s, err);
+                break;
+
+            case BREEZY_SVC_STOPPED:
+                break;
+            }
+        }
+        xSemaphoreGive(s_lock);
+    }
+}
+
+// Call with the lock held
+static void ensure_supervisor(void)
+{
+    if (s_supervisor) return;
+
+    UBaseType_t prio = uxTaskPriorityGet(NULL);
+    if (prio > 1) prio--;
+    if (xTaskCreate(supervisor_task, "breezy_svc", SVC_SUPERVISOR_STACK,
+                    NULL, prio, &s_supervisor) != pdPASS) {
+        s_supervisor = NULL;
+        printf("svc: cannot start the supervisor; services won't be restarted\n");
+    }
+}
+
+// Start s, which is stopped or waiting to restart. Call with the lock held.
+static int start_now(svc_t *s)
+{
+    if (s->state == BREEZY_SVC_RUNNING || s->state == BREEZY_SVC_STOPPING) {
+        printf("svc: %s is %s\n", s->name,
+               s->state == BREEZY_SVC_RUNNING ? "already running" : "still stopping");
+        return 1;
+    }
+
+    s->fails = 0;
+    esp_err_t err = start_locked(s);
+    if (err != ESP_OK) {
+        printf("svc: %s: cannot start: %s\n", s->name, esp_err_to_name(err));
+        s->state = BREEZY_SVC_STOPPED;
+        return 1;
+    }
+    ensure_supervisor();
+    return 0;
+}
+
+// ============ API ============
+
+esp_err_t breezy_svc_register(const breezy_svc_def_t *def)
+{
+    if (!def || !def->name || !def->start) return ESP_ERR_INVALID_ARG;
+    lock_init();
+
+    esp_err_t err = ESP_OK;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    svc_t *s = find_svc(def->name);
+    if (s) {
+        err = ESP_ERR_INVALID_STATE;
+    } else if ((s = alloc_svc(def->name)) == NULL) {
+        err = ESP_ERR_NO_MEM;
+    } else {
+        s->def = *def;
+        s->def.name = s->name;
+        s->argc = 1;
+    }
+    xSemaphoreGive(s_lock);
+    return err;
+}
+
+int breezy_svc_start(int argc, char **argv)
+{
+    lock_init();
+    if (argc > SVC_MAX_ARGS) {
+        printf("svc: too many arguments\n");
+        return 1;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    svc_t *s = find_svc(argv[0]);
+    if (!s) {
+        xSemaphoreGive(s_lock);
+        printf("svc: %s: no such service\n", argv[0]);
+        return 1;
+    }
+
+    // New arguments replace the saved ones; none reuses them
+    if (s->def.start && argc > 1) {
+        size_t len = 0;
+        for (int i = 1; i < argc; i++) len += strlen(argv[i]) + 1;
+        char *args = malloc(len);
+        if (!args) {
+            xSemaphoreGive(s_lock);
+            printf("svc: out of memory\n");
+            return 1;
+        }
+        char *p = args;
+        for (int i = 1; i < argc; i++) {
+            strcpy(p, argv[i]);
+            p += strlen(p) + 1;
+        }
+        free(s->args);
+        s->args = args;
+        s->argc = argc;
+    }
+
+    int ret = start_now(s);
+    xSemaphoreGive(s_lock);
+    return ret;
+}
+
+int breezy_svc_run(const char *name, const char *cmdline)
+{
+    lock_init();
+    char *cmd = strdup(cmdline);
+    if (!cmd) {
+        printf("svc: out of memory\n");
+        return 1;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    svc_t *s = find_svc(name);
+    int ret = 1;
+    if (s && s->def.start) {
+        printf("svc: %s is a built-in service; use svc start\n", name);
+    } else if (!s && (s = alloc_svc(name)) == NULL) {
+        printf("svc: too many services\n");
+    } else if (s->state != BREEZY_SVC_STOPPED) {
+        printf("svc: %s is running; stop it first\n", name);
+    } else {
+        free(s->cmdline);
+        s->cmdline = cmd;
+        cmd = NULL;
+        breezy_profile_start(&s->profile);
+        ret = start_now(s);
+    }
+    xSemaphoreGive(s_lock);
+    free(cmd);
+    return ret;
+}
+
+int breezy_svc_stop(const char *name)
+{
+    lock_init();
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    svc_t *s = find_svc(name);
+    if (!s) {
+        xSemaphoreGive(s_lock);
+        printf("svc: %s: no such service\n", name);
+        return 1;
+    }
+
+    if (s->state == BREEZY_SVC_RUNNING && s->def.start) {
+        if (s->def.stop) s->def.stop();
+        s->state = BREEZY_SVC_STOPPED;
+    } else if (s->state == BREEZY_SVC_RUNNING) {
+        s->state = BREEZY_SVC_STOPPING;
+        breezy_elf_kill_job(svc_job(s));
+    } else if (s->state == BREEZY_SVC_BACKOFF) {
+        s->state = BREEZY_SVC_STOPPED;
+    }
+    xSemaphoreGive(s_lock);
+
+    // A command service is stopped once its task has returned
+    for (int waited = 0; waited < SVC_STOP_WAIT_MS; waited += 50) {
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        bool stopping = s->state == BREEZY_SVC_STOPPING && !s->task_done;
+        if (s->state == BREEZY_SVC_STOPPING && s->task_done) {
+            s->last_ret = s->task_ret;
+            s->state = BREEZY_SVC_STOPPED;
+        }
+        xSemaphoreGive(s_lock);
+        if (!stopping) return 0;
+        vTaskDelay(pdMS_TO_TICKS(50));
+    }
+    printf("svc: %s is still stopping\n", name);
+    return 0;
+}
+
+size_t breezy_svc_list(breezy_svc_info_t *out, size_t max)
+{
+    lock_init();
+    int64_t now = esp_timer_get_time();
+    size_t n = 0;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < BREEZY_SVC_MAX && n < max; i++) {
+        const svc_t *s = &s_svcs[i];
+        if (!s->in_use) continue;
+
+        breezy_svc_info_t *o = &out[n++];
+        memset(o, 0, sizeof(*o));
+        strncpy(o->name, s->name, sizeof(o->name) - 1);
+        if (s->cmdline) strncpy(o->cmd, s->cmdline, sizeof(o->cmd) - 1);
+        o->state = s->state;
+        o->last_ret = s->last_ret;
+        o->restarts = s->restarts;
+        o->uptime_s = s->state == BREEZY_SVC_RUNNING
+            ? (uint32_t)((now - s->started_us) / 1000000) : 0;
+        o->mem = s->def.start ? s->mem : s->profile.heap_peak;
+        o->cpu_permille = cpu_permille(s);
+    }
+    xSemaphoreGive(s_lock);
+    return n;
+}
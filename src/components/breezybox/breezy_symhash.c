@@ -0,0 +1,110 @@
+/*
+ * breezy_symhash.c - O(1) symbol resolution for the ELF loader
+ *
+ * elf_loader resolves every undefined symbol of an app with elf_find_sym(),
+ * which strcmp()s its way through the libc, ESP-IDF and customer tables.
+ * With a full firmware table (thousands of names) that is the bulk of the
+ * relocation time for an app with a few hundred imports. We wrap
+ * elf_find_sym and answer from a build-time perfect hash first.
+ */
+
+#include "breezy_symhash.h"
+#include "breezy_abi.h"
+#include "breezy_arena.h"
+#include "breezy_stop.h"
+#include <stddef.h>
+#include <string.h>
+
+#ifdef CONFIG_BREEZYBOX_ELF_SYMHASH
+// Generated by tools/gen_symhash.py at build time
+extern const breezy_symhash_t g_breezy_symhash;
+#define SYMHASH (&g_breezy_symhash)
+#else
+#define SYMHASH ((const breezy_symhash_t *)NULL)
+#endif
+
+static bool s_enabled = true;
+static uint32_t s_lookups = 0;
+static uint32_t s_hits = 0;
+
+uint32_t breezy_symhash_fn(uint32_t seed, const char *s)
+{
+    // FNV-1a, seeded through the offset basis
+    uint32_t h = 2166136261u ^ seed;
+    while (*s) {
+        h = (h ^ (uint8_t)*s++) * 16777619u;
+    }
+
+    // Murmur3 finalizer, so neighbouring seeds give unrelated slots
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+void *breezy_symhash_find(const char *name)
+{
+    const breezy_symhash_t *t = SYMHASH;
+    if (!t || t->size == 0) return NULL;
+
+    int32_t d = t->disp[breezy_symhash_fn(0, name) % t->size];
+    uint32_t slot = d < 0 ? (uint32_t)(-d - 1) : breezy_symhash_fn(d, name) % t->size;
+
+    // Every name maps to some slot; only a match there means it's ours
+    const breezy_symhash_entry_t *e = &t->table[slot];
+    return strcmp(e->name, name) == 0 ? e->addr : NULL;
+}
+
+uint32_t breezy_symhash_size(void)
+{
+    const breezy_symhash_t *t = SYMHASH;
+    return t ? t->size : 0;
+}
+
+void breezy_symhash_set_enabled(bool enabled)
+{
+    s_enabled = enabled;
+}
+
+void breezy_symhash_stats(uint32_t *lookups, uint32_t *hits)
+{
+    if (lookups) *lookups = s_lookups;
+    if (hits) *hits = s_hits;
+}
+
+void breezy_symhash_stats_reset(void)
+{
+    s_lookups = 0;
+    s_hits = 0;
+}
+
+// ============ elf_loader Hook ============
+
+uintptr_t __real_elf_find_sym(const char *sym_name);
+
+uintptr_t __wrap_elf_find_sym(const char *sym_name)
+{
+    // Apps built against breezy_abi.h import just the slot table
+    const breezy_abi_t *abi = breezy_abi_find(sym_name);
+    if (abi) return (uintptr_t)abi;
+
+    // Allocator imports go to the app's arena
+    void *alloc = breezy_arena_symbol(sym_name);
+    if (alloc) return (uintptr_t)alloc;
+
+    // Blocking and file-opening imports become stop points for kill
+    void *stop = breezy_stop_symbol(sym_name);
+    if (stop) return (uintptr_t)stop;
+
+    s_lookups++;
+    if (s_enabled) {
+        void *addr = breezy_symhash_find(sym_name);
+        if (addr) {
+            s_hits++;
+            return (uintptr_t)addr;
+        }
+    }
+    return __real_elf_find_sym(sym_name);
+}
@@ -0,0 +1,701 @@
+/*
+ * breezy_tmpfs.c - RAM filesystem at /tmp
+ *
+ * A tree of nodes under one mutex. A file's data is one buffer that grows
+ * by doubling, charged in full against the size cap. Open descriptors and
+ * directory streams point at nodes: an unlinked file stays readable until
+ * its last descriptor closes, and removing the entry a directory stream is
+ * about to return moves the stream on to the next one.
+ */
+
+#include "breezy_tmpfs.h"
+#include "esp_vfs.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#ifdef CONFIG_BREEZYBOX_TMPFS_KB
+#define TMPFS_LIMIT (CONFIG_BREEZYBOX_TMPFS_KB * 1024)
+#else
+#define TMPFS_LIMIT (1024 * 1024)
+#endif
+
+#define TMPFS_MAX_FDS   16
+#define TMPFS_NAME_MAX  64
+#define TMPFS_MIN_ALLOC 256
+
+static const char *TAG = "tmpfs";
+
+typedef struct tmp_node {
+    struct tmp_node *parent;
+    struct tmp_node *next;      // Next entry in the parent
+    struct tmp_node *child;     // First entry, directories only
+    char *name;
+    bool dir;
+    bool unlinked;              // Removed while open; freed on last close
+    int open;                   // Descriptors on it
+    uint8_t *data;
+    size_t size;
+    size_t cap;
+    time_t mtime;
+} tmp_node_t;
+
+typedef struct {
+    tmp_node_t *node;           // NULL if the slot is free
+    off_t pos;
+    int flags;
+} tmp_fd_t;
+
+typedef struct tmp_dir {
+    DIR dir;                    // First: the VFS layer fills it in
+    struct tmp_dir *next_open;
+    tmp_node_t *node;
+    tmp_node_t *cursor;         // Entry readdir returns next
+    long index;                 // Of cursor, for telldir
+    struct dirent entry;
+} tmp_dir_t;
+
+static tmp_node_t s_root = { .dir = true };
+static tmp_fd_t s_fds[TMPFS_MAX_FDS];
+static tmp_dir_t *s_dirs = NULL;
+static size_t s_used = 0;
+static SemaphoreHandle_t s_lock = NULL;
+
+#define LOCK()   xSemaphoreTake(s_lock, portMAX_DELAY)
+#define UNLOCK() xSemaphoreGive(s_lock)
+
+// ============ Nodes ============
+
+static void *data_realloc(void *p, size_t size)
+{
+#ifdef CONFIG_SPIRAM
+    void *q = heap_caps_realloc(p, size, MALLOC_CAP_SPIRAM);
+    if (q) return q;
+#endif
+    return realloc(p, size);
+}
+
+// Make room for size bytes of data, within the cap
+static int node_reserve(tmp_node_t *n, size_t size)
+{
+    if (size <= n->cap) return 0;
+
+    size_t cap = n->cap ? n->cap * 2 : TMPFS_MIN_ALLOC;
+    if (cap < size) cap = size;
+    if (s_used - n->cap + cap > TMPFS_LIMIT) cap = size;
+    if (s_used - n->cap + cap > TMPFS_LIMIT) {
+        errno = ENOSPC;
+        return -1;
+    }
+
+    uint8_t *data = data_realloc(n->data, cap);
+    if (!data) {
+        errno = ENOSPC;
+        return -1;
+    }
+    s_used = s_used - n->cap + cap;
+    n->data = data;
+    n->cap = cap;
+    return 0;
+}
+
+static int node_truncate(tmp_node_t *n, off_t length)
+{
+    if (n->dir) {
+        errno = EISDIR;
+        return -1;
+    }
+    if (length < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if ((size_t)length > n->size) {
+        if (node_reserve(n, length) != 0) return -1;
+        memset(n->data + n->size, 0, length - n->size);
+    }
+    n->size = length;
+    n->mtime = time(NULL);
+    return 0;
+}
+
+static void node_free(tmp_node_t *n)
+{
+    s_used -= n->cap;
+    free(n->data);
+    free(n->name);
+    free(n);
+}
+
+// Take n out of its directory
+static void node_detach(tmp_node_t *n)
+{
+    for (tmp_dir_t *d = s_dirs; d; d = d->next_open) {
+        if (d->cursor == n) d->cursor = n->next;
+    }
+
+    tmp_node_t **pp = &n->parent->child;
+    while (*pp != n) pp = &(*pp)->next;
+    *pp = n->next;
+    n->parent->mtime = time(NULL);
+    n->parent = NULL;
+    n->next = NULL;
+}
+
+// Put n at the end of dir, so open directory streams still see it
+static void node_attach(tmp_node_t *n, tmp_node_t *dir)
+{
+    tmp_node_t **pp = &dir->child;
+    while (*pp) pp = &(*pp)->next;
+    *pp = n;
+    n->parent = dir;
+    dir->mtime = time(NULL);
+}
+
+// Take n out of its directory; freed now unless still open
+static void node_unlink(tmp_node_t *n)
+{
+    node_detach(n);
+    if (n->open > 0) {
+        n->unlinked = true;
+    } else {
+        node_free(n);
+    }
+}
+
+static tmp_node_t *dir_find(tmp_node_t *dir, const char *name, size_t len)
+{
+    for (tmp_node_t *n = dir->child; n; n = n->next) {
+        if (strncmp(n->name, name, len) == 0 && n->name[len] == '\0') return n;
+    }
+    return NULL;
+}
+
+// Walk path from the root. With leaf set, stop at the last component:
+// return its directory and point *leaf at the name within path.
+static tmp_node_t *walk(const char *path, const char **leaf)
+{
+    tmp_node_t *n = &s_root;
+    const char *p = path;
+
+    for (;;) {
+        while (*p == '/') p++;
+        if (*p == '\0') break;
+
+        size_t len = strcspn(p, "/");
+        const char *rest = p + len + strspn(p + len, "/");
+        if (leaf && *rest == '\0') {
+            if (len >= TMPFS_NAME_MAX) {
+                errno = ENAMETOOLONG;
+                return NULL;
+            }
+            *leaf = p;
+            return n;
+        }
+
+        if (!n->dir) {
+            errno = ENOTDIR;
+            return NULL;
+        }
+        if (len == 1 && p[0] == '.') {
+            // Stay
+        } else if (len == 2 && p[0] == '.' && p[1] == '.') {
+            if (n->parent) n = n->parent;
+        } else {
+            n = dir_find(n, p, len);
+            if (!n) {
+                errno = ENOENT;
+                return NULL;
+            }
+        }
+        p += len;
+    }
+
+    if (leaf) {
+        // The root itself, which has no name in a directory
+        errno = EBUSY;
+        return NULL;
+    }
+    return n;
+}
+
+static tmp_node_t *lookup(const char *path)
+{
+    return walk(path, NULL);
+}
+
+// The entry for path's last component in *dir, or NULL; *dir is NULL if
+// the directory does not exist
+static tmp_node_t *lookup_leaf(const char *path, tmp_node_t **dir, const char **name,
+                               size_t *len)
+{
+    *dir = walk(path, name);
+    if (!*dir) return NULL;
+    if (!(*dir)->dir) {
+        *dir = NULL;
+        errno = ENOTDIR;
+        return NULL;
+    }
+    *len = strcspn(*name, "/");
+    if ((*len == 1 && (*name)[0] == '.') || (*len == 2 && strncmp(*name, "..", 2) == 0)) {
+        *dir = NULL;
+        errno = EINVAL;
+        return NULL;
+    }
+    return dir_find(*dir, *name, *len);
+}
+
+static tmp_node_t *node_new(tmp_node_t *dir, const char *name, size_t len, bool is_dir)
+{
+    tmp_node_t *n = calloc(1, sizeof(tmp_node_t));
+    char *copy = n ? strndup(name, len) : NULL;
+    if (!copy) {
+        free(n);
+        errno = ENOSPC;
+        return NULL;
+    }
+    n->name = copy;
+    n->dir = is_dir;
+    n->mtime = time(NULL);
+    node_attach(n, dir);
+    return n;
+}
+
+static void node_stat(const tmp_node_t *n, struct stat *st)
+{
+    memset(st, 0, sizeof(*st));
+    st->st_mode = n->dir ? S_IFDIR | 0755 : S_IFREG | 0644;
+    st->st_nlink = 1;
+    st->st_size = n->dir ? 0 : n->size;
+    st->st_blksize = TMPFS_MIN_ALLOC;
+    st->st_mtime = n->mtime;
+    st->st_atime = n->mtime;
+    st->st_ctime = n->mtime;
+}
+
+// ============ Files ============
+
+static tmp_fd_t *get_fd(int fd)
+{
+    if (fd < 0 || fd >= TMPFS_MAX_FDS || !s_fds[fd].node) {
+        errno = EBADF;
+        return NULL;
+    }
+    return &s_fds[fd];
+}
+
+static int tmp_open(const char *path, int flags, int mode)
+{
+    (void)mode;
+    LOCK();
+
+    int fd = -1;
+    for (int i = 0; i < TMPFS_MAX_FDS; i++) {
+        if (!s_fds[i].node) {
+            fd = i;
+            break;
+        }
+    }
+
+    int acc = flags & O_ACCMODE;
+    tmp_node_t *n = lookup(path);
+    if (fd < 0) {
+        errno = ENFILE;
+    } else if (n && (flags & O_CREAT) && (flags & O_EXCL)) {
+        errno = EEXIST;
+        n = NULL;
+    } else if (n && n->dir && acc != O_RDONLY) {
+        errno = EISDIR;
+        n = NULL;
+    } else if (!n && errno == ENOENT && (flags & O_CREAT)) {
+        tmp_node_t *dir;
+        const char *name;
+        size_t len;
+        if (!lookup_leaf(path, &dir, &name, &len) && dir) {
+            n = node_new(dir, name, len, false);
+        }
+    } else if (n && (flags & O_TRUNC) && acc != O_RDONLY) {
+        node_truncate(n, 0);
+    }
+
+    if (fd >= 0 && n) {
+        n->open++;
+        s_fds[fd] = (tmp_fd_t){ .node = n, .pos = 0, .flags = flags };
+    } else {
+        fd = -1;
+    }
+    UNLOCK();
+    return fd;
+}
+
+static int tmp_close(int fd)
+{
+    LOCK();
+    tmp_fd_t *f = get_fd(fd);
+    if (!f) {
+        UNLOCK();
+        return -1;
+    }
+    tmp_node_t *n = f->node;
+    f->node = NULL;
+    if (--n->open == 0 && n->unlinked) node_free(n);
+    UNLOCK();
+    return 0;
+}
+
+static ssize_t tmp_read(int fd, void *dst, size_t size)
+{
+    LOCK();
+    tmp_fd_t *f = get_fd(fd);
+    ssize_t ret = -1;
+    if (f && f->node->dir) {
+        errno = EISDIR;
+    } else if (f && (f->flags & O_ACCMODE) == O_WRONLY) {
+        errno = EBADF;
+    } else if (f) {
+        tmp_node_t *n = f->node;
+        size_t avail = (size_t)f->pos < n->size ? n->size - f->pos : 0;
+        ret = size < avail ? size : avail;
+        memcpy(dst, n->data + f->pos, ret);
+        f->pos += ret;
+    }
+    UNLOCK();
+    return ret;
+}
+
+static ssize_t tmp_write(int fd, const void *data, size_t size)
+{
+    LOCK();
+    tmp_fd_t *f = get_fd(fd);
+    ssize_t ret = -1;
+    if (f && (f->flags & O_ACCMODE) == O_RDONLY) {
+        errno = EBADF;
+    } else if (f) {
+        tmp_node_t *n = f->node;
+        if (f->flags & O_APPEND) f->pos = n->size;
+        size_t end = f->pos + size;
+        if (node_reserve(n, end) == 0) {
+            // A seek past the end leaves a hole of zeros
+            if ((size_t)f->pos > n->size) memset(n->data + n->size, 0, f->pos - n->size);
+            memcpy(n->data + f->pos, data, size);
+            if (end > n->size) n->size = end;
+            n->mtime = time(NULL);
+            f->pos = end;
+            ret = size;
+        }
+    }
+    UNLOCK();
+    return ret;
+}
+
+static off_t tmp_lseek(int fd, off_t offset, int whence)
+{
+    LOCK();
+    tmp_fd_t *f = get_fd(fd);
+    off_t ret = -1;
+    if (f) {
+        off_t base = whence == SEEK_SET ? 0
+                   : whence == SEEK_CUR ? f->pos
+                   : whence == SEEK_END ? (off_t)f->node->size : -1;
+        if (base < 0 || base + offset < 0) {
+            errno = EINVAL;
+        } else {
+            f->pos = base + offset;
+            ret = f->pos;
+        }
+    }
+    UNLOCK();
+    return ret;
+}
+
+static int tmp_fstat(int fd, struct stat *st)
+{
+    LOCK();
+    tmp_fd_t *f = get_fd(fd);
+    if (f) node_stat(f->node, st);
+    UNLOCK();
+    return f ? 0 : -1;
+}
+
+static int tmp_ftruncate(int fd, off_t length)
+{
+    LOCK();
+    tmp_fd_t *f = get_fd(fd);
+    int ret = -1;
+    if (f && (f->flags & O_ACCMODE) == O_RDONLY) {
+        errno = EBADF;
+    } else if (f) {
+        ret = node_truncate(f->node, length);
+    }
+    UNLOCK();
+    return ret;
+}
+
+static int tmp_fsync(int fd)
+{
+    LOCK();
+    tmp_fd_t *f = get_fd(fd);
+    UNLOCK();
+    return f ? 0 : -1;
+}
+
+// ============ Paths ============
+
+static int tmp_stat(const char *path, struct stat *st)
+{
+    LOCK();
+    tmp_node_t *n = lookup(path);
+    if (n) node_stat(n, st);
+    UNLOCK();
+    return n ? 0 : -1;
+}
+
+static int tmp_truncate(const char *path, off_t length)
+{
+    LOCK();
+    tmp_node_t *n = lookup(path);
+    int ret = n ? node_truncate(n, length) : -1;
+    UNLOCK();
+    return ret;
+}
+
+static int tmp_unlink(const char *path)
+{
+    LOCK();
+    tmp_node_t *n = lookup(path);
+    int ret = -1;
+    if (n && n->dir) {
+        errno = EISDIR;
+    } else if (n) {
+        node_unlink(n);
+        ret = 0;
+    }
+    UNLOCK();
+    return ret;
+}
+
+static int tmp_mkdir(const char *path, mode_t mode)
+{
+    (void)mode;
+    LOCK();
+    tmp_node_t *dir;
+    const char *name;
+    size_t len;
+    tmp_node_t *n = lookup_leaf(path, &dir, &name, &len);
+    int ret = -1;
+    if (n || (!dir && errno == EBUSY)) {
+        errno = EEXIST;
+    } else if (dir && node_new(dir, name, len, true)) {
+        ret = 0;
+    }
+    UNLOCK();
+    return ret;
+}
+
+static int tmp_rmdir(const char *path)
+{
+    LOCK();
+    tmp_node_t *n = lookup(path);
+    int ret = -1;
+    if (n == &s_root) {
+        errno = EBUSY;
+    } else if (n && !n->dir) {
+        errno = ENOTDIR;
+    } else if (n && n->child) {
+        errno = ENOTEMPTY;
+    } else if (n) {
+        node_unlink(n);
+        ret = 0;
+    }
+    UNLOCK();
+    return ret;
+}
+
+static bool is_within(const tmp_node_t *n, const tmp_node_t *dir)
+{
+    for (; n; n = n->parent) {
+        if (n == dir) return true;
+    }
+    return false;
+}
+
+static int tmp_rename(const char *src, const char *dst)
+{
+    LOCK();
+    tmp_node_t *n = lookup(src);
+    tmp_node_t *dir;
+    const char *name;
+    size_t len;
+    tmp_node_t *old = n ? lookup_leaf(dst, &dir, &name, &len) : NULL;
+    int ret = -1;
+
+    if (!n || (!old && !dir)) {
+        // errno set by the lookup
+    } else if (n == &s_root || is_within(dir, n)) {
+        errno = EINVAL;
+    } else if (old == n) {
+        ret = 0;
+    } else if (old && old->dir && !n->dir) {
+        errno = EISDIR;
+    } else if (old && !old->dir && n->dir) {
+        errno = ENOTDIR;
+    } else if (old && old->child) {
+        errno = ENOTEMPTY;
+    } else {
+        char *copy = strndup(name, len);
+        if (!copy) {
+            errno = ENOSPC;
+        } else {
+            if (old) node_unlink(old);
+            node_detach(n);
+            free(n->name);
+            n->name = copy;
+            node_attach(n, dir);
+            ret = 0;
+        }
+    }
+    UNLOCK();
+    return ret;
+}
+
+// ============ Directories ============
+
+static DIR *tmp_opendir(const char *path)
+{
+    LOCK();
+    tmp_node_t *n = lookup(path);
+    tmp_dir_t *d = NULL;
+    if (n && !n->dir) {
+        errno = ENOTDIR;
+    } else if (n) {
+        d = calloc(1, sizeof(tmp_dir_t));
+        if (!d) {
+            errno = ENOMEM;
+        } else {
+            d->node = n;
+            d->cursor = n->child;
+            d->next_open = s_dirs;
+            s_dirs = d;
+            n->open++;
+        }
+    }
+    UNLOCK();
+    return (DIR *)d;
+}
+
+static struct dirent *tmp_readdir(DIR *pdir)
+{
+    tmp_dir_t *d = (tmp_dir_t *)pdir;
+    struct dirent *ret = NULL;
+
+    LOCK();
+    tmp_node_t *n = d->cursor;
+    if (n) {
+        d->entry.d_ino = d->index + 1;
+        d->entry.d_type = n->dir ? DT_DIR : DT_REG;
+        strncpy(d->entry.d_name, n->name, sizeof(d->entry.d_name) - 1);
+        d->entry.d_name[sizeof(d->entry.d_name) - 1] = '\0';
+        d->cursor = n->next;
+        d->index++;
+        ret = &d->entry;
+    }
+    UNLOCK();
+    return ret;
+}
+
+static long tmp_telldir(DIR *pdir)
+{
+    tmp_dir_t *d = (tmp_dir_t *)pdir;
+    LOCK();
+    long index = d->index;
+    UNLOCK();
+    return index;
+}
+
+static void tmp_seekdir(DIR *pdir, long offset)
+{
+    tmp_dir_t *d = (tmp_dir_t *)pdir;
+    LOCK();
+    d->cursor = d->node->unlinked ? NULL : d->node->child;
+    d->index = 0;
+    while (d->cursor && d->index < offset) {
+        d->cursor = d->cursor->next;
+        d->index++;
+    }
+    UNLOCK();
+}
+
+static int tmp_closedir(DIR *pdir)
+{
+    tmp_dir_t *d = (tmp_dir_t *)pdir;
+    LOCK();
+    tmp_dir_t **pp = &s_dirs;
+    while (*pp != d) pp = &(*pp)->next_open;
+    *pp = d->next_open;
+
+    tmp_node_t *n = d->node;
+    if (--n->open == 0 && n->unlinked) node_free(n);
+    UNLOCK();
+    free(d);
+    return 0;
+}
+
+// ============ Public API ============
+
+esp_err_t breezy_tmpfs_init(void)
+{
+    if (s_lock) return ESP_OK;
+    s_lock = xSemaphoreCreateMutex();
+    if (!s_lock) return ESP_ERR_NO_MEM;
+
+    s_root.mtime = time(NULL);
+
+    esp_vfs_t vfs = {
+        .flags = ESP_VFS_FLAG_DEFAULT,
+        .open = tmp_open,
+        .close = tmp_close,
+        .read = tmp_read,
+        .write = tmp_write,
+        .lseek = tmp_lseek,
+        .fstat = tmp_fstat,
+        .fsync = tmp_fsync,
+        .ftruncate = tmp_ftruncate,
+        .stat = tmp_stat,
+        .truncate = tmp_truncate,
+        .unlink = tmp_unlink,
+        .rename = tmp_rename,
+        .mkdir = tmp_mkdir,
+        .rmdir = tmp_rmdir,
+        .opendir = tmp_opendir,
+        .readdir = tmp_readdir,
+        .telldir = tmp_telldir,
+        .seekdir = tmp_seekdir,
+        .closedir = tmp_closedir,
+    };
+
+    esp_err_t ret = esp_vfs_register(BREEZYBOX_TMP_DIR, &vfs, NULL);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot register %s: %s", BREEZYBOX_TMP_DIR, esp_err_to_name(ret));
+        vSemaphoreDelete(s_lock);
+        s_lock = NULL;
+    }
+    return ret;
+}
+
+void breezy_tmpfs_info(size_t *total, size_t *used)
+{
+    if (total) *total = TMPFS_LIMIT;
+    if (used) {
+        if (s_lock) LOCK();
+        *used = s_used;
+        if (s_lock) UNLOCK();
+    }
+}
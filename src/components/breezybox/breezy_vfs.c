@@ -1,10 +1,22 @@
 #include "breezy_vfs.h"
+#include "breezy_cmdtab.h"
+#include "breezy_tmpfs.h"
+#include "breezy_bcache.h"
+#include "breezy_statcache.h"
 #include "esp_littlefs.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 
+#define RESOLVE_CACHE_SIZE 4     // Per task; 0 turns the cache off
+#define RESOLVE_CACHE_NAME 48    // Longer relative names are not cached
+
 static char s_cwd[BREEZYBOX_MAX_PATH + 1] = BREEZYBOX_MOUNT_POINT;
+static uint32_t s_cwd_gen = 1;   // Bumped on every chdir
 
 void breezybox_get_cwd(char *buf, size_t size)
 {
@@ -21,60 +33,158 @@ const char *breezybox_cwd(void)
 
 int breezybox_set_cwd(const char *path)
 {
-    char new_path[BREEZYBOX_MAX_PATH + 1];
-
-    if (strcmp(path, "..") == 0) {
-        if (strcmp(s_cwd, "/") == 0) return 0;
-        strncpy(new_path, s_cwd, sizeof(new_path));
-        char *last_slash = strrchr(new_path, '/');
-        if (last_slash == new_path) {
-            new_path[1] = '\0';
-        } else if (last_slash) {
-            *last_slash = '\0';
-        }
-    } else if (path[0] == '/') {
-        strncpy(new_path, path, sizeof(new_path) - 1);
-        new_path[sizeof(new_path) - 1] = '\0';
-    } else {
-        size_t cwd_len = strlen(s_cwd);
-        size_t path_len = strlen(path);
-        if (cwd_len + 1 + path_len >= sizeof(new_path)) return -1;
-
-        strcpy(new_path, s_cwd);
-        if (cwd_len > 1) {
-            new_path[cwd_len] = '/';
-            strcpy(new_path + cwd_len + 1, path);
-        } else {
-            strcpy(new_path + 1, path);
-        }
+    char new_path[BREEZYBOX_MAX_PATH * 2 + 2];
+    if (!breezybox_resolve_path(path, new_path, sizeof(new_path)) ||
+        strlen(new_path) > BREEZYBOX_MAX_PATH) {
+        return -1;
     }
 
     struct stat st;
     if (strcmp(new_path, "/") == 0 ||
         (stat(new_path, &st) == 0 && S_ISDIR(st.st_mode))) {
         strcpy(s_cwd, new_path);
+        s_cwd_gen++;
+        breezy_cmdtab_invalidate(NULL);  // Bare names resolve from the CWD
         return 0;
     }
     return -1;
 }
 
+// ============ Path Resolution ============
+
+// Absolute, with no empty, "." or ".." components and no trailing slash
+static bool is_canonical(const char *path)
+{
+    if (path[0] != '/') return false;
+    if (path[1] == '\0') return true;
+
+    for (const char *p = path; *p;) {
+        const char *c = ++p;  // Past the slash
+        if (*c == '/' || *c == '\0') return false;
+        if (c[0] == '.' && (c[1] == '/' || c[1] == '\0' ||
+                            (c[1] == '.' && (c[2] == '/' || c[2] == '\0')))) {
+            return false;
+        }
+        while (*p && *p != '/') p++;
+    }
+    return true;
+}
+
+// Collapse "//", "." and ".." of an absolute path in place. The output
+// never gets ahead of the input, so one buffer does.
+static void canonicalize(char *path)
+{
+    size_t w = 0;
+    size_t i = 0;
+    while (path[i]) {
+        while (path[i] == '/') i++;
+        if (!path[i]) break;
+
+        size_t start = i;
+        while (path[i] && path[i] != '/') i++;
+        size_t n = i - start;
+
+        if (n == 1 && path[start] == '.') continue;
+        if (n == 2 && path[start] == '.' && path[start + 1] == '.') {
+            while (w > 0 && path[--w] != '/') {}
+            continue;
+        }
+        path[w++] = '/';
+        memmove(path + w, path + start, n);
+        w += n;
+    }
+    if (w == 0) path[w++] = '/';
+    path[w] = '\0';
+}
+
+#if RESOLVE_CACHE_SIZE > 0
+// Recent relative names and what they resolved to, per task: scripts and
+// commands look up the same few names over and over
+typedef struct {
+    uint32_t gen;               // s_cwd_gen when stored; 0 if unused
+    char name[RESOLVE_CACHE_NAME];
+    char path[BREEZYBOX_MAX_PATH * 2 + 2];
+} resolve_entry_t;
+
+typedef struct {
+    resolve_entry_t entries[RESOLVE_CACHE_SIZE];
+    int next;
+} resolve_cache_t;
+
+static pthread_key_t s_cache_key;
+static pthread_once_t s_cache_once = PTHREAD_ONCE_INIT;
+
+static void cache_key_init(void)
+{
+    pthread_key_create(&s_cache_key, free);
+}
+
+static resolve_cache_t *task_cache(void)
+{
+    pthread_once(&s_cache_once, cache_key_init);
+    resolve_cache_t *c = pthread_getspecific(s_cache_key);
+    if (!c && (c = calloc(1, sizeof(*c))) != NULL) {
+        if (pthread_setspecific(s_cache_key, c) != 0) {
+            free(c);
+            c = NULL;
+        }
+    }
+    return c;
+}
+#endif
+
 char *breezybox_resolve_path(const char *path, char *buf, size_t size)
 {
+    size_t path_len = strlen(path);
+
     if (path[0] == '/') {
-        strncpy(buf, path, size - 1);
-        buf[size - 1] = '\0';
-    } else {
-        size_t cwd_len = strlen(s_cwd);
-        size_t path_len = strlen(path);
-        if (cwd_len + 1 + path_len >= size) return NULL;
-        
-        if (cwd_len == 1 && s_cwd[0] == '/') {
-            snprintf(buf, size, "/%s", path);
-        } else {
-            snprintf(buf, size, "%s/%s", s_cwd, path);
+        if (path_len >= size) goto too_long;
+        memcpy(buf, path, path_len + 1);
+        if (!is_canonical(buf)) canonicalize(buf);
+        return buf;
+    }
+
+#if RESOLVE_CACHE_SIZE > 0
+    resolve_cache_t *cache = path_len < RESOLVE_CACHE_NAME ? task_cache() : NULL;
+    if (cache) {
+        for (int i = 0; i < RESOLVE_CACHE_SIZE; i++) {
+            resolve_entry_t *e = &cache->entries[i];
+            if (e->gen == s_cwd_gen && strcmp(e->name, path) == 0) {
+                size_t len = strlen(e->path);
+                if (len >= size) goto too_long;
+                memcpy(buf, e->path, len + 1);
+                return buf;
+            }
         }
     }
+#endif
+
+    size_t cwd_len = strlen(s_cwd);
+    if (cwd_len + 1 + path_len >= size) goto too_long;
+    memcpy(buf, s_cwd, cwd_len);
+    buf[cwd_len] = '/';
+    memcpy(buf + cwd_len + 1, path, path_len + 1);
+    canonicalize(buf);
+
+#if RESOLVE_CACHE_SIZE > 0
+    if (cache && strlen(buf) < sizeof(cache->entries[0].path)) {
+        resolve_entry_t *e = &cache->entries[cache->next];
+        cache->next = (cache->next + 1) % RESOLVE_CACHE_SIZE;
+        e->gen = s_cwd_gen;
+        memcpy(e->name, path, path_len + 1);
+        strcpy(e->path, buf);
+    }
+#endif
     return buf;
+
+too_long:
+    if (size > 0) buf[0] = '\0';
+    return NULL;
+}
+
+const char *breezybox_canonical_path(const char *path, char *buf, size_t size)
+{
+    return is_canonical(path) ? path : breezybox_resolve_path(path, buf, size);
 }
 
 esp_err_t breezybox_vfs_init(void)
@@ -86,6 +196,13 @@ esp_err_t breezybox_vfs_init(void)
         .dont_mount = false,
     };
 
+#ifdef CONFIG_BREEZYBOX_FS_CACHE
+    // Before mounting, so LittleFS reads through it from the start
+    if (breezy_bcache_init(conf.partition_label) != ESP_OK) {
+        printf("Block cache disabled\n");
+    }
+#endif
+
     esp_err_t ret = esp_vfs_littlefs_register(&conf);
     if (ret != ESP_OK) {
         if (ret == ESP_FAIL) {
@@ -95,11 +212,19 @@ esp_err_t breezybox_vfs_init(void)
         }
         return ret;
     }
+    breezy_statcache_init();
 
     size_t total = 0, used = 0;
     esp_littlefs_info("storage", &total, &used);
     printf("LittleFS: %d KB total, %d KB used\n", (int)(total / 1024), (int)(used / 1024));
 
+#ifdef CONFIG_BREEZYBOX_TMPFS
+    // Scratch files go to RAM instead of wearing the flash
+    if (breezy_tmpfs_init() == ESP_OK) {
+        setenv("TMPDIR", BREEZYBOX_TMP_DIR, 1);
+    }
+#endif
+
     strcpy(s_cwd, BREEZYBOX_MOUNT_POINT);
     return ESP_OK;
 }
\ No newline at end of file
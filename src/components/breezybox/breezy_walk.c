@@ -0,0 +1,185 @@
+/*
+ * breezy_walk.c - Iterative directory tree walk
+ *
+ * One frame per open directory on a heap array that grows as needed, and
+ * one shared path buffer that each level appends its name to and cuts back
+ * off. Nothing on the C stack depends on the depth of the tree.
+ */
+
+#include "breezy_walk.h"
+#include <dirent.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FRAMES_MIN  8
+
+typedef struct {
+    DIR *dir;               // NULL once read to the end, or if it won't open
+    size_t path_len;        // Length of this directory's path
+    size_t name_off;        // Where its name starts in the path
+    bool has_st;
+    struct stat st;
+    uint64_t data;          // breezy_walk_entry_t.dir_data
+} frame_t;
+
+typedef struct {
+    char *path;
+    size_t root_len;
+    frame_t *frames;
+    int depth;              // Frames in use
+    int cap;
+    bool oom;
+} walk_t;
+
+static breezy_walk_ret_t call(const walk_t *w, breezy_walk_cb_t cb, size_t name_off,
+                              int depth, bool is_dir, const struct stat *st,
+                              uint64_t *dir_data, void *ctx)
+{
+    if (!cb) return BREEZY_WALK_CONTINUE;
+
+    breezy_walk_entry_t e = {
+        .path = w->path,
+        .name = w->path + name_off,
+        .root_len = w->root_len,
+        .depth = depth,
+        .is_dir = is_dir,
+        .st = st,
+        .dir_data = dir_data,
+    };
+    return cb(&e, ctx);
+}
+
+// New frame for the directory now in w->path; its DIR is opened later
+static frame_t *push(walk_t *w, size_t name_off, const struct stat *st)
+{
+    if (w->depth == w->cap) {
+        int cap = w->cap ? w->cap * 2 : FRAMES_MIN;
+        frame_t *frames = realloc(w->frames, cap * sizeof(frame_t));
+        if (!frames) return NULL;
+        w->frames = frames;
+        w->cap = cap;
+    }
+
+    frame_t *f = &w->frames[w->depth++];
+    f->dir = NULL;
+    f->path_len = strlen(w->path);
+    f->name_off = name_off;
+    f->has_st = st != NULL;
+    if (st) f->st = *st;
+    f->data = 0;
+    return f;
+}
+
+// Enter a directory: pre, then open it unless pre said otherwise
+static breezy_walk_ret_t enter(walk_t *w, breezy_walk_cb_t pre, size_t name_off,
+                               const struct stat *st, void *ctx)
+{
+    frame_t *f = push(w, name_off, st);
+    if (!f) {
+        w->oom = true;
+        return BREEZY_WALK_STOP;
+    }
+
+    breezy_walk_ret_t r = call(w, pre, name_off, w->depth - 1, true, st, &f->data, ctx);
+    if (r == BREEZY_WALK_SKIP) {
+        w->depth--;
+        return BREEZY_WALK_CONTINUE;
+    }
+    if (r == BREEZY_WALK_CONTINUE) f->dir = opendir(w->path);
+    return r;
+}
+
+int breezy_walk(const char *root, breezy_walk_cb_t pre, breezy_walk_cb_t post,
+                unsigned flags, void *ctx)
+{
+    struct stat st;
+    if (stat(root, &st) != 0) return -1;
+
+    size_t root_len = strlen(root);
+    if (root_len >= BREEZY_WALK_PATH_MAX) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    walk_t w = { .root_len = root_len };
+    w.path = malloc(BREEZY_WALK_PATH_MAX);
+    if (!w.path) return -1;
+    memcpy(w.path, root, root_len + 1);
+
+    const char *slash = strrchr(root, '/');
+    size_t name_off = (slash && slash[1]) ? (size_t)(slash + 1 - root) : 0;
+    bool is_dir = S_ISDIR(st.st_mode);
+    bool want_st = (flags & BREEZY_WALK_STAT) || ((flags & BREEZY_WALK_STAT_FILES) && !is_dir);
+
+    int ret = 0;
+    breezy_walk_ret_t r;
+    if (!is_dir) {
+        r = call(&w, pre, name_off, 0, false, want_st ? &st : NULL, NULL, ctx);
+    } else {
+        r = enter(&w, pre, name_off, want_st ? &st : NULL, ctx);
+    }
+    if (r == BREEZY_WALK_STOP) ret = 1;
+
+    while (ret == 0 && w.depth > 0) {
+        frame_t *f = &w.frames[w.depth - 1];
+        struct dirent *d = f->dir ? readdir(f->dir) : NULL;
+
+        if (!d) {
+            // Contents done: post, then back up a level
+            if (f->dir) closedir(f->dir);
+            f->dir = NULL;
+            w.path[f->path_len] = '\0';
+            r = call(&w, post, f->name_off, w.depth - 1, true,
+                     f->has_st ? &f->st : NULL, &f->data, ctx);
+            w.depth--;
+            if (r == BREEZY_WALK_STOP) ret = 1;
+            continue;
+        }
+        if (strcmp(d->d_name, ".") == 0 || strcmp(d->d_name, "..") == 0) continue;
+
+        // Append the name; a root of "/" already ends in one
+        size_t len = f->path_len;
+        size_t name_len = strlen(d->d_name);
+        bool sep = len == 0 || w.path[len - 1] != '/';
+        if (len + sep + name_len >= BREEZY_WALK_PATH_MAX) continue;
+        if (sep) w.path[len++] = '/';
+        memcpy(w.path + len, d->d_name, name_len + 1);
+
+        // readdir() usually knows directories from files; stat() only if
+        // asked to or it doesn't
+        is_dir = d->d_type == DT_DIR;
+        want_st = (flags & BREEZY_WALK_STAT) || ((flags & BREEZY_WALK_STAT_FILES) && !is_dir);
+        if (want_st || d->d_type == DT_UNKNOWN) {
+            if (stat(w.path, &st) != 0) {
+                w.path[f->path_len] = '\0';
+                continue;
+            }
+            is_dir = S_ISDIR(st.st_mode);
+            want_st = (flags & BREEZY_WALK_STAT) || ((flags & BREEZY_WALK_STAT_FILES) && !is_dir);
+        }
+
+        if (is_dir) {
+            // May move the frames; f is not used again
+            r = enter(&w, pre, len, want_st ? &st : NULL, ctx);
+            if (r == BREEZY_WALK_STOP) ret = 1;
+        } else {
+            r = call(&w, pre, len, w.depth, false, want_st ? &st : NULL, NULL, ctx);
+            if (r == BREEZY_WALK_STOP) ret = 1;
+            w.path[f->path_len] = '\0';
+        }
+    }
+
+    // Stopped early: close whatever is still open
+    while (w.depth > 0) {
+        frame_t *f = &w.frames[--w.depth];
+        if (f->dir) closedir(f->dir);
+    }
+    free(w.frames);
+    free(w.path);
+    if (w.oom) {
+        errno = ENOMEM;
+        return -1;
+    }
+    return ret;
+}
@@ -1,7 +1,10 @@
 #include "breezy_vfs.h"
+#include "breezy_cmdtab.h"
+#include "breezy_statcache.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdbool.h>
 #include <errno.h>
 #include <dirent.h>
 #include <sys/stat.h>
@@ -11,11 +14,14 @@
 // Declare the 'real' functions
 FILE* __real_fopen(const char *path, const char *mode);
 int __real_open(const char *path, int flags, int mode);
+int __real_fclose(FILE *f);
+int __real_close(int fd);
 int __real_mkdir(const char *path, mode_t mode);
 int __real_stat(const char *path, struct stat *st);
 int __real_rename(const char *oldpath, const char *newpath);
 int __real_remove(const char *path);
 int __real_rmdir(const char *path);
+int __real_unlink(const char *path);
 DIR* __real_opendir(const char *name);
 struct dirent* __real_readdir(DIR* dirp);
 int __real_closedir(DIR* dirp);
@@ -32,53 +38,118 @@ typedef struct {
 } virtual_root_dir_t;
 
 // Mount points to show at "/"
-static const char *s_mount_names[] = { "root" };
+static const char *s_mount_names[] = {
+    "root",
+#ifdef CONFIG_BREEZYBOX_TMPFS
+    "tmp",
+#endif
+};
 #define NUM_MOUNTS (sizeof(s_mount_names) / sizeof(s_mount_names[0]))
 
 // ============ Wrapped Functions ============
 
+// Commands mostly pass paths they have resolved already; those go through
+// breezybox_canonical_path() without another copy
+
+// Writes can create, replace or truncate a program the shell has cached
+static bool fopen_mode_writes(const char *mode)
+{
+    return strpbrk(mode, "wa+") != NULL;
+}
+
 FILE* __wrap_fopen(const char *path, const char *mode)
 {
     char resolved[BREEZYBOX_MAX_PATH * 2 + 2];
-    const char *p = breezybox_resolve_path(path, resolved, sizeof(resolved));
-    return __real_fopen(p ? p : path, mode);
+    const char *p = breezybox_canonical_path(path, resolved, sizeof(resolved));
+    FILE *f = __real_fopen(p ? p : path, mode);
+    if (f && p && fopen_mode_writes(mode)) {
+        breezy_cmdtab_invalidate(p);
+        breezy_statcache_writer_open(fileno(f), p);
+    }
+    return f;
 }
 
 int __wrap_open(const char *path, int flags, int mode)
 {
     char resolved[BREEZYBOX_MAX_PATH * 2 + 2];
-    const char *p = breezybox_resolve_path(path, resolved, sizeof(resolved));
-    return __real_open(p ? p : path, flags, mode);
+    const char *p = breezybox_canonical_path(path, resolved, sizeof(resolved));
+    int fd = __real_open(p ? p : path, flags, mode);
+    if (fd >= 0 && p && (flags & (O_WRONLY | O_RDWR | O_CREAT | O_TRUNC))) {
+        breezy_cmdtab_invalidate(p);
+        breezy_statcache_writer_open(fd, p);
+    }
+    return fd;
+}
+
+// A file written through fd has its final size and mtime now
+int __wrap_fclose(FILE *f)
+{
+    int fd = f ? fileno(f) : -1;
+    int ret = __real_fclose(f);
+    breezy_statcache_fd_closed(fd);
+    return ret;
+}
+
+int __wrap_close(int fd)
+{
+    int ret = __real_close(fd);
+    breezy_statcache_fd_closed(fd);
+    return ret;
 }
 
 int __wrap_mkdir(const char *path, mode_t mode)
 {
     char resolved[BREEZYBOX_MAX_PATH * 2 + 2];
-    const char *p = breezybox_resolve_path(path, resolved, sizeof(resolved));
-    return __real_mkdir(p ? p : path, mode);
+    const char *p = breezybox_canonical_path(path, resolved, sizeof(resolved));
+    int ret = __real_mkdir(p ? p : path, mode);
+    if (ret == 0) breezy_statcache_clear();
+    if (ret == 0 && p) breezy_cmdtab_invalidate(p);
+    return ret;
 }
 
 int __wrap_rename(const char *oldpath, const char *newpath)
 {
     char resolved_old[BREEZYBOX_MAX_PATH * 2 + 2];
     char resolved_new[BREEZYBOX_MAX_PATH * 2 + 2];
-    const char *p_old = breezybox_resolve_path(oldpath, resolved_old, sizeof(resolved_old));
-    const char *p_new = breezybox_resolve_path(newpath, resolved_new, sizeof(resolved_new));
-    return __real_rename(p_old ? p_old : oldpath, p_new ? p_new : newpath);
+    const char *p_old = breezybox_canonical_path(oldpath, resolved_old, sizeof(resolved_old));
+    const char *p_new = breezybox_canonical_path(newpath, resolved_new, sizeof(resolved_new));
+    int ret = __real_rename(p_old ? p_old : oldpath, p_new ? p_new : newpath);
+    if (ret == 0) {
+        breezy_statcache_clear();
+        if (p_old) breezy_cmdtab_invalidate(p_old);
+        if (p_new) breezy_cmdtab_invalidate(p_new);
+    }
+    return ret;
 }
 
 int __wrap_remove(const char *path)
 {
     char resolved[BREEZYBOX_MAX_PATH * 2 + 2];
-    const char *p = breezybox_resolve_path(path, resolved, sizeof(resolved));
-    return __real_remove(p ? p : path);
+    const char *p = breezybox_canonical_path(path, resolved, sizeof(resolved));
+    int ret = __real_remove(p ? p : path);
+    if (ret == 0) breezy_statcache_clear();
+    if (ret == 0 && p) breezy_cmdtab_invalidate(p);
+    return ret;
 }
 
 int __wrap_rmdir(const char *path)
 {
     char resolved[BREEZYBOX_MAX_PATH * 2 + 2];
-    const char *p = breezybox_resolve_path(path, resolved, sizeof(resolved));
-    return __real_rmdir(p ? p : path);
+    const char *p = breezybox_canonical_path(path, resolved, sizeof(resolved));
+    int ret = __real_rmdir(p ? p : path);
+    if (ret == 0) breezy_statcache_clear();
+    if (ret == 0 && p) breezy_cmdtab_invalidate(p);
+    return ret;
+}
+
+int __wrap_unlink(const char *path)
+{
+    char resolved[BREEZYBOX_MAX_PATH * 2 + 2];
+    const char *p = breezybox_canonical_path(path, resolved, sizeof(resolved));
+    int ret = __real_unlink(p ? p : path);
+    if (ret == 0) breezy_statcache_clear();
+    if (ret == 0 && p) breezy_cmdtab_invalidate(p);
+    return ret;
 }
 
 int __wrap_chdir(const char *path)
@@ -95,7 +166,7 @@ char* __wrap_getcwd(char *buf, size_t size)
 int __wrap_stat(const char *path, struct stat *st)
 {
     char resolved[BREEZYBOX_MAX_PATH * 2 + 2];
-    const char *p = breezybox_resolve_path(path, resolved, sizeof(resolved));
+    const char *p = breezybox_canonical_path(path, resolved, sizeof(resolved));
     if (!p) p = path;
 
     // Virtual directories
@@ -106,13 +177,17 @@ int __wrap_stat(const char *path, struct stat *st)
         return 0;
     }
 
-    return __real_stat(p, st);
+    uint32_t epoch;
+    if (breezy_statcache_get(p, st, &epoch)) return 0;
+    int ret = __real_stat(p, st);
+    if (ret == 0) breezy_statcache_put(p, st, epoch);
+    return ret;
 }
 
 DIR* __wrap_opendir(const char *name)
 {
     char resolved[BREEZYBOX_MAX_PATH * 2 + 2];
-    const char *p = breezybox_resolve_path(name, resolved, sizeof(resolved));
+    const char *p = breezybox_canonical_path(name, resolved, sizeof(resolved));
     if (!p) p = name;
 
     // Virtual root "/"
@@ -180,7 +255,7 @@ char* __wrap_realpath(const char *path, char *resolved_path)
 {
     char temp_buffer[BREEZYBOX_MAX_PATH * 2 + 2];
     
-    const char *p = breezybox_resolve_path(path, temp_buffer, sizeof(temp_buffer));
+    const char *p = breezybox_canonical_path(path, temp_buffer, sizeof(temp_buffer));
     if (!p) p = path;
 
     if (strcmp(p, "/") == 0 || strcmp(p, "/root") == 0) {
@@ -2,6 +2,9 @@
 #include "breezy_vfs.h"
 #include "breezy_cmd.h"
 #include "breezy_exec.h"
+#include "breezy_jobs.h"
+#include "breezy_init.h"
+#include "breezy_script.h"
 #include "esp_console.h"
 #include "esp_heap_caps.h"
 #include "linenoise/linenoise.h"
@@ -9,7 +12,7 @@
 #include "freertos/task.h"
 #include <stdio.h>
 #include <string.h>
-#include <ctype.h>
+#include <sys/stat.h>
 
 #define INIT_SCRIPT BREEZYBOX_MOUNT_POINT "/init.sh"
 #define DEFAULT_INIT "echo Welcome to BreezyBox!\n"
@@ -100,46 +103,26 @@ int cmd_sleep(int argc, char **argv)
     return 0;
 }
 
-// Run a script file with redirect support
+int cmd_true(int argc, char **argv)
+{
+    (void)argc; (void)argv;
+    return 0;
+}
+
+int cmd_false(int argc, char **argv)
+{
+    (void)argc; (void)argv;
+    return 1;
+}
+
+// Run a script file (compiled and cached, see breezy_script.h)
 int cmd_sh(int argc, char **argv)
 {
     if (argc < 2) {
-        printf("Usage: sh <script>\n");
-        return 1;
-    }
-    
-    char resolved[BREEZYBOX_MAX_PATH * 2 + 2];
-    const char *path = argv[1];
-    if (path[0] != '/') {
-        if (!breezybox_resolve_path(path, resolved, sizeof(resolved))) {
-            printf("sh: path too long\n");
-            return 1;
-        }
-        path = resolved;
-    }
-    
-    FILE *f = fopen(path, "r");
-    if (!f) {
-        printf("sh: %s: No such file\n", argv[1]);
+        printf("Usage: sh <script> [args...]\n");
         return 1;
     }
-    
-    char line[256];
-    int ret = 0;
-    while (fgets(line, sizeof(line), f)) {
-        size_t len = strlen(line);
-        while (len > 0 && (line[len-1] == '\n' || line[len-1] == '\r' || line[len-1] == ' ')) {
-            line[--len] = '\0';
-        }
-        
-        char *p = line;
-        while (*p && isspace((unsigned char)*p)) p++;
-        if (*p == '\0' || *p == '#') continue;
-        
-        ret = breezybox_exec(p);
-    }
-    fclose(f);
-    return ret;
+    return breezy_script_run(argc - 1, argv + 1);
 }
 
 // ============ Init Script ============
@@ -155,28 +138,13 @@ static void create_default_init(void)
 
 static void run_init_script(void)
 {
-    FILE *f = fopen(INIT_SCRIPT, "r");
-    if (!f) {
+    struct stat st;
+    if (stat(INIT_SCRIPT, &st) != 0) {
         create_default_init();
-        f = fopen(INIT_SCRIPT, "r");
-        if (!f) return;
     }
 
-    char line[256];
-    while (fgets(line, sizeof(line), f)) {
-        size_t len = strlen(line);
-        while (len > 0 && (line[len-1] == '\n' || line[len-1] == '\r' || line[len-1] == ' ')) {
-            line[--len] = '\0';
-        }
-        
-        char *p = line;
-        while (*p && isspace((unsigned char)*p)) p++;
-        if (*p == '\0' || *p == '#') continue;
-
-        // Execute with redirect support
-        breezybox_exec(p);
-    }
-    fclose(f);
+    // Stanzas marked @background keep running after this returns
+    breezy_init_run(INIT_SCRIPT);
 }
 
 // ============ Command Registration ============
@@ -194,25 +162,47 @@ esp_err_t breezybox_register_commands(void)
         { .command = "more",  .help = "Paginate file",           .hint = "<file>",    .func = &cmd_more  },
         { .command = "wc",    .help = "Count lines/words/chars", .hint = "[-lwc] <file>", .func = &cmd_wc },
         { .command = "mkdir", .help = "Create directory",        .hint = "<dir>",     .func = &cmd_mkdir },
-        { .command = "cp",    .help = "Copy file",               .hint = "<src> <dst>", .func = &cmd_cp  },
+        { .command = "cp",    .help = "Copy file/directory",     .hint = "[-r] <src> <dst>", .func = &cmd_cp },
         { .command = "mv",    .help = "Move/rename file",        .hint = "<src> <dst>", .func = &cmd_mv  },
         { .command = "rm",    .help = "Remove file/directory",   .hint = "[-r] <file...>", .func = &cmd_rm },
         { .command = "df",    .help = "Show disk free space",    .hint = NULL,        .func = &cmd_df    },
         { .command = "du",    .help = "Show disk usage",         .hint = "[-s] [path]", .func = &cmd_du  },
+        { .command = "find",  .help = "Find files in a tree",    .hint = "[path] [-name pat] [-type f|d] [-size [+-]N[ckM]] [-newer file] [-maxdepth N]", .func = &cmd_find },
+        { .command = "fsbench", .help = "Measure small-file rates", .hint = "[dir] [files] [bytes]", .func = &cmd_fsbench },
+        { .command = "sync",  .help = "Write cached data to flash", .hint = "[-s]",  .func = &cmd_sync  },
         { .command = "free",  .help = "Show memory usage",       .hint = NULL,        .func = &cmd_free  },
+        { .command = "dmesg", .help = "Show recent log lines",   .hint = "[-c]",      .func = &cmd_dmesg },
         { .command = "date",  .help = "Show/set date and time",  .hint = "[\"YYYY-MM-DD HH:MM:SS\"]", .func = &cmd_date },
         { .command = "clear", .help = "Clear screen",            .hint = NULL,        .func = &cmd_clear },
         { .command = "sleep", .help = "Sleep for N seconds",     .hint = "<seconds>", .func = &cmd_sleep },
-        { .command = "sh",    .help = "Run script file",         .hint = "<script>",  .func = &cmd_sh    },
-        { .command = "eget",  .help = "Download ELF from GitHub", .hint = "<user/repo>", .func = &cmd_eget },
+        { .command = "sh",    .help = "Run script file",         .hint = "<script> [args...]", .func = &cmd_sh },
+        { .command = "xargs", .help = "Run a command for words from stdin", .hint = "[-P N] [-n N] [-a file] <cmd> [args...]", .func = &cmd_xargs },
+        { .command = "parallel", .help = "Run a command per word, on every core", .hint = "[-P N] [-a file] <cmd> [args...]", .func = &cmd_xargs },
+        { .command = "test",  .help = "Evaluate a condition",    .hint = "<expr>",    .func = &cmd_test  },
+        { .command = "[",     .help = "Evaluate a condition",    .hint = "<expr> ]",  .func = &cmd_test  },
+        { .command = "true",  .help = "Return success",          .hint = NULL,        .func = &cmd_true  },
+        { .command = "false", .help = "Return failure",          .hint = NULL,        .func = &cmd_false },
+        { .command = "eget",  .help = "Download ELF from GitHub", .hint = "[-a] [-z] <user/repo>", .func = &cmd_eget },
+        { .command = "hash",  .help = "Show/manage ELF image cache", .hint = "[-r] [-p|-u|-s <cmd>]", .func = &cmd_hash },
+        { .command = "appfs", .help = "Manage flash app store", .hint = "[ls | rm <name> | add <file> [name]]", .func = &cmd_appfs },
+        { .command = "elfbench", .help = "Measure ELF load time", .hint = "<cmd> [runs]", .func = &cmd_elfbench },
+        { .command = "time",  .help = "Time a command",          .hint = "[-o file] <cmd> [args]", .func = &cmd_time },
+        { .command = "jobs",  .help = "List background jobs",    .hint = NULL,        .func = &cmd_jobs  },
+        { .command = "fg",    .help = "Wait for a background job", .hint = "[job]",   .func = &cmd_fg    },
+        { .command = "kill",  .help = "Stop a background job",   .hint = "<job...>",  .func = &cmd_kill  },
+        { .command = "boottime", .help = "Show init.sh stanza timings", .hint = NULL,  .func = &cmd_boottime },
+        { .command = "svc",   .help = "Manage services",         .hint = "[status|start|stop|restart|run] [name] [args]", .func = &cmd_svc },
         { .command = "wifi",  .help = "WiFi commands",           .hint = "<scan|connect|disconnect|status|forget>", .func = &cmd_wifi },
-        { .command = "httpd", .help = "HTTP file server",        .hint = "[dir] [-p port]", .func = &cmd_httpd },
+        { .command = "httpd", .help = "HTTP file server",        .hint = "[dir] [-p port] | stop", .func = &cmd_httpd },
     };
 
     for (size_t i = 0; i < sizeof(cmds) / sizeof(cmds[0]); i++) {
         esp_err_t err = esp_console_cmd_register(&cmds[i]);
         if (err != ESP_OK) return err;
     }
+
+    // Already there if commands are registered again
+    breezy_svc_register(&httpd_service);
     return ESP_OK;
 }
 
@@ -272,6 +262,9 @@ static void stdio_repl_task(void *arg)
     printf("\nType 'help' to get the list of commands.\n");
     
     while (true) {
+        // Announce background jobs that finished since the last prompt
+        breezy_jobs_report();
+
         char *line = linenoise("$ ");
         
         if (line == NULL) {
@@ -0,0 +1,116 @@
+/*
+ * appfs.c - Manage the flash app store
+ *
+ * Usage: appfs [ls]
+ *        appfs rm <name>
+ *        appfs add <file> [name]
+ *
+ * Programs in the store run as /apps/<name> and are found by bare name
+ * after /root/bin. add copies an ELF from the filesystem into the store;
+ * the name defaults to the file's base name.
+ */
+
+#include "breezy_cmd.h"
+#include "breezy_appfs.h"
+#include "esp_heap_caps.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define APPFS_MAX_LIST  100
+#define APPFS_CHUNK     4096
+
+static int appfs_ls(void)
+{
+    breezy_appfs_info_t *list = malloc(APPFS_MAX_LIST * sizeof(breezy_appfs_info_t));
+    if (!list) {
+        printf("appfs: out of memory\n");
+        return 1;
+    }
+
+    size_t n = breezy_appfs_list(list, APPFS_MAX_LIST);
+    for (size_t i = 0; i < n; i++) {
+        printf("%7u  %s\n", (unsigned)list[i].size, list[i].name);
+    }
+
+    size_t used, total;
+    breezy_appfs_usage(&used, &total);
+    printf("%u program(s), %uK of %uK used\n", (unsigned)n,
+           (unsigned)(used / 1024), (unsigned)(total / 1024));
+
+    free(list);
+    return 0;
+}
+
+static int appfs_add(const char *file, const char *name)
+{
+    if (!name) {
+        const char *slash = strrchr(file, '/');
+        name = slash ? slash + 1 : file;
+    }
+
+    FILE *f = fopen(file, "rb");
+    if (!f) {
+        printf("appfs: %s: No such file\n", file);
+        return 1;
+    }
+
+    uint8_t *buf = heap_caps_malloc(APPFS_CHUNK, MALLOC_CAP_SPIRAM);
+    breezy_appfs_writer_t *w = buf ? breezy_appfs_begin(name) : NULL;
+    if (!w) {
+        printf("appfs: cannot install %s\n", name);
+        free(buf);
+        fclose(f);
+        return 1;
+    }
+
+    size_t n, total = 0;
+    int ret = 0;
+    while ((n = fread(buf, 1, APPFS_CHUNK, f)) > 0) {
+        if (breezy_appfs_write(w, buf, n) != 0) {
+            ret = -1;
+            break;
+        }
+        total += n;
+    }
+    free(buf);
+    fclose(f);
+
+    if (ret != 0) {
+        breezy_appfs_abort(w);
+        printf("appfs: %s: write failed\n", name);
+        return 1;
+    }
+    if (breezy_appfs_commit(w) != 0) {
+        printf("appfs: %s: install failed\n", name);
+        return 1;
+    }
+
+    printf("Installed %s%s (%u bytes)\n", BREEZY_APPFS_PREFIX, name, (unsigned)total);
+    return 0;
+}
+
+int cmd_appfs(int argc, char **argv)
+{
+    if (!breezy_appfs_available()) {
+        printf("appfs: no app store partition\n");
+        return 1;
+    }
+
+    if (argc < 2 || strcmp(argv[1], "ls") == 0) {
+        return appfs_ls();
+    }
+    if (strcmp(argv[1], "rm") == 0 && argc >= 3) {
+        if (breezy_appfs_remove(argv[2]) != 0) {
+            printf("appfs: %s: not installed\n", argv[2]);
+            return 1;
+        }
+        return 0;
+    }
+    if (strcmp(argv[1], "add") == 0 && argc >= 3) {
+        return appfs_add(argv[2], argc >= 4 ? argv[3] : NULL);
+    }
+
+    printf("Usage: appfs [ls | rm <name> | add <file> [name]]\n");
+    return 1;
+}
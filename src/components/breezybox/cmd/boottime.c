@@ -0,0 +1,49 @@
+/*
+ * boottime.c - Show how long each init.sh stanza took
+ *
+ * Usage: boottime
+ *
+ * One line per stanza (see breezy_init.h), in file order: when it started
+ * and how long it ran, counted from the start of init, then when the
+ * prompt appeared. Stanzas still running show their time so far.
+ */
+
+#include "breezy_cmd.h"
+#include "breezy_init.h"
+#include <stdio.h>
+
+int cmd_boottime(int argc, char **argv)
+{
+    (void)argc; (void)argv;
+
+    breezy_init_info_t list[BREEZY_INIT_MAX_STANZAS + 1];
+    uint32_t prompt_ms;
+    size_t n = breezy_init_list(list, BREEZY_INIT_MAX_STANZAS + 1, &prompt_ms);
+    if (n == 0) {
+        printf("boottime: init has not run\n");
+        return 1;
+    }
+
+    printf("%-15s %8s %8s  %-7s %-4s %s\n", "STANZA", "START", "TIME", "STATUS", "MODE", "AFTER");
+    for (size_t i = 0; i < n; i++) {
+        const breezy_init_info_t *s = &list[i];
+        char status[16];
+        if (s->state == BREEZY_INIT_WAITING) {
+            snprintf(status, sizeof(status), "waiting");
+        } else if (s->state == BREEZY_INIT_RUNNING) {
+            snprintf(status, sizeof(status), "running");
+        } else {
+            snprintf(status, sizeof(status), "%d", s->ret);
+        }
+
+        const char *mode = s->background ? "bg" : "fg";
+        if (s->state == BREEZY_INIT_WAITING) {
+            printf("%-15s %8s %8s  %-7s %-4s %s\n", s->name, "-", "-", status, mode, s->after);
+        } else {
+            printf("%-15s %6ums %6ums  %-7s %-4s %s\n", s->name,
+                   (unsigned)s->start_ms, (unsigned)s->run_ms, status, mode, s->after);
+        }
+    }
+    printf("prompt after %u ms\n", (unsigned)prompt_ms);
+    return 0;
+}
@@ -2,37 +2,42 @@
 #include "breezy_vfs.h"
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
 int cmd_cat(int argc, char **argv)
 {
-    if (argc < 2) {
+    // No file: copy stdin when it is a pipe or redirect
+    if (argc < 2 && isatty(fileno(stdin))) {
         printf("Usage: cat <file>\n");
         return 1;
     }
 
-    char resolved[BREEZYBOX_MAX_PATH * 2 + 2];
-    const char *path = argv[1];
+    FILE *f = stdin;
+    if (argc >= 2) {
+        char resolved[BREEZYBOX_MAX_PATH * 2 + 2];
+        const char *path = argv[1];
 
-    if (path[0] != '/') {
-        if (!breezybox_resolve_path(path, resolved, sizeof(resolved))) {
-            printf("cat: path too long\n");
-            return 1;
+        if (path[0] != '/') {
+            if (!breezybox_resolve_path(path, resolved, sizeof(resolved))) {
+                printf("cat: path too long\n");
+                return 1;
+            }
+            path = resolved;
         }
-        path = resolved;
-    }
 
-    FILE *f = fopen(path, "r");
-    if (!f) {
-        printf("cat: %s: No such file\n", argv[1]);
-        return 1;
+        f = fopen(path, "r");
+        if (!f) {
+            printf("cat: %s: No such file\n", argv[1]);
+            return 1;
+        }
     }
 
-    char buf[128];
+    char buf[512];
     size_t n;
     while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
         fwrite(buf, 1, n, stdout);
     }
-    fclose(f);
+    if (f != stdin) fclose(f);
     fflush(stdout);
 
     return 0;
@@ -1,82 +1,168 @@
 /*
  * cp.c - Copy files
- * 
- * Usage: cp <source> <dest>
+ *
+ * Usage: cp [-r] <source> <dest>
+ *   -r  Copy a directory and everything in it
  */
 
+#include <errno.h>
+#include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include "breezy_vfs.h"
+#include "breezy_walk.h"
 
-#define COPY_BUF_SIZE 512
+#define COPY_BUF_SIZE 4096
+
+// Copy one file through buf; names are for messages
+static int copy_file(const char *src_path, const char *dst_path,
+                     const char *src_name, const char *dst_name, char *buf)
+{
+    // Open source for reading
+    FILE *src = fopen(src_path, "rb");
+    if (!src) {
+        printf("cp: cannot open '%s'\n", src_name);
+        return 1;
+    }
+
+    // Open dest for writing
+    FILE *dst = fopen(dst_path, "wb");
+    if (!dst) {
+        printf("cp: cannot create '%s'\n", dst_name);
+        fclose(src);
+        return 1;
+    }
+
+    // Copy contents, a flash sector at a time
+    size_t bytes_read;
+    int ret = 0;
+
+    while ((bytes_read = fread(buf, 1, COPY_BUF_SIZE, src)) > 0) {
+        size_t written = fwrite(buf, 1, bytes_read, dst);
+        if (written != bytes_read) {
+            printf("cp: write error\n");
+            ret = 1;
+            break;
+        }
+    }
+
+    fclose(src);
+    fclose(dst);
+
+    return ret;
+}
+
+typedef struct {
+    const char *dst_root;
+    char *dst;              // BREEZY_WALK_PATH_MAX
+    char *buf;
+    int errors;
+} cp_ctx_t;
+
+// Each entry goes to the same place under dst_root; directories are made
+// before their contents
+static breezy_walk_ret_t cp_entry(const breezy_walk_entry_t *e, void *ctx)
+{
+    cp_ctx_t *cp = ctx;
+    const char *rel = e->path + e->root_len;
+    int n = snprintf(cp->dst, BREEZY_WALK_PATH_MAX, "%s%s%s", cp->dst_root,
+                     (rel[0] && rel[0] != '/') ? "/" : "", rel);
+    if (n < 0 || n >= BREEZY_WALK_PATH_MAX) {
+        printf("cp: path too long: '%s'\n", e->path);
+        cp->errors++;
+        return BREEZY_WALK_SKIP;
+    }
+
+    if (!e->is_dir) {
+        if (copy_file(e->path, cp->dst, e->path, cp->dst, cp->buf) != 0) cp->errors++;
+        return BREEZY_WALK_CONTINUE;
+    }
+
+    struct stat st;
+    if (mkdir(cp->dst, 0755) != 0 && !(errno == EEXIST && stat(cp->dst, &st) == 0 && S_ISDIR(st.st_mode))) {
+        printf("cp: cannot create directory '%s'\n", cp->dst);
+        cp->errors++;
+        return BREEZY_WALK_SKIP;
+    }
+    return BREEZY_WALK_CONTINUE;
+}
 
 int cmd_cp(int argc, char **argv)
 {
+    bool recursive = argc >= 2 && strcmp(argv[1], "-r") == 0;
+    if (recursive) {
+        argc--;
+        argv++;
+    }
     if (argc < 3) {
-        printf("Usage: cp <source> <dest>\n");
+        printf("Usage: cp [-r] <source> <dest>\n");
         return 1;
     }
-    
+
     char src_path[256], dst_path[256];
     breezybox_resolve_path(argv[1], src_path, sizeof(src_path));
     breezybox_resolve_path(argv[2], dst_path, sizeof(dst_path));
-    
-    // Check if source exists and is a file
+
+    // Check if source exists, and is a file unless -r
     struct stat st;
     if (stat(src_path, &st) != 0) {
         printf("cp: cannot stat '%s': No such file\n", argv[1]);
         return 1;
     }
-    if (S_ISDIR(st.st_mode)) {
-        printf("cp: '%s' is a directory (not supported)\n", argv[1]);
+    bool src_dir = S_ISDIR(st.st_mode);
+    if (src_dir && !recursive) {
+        printf("cp: '%s' is a directory (use -r)\n", argv[1]);
         return 1;
     }
-    
+
     // Check if dest is a directory - if so, append source filename
     if (stat(dst_path, &st) == 0 && S_ISDIR(st.st_mode)) {
         // Extract filename from source
-        const char *filename = strrchr(argv[1], '/');
-        filename = filename ? filename + 1 : argv[1];
-        
+        const char *filename = strrchr(src_path, '/');
+        filename = filename ? filename + 1 : src_path;
+
         size_t len = strlen(dst_path);
-        if (len > 0 && dst_path[len-1] != '/') {
-            strncat(dst_path, "/", sizeof(dst_path) - len - 1);
+        size_t room = sizeof(dst_path) - len;
+        int n = snprintf(dst_path + len, room, "%s%s",
+                         (len > 0 && dst_path[len-1] != '/') ? "/" : "", filename);
+        if (n < 0 || (size_t)n >= room) {
+            printf("cp: path too long\n");
+            return 1;
         }
-        strncat(dst_path, filename, sizeof(dst_path) - strlen(dst_path) - 1);
     }
-    
-    // Open source for reading
-    FILE *src = fopen(src_path, "rb");
-    if (!src) {
-        printf("cp: cannot open '%s'\n", argv[1]);
+
+    char *buf = malloc(COPY_BUF_SIZE);
+    if (!buf) {
+        printf("cp: out of memory\n");
         return 1;
     }
-    
-    // Open dest for writing
-    FILE *dst = fopen(dst_path, "wb");
-    if (!dst) {
-        printf("cp: cannot create '%s'\n", argv[2]);
-        fclose(src);
+
+    int ret;
+    if (!src_dir) {
+        ret = copy_file(src_path, dst_path, argv[1], argv[2], buf);
+        free(buf);
+        return ret;
+    }
+
+    // A copy inside the source would be walked into as it grows
+    size_t src_len = strlen(src_path);
+    if (strncmp(dst_path, src_path, src_len) == 0 &&
+        (dst_path[src_len] == '/' || dst_path[src_len] == '\0' || src_path[src_len - 1] == '/')) {
+        printf("cp: cannot copy '%s' into itself\n", argv[1]);
+        free(buf);
         return 1;
     }
-    
-    // Copy contents
-    char buf[COPY_BUF_SIZE];
-    size_t bytes_read;
-    
-    while ((bytes_read = fread(buf, 1, sizeof(buf), src)) > 0) {
-        size_t written = fwrite(buf, 1, bytes_read, dst);
-        if (written != bytes_read) {
-            printf("cp: write error\n");
-            fclose(src);
-            fclose(dst);
-            return 1;
-        }
+
+    cp_ctx_t cp = { .dst_root = dst_path, .buf = buf };
+    cp.dst = malloc(BREEZY_WALK_PATH_MAX);
+    if (!cp.dst || breezy_walk(src_path, cp_entry, NULL, 0, &cp) < 0) {
+        printf("cp: cannot copy '%s'\n", argv[1]);
+        cp.errors++;
     }
-    
-    fclose(src);
-    fclose(dst);
-    
-    return 0;
-}
\ No newline at end of file
+
+    free(cp.dst);
+    free(buf);
+    return cp.errors > 0 ? 1 : 0;
+}
@@ -7,6 +7,7 @@
 #include <stdio.h>
 #include "esp_littlefs.h"
 #include "breezy_vfs.h"
+#include "breezy_tmpfs.h"
 
 int cmd_df(int argc, char **argv)
 {
@@ -30,6 +31,16 @@ int cmd_df(int argc, char **argv)
     printf("Filesystem      Size    Used   Avail  Use%%\n");
     printf("%-12s  %5luK  %5luK  %5luK  %3d%%\n",
            BREEZYBOX_MOUNT_POINT, total_kb, used_kb, free_kb, percent);
+
+#ifdef CONFIG_BREEZYBOX_TMPFS
+    breezy_tmpfs_info(&total_bytes, &used_bytes);
+    total_kb = total_bytes / 1024;
+    used_kb = (used_bytes + 1023) / 1024;
+    free_kb = total_kb > used_kb ? total_kb - used_kb : 0;
+    percent = (total_kb > 0) ? ((int)(used_kb * 100 / total_kb)) : 0;
+    printf("%-12s  %5luK  %5luK  %5luK  %3d%%\n",
+           BREEZYBOX_TMP_DIR, total_kb, used_kb, free_kb, percent);
+#endif
     
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,43 @@
+/*
+ * dmesg.c - Show recent log lines
+ *
+ * Usage: dmesg [-c]
+ *   -c  Clear the buffer after printing it
+ *
+ * Prints the log ring buffer (see breezy_log.h), oldest line first. It
+ * holds the lines of every task, including those kept off the console
+ * while a command's output was redirected.
+ */
+
+#include "breezy_cmd.h"
+#include "breezy_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int cmd_dmesg(int argc, char **argv)
+{
+    bool clear = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-c") == 0) {
+            clear = true;
+        } else {
+            printf("Usage: dmesg [-c]\n");
+            return 1;
+        }
+    }
+
+    size_t size = breezy_log_size();
+    char *buf = size ? malloc(size) : NULL;
+    if (size && !buf) {
+        printf("dmesg: out of memory\n");
+        return 1;
+    }
+
+    size_t n = buf ? breezy_log_read(buf, size) : 0;
+    if (clear) breezy_log_clear();
+    fwrite(buf, 1, n, stdout);
+
+    free(buf);
+    return 0;
+}
@@ -5,61 +5,47 @@
  *   -s  Summary only (don't show subdirectories)
  */
 
+#include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
-#include <dirent.h>
-#include <sys/stat.h>
 #include "breezy_vfs.h"
+#include "breezy_walk.h"
 
-static int s_summary_only = 0;
+typedef struct {
+    bool summary;
+    unsigned long total;
+} du_ctx_t;
 
-// Calculate size of a directory recursively
-static unsigned long get_dir_size(const char *path, int depth)
+static breezy_walk_ret_t du_pre(const breezy_walk_entry_t *e, void *ctx)
 {
-    DIR *dir = opendir(path);
-    if (!dir) return 0;
-    
-    struct dirent *entry;
-    struct stat st;
-    char child_path[512];
-    unsigned long total = 0;
-    
-    while ((entry = readdir(dir)) != NULL) {
-        // Skip . and ..
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-            continue;
-        }
-        
-        snprintf(child_path, sizeof(child_path), "%.240s/%.240s", path, entry->d_name);
-        
-        if (stat(child_path, &st) == 0) {
-            if (S_ISDIR(st.st_mode)) {
-                unsigned long subdir_size = get_dir_size(child_path, depth + 1);
-                total += subdir_size;
-                
-                // Print subdirectory if not summary mode
-                if (!s_summary_only) {
-                    printf("%7lu  %s\n", (subdir_size + 1023) / 1024, child_path);
-                }
-            } else {
-                total += st.st_size;
-            }
-        }
+    du_ctx_t *du = ctx;
+    if (e->is_dir) {
+        *e->dir_data = du->total;   // Subtotal starts here
+    } else {
+        du->total += e->st->st_size;
     }
-    
-    closedir(dir);
-    return total;
+    return BREEZY_WALK_CONTINUE;
+}
+
+// Subdirectories as they are finished; the root's total comes last
+static breezy_walk_ret_t du_post(const breezy_walk_entry_t *e, void *ctx)
+{
+    du_ctx_t *du = ctx;
+    if (!du->summary && e->depth > 0) {
+        printf("%7lu  %s\n", (du->total - (unsigned long)*e->dir_data + 1023) / 1024, e->path);
+    }
+    return BREEZY_WALK_CONTINUE;
 }
 
 int cmd_du(int argc, char **argv)
 {
-    s_summary_only = 0;
+    du_ctx_t du = { 0 };
     const char *target = ".";
     
     // Parse arguments
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-s") == 0) {
-            s_summary_only = 1;
+            du.summary = true;
         } else if (argv[i][0] != '-') {
             target = argv[i];
         }
@@ -68,22 +54,13 @@ int cmd_du(int argc, char **argv)
     char path[256];
     breezybox_resolve_path(target, path, sizeof(path));
     
-    struct stat st;
-    if (stat(path, &st) != 0) {
+    if (breezy_walk(path, du_pre, du_post, BREEZY_WALK_STAT_FILES, &du) < 0) {
         printf("du: cannot access '%s'\n", target);
         return 1;
     }
     
-    unsigned long size;
-    
-    if (S_ISDIR(st.st_mode)) {
-        size = get_dir_size(path, 0);
-    } else {
-        size = st.st_size;
-    }
-    
     // Print total (always shown)
-    printf("%7lu  %s\n", (size + 1023) / 1024, path);
+    printf("%7lu  %s\n", (du.total + 1023) / 1024, path);
     
     return 0;
-}
\ No newline at end of file
+}
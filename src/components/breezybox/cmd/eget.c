@@ -1,10 +1,16 @@
 /*
  * eget.c - Download ELF binaries from GitHub releases
  * 
- * Usage: eget <user/repo>
+ * Usage: eget [-a] [-z] <user/repo>
  * 
  * Downloads all .elf files from the latest release to /root/bin/
  * The .elf extension is removed from the installed binary name.
+ * With -a, installs into the flash app store instead (see appfs).
+ *
+ * Assets may also be gzipped (<name>.<arch>.elf.gz). Those are kept
+ * compressed in /root/bin, where the loader inflates them (breezy_gz.h),
+ * and inflated on the fly for the app store, which maps programs in
+ * place. With -z, plain assets are compressed on the way into /root/bin.
  */
 
 #include <stdio.h>
@@ -17,6 +23,8 @@
 #include "esp_heap_caps.h"
 #include "cJSON.h"
 #include "breezy_vfs.h"
+#include "breezy_appfs.h"
+#include "breezy_gz.h"
 
 #define MAX_RESPONSE_SIZE   (64 * 1024)  // 64KB for API response
 #define MAX_URL_LEN         512
@@ -31,6 +39,8 @@
   #error "eget: unknown breezy target arch"
 #endif
 #define ARCH_SUFFIX "." BREEZY_ARCH ".elf"
+#define GZ_SUFFIX   ".gz"
+#define ZBUF_SIZE   4096
 
 // Buffer for HTTP response
 static char *s_response_buf = NULL;
@@ -103,23 +113,110 @@ static char *fetch_json(const char *url, int *out_len)
     return result;
 }
 
+typedef enum {
+    Z_NONE,
+    Z_INFLATE,                  // .gz asset into the app store
+    Z_DEFLATE,                  // Plain asset into /root/bin with -z
+} zmode_t;
+
 // Context struct to pass to the event handler
 typedef struct {
-    FILE *file;
+    FILE *file;                 // Destination: a file...
+    breezy_appfs_writer_t *app; // ...or an app store install
     size_t total_written;
+    bool failed;
+    zmode_t zmode;
+    z_stream zs;
+    uint8_t *zbuf;
+    int zret;
 } download_ctx_t;
 
+static void sink(download_ctx_t *ctx, const void *data, size_t len)
+{
+    if (ctx->app) {
+        if (breezy_appfs_write(ctx->app, data, len) == 0) {
+            ctx->total_written += len;
+        } else {
+            ctx->failed = true;
+        }
+    } else if (ctx->file) {
+        size_t written = fwrite(data, 1, len, ctx->file);
+        ctx->total_written += written;
+        if (written != len) ctx->failed = true;
+    }
+}
+
+// Run data through zlib and sink what comes out
+static void sink_z(download_ctx_t *ctx, const void *data, size_t len, int flush)
+{
+    ctx->zs.next_in = (Bytef *)data;
+    ctx->zs.avail_in = len;
+    do {
+        ctx->zs.next_out = ctx->zbuf;
+        ctx->zs.avail_out = ZBUF_SIZE;
+        if (ctx->zmode == Z_INFLATE) {
+            ctx->zret = inflate(&ctx->zs, Z_NO_FLUSH);
+        } else {
+            ctx->zret = deflate(&ctx->zs, flush);
+        }
+        if (ctx->zret != Z_OK && ctx->zret != Z_STREAM_END && ctx->zret != Z_BUF_ERROR) {
+            ctx->failed = true;
+            return;
+        }
+        sink(ctx, ctx->zbuf, ZBUF_SIZE - ctx->zs.avail_out);
+    } while (!ctx->failed && ctx->zret != Z_STREAM_END &&
+             (ctx->zs.avail_in > 0 || ctx->zs.avail_out == 0 ||
+              (flush == Z_FINISH && ctx->zret == Z_OK)));
+}
+
+static int zbegin(download_ctx_t *ctx, zmode_t mode)
+{
+    ctx->zmode = mode;
+    if (mode == Z_NONE) return 0;
+
+    ctx->zbuf = malloc(ZBUF_SIZE);
+    breezy_gz_stream_init(&ctx->zs);
+    int zret = mode == Z_INFLATE
+        ? inflateInit2(&ctx->zs, BREEZY_GZ_WINDOW_BITS)
+        : deflateInit2(&ctx->zs, Z_BEST_COMPRESSION, Z_DEFLATED,
+                       BREEZY_GZ_WINDOW_BITS, 8, Z_DEFAULT_STRATEGY);
+    if (!ctx->zbuf || zret != Z_OK) {
+        printf("eget: out of memory\n");
+        free(ctx->zbuf);
+        ctx->zmode = Z_NONE;
+        return -1;
+    }
+    return 0;
+}
+
+// Flush zlib and release it. Returns 0 if the stream was complete.
+static int zend(download_ctx_t *ctx)
+{
+    int ret = 0;
+    if (ctx->zmode == Z_DEFLATE) {
+        if (!ctx->failed) sink_z(ctx, NULL, 0, Z_FINISH);
+        deflateEnd(&ctx->zs);
+    } else if (ctx->zmode == Z_INFLATE) {
+        if (ctx->zret != Z_STREAM_END) ret = -1;
+        inflateEnd(&ctx->zs);
+    }
+    free(ctx->zbuf);
+    if (ctx->failed) ret = -1;
+    if (ret != 0 && ctx->zmode != Z_NONE) printf("eget: compression error\n");
+    return ret;
+}
+
 static esp_err_t download_event_handler(esp_http_client_event_t *evt)
 {
     download_ctx_t *ctx = (download_ctx_t *)evt->user_data;
 
     switch (evt->event_id) {
     case HTTP_EVENT_ON_DATA:
-        if (ctx->file && evt->data_len > 0) {
-            size_t written = fwrite(evt->data, 1, evt->data_len, ctx->file);
-            ctx->total_written += written;
-            // Optional: Print progress dots
-            // if (ctx->total_written % 10240 == 0) printf("."); 
+        if (evt->data_len <= 0 || ctx->failed) break;
+        if (ctx->zmode != Z_NONE) {
+            sink_z(ctx, evt->data, evt->data_len, Z_NO_FLUSH);
+        } else {
+            sink(ctx, evt->data, evt->data_len);
         }
         break;
     default:
@@ -128,22 +225,13 @@ static esp_err_t download_event_handler(esp_http_client_event_t *evt)
     return ESP_OK;
 }
 
-static int download_file(const char *url, const char *dest_path)
+// Fetch url into ctx's destination. Returns 0 on a complete download.
+static int download(const char *url, download_ctx_t *ctx)
 {
-    printf("  Downloading to %s...\n", dest_path);
-
-    FILE *f = fopen(dest_path, "wb");
-    if (!f) {
-        printf("eget: cannot create file\n");
-        return -1;
-    }
-
-    download_ctx_t ctx = { .file = f, .total_written = 0 };
-
     esp_http_client_config_t config = {
         .url = url,
         .event_handler = download_event_handler,
-        .user_data = &ctx,
+        .user_data = ctx,
         .crt_bundle_attach = esp_crt_bundle_attach,
         .timeout_ms = 60000,
         .max_redirection_count = 5,
@@ -154,7 +242,6 @@ static int download_file(const char *url, const char *dest_path)
 
     esp_http_client_handle_t client = esp_http_client_init(&config);
     if (!client) {
-        fclose(f);
         return -1;
     }
 
@@ -166,26 +253,106 @@ static int download_file(const char *url, const char *dest_path)
     int status = esp_http_client_get_status_code(client);
     
     esp_http_client_cleanup(client);
-    fclose(f);
 
-    if (err != ESP_OK || status != 200) {
+    if (err != ESP_OK || status != 200 || ctx->failed) {
         printf("\neget: download failed (err=%d, status=%d)\n", err, status);
+        return -1;
+    }
+    return 0;
+}
+
+static int download_file(const char *url, const char *dest_path, zmode_t zmode)
+{
+    printf("  Downloading to %s...\n", dest_path);
+
+    FILE *f = fopen(dest_path, "wb");
+    if (!f) {
+        printf("eget: cannot create file\n");
+        return -1;
+    }
+
+    download_ctx_t ctx = { .file = f };
+    int ret = zbegin(&ctx, zmode);
+    if (ret == 0) {
+        ret = download(url, &ctx);
+        if (zend(&ctx) != 0) ret = -1;
+    }
+    fclose(f);
+
+    if (ret != 0) {
         unlink(dest_path); // Delete partial file
         return -1;
     }
 
+    printf("  Success (%u bytes%s)\n", (unsigned)ctx.total_written,
+           zmode == Z_DEFLATE ? " compressed" : "");
+    return 0;
+}
+
+// Stream straight into the flash app store, no LittleFS copy
+static int download_app(const char *url, const char *name, zmode_t zmode)
+{
+    printf("  Installing to %s%s...\n", BREEZY_APPFS_PREFIX, name);
+
+    breezy_appfs_writer_t *w = breezy_appfs_begin(name);
+    if (!w) {
+        printf("eget: cannot install %s\n", name);
+        return -1;
+    }
+
+    download_ctx_t ctx = { .app = w };
+    int ret = zbegin(&ctx, zmode);
+    if (ret == 0) {
+        ret = download(url, &ctx);
+        if (zend(&ctx) != 0) ret = -1;
+    }
+    if (ret != 0) {
+        breezy_appfs_abort(w);
+        return -1;
+    }
+    if (breezy_appfs_commit(w) != 0) {
+        printf("eget: %s: install failed\n", name);
+        return -1;
+    }
+
     printf("  Success (%u bytes)\n", (unsigned)ctx.total_written);
     return 0;
 }
 
-// Copy name with the arch suffix removed
-static void strip_arch_suffix(const char *name, char *out, size_t out_size)
+static bool ends_with(const char *s, const char *sfx)
+{
+    size_t len = strlen(s);
+    size_t sfx_len = strlen(sfx);
+    return len > sfx_len && strcasecmp(s + len - sfx_len, sfx) == 0;
+}
+
+// Is this platform's binary: <name>.<arch>.elf or <name>.<arch>.elf.gz?
+static bool is_arch_asset(const char *name, bool *gz)
+{
+    *gz = ends_with(name, ARCH_SUFFIX GZ_SUFFIX);
+    return *gz || ends_with(name, ARCH_SUFFIX);
+}
+
+static bool has_asset(cJSON *assets, const char *want)
+{
+    cJSON *asset;
+    cJSON_ArrayForEach(asset, assets) {
+        cJSON *name = cJSON_GetObjectItem(asset, "name");
+        if (name && cJSON_IsString(name) && strcasecmp(name->valuestring, want) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Copy name with the arch suffix (and .gz) removed
+static void strip_arch_suffix(const char *name, bool gz, char *out, size_t out_size)
 {
     strncpy(out, name, out_size - 1);
     out[out_size - 1] = '\0';
 
     size_t len = strlen(out);
-    size_t sfx = strlen(ARCH_SUFFIX);
+    size_t sfx = strlen(ARCH_SUFFIX) + (gz ? strlen(GZ_SUFFIX) : 0);
     if (len > sfx) {
         out[len - sfx] = '\0';
     }
@@ -193,9 +360,30 @@ static void strip_arch_suffix(const char *name, char *out, size_t out_size)
 
 int cmd_eget(int argc, char **argv)
 {
+    bool to_app = false;
+    bool compress = false;
+    while (argc >= 2 && argv[1][0] == '-') {
+        if (strcmp(argv[1], "-a") == 0) {
+            to_app = true;
+        } else if (strcmp(argv[1], "-z") == 0) {
+            compress = true;
+        } else {
+            break;
+        }
+        argc--;
+        argv++;
+    }
+
     if (argc < 2) {
-        printf("Usage: eget <user/repo>\n");
+        printf("Usage: eget [-a] [-z] <user/repo>\n");
         printf("  Downloads .elf files from latest GitHub release to %s/\n", BIN_DIR);
+        printf("  -a  Install into the flash app store instead\n");
+        printf("  -z  Store programs gzipped (about half the flash)\n");
+        return 1;
+    }
+    
+    if (to_app && !breezy_appfs_available()) {
+        printf("eget: no app store partition\n");
         return 1;
     }
     
@@ -269,12 +457,22 @@ int cmd_eget(int argc, char **argv)
         }
         
         const char *asset_name = name->valuestring;
-        size_t name_len = strlen(asset_name);
-        size_t sfx_len = strlen(ARCH_SUFFIX);
+        bool gz;
 
-        // Only this platform's binaries: <name>.<arch>.elf
-        if (name_len <= sfx_len ||
-            strcasecmp(asset_name + name_len - sfx_len, ARCH_SUFFIX) != 0) {
+        // Only this platform's binaries: <name>.<arch>.elf[.gz]
+        if (!is_arch_asset(asset_name, &gz)) {
+            continue;
+        }
+
+        // Offered both ways: gzipped for LittleFS, plain for the app store
+        char other[128];
+        if (gz) {
+            snprintf(other, sizeof(other), "%.*s",
+                     (int)(strlen(asset_name) - strlen(GZ_SUFFIX)), asset_name);
+        } else {
+            snprintf(other, sizeof(other), "%s" GZ_SUFFIX, asset_name);
+        }
+        if (gz == to_app && has_asset(assets, other)) {
             continue;
         }
 
@@ -282,13 +480,22 @@ int cmd_eget(int argc, char **argv)
 
         // Build destination path
         char bin_name[64];
-        strip_arch_suffix(asset_name, bin_name, sizeof(bin_name));
+        strip_arch_suffix(asset_name, gz, bin_name, sizeof(bin_name));
+        
+        if (to_app) {
+            if (download_app(download_url->valuestring, bin_name,
+                             gz ? Z_INFLATE : Z_NONE) == 0) {
+                downloaded++;
+            }
+            continue;
+        }
         
         char dest_path[128];
         snprintf(dest_path, sizeof(dest_path), "%s/%s", BIN_DIR, bin_name);
         
         // Download the file
-        if (download_file(download_url->valuestring, dest_path) == 0) {
+        if (download_file(download_url->valuestring, dest_path,
+                          compress && !gz ? Z_DEFLATE : Z_NONE) == 0) {
             downloaded++;
         }
     }
@@ -300,6 +507,7 @@ int cmd_eget(int argc, char **argv)
         return 1;
     }
     
-    printf("Done. Installed %d binary(s) to %s/\n", downloaded, BIN_DIR);
+    printf("Done. Installed %d binary(s) to %s\n", downloaded,
+           to_app ? "the app store" : BIN_DIR "/");
     return 0;
 }
\ No newline at end of file
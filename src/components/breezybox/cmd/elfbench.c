@@ -0,0 +1,79 @@
+/*
+ * elfbench.c - Measure ELF load time
+ *
+ * Usage: elfbench <cmd> [runs]
+ *
+ * Loads and relocates the program <runs> times (default 10) without running
+ * it or using the image cache, once resolving symbols through the perfect
+ * hash table and once through elf_loader's linear tables only. Pick an app
+ * with many imports (vi, gzip) to see the difference.
+ */
+
+#include "breezy_cmd.h"
+#include "breezy_elf.h"
+#include "breezy_exec.h"
+#include "breezy_log.h"
+#include "breezy_symhash.h"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ELFBENCH_DEFAULT_RUNS 10
+
+// Average microseconds per load, or -1 on load error
+static int64_t bench(const char *path, int runs, bool use_hash)
+{
+    breezy_symhash_set_enabled(use_hash);
+    breezy_symhash_stats_reset();
+
+    // Keep per-load log lines off the console (and out of the timing)
+    bool quiet = breezy_log_quiet_begin() == 0;
+    int64_t start = esp_timer_get_time();
+    int ret = 0;
+    for (int i = 0; i < runs && ret == 0; i++) {
+        ret = breezy_elf_load_test(path);
+    }
+    int64_t elapsed = esp_timer_get_time() - start;
+    if (quiet) breezy_log_quiet_end();
+
+    breezy_symhash_set_enabled(true);
+    return ret == 0 ? elapsed / runs : -1;
+}
+
+int cmd_elfbench(int argc, char **argv)
+{
+    if (argc < 2) {
+        printf("Usage: elfbench <cmd> [runs]\n");
+        return 1;
+    }
+
+    int runs = argc >= 3 ? atoi(argv[2]) : ELFBENCH_DEFAULT_RUNS;
+    if (runs <= 0) runs = ELFBENCH_DEFAULT_RUNS;
+
+    char *path = breezybox_find_executable(argv[1]);
+    if (!path || !breezy_elf_is_elf(path)) {
+        printf("elfbench: %s: not an ELF program\n", argv[1]);
+        free(path);
+        return 1;
+    }
+
+    printf("elfbench: %s, %d loads\n", path, runs);
+    bench(path, 1, true);  // Warm-up, so neither pass pays the cold read
+
+    uint32_t lookups, hits;
+    int64_t hashed = bench(path, runs, true);
+    breezy_symhash_stats(&lookups, &hits);
+    int64_t linear = bench(path, runs, false);
+    free(path);
+
+    if (hashed < 0 || linear < 0) {
+        printf("elfbench: load failed\n");
+        return 1;
+    }
+
+    printf("  symbol hash (%u syms): %7lld us/load, %u lookups, %u hashed\n",
+           (unsigned)breezy_symhash_size(), (long long)hashed,
+           (unsigned)(lookups / runs), (unsigned)(hits / runs));
+    printf("  linear tables only:    %7lld us/load\n", (long long)linear);
+    return 0;
+}
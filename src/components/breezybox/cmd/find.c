@@ -0,0 +1,182 @@
+/*
+ * find.c - Find files in a directory tree
+ *
+ * Usage: find [path] [-name pattern] [-type f|d] [-size [+|-]N[c|k|M]]
+ *             [-newer file] [-maxdepth N]
+ *
+ * Prints every entry below path (default ".") that matches all the tests.
+ * -name takes *, ? and [...] wildcards, which the shell passes through
+ * as they are. -size counts bytes, or KB/MB with k/M, rounded up; + is more
+ * than, - less than.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "breezy_vfs.h"
+#include "breezy_walk.h"
+
+typedef struct {
+    const char *start;      // As given, for printing
+    size_t start_len;
+    const char *name;
+    char type;              // 'f', 'd' or 0
+    int size_cmp;           // -1, 0 or 1; size_unit 0 means no -size
+    unsigned long size;
+    unsigned long size_unit;
+    bool newer;
+    time_t newer_than;
+    int maxdepth;           // -1: no limit
+} find_ctx_t;
+
+// One pattern element against c; returns the rest of the pattern, or NULL
+static const char *match_one(const char *pat, char c)
+{
+    if (*pat == '?') return pat + 1;
+    if (*pat == '\\' && pat[1]) return pat[1] == c ? pat + 2 : NULL;
+    if (*pat == '[') {
+        const char *p = pat + 1;
+        bool negate = *p == '!' || *p == '^';
+        if (negate) p++;
+        if (!*p) return c == '[' ? pat + 1 : NULL;
+        bool hit = false;
+        // A ']' right after the '[' is a member
+        do {
+            if (p[1] == '-' && p[2] && p[2] != ']') {
+                if (c >= p[0] && c <= p[2]) hit = true;
+                p += 3;
+            } else {
+                if (c == *p) hit = true;
+                p++;
+            }
+        } while (*p && *p != ']');
+        if (*p != ']') return *pat == c ? pat + 1 : NULL;   // No closing ']'
+        return hit != negate ? p + 1 : NULL;
+    }
+    return (*pat && *pat == c) ? pat + 1 : NULL;
+}
+
+// Shell-style wildcard match, backtracking only to the last '*'
+static bool name_match(const char *pat, const char *s)
+{
+    const char *star = NULL, *resume = NULL;
+    while (*s) {
+        if (*pat == '*') {
+            star = ++pat;
+            resume = s;
+            continue;
+        }
+        const char *next = match_one(pat, *s);
+        if (next) {
+            pat = next;
+            s++;
+        } else if (star) {
+            pat = star;
+            s = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (*pat == '*') pat++;
+    return *pat == '\0';
+}
+
+static bool matches(const find_ctx_t *fc, const breezy_walk_entry_t *e)
+{
+    if (fc->type && (fc->type == 'd') != e->is_dir) return false;
+    if (fc->name && !name_match(fc->name, e->name)) return false;
+    if (fc->size_unit) {
+        unsigned long units = ((unsigned long)e->st->st_size + fc->size_unit - 1) / fc->size_unit;
+        int cmp = units > fc->size ? 1 : units < fc->size ? -1 : 0;
+        if (cmp != fc->size_cmp) return false;
+    }
+    if (fc->newer && e->st->st_mtime <= fc->newer_than) return false;
+    return true;
+}
+
+static breezy_walk_ret_t find_entry(const breezy_walk_entry_t *e, void *ctx)
+{
+    const find_ctx_t *fc = ctx;
+    if (matches(fc, e)) {
+        // Under the path as the user typed it, like the shell would show it
+        const char *rel = e->path + e->root_len;
+        bool sep = rel[0] && rel[0] != '/' && fc->start[fc->start_len - 1] != '/';
+        printf("%.*s%s%s\n", (int)fc->start_len, fc->start, sep ? "/" : "", rel);
+    }
+    // Prune instead of walking what can't be printed
+    if (e->is_dir && fc->maxdepth >= 0 && e->depth >= fc->maxdepth) return BREEZY_WALK_SKIP;
+    return BREEZY_WALK_CONTINUE;
+}
+
+static int usage(void)
+{
+    printf("Usage: find [path] [-name pattern] [-type f|d] [-size [+|-]N[c|k|M]] [-newer file] [-maxdepth N]\n");
+    return 1;
+}
+
+int cmd_find(int argc, char **argv)
+{
+    find_ctx_t fc = { .start = ".", .maxdepth = -1 };
+
+    int i = 1;
+    if (i < argc && argv[i][0] != '-') fc.start = argv[i++];
+
+    for (; i < argc; i++) {
+        if (i + 1 >= argc) return usage();
+        const char *opt = argv[i], *arg = argv[++i];
+
+        if (strcmp(opt, "-name") == 0) {
+            fc.name = arg;
+        } else if (strcmp(opt, "-type") == 0) {
+            if (strcmp(arg, "f") != 0 && strcmp(arg, "d") != 0) return usage();
+            fc.type = arg[0];
+        } else if (strcmp(opt, "-size") == 0) {
+            fc.size_cmp = *arg == '+' ? 1 : *arg == '-' ? -1 : 0;
+            if (fc.size_cmp) arg++;
+            char *end;
+            fc.size = strtoul(arg, &end, 10);
+            if (end == arg) return usage();
+            switch (*end) {
+                case '\0':
+                case 'c': fc.size_unit = 1; break;
+                case 'k': fc.size_unit = 1024; break;
+                case 'M': fc.size_unit = 1024 * 1024; break;
+                default: return usage();
+            }
+            if (*end && end[1]) return usage();
+        } else if (strcmp(opt, "-newer") == 0) {
+            char ref[256];
+            struct stat st;
+            breezybox_resolve_path(arg, ref, sizeof(ref));
+            if (stat(ref, &st) != 0) {
+                printf("find: cannot access '%s'\n", arg);
+                return 1;
+            }
+            fc.newer = true;
+            fc.newer_than = st.st_mtime;
+        } else if (strcmp(opt, "-maxdepth") == 0) {
+            char *end;
+            fc.maxdepth = (int)strtol(arg, &end, 10);
+            if (end == arg || *end || fc.maxdepth < 0) return usage();
+        } else {
+            return usage();
+        }
+    }
+
+    // Printed paths keep the user's prefix, without trailing slashes
+    fc.start_len = strlen(fc.start);
+    while (fc.start_len > 1 && fc.start[fc.start_len - 1] == '/') fc.start_len--;
+
+    char path[256];
+    breezybox_resolve_path(fc.start, path, sizeof(path));
+
+    // Sizes and times need a stat() per entry; names and types don't
+    unsigned flags = (fc.size_unit || fc.newer) ? BREEZY_WALK_STAT : 0;
+    if (breezy_walk(path, find_entry, NULL, flags, &fc) < 0) {
+        printf("find: cannot access '%s'\n", fc.start);
+        return 1;
+    }
+    return 0;
+}
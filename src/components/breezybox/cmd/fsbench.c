@@ -0,0 +1,95 @@
+/*
+ * fsbench.c - Measure small-file rates of a filesystem
+ *
+ * Usage: fsbench [dir] [files] [bytes]
+ *
+ * Creates <files> files (default 50) of <bytes> bytes (default 512) in a
+ * scratch directory under dir (default the CWD), stats them, deletes them,
+ * and prints files per second for each step. Compare `fsbench /tmp` with
+ * `fsbench /root`.
+ */
+
+#include "breezy_cmd.h"
+#include "breezy_vfs.h"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define FSBENCH_FILES   50
+#define FSBENCH_BYTES   512
+#define FSBENCH_DIR     "fsbench.tmp"
+
+static void report(const char *step, int files, int64_t us)
+{
+    if (us < 1) us = 1;
+    printf("  %-8s %6u files/s  (%u us each)\n", step,
+           (unsigned)(files * 1000000LL / us), (unsigned)(us / files));
+}
+
+int cmd_fsbench(int argc, char **argv)
+{
+    const char *dir = argc >= 2 ? argv[1] : ".";
+    int files = argc >= 3 ? atoi(argv[2]) : FSBENCH_FILES;
+    int bytes = argc >= 4 ? atoi(argv[3]) : FSBENCH_BYTES;
+    if (files <= 0 || bytes < 0) {
+        printf("Usage: fsbench [dir] [files] [bytes]\n");
+        return 1;
+    }
+
+    char base[BREEZYBOX_MAX_PATH * 2 + 2];
+    char path[sizeof(base) + 16];
+    if (!breezybox_resolve_path(dir, path, sizeof(path)) ||
+        snprintf(base, sizeof(base), "%s/%s", path, FSBENCH_DIR) >= (int)sizeof(base)) {
+        printf("fsbench: path too long\n");
+        return 1;
+    }
+    if (mkdir(base, 0755) != 0) {
+        printf("fsbench: cannot create %s\n", base);
+        return 1;
+    }
+
+    char *data = malloc(bytes + 1);
+    if (!data) {
+        printf("fsbench: out of memory\n");
+        rmdir(base);
+        return 1;
+    }
+    memset(data, 'x', bytes);
+
+    printf("fsbench: %s, %d files of %d bytes\n", base, files, bytes);
+
+    const char *failed = NULL;
+    int64_t t0 = esp_timer_get_time();
+    for (int i = 0; i < files && !failed; i++) {
+        snprintf(path, sizeof(path), "%s/f%d", base, i);
+        FILE *f = fopen(path, "w");
+        if (!f || fwrite(data, 1, bytes, f) != (size_t)bytes) failed = "write";
+        if (f && fclose(f) != 0) failed = "write";
+    }
+    int64_t t1 = esp_timer_get_time();
+    for (int i = 0; i < files && !failed; i++) {
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/f%d", base, i);
+        if (stat(path, &st) != 0 || st.st_size != bytes) failed = "stat";
+    }
+    int64_t t2 = esp_timer_get_time();
+    for (int i = 0; i < files; i++) {
+        snprintf(path, sizeof(path), "%s/f%d", base, i);
+        unlink(path);
+    }
+    int64_t t3 = esp_timer_get_time();
+    rmdir(base);
+    free(data);
+
+    if (failed) {
+        printf("fsbench: %s failed\n", failed);
+        return 1;
+    }
+    report("create", files, t1 - t0);
+    report("stat", files, t2 - t1);
+    report("delete", files, t3 - t2);
+    return 0;
+}
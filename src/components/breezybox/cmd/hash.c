@@ -0,0 +1,117 @@
+/*
+ * hash.c - Inspect the resident ELF image cache
+ *
+ * Usage: hash [-r] [-p|-u|-s <cmd>]
+ *   (none)    List cached images, most recently used first
+ *   -r        Forget remembered program locations and flush every
+ *             image that is not running
+ *   -p <cmd>  Pin: load now and never evict
+ *   -u <cmd>  Unpin
+ *   -s <cmd>  Show where each section of a cached image landed
+ */
+
+#include "breezy_cmd.h"
+#include "breezy_elf.h"
+#include "breezy_cmdtab.h"
+#include "breezy_exec.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HASH_MAX_LIST 32
+
+static int hash_pin(const char *name, bool pin)
+{
+    char *path = breezybox_find_executable(name);
+    if (!path) {
+        printf("hash: %s: not found\n", name);
+        return 1;
+    }
+
+    int ret = breezy_elf_cache_pin(path, pin);
+    if (ret != 0) {
+        printf("hash: %s: cannot %s\n", name, pin ? "load into cache" : "unpin");
+    }
+    free(path);
+    return ret != 0;
+}
+
+static int hash_sections(const char *name)
+{
+    char *path = breezybox_find_executable(name);
+    if (!path) {
+        printf("hash: %s: not found\n", name);
+        return 1;
+    }
+
+    breezy_elf_sec_info_t secs[8];
+    int n = breezy_elf_cache_sections(path, secs, 8);
+    if (n < 0) {
+        printf("hash: %s: not cached (run it or hash -p it first)\n", name);
+        free(path);
+        return 1;
+    }
+
+    printf("%s\n", path);
+    for (int i = 0; i < n; i++) {
+        printf("  %-12s %7u  %p  %s\n", secs[i].name, (unsigned)secs[i].size,
+               (void *)secs[i].addr, secs[i].internal ? "internal" : "PSRAM");
+    }
+    free(path);
+    return 0;
+}
+
+static int hash_list(void)
+{
+    breezy_elf_cache_info_t *list = malloc(HASH_MAX_LIST * sizeof(breezy_elf_cache_info_t));
+    if (!list) {
+        printf("hash: out of memory\n");
+        return 1;
+    }
+
+    size_t n = breezy_elf_cache_list(list, HASH_MAX_LIST);
+    size_t used, budget;
+    breezy_elf_cache_usage(&used, &budget);
+
+    if (n == 0) {
+        printf("hash: cache empty\n");
+    } else {
+        printf(" hits    size    heap  path\n");
+        for (size_t i = 0; i < n; i++) {
+            printf("%5u %6uK %6uK  %s%s%s\n",
+                   (unsigned)list[i].hits,
+                   (unsigned)((list[i].mem_size + 1023) / 1024),
+                   (unsigned)((list[i].heap_peak + 1023) / 1024),
+                   list[i].path,
+                   list[i].pinned ? " [pinned]" : "",
+                   list[i].in_use ? " [running]" : "");
+        }
+    }
+    printf("Cache: %uK of %uK used\n",
+           (unsigned)(used / 1024), (unsigned)(budget / 1024));
+
+    free(list);
+    return 0;
+}
+
+int cmd_hash(int argc, char **argv)
+{
+    if (argc < 2) {
+        return hash_list();
+    }
+
+    if (strcmp(argv[1], "-r") == 0) {
+        breezy_cmdtab_invalidate(NULL);
+        breezy_elf_cache_flush();
+        return 0;
+    }
+    if ((strcmp(argv[1], "-p") == 0 || strcmp(argv[1], "-u") == 0) && argc >= 3) {
+        return hash_pin(argv[2], argv[1][1] == 'p');
+    }
+    if (strcmp(argv[1], "-s") == 0 && argc >= 3) {
+        return hash_sections(argv[2]);
+    }
+
+    printf("Usage: hash [-r] [-p|-u|-s <cmd>]\n");
+    return 1;
+}
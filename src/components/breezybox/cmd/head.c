@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 int cmd_head(int argc, char **argv)
 {
@@ -23,25 +24,29 @@ int cmd_head(int argc, char **argv)
         }
     }
     
-    if (!filename) {
+    // No file: read stdin when it is a pipe or redirect
+    if (!filename && isatty(fileno(stdin))) {
         printf("Usage: head [-n lines] <file>\n");
         return 1;
     }
     
-    char resolved[BREEZYBOX_MAX_PATH * 2 + 2];
-    const char *path = filename;
-    if (path[0] != '/') {
-        if (!breezybox_resolve_path(path, resolved, sizeof(resolved))) {
-            printf("head: path too long\n");
+    FILE *f = stdin;
+    if (filename) {
+        char resolved[BREEZYBOX_MAX_PATH * 2 + 2];
+        const char *path = filename;
+        if (path[0] != '/') {
+            if (!breezybox_resolve_path(path, resolved, sizeof(resolved))) {
+                printf("head: path too long\n");
+                return 1;
+            }
+            path = resolved;
+        }
+        
+        f = fopen(path, "r");
+        if (!f) {
+            printf("head: %s: No such file\n", filename);
             return 1;
         }
-        path = resolved;
-    }
-    
-    FILE *f = fopen(path, "r");
-    if (!f) {
-        printf("head: %s: No such file\n", filename);
-        return 1;
     }
     
     char line[256];
@@ -54,6 +59,6 @@ int cmd_head(int argc, char **argv)
         }
     }
     
-    fclose(f);
+    if (f != stdin) fclose(f);
     return 0;
 }
\ No newline at end of file
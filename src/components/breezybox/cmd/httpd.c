@@ -1,8 +1,7 @@
 #include "breezy_cmd.h"
+#include "breezy_svc.h"
 #include "breezy_vfs.h"
 #include "esp_http_server.h"
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -11,6 +10,7 @@
 
 #define MAX_URI_LEN 128
 #define MAX_FILEPATH (BREEZYBOX_MAX_PATH + MAX_URI_LEN + 2)
+#define IO_BUF_SIZE 4096  // One flash sector; too big for the handler stack
 
 static char s_base_path[BREEZYBOX_MAX_PATH + 1];
 static httpd_handle_t s_server = NULL;
@@ -58,7 +58,9 @@ static esp_err_t get_handler(httpd_req_t *req)
                 struct stat est;
                 const char *suffix = "";
                 long size = 0;
-                if (stat(entry_path, &est) == 0) {
+                if (entry->d_type == DT_DIR) {
+                    suffix = "/";
+                } else if (stat(entry_path, &est) == 0) {
                     if (S_ISDIR(est.st_mode)) suffix = "/";
                     else size = est.st_size;
                 }
@@ -104,12 +106,18 @@ static esp_err_t get_handler(httpd_req_t *req)
         httpd_resp_set_type(req, "application/octet-stream");
     }
 
-    char buf[256];
+    char *buf = malloc(IO_BUF_SIZE);
+    if (!buf) {
+        fclose(f);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
     size_t read_bytes;
-    while ((read_bytes = fread(buf, 1, sizeof(buf), f)) > 0) {
+    while ((read_bytes = fread(buf, 1, IO_BUF_SIZE, f)) > 0) {
         httpd_resp_send_chunk(req, buf, read_bytes);
     }
     httpd_resp_send_chunk(req, NULL, 0);
+    free(buf);
     fclose(f);
 
     printf("  200 OK (%ld bytes)\n", st.st_size);
@@ -139,16 +147,23 @@ static esp_err_t put_handler(httpd_req_t *req)
         return ESP_FAIL;
     }
 
-    char buf[256];
+    char *buf = malloc(IO_BUF_SIZE);
+    if (!buf) {
+        fclose(f);
+        printf("  500 Out of memory\n");
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
     int remaining = req->content_len;
     int received;
     
     while (remaining > 0) {
-        int to_read = (remaining < (int)sizeof(buf)) ? remaining : (int)sizeof(buf);
+        int to_read = (remaining < IO_BUF_SIZE) ? remaining : IO_BUF_SIZE;
         received = httpd_req_recv(req, buf, to_read);
         
         if (received <= 0) {
             if (received == HTTPD_SOCK_ERR_TIMEOUT) continue;
+            free(buf);
             fclose(f);
             printf("  500 Receive error\n");
             httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Receive error");
@@ -159,6 +174,7 @@ static esp_err_t put_handler(httpd_req_t *req)
         remaining -= received;
     }
     
+    free(buf);
     fclose(f);
     httpd_resp_sendstr(req, "OK\n");
     printf("  201 Created\n");
@@ -192,34 +208,33 @@ static esp_err_t delete_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
-int cmd_httpd(int argc, char **argv)
+// ============ Service ============
+
+// argv: httpd [dir] [-p port]; cmd_httpd makes dir absolute
+static esp_err_t httpd_svc_start(int argc, char **argv)
 {
-    const char *dir = (argc > 1) ? argv[1] : ".";
+    const char *dir = (argc > 1 && strcmp(argv[1], "-p") != 0) ? argv[1] : "/";
     int port = 80;
-    
+
     // Parse -p port
     for (int i = 1; i < argc - 1; i++) {
         if (strcmp(argv[i], "-p") == 0) {
             port = atoi(argv[i + 1]);
             if (port <= 0 || port > 65535) {
                 printf("Invalid port\n");
-                return 1;
+                return ESP_ERR_INVALID_ARG;
             }
         }
     }
-    
-    // Resolve directory path
-    if (dir[0] != '/') {
-        breezybox_resolve_path(dir, s_base_path, sizeof(s_base_path));
-    } else {
-        strncpy(s_base_path, dir, sizeof(s_base_path) - 1);
-    }
-    
+
+    strncpy(s_base_path, dir, sizeof(s_base_path) - 1);
+    s_base_path[sizeof(s_base_path) - 1] = '\0';
+
     // Verify directory exists
     struct stat st;
     if (stat(s_base_path, &st) != 0 || !S_ISDIR(st.st_mode)) {
         printf("Not a directory: %s\n", s_base_path);
-        return 1;
+        return ESP_ERR_NOT_FOUND;
     }
 
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
@@ -228,9 +243,11 @@ int cmd_httpd(int argc, char **argv)
     config.max_uri_handlers = 8;
     config.stack_size = 8192;  // Increase from default 4096
 
-    if (httpd_start(&s_server, &config) != ESP_OK) {
+    esp_err_t err = httpd_start(&s_server, &config);
+    if (err != ESP_OK) {
         printf("Failed to start server\n");
-        return 1;
+        s_server = NULL;
+        return err;
     }
 
     // Register wildcard handlers
@@ -255,19 +272,57 @@ int cmd_httpd(int argc, char **argv)
     httpd_register_uri_handler(s_server, &delete_uri);
 
     printf("Serving %s on port %d\n", s_base_path, port);
-    printf("Press Enter to stop...\n\n");
+    return ESP_OK;
+}
 
-    // Wait for Enter key
-    int c;
-    while ((c = getchar()) != '\n' && c != '\r') {
-        if (c == EOF) {
-            vTaskDelay(pdMS_TO_TICKS(100));
-        }
+static void httpd_svc_stop(void)
+{
+    if (s_server) {
+        httpd_stop(s_server);
+        s_server = NULL;
     }
+}
 
-    httpd_stop(s_server);
-    s_server = NULL;
-    printf("\nServer stopped\n");
-    
-    return 0;
-}
\ No newline at end of file
+static bool httpd_svc_running(void)
+{
+    return s_server != NULL;
+}
+
+const breezy_svc_def_t httpd_service = {
+    .name = "httpd",
+    .start = httpd_svc_start,
+    .stop = httpd_svc_stop,
+    .running = httpd_svc_running,
+    .task = "httpd",
+};
+
+// ============ Command ============
+
+// Starts the httpd service, so the console stays free; `httpd stop` ends it
+int cmd_httpd(int argc, char **argv)
+{
+    if (argc == 2 && strcmp(argv[1], "stop") == 0) {
+        return breezy_svc_stop("httpd");
+    }
+
+    // Resolve dir now: the service may be restarted from another directory
+    bool has_dir = argc > 1 && strcmp(argv[1], "-p") != 0;
+    char dir[BREEZYBOX_MAX_PATH + 1];
+    if (!breezybox_resolve_path(has_dir ? argv[1] : ".", dir, sizeof(dir))) {
+        printf("httpd: path too long\n");
+        return 1;
+    }
+
+    char *args[8];
+    int n = 0;
+    args[n++] = argv[0];
+    args[n++] = dir;
+    for (int i = has_dir ? 2 : 1; i < argc && n < 7; i++) {
+        args[n++] = argv[i];
+    }
+    args[n] = NULL;
+
+    int ret = breezy_svc_start(n, args);
+    if (ret == 0) printf("Stop with: httpd stop\n");
+    return ret;
+}
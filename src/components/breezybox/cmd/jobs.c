@@ -0,0 +1,89 @@
+/*
+ * jobs.c - Manage background jobs (`cmd &`)
+ *
+ * Usage: jobs
+ *        fg [job]          Wait for a job (default: the latest) to finish
+ *        kill <job...>     Stop the programs a job is running
+ *
+ * A job may be given as "2" or "%2".
+ */
+
+#include "breezy_cmd.h"
+#include "breezy_jobs.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static int parse_job(const char *s)
+{
+    if (*s == '%') s++;
+    char *end;
+    long id = strtol(s, &end, 10);
+    if (end == s || *end != '\0' || id <= 0) return -1;
+    return (int)id;
+}
+
+int cmd_jobs(int argc, char **argv)
+{
+    (void)argc; (void)argv;
+
+    breezy_job_info_t list[BREEZY_JOBS_MAX];
+    size_t n = breezy_jobs_list(list, BREEZY_JOBS_MAX);
+    for (size_t i = 0; i < n; i++) {
+        if (!list[i].done) printf("[%d] Running  %s\n", list[i].id, list[i].cmd);
+    }
+
+    // Finished ones are shown once, then forgotten
+    breezy_jobs_report();
+    return 0;
+}
+
+int cmd_fg(int argc, char **argv)
+{
+    int id = 0;
+    if (argc > 1 && (id = parse_job(argv[1])) < 0) {
+        printf("Usage: fg [job]\n");
+        return 1;
+    }
+
+    breezy_job_info_t list[BREEZY_JOBS_MAX];
+    size_t n = breezy_jobs_list(list, BREEZY_JOBS_MAX);
+    const breezy_job_info_t *job = NULL;
+    for (size_t i = 0; i < n; i++) {
+        if (!id || list[i].id == id) job = &list[i];  // Oldest first
+    }
+    if (!job) {
+        printf("fg: no such job\n");
+        return 1;
+    }
+    printf("%s\n", job->cmd);
+
+    // The job keeps its own stdin; this just waits for it
+    int ret = 0;
+    if (breezy_jobs_wait(job->id, &ret) < 0) {
+        printf("fg: no such job\n");
+        return 1;
+    }
+    return ret;
+}
+
+int cmd_kill(int argc, char **argv)
+{
+    if (argc < 2) {
+        printf("Usage: kill <job...>\n");
+        return 1;
+    }
+
+    int status = 0;
+    for (int i = 1; i < argc; i++) {
+        int id = parse_job(argv[i]);
+        int n = id > 0 ? breezy_jobs_kill(id) : -1;
+        if (n < 0) {
+            printf("kill: %s: no such job\n", argv[i]);
+            status = 1;
+        } else if (n == 0) {
+            printf("kill: %s: no program to stop (built-ins run to completion)\n", argv[i]);
+            status = 1;
+        }
+    }
+    return status;
+}
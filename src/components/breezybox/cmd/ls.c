@@ -28,6 +28,12 @@ int cmd_ls(int argc, char **argv)
     while ((entry = readdir(dir)) != NULL) {
         if (entry->d_name[0] == '.') continue;
 
+        // readdir already says so; only files need their size
+        if (entry->d_type == DT_DIR) {
+            printf("%-20s  <DIR>\n", entry->d_name);
+            continue;
+        }
+
         char entry_path[BREEZYBOX_MAX_PATH * 2 + 258];
         snprintf(entry_path, sizeof(entry_path), "%s/%s", path, entry->d_name);
 
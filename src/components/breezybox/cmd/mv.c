@@ -5,10 +5,13 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include "breezy_vfs.h"
 
+#define COPY_BUF_SIZE 4096
+
 int cmd_mv(int argc, char **argv)
 {
     if (argc < 3) {
@@ -66,17 +69,18 @@ int cmd_mv(int argc, char **argv)
         return 1;
     }
     
-    char buf[512];
+    char *buf = malloc(COPY_BUF_SIZE);
     size_t bytes_read;
-    int error = 0;
+    int error = !buf;
     
-    while ((bytes_read = fread(buf, 1, sizeof(buf), src)) > 0) {
+    while (buf && (bytes_read = fread(buf, 1, COPY_BUF_SIZE, src)) > 0) {
         if (fwrite(buf, 1, bytes_read, dst) != bytes_read) {
             error = 1;
             break;
         }
     }
     
+    free(buf);
     fclose(src);
     fclose(dst);
     
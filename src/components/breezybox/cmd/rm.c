@@ -6,57 +6,29 @@
 
 #include <stdio.h>
 #include <string.h>
-#include <dirent.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include "breezy_vfs.h"
+#include "breezy_walk.h"
 
-// Forward declaration for recursion
-static int remove_recursive(const char *path);
+// Files on the way down, each directory once it is empty
+static breezy_walk_ret_t rm_file(const breezy_walk_entry_t *e, void *ctx)
+{
+    if (!e->is_dir && remove(e->path) != 0) (*(int *)ctx)++;
+    return BREEZY_WALK_CONTINUE;
+}
 
-static int remove_dir_contents(const char *path)
+static breezy_walk_ret_t rm_dir(const breezy_walk_entry_t *e, void *ctx)
 {
-    DIR *dir = opendir(path);
-    if (!dir) return -1;
-    
-    struct dirent *entry;
-    char child_path[512];
-    int ret = 0;
-    
-    while ((entry = readdir(dir)) != NULL) {
-        // Skip . and ..
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-            continue;
-        }
-        
-        snprintf(child_path, sizeof(child_path), "%.240s/%.240s", path, entry->d_name);
-        
-        if (remove_recursive(child_path) != 0) {
-            ret = -1;
-        }
-    }
-    
-    closedir(dir);
-    return ret;
+    if (rmdir(e->path) != 0) (*(int *)ctx)++;
+    return BREEZY_WALK_CONTINUE;
 }
 
 static int remove_recursive(const char *path)
 {
-    struct stat st;
-    if (stat(path, &st) != 0) {
-        return -1;
-    }
-    
-    if (S_ISDIR(st.st_mode)) {
-        // Remove directory contents first
-        if (remove_dir_contents(path) != 0) {
-            return -1;
-        }
-        // Then remove the directory itself
-        return rmdir(path);
-    } else {
-        return remove(path);
-    }
+    int failed = 0;
+    if (breezy_walk(path, rm_file, rm_dir, 0, &failed) != 0) return -1;
+    return failed ? -1 : 0;
 }
 
 int cmd_rm(int argc, char **argv)
@@ -0,0 +1,115 @@
+/*
+ * svc.c - Start, stop and list supervised services
+ *
+ * Usage: svc [status [name]]
+ *        svc start <name> [args...]
+ *        svc stop <name>
+ *        svc restart <name> [args...]
+ *        svc run <name> <cmd> [args...]
+ *
+ * `start` starts a built-in service (httpd, or those the firmware adds)
+ * with args, or with those it had last time; on a `svc run` service it
+ * starts its command again. `run` adds a service that runs cmd with args,
+ * kept quoted so they are not parsed again when it starts.
+ * See breezy_svc.h for how services are restarted.
+ */
+
+#include "breezy_cmd.h"
+#include "breezy_parse.h"
+#include "breezy_svc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *state_name(breezy_svc_state_t state)
+{
+    switch (state) {
+    case BREEZY_SVC_RUNNING:  return "running";
+    case BREEZY_SVC_STOPPING: return "stopping";
+    case BREEZY_SVC_BACKOFF:  return "backoff";
+    default:                  return "stopped";
+    }
+}
+
+static int svc_status(const char *name)
+{
+    breezy_svc_info_t list[BREEZY_SVC_MAX];
+    size_t n = breezy_svc_list(list, BREEZY_SVC_MAX);
+    bool found = false;
+
+    printf("%-15s %-8s %8s %4s %8s %5s  %s\n",
+           "NAME", "STATE", "UPTIME", "RST", "MEM", "CPU", "CMD");
+    for (size_t i = 0; i < n; i++) {
+        const breezy_svc_info_t *s = &list[i];
+        if (name && strcmp(s->name, name) != 0) continue;
+        found = true;
+
+        char state[16];
+        if (s->state == BREEZY_SVC_STOPPED && s->last_ret != 0) {
+            snprintf(state, sizeof(state), "exit %d", s->last_ret);
+        } else {
+            snprintf(state, sizeof(state), "%s", state_name(s->state));
+        }
+
+        char cpu[16] = "-";
+        if (s->cpu_permille >= 0) {
+            snprintf(cpu, sizeof(cpu), "%d.%d%%", s->cpu_permille / 10, s->cpu_permille % 10);
+        }
+
+        printf("%-15s %-8s %7us %4u %8u %5s  %s\n", s->name, state,
+               (unsigned)s->uptime_s, (unsigned)s->restarts, (unsigned)s->mem,
+               cpu, s->cmd[0] ? s->cmd : "(built-in)");
+    }
+
+    if (name && !found) {
+        printf("svc: %s: no such service\n", name);
+        return 1;
+    }
+    return 0;
+}
+
+int cmd_svc(int argc, char **argv)
+{
+    const char *op = argc > 1 ? argv[1] : "status";
+
+    if (strcmp(op, "status") == 0) {
+        return svc_status(argc > 2 ? argv[2] : NULL);
+    }
+    if (argc < 3) {
+        printf("Usage: svc [status [name] | start|restart <name> [args] | stop <name> |"
+               " run <name> <cmd> [args]]\n");
+        return 1;
+    }
+
+    if (strcmp(op, "start") == 0) {
+        return breezy_svc_start(argc - 2, argv + 2);
+    }
+    if (strcmp(op, "stop") == 0) {
+        return breezy_svc_stop(argv[2]);
+    }
+    if (strcmp(op, "restart") == 0) {
+        if (breezy_svc_stop(argv[2]) != 0) return 1;
+        return breezy_svc_start(argc - 2, argv + 2);
+    }
+    if (strcmp(op, "run") == 0) {
+        if (argc < 4) {
+            printf("Usage: svc run <name> <cmd> [args...]\n");
+            return 1;
+        }
+        if (strlen(argv[2]) >= BREEZY_SVC_NAME_MAX) {
+            printf("svc: name too long\n");
+            return 1;
+        }
+        char *cmdline = breezy_parse_format_argv(argc - 3, argv + 3);
+        if (!cmdline) {
+            printf("svc: out of memory\n");
+            return 1;
+        }
+        int ret = breezy_svc_run(argv[2], cmdline);
+        free(cmdline);
+        return ret;
+    }
+
+    printf("svc: unknown command %s\n", op);
+    return 1;
+}
@@ -0,0 +1,55 @@
+/*
+ * sync.c - Write cached file data to flash
+ *
+ * Usage: sync [-s]
+ *
+ * -s also prints the block cache and stat() cache counters.
+ */
+
+#include "breezy_cmd.h"
+#include "breezy_bcache.h"
+#include "breezy_statcache.h"
+#include <stdio.h>
+#include <string.h>
+
+static void print_stats(void)
+{
+    unsigned hits, misses;
+    breezy_statcache_counts(&hits, &misses);
+    printf("stat() cache: %u hits, %u misses\n", hits, misses);
+
+    breezy_bcache_stats_t st;
+    breezy_bcache_stats(&st);
+    if (!st.enabled) {
+        printf("Block cache: off\n");
+        return;
+    }
+
+    uint32_t reads = st.hits + st.misses;
+    printf("Block cache: %uK, %u sectors dirty\n",
+           (unsigned)(st.sectors * BREEZY_BCACHE_SECTOR / 1024), (unsigned)st.dirty);
+    printf("  reads   %u hits, %u misses (%u%% hit), %u read ahead\n",
+           (unsigned)st.hits, (unsigned)st.misses,
+           reads ? (unsigned)((uint64_t)st.hits * 100 / reads) : 0, (unsigned)st.readahead);
+    printf("  writes  %u calls in %u flash writes (%uK), %u erases\n",
+           (unsigned)st.writes, (unsigned)st.flash_writes,
+           (unsigned)(st.flushed_bytes / 1024), (unsigned)st.erases);
+    printf("  flushes %u, %u errors\n", (unsigned)st.flushes, (unsigned)st.errors);
+}
+
+int cmd_sync(int argc, char **argv)
+{
+    bool stats = argc >= 2 && strcmp(argv[1], "-s") == 0;
+    if (argc > 2 || (argc == 2 && !stats)) {
+        printf("Usage: sync [-s]\n");
+        return 1;
+    }
+
+    int ret = 0;
+    if (breezy_bcache_sync() != ESP_OK) {
+        printf("sync: flash write failed\n");
+        ret = 1;
+    }
+    if (stats) print_stats();
+    return ret;
+}
@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #define TAIL_LINE_SIZE 256
 #define TAIL_MAX_LINES 100
@@ -25,7 +26,8 @@ int cmd_tail(int argc, char **argv)
         }
     }
     
-    if (!filename) {
+    // No file: read stdin when it is a pipe or redirect
+    if (!filename && isatty(fileno(stdin))) {
         printf("Usage: tail [-n lines] <file>\n");
         return 1;
     }
@@ -35,27 +37,30 @@ int cmd_tail(int argc, char **argv)
         num_lines = TAIL_MAX_LINES;
     }
     
-    char resolved[BREEZYBOX_MAX_PATH * 2 + 2];
-    const char *path = filename;
-    if (path[0] != '/') {
-        if (!breezybox_resolve_path(path, resolved, sizeof(resolved))) {
-            printf("tail: path too long\n");
+    FILE *f = stdin;
+    if (filename) {
+        char resolved[BREEZYBOX_MAX_PATH * 2 + 2];
+        const char *path = filename;
+        if (path[0] != '/') {
+            if (!breezybox_resolve_path(path, resolved, sizeof(resolved))) {
+                printf("tail: path too long\n");
+                return 1;
+            }
+            path = resolved;
+        }
+        
+        f = fopen(path, "r");
+        if (!f) {
+            printf("tail: %s: No such file\n", filename);
             return 1;
         }
-        path = resolved;
-    }
-    
-    FILE *f = fopen(path, "r");
-    if (!f) {
-        printf("tail: %s: No such file\n", filename);
-        return 1;
     }
     
     // Circular buffer for last N lines
     char (*lines)[TAIL_LINE_SIZE] = malloc(num_lines * TAIL_LINE_SIZE);
     if (!lines) {
         printf("tail: out of memory\n");
-        fclose(f);
+        if (f != stdin) fclose(f);
         return 1;
     }
     
@@ -69,7 +74,7 @@ int cmd_tail(int argc, char **argv)
         head = (head + 1) % num_lines;
         if (count < num_lines) count++;
     }
-    fclose(f);
+    if (f != stdin) fclose(f);
     
     // Print lines in order
     int start = (count < num_lines) ? 0 : head;
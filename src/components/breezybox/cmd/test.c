@@ -0,0 +1,100 @@
+/*
+ * test.c - Evaluate a condition for scripts (test / [)
+ *
+ * Usage: test <expr>   or   [ <expr> ]
+ *   -n s, -z s, s          String is non-empty / empty / non-empty
+ *   s1 = s2, s1 != s2      String comparison
+ *   n1 -eq|-ne|-lt|-le|-gt|-ge n2
+ *   -e f, -f f, -d f, -s f  Exists / regular file / directory / non-empty
+ *   ! expr                 Negation
+ *
+ * Returns 0 if true, 1 if false, 2 on a malformed expression.
+ */
+
+#include "breezy_cmd.h"
+#include "breezy_vfs.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+static bool parse_int(const char *s, long *out)
+{
+    char *end;
+    *out = strtol(s, &end, 10);
+    return *s && *end == '\0';
+}
+
+static int test_file(const char *op, const char *name)
+{
+    char resolved[BREEZYBOX_MAX_PATH * 2 + 2];
+    const char *path = breezybox_resolve_path(name, resolved, sizeof(resolved));
+    struct stat st;
+    if (!path || stat(path, &st) != 0) return 1;
+
+    switch (op[1]) {
+    case 'e': return 0;
+    case 'f': return S_ISREG(st.st_mode) ? 0 : 1;
+    case 'd': return S_ISDIR(st.st_mode) ? 0 : 1;
+    case 's': return st.st_size > 0 ? 0 : 1;
+    }
+    return 2;
+}
+
+static int test_eval(int argc, char **argv)
+{
+    if (argc > 0 && strcmp(argv[0], "!") == 0) {
+        int ret = test_eval(argc - 1, argv + 1);
+        return ret == 2 ? 2 : !ret;
+    }
+
+    switch (argc) {
+    case 0:
+        return 1;
+    case 1:
+        return argv[0][0] ? 0 : 1;
+    case 2:
+        if (strcmp(argv[0], "-n") == 0) return argv[1][0] ? 0 : 1;
+        if (strcmp(argv[0], "-z") == 0) return argv[1][0] ? 1 : 0;
+        if (strlen(argv[0]) == 2 && argv[0][0] == '-' && strchr("efds", argv[0][1])) {
+            return test_file(argv[0], argv[1]);
+        }
+        break;
+    case 3: {
+        const char *op = argv[1];
+        if (strcmp(op, "=") == 0) return strcmp(argv[0], argv[2]) == 0 ? 0 : 1;
+        if (strcmp(op, "!=") == 0) return strcmp(argv[0], argv[2]) != 0 ? 0 : 1;
+
+        static const char *const ops[] = { "-eq", "-ne", "-lt", "-le", "-gt", "-ge" };
+        for (int i = 0; i < 6; i++) {
+            if (strcmp(op, ops[i]) != 0) continue;
+
+            long a, b;
+            if (!parse_int(argv[0], &a) || !parse_int(argv[2], &b)) {
+                printf("test: integer expected\n");
+                return 2;
+            }
+            bool r = i == 0 ? a == b : i == 1 ? a != b : i == 2 ? a < b :
+                     i == 3 ? a <= b : i == 4 ? a > b : a >= b;
+            return r ? 0 : 1;
+        }
+        break;
+    }
+    }
+
+    printf("test: bad expression\n");
+    return 2;
+}
+
+int cmd_test(int argc, char **argv)
+{
+    if (strcmp(argv[0], "[") == 0) {
+        if (argc < 2 || strcmp(argv[argc - 1], "]") != 0) {
+            printf("[: missing ]\n");
+            return 2;
+        }
+        argc--;
+    }
+    return test_eval(argc - 1, argv + 1);
+}
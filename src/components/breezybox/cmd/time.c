@@ -0,0 +1,116 @@
+/*
+ * time.c - Run a command and report where its time went
+ *
+ * Usage: time [-o file] <cmd> [args...]
+ *   -o file  Also append the results to file as one line of key=value
+ *            pairs, for tracking regressions across builds
+ *
+ * Prints the wall time, and for ELF programs the PATH lookup, file read,
+ * esp_elf_init, esp_elf_relocate, run and esp_elf_deinit times, what the
+ * programs allocated, and how far free SRAM and PSRAM dropped. The report
+ * goes to stderr, so `time cmd > file` keeps it out of the file. The
+ * command gets the words as the shell split them, not parsed again. The
+ * shell splits pipelines before `time` sees them; to time a whole
+ * pipeline, put it in a script and time `sh script`.
+ */
+
+#include "breezy_cmd.h"
+#include "breezy_exec.h"
+#include "breezy_parse.h"
+#include "breezy_profile.h"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void print_report(const breezy_profile_t *p, int64_t wall_us, int ret)
+{
+    fprintf(stderr, "real     %10.3f ms  (exit %d)\n", wall_us / 1000.0, ret);
+    if (p->runs == 0 && p->cycles[BREEZY_PROFILE_LOOKUP] == 0) return;
+
+    for (int i = 0; i < BREEZY_PROFILE_PHASES; i++) {
+        fprintf(stderr, "  %-8s %10.3f ms\n", breezy_profile_phase_name(i),
+                breezy_profile_us(p->cycles[i]) / 1000.0);
+    }
+    fprintf(stderr, "programs %u run, %u cached, %u bytes read\n",
+            (unsigned)p->runs, (unsigned)p->cached, (unsigned)p->file_bytes);
+    fprintf(stderr, "heap     %u bytes in %u allocs, peak %u\n",
+            (unsigned)p->heap_bytes, (unsigned)p->heap_allocs, (unsigned)p->heap_peak);
+    fprintf(stderr, "peak     SRAM %u, PSRAM %u bytes below start\n",
+            (unsigned)p->sram_peak, (unsigned)p->psram_peak);
+}
+
+// One line per run: cmd="..." status=0 wall_us=1234 lookup_us=12 ...
+static int log_report(const char *path, const char *cmdline,
+                      const breezy_profile_t *p, int64_t wall_us, int ret)
+{
+    FILE *f = fopen(path, "a");
+    if (!f) {
+        fprintf(stderr, "time: cannot open %s\n", path);
+        return -1;
+    }
+
+    fputs("cmd=\"", f);
+    for (const char *c = cmdline; *c; c++) {
+        if (*c == '"' || *c == '\\') fputc('\\', f);
+        fputc(*c, f);
+    }
+    fprintf(f, "\" status=%d wall_us=%lld", ret, (long long)wall_us);
+    for (int i = 0; i < BREEZY_PROFILE_PHASES; i++) {
+        fprintf(f, " %s_us=%.1f", breezy_profile_phase_name(i),
+                breezy_profile_us(p->cycles[i]));
+    }
+    fprintf(f, " runs=%u cached=%u read_bytes=%u heap_bytes=%u heap_allocs=%u"
+               " heap_peak=%u sram_peak=%u psram_peak=%u\n",
+            (unsigned)p->runs, (unsigned)p->cached, (unsigned)p->file_bytes,
+            (unsigned)p->heap_bytes, (unsigned)p->heap_allocs, (unsigned)p->heap_peak,
+            (unsigned)p->sram_peak, (unsigned)p->psram_peak);
+    fclose(f);
+    return 0;
+}
+
+int cmd_time(int argc, char **argv)
+{
+    const char *log_path = NULL;
+    int first = 1;
+
+    if (argc >= 3 && strcmp(argv[1], "-o") == 0) {
+        log_path = argv[2];
+        first = 3;
+    }
+    if (first >= argc) {
+        printf("Usage: time [-o file] <cmd> [args...]\n");
+        return 1;
+    }
+
+    // The command's words, quoted back into a line for the log
+    char *cmdline = NULL;
+    if (log_path && !(cmdline = breezy_parse_format_argv(argc - first, argv + first))) {
+        printf("time: out of memory\n");
+        return 1;
+    }
+
+    breezy_profile_t prof;
+    breezy_profile_t *outer = breezy_profile_current();
+    breezy_profile_start(&prof);
+    if (breezy_profile_attach(&prof) != 0) {
+        printf("time: too many commands being timed\n");
+        free(cmdline);
+        return 1;
+    }
+
+    int64_t start = esp_timer_get_time();
+    int ret = breezybox_exec_argv(argc - first, argv + first);
+    int64_t wall_us = esp_timer_get_time() - start;
+
+    // A `time` inside a timed script hands the profile back
+    breezy_profile_attach(outer);
+
+    print_report(&prof, wall_us, ret);
+    if (log_path && log_report(log_path, cmdline, &prof, wall_us, ret) != 0 && ret == 0) {
+        ret = 1;
+    }
+
+    free(cmdline);
+    return ret;
+}
@@ -2,6 +2,7 @@
 #include "breezy_vfs.h"
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 #include <ctype.h>
 
 int cmd_wc(int argc, char **argv)
@@ -29,25 +30,29 @@ int cmd_wc(int argc, char **argv)
         show_lines = show_words = show_chars = 1;
     }
     
-    if (!filename) {
+    // No file: read stdin when it is a pipe or redirect
+    if (!filename && isatty(fileno(stdin))) {
         printf("Usage: wc [-lwc] <file>\n");
         return 1;
     }
     
-    char resolved[BREEZYBOX_MAX_PATH * 2 + 2];
-    const char *path = filename;
-    if (path[0] != '/') {
-        if (!breezybox_resolve_path(path, resolved, sizeof(resolved))) {
-            printf("wc: path too long\n");
+    FILE *f = stdin;
+    if (filename) {
+        char resolved[BREEZYBOX_MAX_PATH * 2 + 2];
+        const char *path = filename;
+        if (path[0] != '/') {
+            if (!breezybox_resolve_path(path, resolved, sizeof(resolved))) {
+                printf("wc: path too long\n");
+                return 1;
+            }
+            path = resolved;
+        }
+        
+        f = fopen(path, "r");
+        if (!f) {
+            printf("wc: %s: No such file\n", filename);
             return 1;
         }
-        path = resolved;
-    }
-    
-    FILE *f = fopen(path, "r");
-    if (!f) {
-        printf("wc: %s: No such file\n", filename);
-        return 1;
     }
     
     long lines = 0, words = 0, chars = 0;
@@ -69,13 +74,13 @@ int cmd_wc(int argc, char **argv)
         }
     }
     
-    fclose(f);
+    if (f != stdin) fclose(f);
     
     // Print results
     if (show_lines) printf("%7ld ", lines);
     if (show_words) printf("%7ld ", words);
     if (show_chars) printf("%7ld ", chars);
-    printf("%s\n", filename);
+    printf("%s\n", filename ? filename : "");
     
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,328 @@
+/*
+ * xargs.c - Run a command for the words read from stdin, several at once
+ *
+ * Usage: xargs [-P N] [-n N] [-a file] <cmd> [args...]
+ *        parallel [-P N] [-a file] <cmd> [args...]
+ *   -P N     Run up to N commands at once (default 1; 0 = one per core)
+ *   -n N     At most N words per command (default: as many as fit)
+ *   -a file  Read the words from file instead of stdin
+ *
+ * `parallel` is `xargs -n 1 -P 0`: one command per word, on every core.
+ *
+ * The words become arguments as they are: nothing in them is taken as
+ * quoting, variables, pipes or redirects. Each command runs in a task of
+ * its own, builtin or ELF, with its stdout
+ * in a pipe. The pipes are copied to stdout in input order, each command's
+ * output in one piece: the oldest command's streams through as it runs,
+ * the others wait in their pipe buffers (and block once those fill up).
+ * A new command starts when the oldest one is done. stderr is not
+ * collected. Exit status is 123 if any command failed, as in GNU xargs.
+ */
+
+#include "breezy_cmd.h"
+#include "breezy_exec.h"
+#include "breezy_jobs.h"
+#include "breezy_log.h"
+#include "breezy_pipe.h"
+#include "breezy_profile.h"
+#include "breezy_vfs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef CONFIG_BREEZYBOX_STAGE_STACK_SIZE
+#define XARGS_STACK_SIZE CONFIG_BREEZYBOX_STAGE_STACK_SIZE
+#else
+#define XARGS_STACK_SIZE 8192
+#endif
+
+#define XARGS_MAX_BYTES     1024    // Most bytes of arguments per command
+#define XARGS_MAX_JOBS      16
+#define XARGS_FAILED        123
+
+typedef struct {
+    char **words;               // This command's share of the input words
+    int nwords;
+    int argc;
+    char **argv;                // Fixed arguments (own copy), then the words
+    FILE *in;                   // Closed pipe: commands read EOF
+    FILE *rd;                   // Its stdout, read by xargs
+    FILE *wr;
+    FILE *err;
+    int ret;
+    int job;                    // Carried into the task, like pipeline stages
+    breezy_profile_t *profile;
+    SemaphoreHandle_t done;
+} xargs_run_t;
+
+static void run_task(void *arg)
+{
+    xargs_run_t *r = (xargs_run_t *)arg;
+    breezy_jobs_enter(r->job);
+    if (r->profile) breezy_profile_attach(r->profile);
+    breezy_log_quiet_begin();   // stdout is a pipe
+
+    FILE *saved_in = stdin;
+    FILE *saved_out = stdout;
+    FILE *saved_err = stderr;
+    stdin = r->in;
+    stdout = r->wr;
+    stderr = r->err;
+
+    r->ret = breezybox_exec_argv(r->argc, r->argv);
+    fflush(stdout);
+
+    stdin = saved_in;
+    stdout = saved_out;
+    stderr = saved_err;
+    fclose(r->wr);              // EOF for the reader
+    fclose(r->in);
+
+    breezy_log_quiet_end();
+    if (r->profile) breezy_profile_attach(NULL);
+    breezy_jobs_leave();
+    xSemaphoreGive(r->done);
+    vTaskDelete(NULL);
+}
+
+// Returns 0 if the task started; otherwise r->ret is set and nothing is open
+static int start_run(xargs_run_t *r, int nfixed, char **fixed, size_t fixed_len)
+{
+    FILE *in_wr = NULL;
+    r->rd = NULL;
+
+    // Commands running at once may each change their argv strings
+    r->argc = nfixed + r->nwords;
+    r->argv = malloc((r->argc + 1) * sizeof(char *) + fixed_len);
+    if (!r->argv) goto fail;
+    char *copy = (char *)(r->argv + r->argc + 1);
+    for (int i = 0; i < nfixed; i++) {
+        r->argv[i] = strcpy(copy, fixed[i]);
+        copy += strlen(fixed[i]) + 1;
+    }
+    memcpy(r->argv + nfixed, r->words, r->nwords * sizeof(char *));
+    r->argv[r->argc] = NULL;
+
+    if (breezy_pipe_open(&r->in, &in_wr, 16) != 0) goto fail;
+    fclose(in_wr);
+    if (breezy_pipe_open(&r->rd, &r->wr, 0) != 0) {
+        fclose(r->in);
+        r->rd = NULL;
+        goto fail;
+    }
+
+    r->err = stderr;
+    r->job = breezy_jobs_current();
+    r->profile = breezy_profile_current();
+    if (xTaskCreate(run_task, "xargs", XARGS_STACK_SIZE, r,
+                    uxTaskPriorityGet(NULL), NULL) == pdPASS) {
+        return 0;
+    }
+    fclose(r->in);
+    fclose(r->wr);
+    fclose(r->rd);
+    r->rd = NULL;
+
+fail:
+    printf("xargs: cannot start: %s\n", fixed[0]);
+    r->ret = -1;
+    xSemaphoreGive(r->done);
+    return -1;
+}
+
+// ============ Input ============
+
+static char *read_all(FILE *f)
+{
+    size_t cap = 256, len = 0;
+    char *buf = malloc(cap);
+    while (buf) {
+        if (len + 128 > cap) {
+            char *bigger = realloc(buf, cap * 2);
+            if (!bigger) {
+                free(buf);
+                return NULL;
+            }
+            buf = bigger;
+            cap *= 2;
+        }
+        size_t n = fread(buf + len, 1, cap - len - 1, f);
+        if (n == 0) break;
+        len += n;
+    }
+    if (buf) buf[len] = '\0';
+    return buf;
+}
+
+// Input split on blanks, in place
+static char **split_words(char *text, int *count)
+{
+    int cap = 16, n = 0;
+    char **words = malloc(cap * sizeof(char *));
+    char *save = NULL;
+    for (char *w = strtok_r(text, " \t\r\n", &save); w && words; w = strtok_r(NULL, " \t\r\n", &save)) {
+        if (n == cap) {
+            char **bigger = realloc(words, cap * 2 * sizeof(char *));
+            if (!bigger) {
+                free(words);
+                return NULL;
+            }
+            words = bigger;
+            cap *= 2;
+        }
+        words[n++] = w;
+    }
+    *count = n;
+    return words;
+}
+
+// Commands of the fixed arguments (fixed_len bytes) plus up to per_cmd
+// words each (0: as many as fit). Prints why on failure.
+static xargs_run_t *plan_runs(const char *name, size_t fixed_len, char **words,
+                              int nwords, int per_cmd, int *count)
+{
+    // At most one command per word
+    xargs_run_t *runs = calloc(nwords ? nwords : 1, sizeof(xargs_run_t));
+    if (!runs) {
+        printf("%s: out of memory\n", name);
+        return NULL;
+    }
+
+    int n = 0;
+    size_t len = 0;
+    for (int i = 0; i < nwords; i++) {
+        size_t wlen = strlen(words[i]) + 1;
+        if (fixed_len + wlen > XARGS_MAX_BYTES) {
+            printf("%s: argument too long: %.32s...\n", name, words[i]);
+            free(runs);
+            return NULL;
+        }
+        xargs_run_t *r = n > 0 ? &runs[n - 1] : NULL;
+        if (!r || (per_cmd > 0 && r->nwords >= per_cmd) || len + wlen > XARGS_MAX_BYTES) {
+            r = &runs[n++];
+            r->words = &words[i];
+            len = fixed_len;
+        }
+        r->nwords++;
+        len += wlen;
+    }
+    *count = n;
+    return runs;
+}
+
+// ============ Command ============
+
+static int usage(const char *name)
+{
+    printf("Usage: %s [-P N]%s [-a file] <cmd> [args...]\n", name,
+           strcmp(name, "parallel") == 0 ? "" : " [-n N]");
+    return 1;
+}
+
+int cmd_xargs(int argc, char **argv)
+{
+    bool parallel = strcmp(argv[0], "parallel") == 0;
+    int jobs = parallel ? 0 : 1;
+    int per_cmd = parallel ? 1 : 0;
+    const char *file = NULL;
+
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        if (i + 1 >= argc) return usage(argv[0]);
+        if (strcmp(argv[i], "-P") == 0) {
+            jobs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-n") == 0 && !parallel) {
+            per_cmd = atoi(argv[++i]);
+            if (per_cmd <= 0) return usage(argv[0]);
+        } else if (strcmp(argv[i], "-a") == 0) {
+            file = argv[++i];
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (i >= argc) return usage(argv[0]);
+    if (jobs <= 0) jobs = portNUM_PROCESSORS;
+    if (jobs > XARGS_MAX_JOBS) jobs = XARGS_MAX_JOBS;
+
+    // No file: read stdin when it is a pipe or redirect
+    FILE *f = stdin;
+    if (file) {
+        char path[BREEZYBOX_MAX_PATH * 2 + 2];
+        if (!breezybox_resolve_path(file, path, sizeof(path)) || !(f = fopen(path, "r"))) {
+            printf("%s: %s: No such file\n", argv[0], file);
+            return 1;
+        }
+    } else if (isatty(fileno(stdin))) {
+        return usage(argv[0]);
+    }
+
+    char *text = read_all(f);
+    if (file) fclose(f);
+
+    // The command and its fixed arguments
+    int nfixed = argc - i;
+    char **fixed = argv + i;
+    size_t fixed_len = 0;
+    for (int j = 0; j < nfixed; j++) fixed_len += strlen(fixed[j]) + 1;
+    if (fixed_len > XARGS_MAX_BYTES) {
+        printf("%s: command too long\n", argv[0]);
+        free(text);
+        return 1;
+    }
+
+    int nwords = 0;
+    char **words = text ? split_words(text, &nwords) : NULL;
+    if (!words) {
+        printf("%s: out of memory\n", argv[0]);
+        free(text);
+        return 1;
+    }
+    int count = 0;
+    xargs_run_t *runs = plan_runs(argv[0], fixed_len, words, nwords, per_cmd, &count);
+    if (!runs) {
+        free(words);
+        free(text);
+        return 1;
+    }
+
+    // Keep up to `jobs` commands running; copy out the oldest's output
+    int status = 0;
+    int next = 0;
+    char buf[256];
+    for (int k = 0; k < count; k++) {
+        for (; next < count && next < k + jobs; next++) {
+            runs[next].done = xSemaphoreCreateBinary();
+            if (!runs[next].done) {
+                runs[next].ret = -1;
+                continue;
+            }
+            start_run(&runs[next], nfixed, fixed, fixed_len);
+        }
+
+        xargs_run_t *r = &runs[k];
+        if (r->rd) {
+            size_t n;
+            while ((n = fread(buf, 1, sizeof(buf), r->rd)) > 0) {
+                fwrite(buf, 1, n, stdout);
+            }
+            fclose(r->rd);
+        }
+        if (r->done) {
+            xSemaphoreTake(r->done, portMAX_DELAY);
+            vSemaphoreDelete(r->done);
+        }
+        if (r->ret != 0) status = XARGS_FAILED;
+        free(r->argv);
+    }
+    fflush(stdout);
+
+    free(runs);
+    free(words);
+    free(text);
+    return status;
+}
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * BreezyBox app ABI: a versioned table of firmware entry points.
+ *
+ * Apps normally import every firmware function by name, and the ELF loader
+ * looks each one up when the app is loaded. Apps built with this header
+ * (buildelf.sh passes -DBREEZY_APP) instead call the functions listed in
+ * breezy_abi_slots.h through fixed slots of one table. The app then imports
+ * a single symbol, breezy_abi_v<MAJOR>_<LEVEL>, which the loader resolves to
+ * the table as long as the firmware has at least LEVEL slots. Functions not
+ * in the table still bind by name, and apps built without this header
+ * keep working unchanged.
+ *
+ * Usage in an app: include it after the system headers.
+ *
+ *     #include <stdio.h>
+ *     #include "breezy_abi.h"
+ *
+ * Slot calls are function-like macros, so they only apply to calls;
+ * taking a function's address (&printf) still binds by name.
+ */
+
+#define BREEZY_ABI_MAGIC    0x49424142  // "BABI"
+#define BREEZY_ABI_MAJOR    1
+#define BREEZY_ABI_LEVEL    105         // Number of slots; bump when appending
+
+typedef struct {
+    uint32_t magic;
+    uint16_t major;
+    uint16_t count;             // Slots in this firmware, >= app's level
+    const void *fn[];
+} breezy_abi_t;
+
+enum {
+#define BREEZY_ABI_SLOT(name) BREEZY_ABI_SLOT_##name,
+#define BREEZY_ABI_OPT(name) BREEZY_ABI_SLOT_##name,
+#include "breezy_abi_slots.h"
+#undef BREEZY_ABI_SLOT
+#undef BREEZY_ABI_OPT
+    BREEZY_ABI_COUNT
+};
+
+#ifndef BREEZY_APP
+
+/**
+ * @brief Resolve an ABI table import (breezy_abi_v<MAJOR>_<LEVEL>)
+ * @return The table, or NULL if name is not an ABI import or the app needs
+ *         a newer or different ABI than this firmware has
+ */
+const breezy_abi_t *breezy_abi_find(const char *name);
+
+#else // BREEZY_APP
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <time.h>
+#include <math.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+// Firmware functions with no system header
+#define MALLOC_CAP_EXEC     (1 << 0)
+#define MALLOC_CAP_32BIT    (1 << 1)
+#define MALLOC_CAP_8BIT     (1 << 2)
+#define MALLOC_CAP_DMA      (1 << 3)
+#define MALLOC_CAP_SPIRAM   (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_DEFAULT  (1 << 12)
+
+void *heap_caps_malloc(size_t size, uint32_t caps);
+void heap_caps_free(void *ptr);
+size_t heap_caps_get_free_size(uint32_t caps);
+void vTaskDelay(uint32_t ticks);
+uint32_t xTaskGetTickCount(void);
+
+uint32_t elf_get_cycle_count(void);
+int breezy_http_download(const char *url, const char *dest_path);
+void vterm_get_size(int *rows, int *cols);
+void vterm_set_palette(const uint16_t palette[16]);
+const uint16_t *vterm_get_palette(void);
+
+#define SM_TEXT     3
+#define SM_VGA13H   0x13
+#define SM_150P     0x80
+
+uint8_t *rgb_display_get_framebuffer(void);
+int rgb_display_set_mode(int mode);
+int rgb_display_get_fb_width(void);
+int rgb_display_get_fb_height(void);
+void rgb_display_set_vga_palette(const uint16_t palette[256]);
+void rgb_display_wait_vsync(void);
+void rgb_gfx_clear(uint8_t color);
+void rgb_gfx_pixel(int x, int y, uint8_t color);
+void rgb_gfx_rectfill(int x, int y, int w, int h, uint8_t color);
+void rgb_gfx_blit(const uint8_t *data, int x, int y, int w, int h,
+                  int src_stride, int transparent_color);
+void rgb_gfx_blit_flip(const uint8_t *data, int x, int y, int w, int h,
+                       int src_stride, int transparent_color,
+                       bool flip_x, bool flip_y);
+
+#define BREEZY_ABI_STR_(x) #x
+#define BREEZY_ABI_STR(x) BREEZY_ABI_STR_(x)
+
+extern const breezy_abi_t breezy_abi_table
+    __asm__("breezy_abi_v" BREEZY_ABI_STR(BREEZY_ABI_MAJOR) "_" BREEZY_ABI_STR(BREEZY_ABI_LEVEL));
+
+#define BREEZY_ABI_FN(name) (*(__typeof__(&name))breezy_abi_table.fn[BREEZY_ABI_SLOT_##name])
+
+// True if an optional slot is present in this firmware
+#define breezy_abi_has(name) (breezy_abi_table.fn[BREEZY_ABI_SLOT_##name] != NULL)
+
+#define printf(...) BREEZY_ABI_FN(printf)(__VA_ARGS__)
+#define fprintf(...) BREEZY_ABI_FN(fprintf)(__VA_ARGS__)
+#define sprintf(...) BREEZY_ABI_FN(sprintf)(__VA_ARGS__)
+#define snprintf(...) BREEZY_ABI_FN(snprintf)(__VA_ARGS__)
+#define vprintf(...) BREEZY_ABI_FN(vprintf)(__VA_ARGS__)
+#define vfprintf(...) BREEZY_ABI_FN(vfprintf)(__VA_ARGS__)
+#define vsnprintf(...) BREEZY_ABI_FN(vsnprintf)(__VA_ARGS__)
+#define puts(...) BREEZY_ABI_FN(puts)(__VA_ARGS__)
+#define fputs(...) BREEZY_ABI_FN(fputs)(__VA_ARGS__)
+#define fputc(...) BREEZY_ABI_FN(fputc)(__VA_ARGS__)
+#define fgets(...) BREEZY_ABI_FN(fgets)(__VA_ARGS__)
+#define fgetc(...) BREEZY_ABI_FN(fgetc)(__VA_ARGS__)
+#define fopen(...) BREEZY_ABI_FN(fopen)(__VA_ARGS__)
+#define fdopen(...) BREEZY_ABI_FN(fdopen)(__VA_ARGS__)
+#define freopen(...) BREEZY_ABI_FN(freopen)(__VA_ARGS__)
+#define fclose(...) BREEZY_ABI_FN(fclose)(__VA_ARGS__)
+#define fread(...) BREEZY_ABI_FN(fread)(__VA_ARGS__)
+#define fwrite(...) BREEZY_ABI_FN(fwrite)(__VA_ARGS__)
+#define fflush(...) BREEZY_ABI_FN(fflush)(__VA_ARGS__)
+#define fseek(...) BREEZY_ABI_FN(fseek)(__VA_ARGS__)
+#define ftell(...) BREEZY_ABI_FN(ftell)(__VA_ARGS__)
+#define rewind(...) BREEZY_ABI_FN(rewind)(__VA_ARGS__)
+#define sscanf(...) BREEZY_ABI_FN(sscanf)(__VA_ARGS__)
+#define perror(...) BREEZY_ABI_FN(perror)(__VA_ARGS__)
+#define remove(...) BREEZY_ABI_FN(remove)(__VA_ARGS__)
+#define rename(...) BREEZY_ABI_FN(rename)(__VA_ARGS__)
+#define malloc(...) BREEZY_ABI_FN(malloc)(__VA_ARGS__)
+#define calloc(...) BREEZY_ABI_FN(calloc)(__VA_ARGS__)
+#define realloc(...) BREEZY_ABI_FN(realloc)(__VA_ARGS__)
+#define free(...) BREEZY_ABI_FN(free)(__VA_ARGS__)
+#define atoi(...) BREEZY_ABI_FN(atoi)(__VA_ARGS__)
+#define atol(...) BREEZY_ABI_FN(atol)(__VA_ARGS__)
+#define strtol(...) BREEZY_ABI_FN(strtol)(__VA_ARGS__)
+#define strtoul(...) BREEZY_ABI_FN(strtoul)(__VA_ARGS__)
+#define strtod(...) BREEZY_ABI_FN(strtod)(__VA_ARGS__)
+#define qsort(...) BREEZY_ABI_FN(qsort)(__VA_ARGS__)
+#define bsearch(...) BREEZY_ABI_FN(bsearch)(__VA_ARGS__)
+#define rand(...) BREEZY_ABI_FN(rand)(__VA_ARGS__)
+#define srand(...) BREEZY_ABI_FN(srand)(__VA_ARGS__)
+#define getenv(...) BREEZY_ABI_FN(getenv)(__VA_ARGS__)
+#define atexit(...) BREEZY_ABI_FN(atexit)(__VA_ARGS__)
+#define strcmp(...) BREEZY_ABI_FN(strcmp)(__VA_ARGS__)
+#define strncmp(...) BREEZY_ABI_FN(strncmp)(__VA_ARGS__)
+#define strncpy(...) BREEZY_ABI_FN(strncpy)(__VA_ARGS__)
+#define strcat(...) BREEZY_ABI_FN(strcat)(__VA_ARGS__)
+#define strncat(...) BREEZY_ABI_FN(strncat)(__VA_ARGS__)
+#define strchr(...) BREEZY_ABI_FN(strchr)(__VA_ARGS__)
+#define strrchr(...) BREEZY_ABI_FN(strrchr)(__VA_ARGS__)
+#define strstr(...) BREEZY_ABI_FN(strstr)(__VA_ARGS__)
+#define strdup(...) BREEZY_ABI_FN(strdup)(__VA_ARGS__)
+#define strtok(...) BREEZY_ABI_FN(strtok)(__VA_ARGS__)
+#define stpcpy(...) BREEZY_ABI_FN(stpcpy)(__VA_ARGS__)
+#define strerror(...) BREEZY_ABI_FN(strerror)(__VA_ARGS__)
+#define open(...) BREEZY_ABI_FN(open)(__VA_ARGS__)
+#define read(...) BREEZY_ABI_FN(read)(__VA_ARGS__)
+#define write(...) BREEZY_ABI_FN(write)(__VA_ARGS__)
+#define close(...) BREEZY_ABI_FN(close)(__VA_ARGS__)
+#define lseek(...) BREEZY_ABI_FN(lseek)(__VA_ARGS__)
+#define fcntl(...) BREEZY_ABI_FN(fcntl)(__VA_ARGS__)
+#define isatty(...) BREEZY_ABI_FN(isatty)(__VA_ARGS__)
+#define usleep(...) BREEZY_ABI_FN(usleep)(__VA_ARGS__)
+#define sleep(...) BREEZY_ABI_FN(sleep)(__VA_ARGS__)
+#define unlink(...) BREEZY_ABI_FN(unlink)(__VA_ARGS__)
+#define getcwd(...) BREEZY_ABI_FN(getcwd)(__VA_ARGS__)
+#define chdir(...) BREEZY_ABI_FN(chdir)(__VA_ARGS__)
+#define rmdir(...) BREEZY_ABI_FN(rmdir)(__VA_ARGS__)
+#define mkdir(...) BREEZY_ABI_FN(mkdir)(__VA_ARGS__)
+#define stat(...) BREEZY_ABI_FN(stat)(__VA_ARGS__)
+#define opendir(...) BREEZY_ABI_FN(opendir)(__VA_ARGS__)
+#define readdir(...) BREEZY_ABI_FN(readdir)(__VA_ARGS__)
+#define closedir(...) BREEZY_ABI_FN(closedir)(__VA_ARGS__)
+#define rewinddir(...) BREEZY_ABI_FN(rewinddir)(__VA_ARGS__)
+#define time(...) BREEZY_ABI_FN(time)(__VA_ARGS__)
+#define clock(...) BREEZY_ABI_FN(clock)(__VA_ARGS__)
+#define localtime(...) BREEZY_ABI_FN(localtime)(__VA_ARGS__)
+#define gettimeofday(...) BREEZY_ABI_FN(gettimeofday)(__VA_ARGS__)
+#define sin(...) BREEZY_ABI_FN(sin)(__VA_ARGS__)
+#define cos(...) BREEZY_ABI_FN(cos)(__VA_ARGS__)
+#define sinf(...) BREEZY_ABI_FN(sinf)(__VA_ARGS__)
+#define cosf(...) BREEZY_ABI_FN(cosf)(__VA_ARGS__)
+#define ldexp(...) BREEZY_ABI_FN(ldexp)(__VA_ARGS__)
+#define roundf(...) BREEZY_ABI_FN(roundf)(__VA_ARGS__)
+#define floorf(...) BREEZY_ABI_FN(floorf)(__VA_ARGS__)
+#define fmodf(...) BREEZY_ABI_FN(fmodf)(__VA_ARGS__)
+#define heap_caps_malloc(...) BREEZY_ABI_FN(heap_caps_malloc)(__VA_ARGS__)
+#define heap_caps_free(...) BREEZY_ABI_FN(heap_caps_free)(__VA_ARGS__)
+#define heap_caps_get_free_size(...) BREEZY_ABI_FN(heap_caps_get_free_size)(__VA_ARGS__)
+#define vTaskDelay(...) BREEZY_ABI_FN(vTaskDelay)(__VA_ARGS__)
+#define xTaskGetTickCount(...) BREEZY_ABI_FN(xTaskGetTickCount)(__VA_ARGS__)
+#define elf_get_cycle_count(...) BREEZY_ABI_FN(elf_get_cycle_count)(__VA_ARGS__)
+#define breezy_http_download(...) BREEZY_ABI_FN(breezy_http_download)(__VA_ARGS__)
+#define vterm_get_size(...) BREEZY_ABI_FN(vterm_get_size)(__VA_ARGS__)
+#define vterm_set_palette(...) BREEZY_ABI_FN(vterm_set_palette)(__VA_ARGS__)
+#define vterm_get_palette(...) BREEZY_ABI_FN(vterm_get_palette)(__VA_ARGS__)
+#define rgb_display_get_framebuffer(...) BREEZY_ABI_FN(rgb_display_get_framebuffer)(__VA_ARGS__)
+#define rgb_display_set_mode(...) BREEZY_ABI_FN(rgb_display_set_mode)(__VA_ARGS__)
+#define rgb_display_get_fb_width(...) BREEZY_ABI_FN(rgb_display_get_fb_width)(__VA_ARGS__)
+#define rgb_display_get_fb_height(...) BREEZY_ABI_FN(rgb_display_get_fb_height)(__VA_ARGS__)
+#define rgb_display_set_vga_palette(...) BREEZY_ABI_FN(rgb_display_set_vga_palette)(__VA_ARGS__)
+#define rgb_display_wait_vsync(...) BREEZY_ABI_FN(rgb_display_wait_vsync)(__VA_ARGS__)
+#define rgb_gfx_clear(...) BREEZY_ABI_FN(rgb_gfx_clear)(__VA_ARGS__)
+#define rgb_gfx_pixel(...) BREEZY_ABI_FN(rgb_gfx_pixel)(__VA_ARGS__)
+#define rgb_gfx_rectfill(...) BREEZY_ABI_FN(rgb_gfx_rectfill)(__VA_ARGS__)
+#define rgb_gfx_blit(...) BREEZY_ABI_FN(rgb_gfx_blit)(__VA_ARGS__)
+#define rgb_gfx_blit_flip(...) BREEZY_ABI_FN(rgb_gfx_blit_flip)(__VA_ARGS__)
+
+#endif // BREEZY_APP
@@ -0,0 +1,144 @@
+/*
+ * breezy_abi_slots.h - Slot list of the BreezyBox app ABI (see breezy_abi.h)
+ *
+ * No include guard: included with BREEZY_ABI_SLOT / BREEZY_ABI_OPT defined
+ * to generate the enum, the firmware table, and so on.
+ *
+ * APPEND ONLY. A slot's index is baked into every app built against it.
+ * Add new entries at the end and bump BREEZY_ABI_LEVEL in breezy_abi.h.
+ * Removing or reordering slots needs a new BREEZY_ABI_MAJOR.
+ *
+ * Left out on purpose: functions newlib defines as macros (getc, putc,
+ * getchar, putchar, feof, ferror, fileno), and ones the compiler usually
+ * inlines (memcpy, memset, memmove, memcmp, strlen, strcpy, sqrtf, fabsf).
+ * Those still bind by name.
+ *
+ * BREEZY_ABI_OPT slots belong to components a firmware may not link
+ * (breezy_rgb_lcd); they are NULL there.
+ *
+ * The malloc/calloc/realloc/free slots hold the per-app arena versions
+ * (breezy_arena.h), not libc's.
+ */
+
+// stdio.h
+BREEZY_ABI_SLOT(printf)
+BREEZY_ABI_SLOT(fprintf)
+BREEZY_ABI_SLOT(sprintf)
+BREEZY_ABI_SLOT(snprintf)
+BREEZY_ABI_SLOT(vprintf)
+BREEZY_ABI_SLOT(vfprintf)
+BREEZY_ABI_SLOT(vsnprintf)
+BREEZY_ABI_SLOT(puts)
+BREEZY_ABI_SLOT(fputs)
+BREEZY_ABI_SLOT(fputc)
+BREEZY_ABI_SLOT(fgets)
+BREEZY_ABI_SLOT(fgetc)
+BREEZY_ABI_SLOT(fopen)
+BREEZY_ABI_SLOT(fdopen)
+BREEZY_ABI_SLOT(freopen)
+BREEZY_ABI_SLOT(fclose)
+BREEZY_ABI_SLOT(fread)
+BREEZY_ABI_SLOT(fwrite)
+BREEZY_ABI_SLOT(fflush)
+BREEZY_ABI_SLOT(fseek)
+BREEZY_ABI_SLOT(ftell)
+BREEZY_ABI_SLOT(rewind)
+BREEZY_ABI_SLOT(sscanf)
+BREEZY_ABI_SLOT(perror)
+BREEZY_ABI_SLOT(remove)
+BREEZY_ABI_SLOT(rename)
+
+// stdlib.h
+BREEZY_ABI_SLOT(malloc)
+BREEZY_ABI_SLOT(calloc)
+BREEZY_ABI_SLOT(realloc)
+BREEZY_ABI_SLOT(free)
+BREEZY_ABI_SLOT(atoi)
+BREEZY_ABI_SLOT(atol)
+BREEZY_ABI_SLOT(strtol)
+BREEZY_ABI_SLOT(strtoul)
+BREEZY_ABI_SLOT(strtod)
+BREEZY_ABI_SLOT(qsort)
+BREEZY_ABI_SLOT(bsearch)
+BREEZY_ABI_SLOT(rand)
+BREEZY_ABI_SLOT(srand)
+BREEZY_ABI_SLOT(getenv)
+BREEZY_ABI_SLOT(atexit)
+
+// string.h
+BREEZY_ABI_SLOT(strcmp)
+BREEZY_ABI_SLOT(strncmp)
+BREEZY_ABI_SLOT(strncpy)
+BREEZY_ABI_SLOT(strcat)
+BREEZY_ABI_SLOT(strncat)
+BREEZY_ABI_SLOT(strchr)
+BREEZY_ABI_SLOT(strrchr)
+BREEZY_ABI_SLOT(strstr)
+BREEZY_ABI_SLOT(strdup)
+BREEZY_ABI_SLOT(strtok)
+BREEZY_ABI_SLOT(stpcpy)
+BREEZY_ABI_SLOT(strerror)
+
+// unistd.h, fcntl.h, dirent.h, sys/stat.h
+BREEZY_ABI_SLOT(open)
+BREEZY_ABI_SLOT(read)
+BREEZY_ABI_SLOT(write)
+BREEZY_ABI_SLOT(close)
+BREEZY_ABI_SLOT(lseek)
+BREEZY_ABI_SLOT(fcntl)
+BREEZY_ABI_SLOT(isatty)
+BREEZY_ABI_SLOT(usleep)
+BREEZY_ABI_SLOT(sleep)
+BREEZY_ABI_SLOT(unlink)
+BREEZY_ABI_SLOT(getcwd)
+BREEZY_ABI_SLOT(chdir)
+BREEZY_ABI_SLOT(rmdir)
+BREEZY_ABI_SLOT(mkdir)
+BREEZY_ABI_SLOT(stat)
+BREEZY_ABI_SLOT(opendir)
+BREEZY_ABI_SLOT(readdir)
+BREEZY_ABI_SLOT(closedir)
+BREEZY_ABI_SLOT(rewinddir)
+
+// time.h, sys/time.h
+BREEZY_ABI_SLOT(time)
+BREEZY_ABI_SLOT(clock)
+BREEZY_ABI_SLOT(localtime)
+BREEZY_ABI_SLOT(gettimeofday)
+
+// math.h
+BREEZY_ABI_SLOT(sin)
+BREEZY_ABI_SLOT(cos)
+BREEZY_ABI_SLOT(sinf)
+BREEZY_ABI_SLOT(cosf)
+BREEZY_ABI_SLOT(ldexp)
+BREEZY_ABI_SLOT(roundf)
+BREEZY_ABI_SLOT(floorf)
+BREEZY_ABI_SLOT(fmodf)
+
+// ESP-IDF
+BREEZY_ABI_SLOT(heap_caps_malloc)
+BREEZY_ABI_SLOT(heap_caps_free)
+BREEZY_ABI_SLOT(heap_caps_get_free_size)
+BREEZY_ABI_SLOT(vTaskDelay)
+BREEZY_ABI_SLOT(xTaskGetTickCount)
+
+// BreezyBox
+BREEZY_ABI_SLOT(elf_get_cycle_count)
+BREEZY_ABI_SLOT(breezy_http_download)
+BREEZY_ABI_SLOT(vterm_get_size)
+BREEZY_ABI_SLOT(vterm_set_palette)
+BREEZY_ABI_SLOT(vterm_get_palette)
+
+// breezy_rgb_lcd (optional)
+BREEZY_ABI_OPT(rgb_display_get_framebuffer)
+BREEZY_ABI_OPT(rgb_display_set_mode)
+BREEZY_ABI_OPT(rgb_display_get_fb_width)
+BREEZY_ABI_OPT(rgb_display_get_fb_height)
+BREEZY_ABI_OPT(rgb_display_set_vga_palette)
+BREEZY_ABI_OPT(rgb_display_wait_vsync)
+BREEZY_ABI_OPT(rgb_gfx_clear)
+BREEZY_ABI_OPT(rgb_gfx_pixel)
+BREEZY_ABI_OPT(rgb_gfx_rectfill)
+BREEZY_ABI_OPT(rgb_gfx_blit)
+BREEZY_ABI_OPT(rgb_gfx_blit_flip)
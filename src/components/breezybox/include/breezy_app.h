@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Loader hints an app can embed in its ELF file.
+ *
+ * Hints are stored in an ELF note section (.note.breezybox), which strip
+ * keeps. The loader reads them without running the app, and ignores notes
+ * it does not know.
+ *
+ *     #include "breezy_app.h"
+ *
+ *     BREEZY_APP_STACK(16384);     // Run main() on a 16 KB stack
+ *     BREEZY_APP_PLACE(BREEZY_PLACE_TEXT | BREEZY_PLACE_DATA);
+ *
+ * BREEZY_APP_PLACE asks for the app's code and/or data (.data, .rodata and
+ * .bss) to be loaded into internal RAM instead of PSRAM, for CPU-bound apps
+ * that would otherwise run out of cache misses. The loader falls back to
+ * PSRAM when internal RAM is short (CONFIG_BREEZYBOX_ELF_PLACE_RESERVE_KB)
+ * and, on Xtensa targets, always keeps code where elf_loader puts it.
+ */
+
+#define BREEZY_NOTE_SECTION ".note.breezybox"
+#define BREEZY_NOTE_NAME    "Breezy"
+#define BREEZY_NOTE_STACK   1           // desc: uint32_t stack size in bytes
+#define BREEZY_NOTE_PLACE   2           // desc: uint32_t BREEZY_PLACE_* flags
+
+#define BREEZY_PLACE_TEXT   (1 << 0)    // Code in internal RAM
+#define BREEZY_PLACE_DATA   (1 << 1)    // Data, rodata and bss in internal RAM
+
+typedef struct {
+    uint32_t namesz;
+    uint32_t descsz;
+    uint32_t type;
+    char name[8];                       // BREEZY_NOTE_NAME, NUL-padded to 4
+    uint32_t desc;
+} breezy_app_note_t;
+
+#define BREEZY_APP_STACK(bytes)                                              \
+    __attribute__((section(BREEZY_NOTE_SECTION), used, aligned(4)))         \
+    static const breezy_app_note_t breezy_app_stack_note = {                \
+        sizeof(BREEZY_NOTE_NAME), sizeof(uint32_t), BREEZY_NOTE_STACK,      \
+        BREEZY_NOTE_NAME, (bytes)                                           \
+    }
+
+#define BREEZY_APP_PLACE(flags)                                              \
+    __attribute__((section(BREEZY_NOTE_SECTION), used, aligned(4)))         \
+    static const breezy_app_note_t breezy_app_place_note = {                \
+        sizeof(BREEZY_NOTE_NAME), sizeof(uint32_t), BREEZY_NOTE_PLACE,      \
+        BREEZY_NOTE_NAME, (flags)                                           \
+    }
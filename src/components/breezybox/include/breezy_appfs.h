@@ -0,0 +1,103 @@
+#pragma once
+
+#include "esp_err.h"
+#include "esp_partition.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * App store: ELF binaries kept in a raw "apps" flash partition instead of
+ * LittleFS. Programs in the store are loaded straight from memory-mapped
+ * flash, so no RAM copy of the file is needed and no filesystem is read.
+ *
+ * Add a partition like this to enable it:
+ *   apps,     data, 0x40,    ,        2M,
+ *
+ * Installed programs show up to the shell as BREEZY_APPFS_PREFIX "<name>".
+ */
+
+#define BREEZY_APPFS_PREFIX     "/apps/"
+#define BREEZY_APPFS_NAME_LEN   24
+
+typedef struct breezy_appfs_writer breezy_appfs_writer_t;
+
+typedef struct {
+    char name[BREEZY_APPFS_NAME_LEN];
+    size_t size;
+} breezy_appfs_info_t;
+
+/**
+ * @brief Find the "apps" partition and load its index
+ * @return ESP_OK, or ESP_ERR_NOT_FOUND if the firmware has no such partition
+ */
+esp_err_t breezy_appfs_init(void);
+
+/**
+ * @brief True if the app store is present and initialized
+ */
+bool breezy_appfs_available(void);
+
+/**
+ * @brief Program name for a BREEZY_APPFS_PREFIX path, NULL for other paths
+ */
+const char *breezy_appfs_name(const char *path);
+
+/**
+ * @brief Look up an installed program
+ * @param size  Out (optional): image size in bytes
+ * @param gen   Out (optional): install generation, changes on every reinstall
+ * @return 0 if installed, -1 if not
+ */
+int breezy_appfs_stat(const char *name, size_t *size, uint32_t *gen);
+
+/**
+ * @brief Map an installed program's image into the address space (read-only)
+ * @return Pointer to the image, or NULL. Release with breezy_appfs_munmap().
+ */
+const void *breezy_appfs_mmap(const char *name, size_t *size,
+                              esp_partition_mmap_handle_t *handle);
+
+void breezy_appfs_munmap(esp_partition_mmap_handle_t handle);
+
+/**
+ * @brief List installed programs
+ * @return Number of entries written to out (at most max)
+ */
+size_t breezy_appfs_list(breezy_appfs_info_t *out, size_t max);
+
+/**
+ * @brief Bytes used by installed images, and the partition size
+ */
+void breezy_appfs_usage(size_t *used, size_t *total);
+
+/**
+ * @brief Remove an installed program
+ * @return 0 on success, -1 if not installed
+ */
+int breezy_appfs_remove(const char *name);
+
+/**
+ * @brief Start installing a program (replaces any program of that name
+ *        once committed). Only one install can be in progress at a time.
+ * @return Writer handle, or NULL (no store, busy, bad name)
+ */
+breezy_appfs_writer_t *breezy_appfs_begin(const char *name);
+
+/**
+ * @brief Append image bytes
+ * @return 0 on success, -1 on flash error or store full
+ */
+int breezy_appfs_write(breezy_appfs_writer_t *w, const void *data, size_t len);
+
+/**
+ * @brief Finish the install and make it visible. Rejects non-ELF images.
+ *        Frees the writer in all cases.
+ * @return 0 on success, -1 on failure
+ */
+int breezy_appfs_commit(breezy_appfs_writer_t *w);
+
+/**
+ * @brief Cancel an install and free the writer
+ */
+void breezy_appfs_abort(breezy_appfs_writer_t *w);
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Per-app heap arenas.
+ *
+ * Each ELF run gets an arena that serves the app's malloc/calloc/realloc/
+ * free. Memory comes from a few large chunks (PSRAM or internal RAM, per
+ * CONFIG_BREEZYBOX_ELF_ARENA_*) carved into size classes, and the whole
+ * arena is released when the app returns, leaks included.
+ *
+ * The app's allocator imports are bound to breezy_arena_malloc() etc. at
+ * load time. Those find the arena attached to the calling task, and fall
+ * back to the global heap when there is none, so they are safe to call
+ * from anywhere.
+ *
+ * Ownership: breezy_arena_free() and breezy_arena_realloc() take arena
+ * blocks and system heap blocks alike. A pointer goes to an arena only if
+ * it lies in that arena's memory; anything else goes to free()/realloc().
+ * Firmware code calls the system allocator directly, so arena memory must
+ * not be handed to a firmware function that frees or grows its caller's
+ * buffer (newlib's getline(), for one): pass it NULL and let it allocate.
+ */
+
+typedef struct breezy_arena breezy_arena_t;
+
+typedef struct {
+    size_t peak;        // Most bytes allocated at once
+    size_t in_use;      // Bytes still allocated (leaked) at teardown
+    size_t reserved;    // Most bytes reserved from the system heap
+    size_t bytes;       // Bytes allocated over the arena's lifetime
+    uint32_t allocs;    // Number of allocations
+} breezy_arena_stats_t;
+
+/**
+ * @brief Create an empty arena and attach it to the calling task
+ * @return Arena, or NULL if arenas are disabled or out of memory
+ */
+breezy_arena_t *breezy_arena_begin(void);
+
+/**
+ * @brief Detach the arena from its task and free all of its memory
+ * @param stats  Out (optional): usage over the arena's lifetime
+ */
+void breezy_arena_end(breezy_arena_t *arena, breezy_arena_stats_t *stats);
+
+/**
+ * @brief Arena-aware replacement for an allocator symbol an app imports
+ * @return Replacement address for malloc/calloc/realloc/free, else NULL
+ */
+void *breezy_arena_symbol(const char *name);
+
+void *breezy_arena_malloc(size_t size);
+void *breezy_arena_calloc(size_t n, size_t size);
+void *breezy_arena_realloc(void *ptr, size_t size);
+void breezy_arena_free(void *ptr);
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Block cache for the LittleFS partition.
+ *
+ * Sits between LittleFS and the flash (it wraps esp_partition_read, _write
+ * and _erase_range for one partition) and keeps whole 4 KB sectors in
+ * PSRAM. Sequential reads pull in several sectors per flash access. Writes
+ * land in the cached sectors and reach the flash later, in their original
+ * order, from a background task: after CONFIG_BREEZYBOX_FS_CACHE_FLUSH_MS,
+ * when CONFIG_BREEZYBOX_FS_CACHE_DIRTY_KB is dirty, before an erase, on
+ * fsync(), on breezy_bcache_sync() and before a restart.
+ *
+ * Because the order is kept, a power cut loses at most the last unflushed
+ * writes; LittleFS sees the same state as after a cut a moment earlier.
+ */
+
+#define BREEZY_BCACHE_SECTOR 4096
+
+typedef struct {
+    bool enabled;
+    uint32_t sectors;       // Cache size
+    uint32_t dirty;         // Sectors with unflushed writes
+    uint32_t hits;          // Sector reads served from the cache
+    uint32_t misses;        // Sector reads that went to the flash
+    uint32_t readahead;     // Sectors read ahead of a sequential reader
+    uint32_t writes;        // Write calls from LittleFS
+    uint32_t flushes;       // Times the dirty data was written out
+    uint32_t flash_writes;  // Flash write calls made by flushes
+    uint64_t flushed_bytes;
+    uint32_t erases;
+    uint32_t errors;        // Failed flash writes
+} breezy_bcache_stats_t;
+
+/**
+ * @brief Start caching the partition with this label (before mounting it)
+ * @return ESP_OK, ESP_ERR_NOT_FOUND or ESP_ERR_NO_MEM
+ */
+esp_err_t breezy_bcache_init(const char *label);
+
+/**
+ * @brief Write all dirty data to the flash now
+ * @return ESP_OK, or ESP_FAIL if a flash write has failed since the last sync
+ */
+esp_err_t breezy_bcache_sync(void);
+
+/**
+ * @brief Counters since boot
+ */
+void breezy_bcache_stats(breezy_bcache_stats_t *stats);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "esp_console.h"
+#include "breezy_svc.h"
 
 // Command handlers - called by esp_console
 int cmd_echo(int argc, char **argv);
@@ -14,6 +15,7 @@ int cmd_mv(int argc, char **argv);
 int cmd_rm(int argc, char **argv);
 int cmd_df(int argc, char **argv);
 int cmd_du(int argc, char **argv);
+int cmd_find(int argc, char **argv);
 int cmd_date(int argc, char **argv);
 int cmd_eget(int argc, char **argv);
 int cmd_wifi(int argc, char **argv);
@@ -22,3 +24,20 @@ int cmd_head(int argc, char **argv);
 int cmd_tail(int argc, char **argv);
 int cmd_more(int argc, char **argv);
 int cmd_wc(int argc, char **argv);
+int cmd_hash(int argc, char **argv);
+int cmd_appfs(int argc, char **argv);
+int cmd_elfbench(int argc, char **argv);
+int cmd_fsbench(int argc, char **argv);
+int cmd_sync(int argc, char **argv);
+int cmd_time(int argc, char **argv);
+int cmd_jobs(int argc, char **argv);
+int cmd_fg(int argc, char **argv);
+int cmd_kill(int argc, char **argv);
+int cmd_boottime(int argc, char **argv);
+int cmd_svc(int argc, char **argv);
+int cmd_dmesg(int argc, char **argv);
+int cmd_xargs(int argc, char **argv);
+int cmd_test(int argc, char **argv);
+
+// Built-in services (breezy_svc.h)
+extern const breezy_svc_def_t httpd_service;
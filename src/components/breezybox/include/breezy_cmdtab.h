@@ -0,0 +1,39 @@
+#pragma once
+
+#include "esp_console.h"
+
+/**
+ * @brief Set up the external program cache (call once at startup)
+ */
+void breezy_cmdtab_init(void);
+
+/**
+ * @brief Look up a registered console command handler by name
+ *
+ * Every esp_console_cmd_register() call in the firmware is captured (via
+ * linker wrap), so this knows BreezyBox built-ins as well as commands the
+ * application registers itself. Commands registered only through a
+ * context-taking handler are not listed.
+ *
+ * @return Handler, or NULL if unknown
+ */
+esp_console_cmd_func_t breezy_cmdtab_find(const char *name);
+
+/**
+ * @brief Find the ELF program a command name refers to
+ *
+ * Same search as breezybox_find_executable(), limited to ELF files. For
+ * bare names the answer (found or not) is cached until invalidated.
+ *
+ * @return Newly allocated absolute path (caller frees), or NULL
+ */
+char *breezy_cmdtab_find_external(const char *name);
+
+/**
+ * @brief Forget cached lookups affected by a change to an absolute path
+ *
+ * Called by the filesystem wrappers after anything is created, written,
+ * renamed or removed, and with NULL (forget everything) when the CWD
+ * changes or the app store is modified.
+ */
+void breezy_cmdtab_invalidate(const char *path);
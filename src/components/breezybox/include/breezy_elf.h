@@ -0,0 +1,105 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "breezy_vfs.h"
+
+/**
+ * @brief Initialize the ELF runner (call once at startup)
+ */
+void breezy_elf_init(void);
+
+/**
+ * @brief Check whether a file starts with the ELF magic
+ * @return 1 if it does, 0 otherwise
+ */
+int breezy_elf_is_elf(const char *path);
+
+/**
+ * @brief Load (or reuse a cached image of) an ELF file and run it
+ *
+ * The program runs in a task of its own, with the caller's stdin/stdout
+ * and priority, and the caller waits for it to return. The stack size is
+ * taken from the app's BREEZY_APP_STACK note (breezy_app.h), else
+ * CONFIG_BREEZYBOX_ELF_STACK_SIZE. Runs inside a background job
+ * (breezy_jobs.h) go to CONFIG_BREEZYBOX_JOB_CORE.
+ *
+ * @param path  Absolute path to the ELF file
+ * @param argc  Argument count passed to the program's main()
+ * @param argv  Argument vector passed to the program's main()
+ * @return Program's return code, or negative on load error
+ */
+int breezy_elf_run(const char *path, int argc, char **argv);
+
+/**
+ * @brief Stop every program running on behalf of a background job
+ *
+ * Cooperative (breezy_stop.h): its stdin/stdout pipes are broken, and the
+ * program stops at its next stdio, file or sleep call, unwinding like a
+ * return: files it opened are closed, its heap arena is freed, and its
+ * waiting caller returns 137. One that only computes runs on until it
+ * makes such a call.
+ *
+ * @return Number of programs asked to stop
+ */
+int breezy_elf_kill_job(int job);
+
+/**
+ * @brief Load and relocate an ELF file, then unload it without running.
+ *        Bypasses the image cache; for load-time benchmarks.
+ * @return 0 on success, negative on load error
+ */
+int breezy_elf_load_test(const char *path);
+
+// ============ Image Cache ============
+
+/**
+ * @brief Snapshot of one image cache entry (see breezy_elf_cache_list)
+ */
+typedef struct {
+    char path[BREEZYBOX_MAX_PATH * 2];
+    size_t mem_size;    // Bytes charged against the cache budget
+    size_t heap_peak;   // Most heap a run has used (per-app arena)
+    uint32_t hits;      // Runs served from the cache
+    bool pinned;        // Never evicted
+    bool in_use;        // Running right now
+} breezy_elf_cache_info_t;
+
+/**
+ * @brief Copy out the cache entries, most recently used first
+ * @return Number of entries written to out (at most max)
+ */
+size_t breezy_elf_cache_list(breezy_elf_cache_info_t *out, size_t max);
+
+/**
+ * @brief Where one section of a loaded image landed
+ */
+typedef struct {
+    const char *name;   // ".text", ".data", ...
+    uintptr_t addr;
+    size_t size;
+    bool internal;      // In internal RAM, else PSRAM (or flash)
+} breezy_elf_sec_info_t;
+
+/**
+ * @brief Copy out the non-empty sections of a cached image
+ * @return Number written to out (at most max), or -1 if path is not cached
+ */
+int breezy_elf_cache_sections(const char *path, breezy_elf_sec_info_t *out, size_t max);
+
+/**
+ * @brief Bytes currently held by the cache, and its budget
+ */
+void breezy_elf_cache_usage(size_t *used, size_t *budget);
+
+/**
+ * @brief Pin or unpin an image. Pinning loads the image if not cached.
+ * @return 0 on success, -1 if the file can't be loaded or doesn't fit
+ */
+int breezy_elf_cache_pin(const char *path, bool pin);
+
+/**
+ * @brief Drop every cached image that is not running right now
+ */
+void breezy_elf_cache_flush(void);
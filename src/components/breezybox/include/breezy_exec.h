@@ -1,5 +1,10 @@
 #pragma once
 
+#include "breezy_parse.h"
+
+// Directory searched for programs by bare name
+#define BREEZYBOX_EXEC_PATH "/root/bin"
+
 /**
  * @brief Initialize the exec subsystem (call once at startup)
  */
@@ -8,13 +13,57 @@ void breezybox_exec_init(void);
 /**
  * @brief Execute a command with redirect support
  * 
+ * Each command name is looked up as a builtin first, then as an ELF
+ * program (see breezybox_find_executable()).
+ * 
  * Supports:
  *   cmd > file      Output redirect (overwrite)
  *   cmd >> file     Output redirect (append)
  *   cmd < file      Input redirect
- *   cmd1 | cmd2     Pipe (serialized via temp file)
+ *   cmd < in > out  Both at once
+ *   cmd1 | cmd2 | ...  Pipeline of any number of stages
+ *   cmd ... &       Run the line as a background job (breezy_jobs.h)
+ * 
+ * The line is tokenized in one pass into a fixed buffer on the stack, with
+ * quotes, backslash escapes and $VAR (see breezy_parse.h), so running a
+ * typical line allocates nothing for the parsing; bigger ones use the heap.
+ *
+ * With more than one stage, every stage runs in its own task, connected to
+ * its neighbours by bounded in-memory pipes. Redirects apply per stage and
+ * take precedence over the pipe on that side.
  * 
  * @param cmdline Command line to execute
- * @return Command return code, or -1 on redirect error
+ * @return Return code of the last stage, or -1 on syntax/redirect/pipe error.
+ *         A background job returns 0 once started.
+ */
+int breezybox_exec(const char *cmdline);
+
+/**
+ * @brief Run a line breezy_parse_line() has already tokenized
+ *
+ * As breezybox_exec(), for callers that expand words their own way
+ * (scripts). The words are used as they are, never parsed again.
+ *
+ * @return As breezybox_exec()
+ */
+int breezybox_exec_line(breezy_line_t *line);
+
+/**
+ * @brief Run one already-split command: builtin, then ELF program
+ *
+ * No redirects, pipes or quote handling; the caller's stdin/stdout are
+ * used as they are. For callers that tokenize once and run many times
+ * (scripts).
+ *
+ * @return The command's return code
+ */
+int breezybox_exec_argv(int argc, char **argv);
+
+/**
+ * @brief Find an executable by name: CWD, then /root/bin, then the app store
+ * 
+ * Names containing '/' are taken as a path (absolute or CWD-relative).
+ * 
+ * @return Newly allocated absolute path (caller frees), or NULL
  */
-int breezybox_exec(const char *cmdline);
\ No newline at end of file
+char *breezybox_find_executable(const char *name);
\ No newline at end of file
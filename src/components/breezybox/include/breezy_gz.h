@@ -0,0 +1,44 @@
+#pragma once
+
+#include "zlib.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * gzip-compressed programs.
+ *
+ * A program may be stored gzipped under its plain name (/root/bin/vi).
+ * The ELF loader inflates it in one pass as it reads the file, straight
+ * into the buffer it loads from; the gzip trailer gives the size up front.
+ * zlib's own state and window come from PSRAM when there is some.
+ */
+
+#define BREEZY_GZ_WINDOW_BITS   (16 + MAX_WBITS)    // gzip header, 32 KB window
+
+/**
+ * @brief Does the data start with the gzip magic?
+ */
+bool breezy_gz_is_gzip(const uint8_t *head, size_t len);
+
+/**
+ * @brief Zero a z_stream and point its allocators at PSRAM.
+ *        Call before inflateInit2()/deflateInit2().
+ */
+void breezy_gz_stream_init(z_stream *zs);
+
+/**
+ * @brief Inflate a whole gzip file, read from its start, into a new PSRAM
+ *        buffer
+ * @param size        Out: uncompressed size
+ * @param bytes_read  Out: compressed bytes read
+ * @return Buffer (free()), or NULL after printing why
+ */
+uint8_t *breezy_gz_read_file(FILE *f, size_t *size, size_t *bytes_read);
+
+/**
+ * @brief Inflate the first len bytes of a gzip file, read from its start
+ * @return 0, or -1 if the file is shorter or not valid gzip
+ */
+int breezy_gz_peek(FILE *f, uint8_t *out, size_t len);
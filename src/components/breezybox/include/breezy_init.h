@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Boot-time runner for init.sh.
+ *
+ * init.sh can be split into stanzas with annotation comments, so that slow
+ * steps don't hold up the prompt:
+ *
+ *   echo Welcome to BreezyBox!
+ *   # @stanza wifi @background
+ *   wifi connect
+ *   # @stanza sshd @after wifi @background
+ *   sshd
+ *   # @stanza clock
+ *   date "2026-01-01 00:00:00"
+ *
+ * Lines before the first stanza run first, on the shell's task. Then every
+ * stanza starts in a task of its own as soon as the stanzas named by its
+ * @after have finished (whether they succeeded or not); @after may only
+ * name stanzas above it. The prompt appears once the stanzas without
+ * @background are done. Stanzas read EOF from stdin.
+ *
+ * The annotations are comments, so `sh init.sh` still runs the whole file
+ * from top to bottom.
+ */
+
+#define BREEZY_INIT_MAX_STANZAS 16
+#define BREEZY_INIT_NAME_MAX    16
+
+typedef enum {
+    BREEZY_INIT_WAITING,        // For its @after stanzas
+    BREEZY_INIT_RUNNING,
+    BREEZY_INIT_DONE,
+} breezy_init_state_t;
+
+typedef struct {
+    char name[BREEZY_INIT_NAME_MAX];
+    char after[64];             // @after names, space-separated (truncated)
+    bool background;
+    breezy_init_state_t state;
+    int ret;                    // Exit status, once done
+    uint32_t start_ms;          // Since init began
+    uint32_t run_ms;            // Run time so far, or in total once done
+} breezy_init_info_t;
+
+/**
+ * @brief Run an init script; returns once the prompt may be shown
+ * @return Exit status of the lines before the first stanza
+ */
+int breezy_init_run(const char *path);
+
+/**
+ * @brief Copy out the stanzas of the last breezy_init_run(), in file order.
+ *        The lines before the first stanza come first, named "main".
+ * @param prompt_ms  Out (optional): ms from init start to the prompt
+ * @return Number written to out (at most max)
+ */
+size_t breezy_init_list(breezy_init_info_t *out, size_t max, uint32_t *prompt_ms);
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Background jobs: `cmd &`.
+ *
+ * A job runs a command line in a task of its own, so the shell prompt
+ * comes back right away. Its output goes to the shell's stdout; its stdin
+ * is at EOF, since the console belongs to the shell. Job numbers are small
+ * and reused, starting at 1.
+ */
+
+#define BREEZY_JOBS_MAX 8
+
+typedef struct {
+    int id;
+    bool done;
+    int ret;            // Exit status, once done
+    char cmd[64];       // Command line (truncated)
+} breezy_job_info_t;
+
+/**
+ * @brief Initialize the job table (call once at startup)
+ */
+void breezy_jobs_init(void);
+
+/**
+ * @brief Start a command line as a background job
+ * @return Job number, or -1 if the table is full or out of memory
+ */
+int breezy_jobs_start(const char *cmdline);
+
+/**
+ * @brief Job the calling task works for, or 0 for the foreground
+ */
+int breezy_jobs_current(void);
+
+/**
+ * @brief Mark the calling task as working for a job (0 = no-op).
+ *        Tasks a job spawns call this, so programs they run can be killed.
+ */
+void breezy_jobs_enter(int job);
+
+/**
+ * @brief Undo breezy_jobs_enter() before the calling task exits
+ */
+void breezy_jobs_leave(void);
+
+/**
+ * @brief Copy out all jobs, oldest first
+ * @return Number written to out (at most max)
+ */
+size_t breezy_jobs_list(breezy_job_info_t *out, size_t max);
+
+/**
+ * @brief Wait for a job to finish and forget it
+ * @param id   Job number, or 0 for the most recent job
+ * @param ret  Out (optional): the job's exit status
+ * @return Job number waited for, or -1 if there is no such job or another
+ *         task is already waiting for it
+ */
+int breezy_jobs_wait(int id, int *ret);
+
+/**
+ * @brief Stop the programs a job is running (see breezy_elf_kill_job())
+ *
+ * Built-in commands can't be stopped; a job running one finishes when the
+ * command does.
+ *
+ * @return Number of programs stopped, or -1 if there is no such job
+ */
+int breezy_jobs_kill(int id);
+
+/**
+ * @brief Print "[n] Done  cmd" for finished jobs and forget them
+ */
+void breezy_jobs_report(void);
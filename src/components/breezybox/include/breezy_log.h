@@ -0,0 +1,61 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Log routing: esp_log output per task, and a ring buffer for `dmesg`.
+ *
+ * breezy_log_init() puts a filter in front of the esp_log output function
+ * that was installed before it. Every log line goes into the ring buffer;
+ * it also goes on to that function unless the task logging it is quiet.
+ * The shell makes a command quiet while its output is redirected or piped,
+ * so its log lines don't end up in the data, without silencing any other
+ * task. Pipeline stages and ELF programs inherit it from the task that
+ * starts them.
+ *
+ * Writers reserve space in the ring with one atomic add and never wait, so
+ * logging stays cheap from any task. The oldest lines are overwritten.
+ */
+
+/**
+ * @brief Install the log filter (call once at startup; repeats are ignored)
+ */
+void breezy_log_init(void);
+
+/**
+ * @brief Keep the calling task's log lines off the console until the
+ *        matching breezy_log_quiet_end(). Nests.
+ * @return 0, or -1 if too many tasks are quiet (logs then stay on)
+ */
+int breezy_log_quiet_begin(void);
+
+void breezy_log_quiet_end(void);
+
+/**
+ * @brief Is the calling task quiet?
+ */
+bool breezy_log_is_quiet(void);
+
+/**
+ * @brief Forget a task that was deleted from outside (killed) while quiet
+ */
+void breezy_log_forget(TaskHandle_t task);
+
+/**
+ * @brief Copy the buffered log text, oldest first, starting at a line
+ * @return Bytes written to out (not NUL-terminated)
+ */
+size_t breezy_log_read(char *out, size_t size);
+
+/**
+ * @brief Size of the ring buffer, the most breezy_log_read() returns
+ */
+size_t breezy_log_size(void);
+
+/**
+ * @brief Drop the buffered lines
+ */
+void breezy_log_clear(void);
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Command-line tokenizer for breezybox_exec() and scripts.
+ *
+ * One pass over the line splits it into pipeline stages, words and
+ * redirect targets, written into the line's own fixed buffers, so a
+ * typical line needs no heap. A line that outgrows them is parsed a second
+ * time into one heap block sized by the first pass; there is no limit on
+ * length, words or stages. The shell syntax understood:
+ *
+ *   'text'          Literal
+ *   "text"          $ expanded; \" \\ \$ escaped
+ *   \c              c, literally (outside quotes)
+ *   $NAME ${NAME}   Variable (getenv() at the prompt), or "" if unset;
+ *                   one word, not re-split
+ *   $? $# $@ $0-$9  Script status and arguments ("" at the prompt)
+ *   $((expr))       Integer arithmetic: + - * / % ( ), comparisons,
+ *                   && ||, ! and variables by name (up to 127 bytes)
+ *   a | b           Pipeline
+ *   < file, > file, >> file
+ *   cmd ... &       Background job (only at the end)
+ *
+ * Operators only count outside quotes, so `echo "a | b"` is one command.
+ * $(cmd), && and || are errors rather than text.
+ */
+
+// Fixed buffers in breezy_line_t; bigger lines use the heap
+#define BREEZY_LINE_MAX         512     // Bytes of words after expansion
+#define BREEZY_LINE_MAX_WORDS   48      // In all stages together
+#define BREEZY_LINE_MAX_STAGES  8
+
+typedef struct {
+    int argc;
+    char **argv;                // NULL-terminated
+    char *infile;               // < file, or NULL
+    char *outfile;              // > or >> file, or NULL
+    bool append;                // >>
+} breezy_line_stage_t;
+
+typedef struct {
+    int nstages;                // 1 with argc 0 for an empty line
+    breezy_line_stage_t *stages;
+    bool background;            // Ended with &
+    char error[64];             // What is wrong, when parsing failed
+    void *heap;                 // Buffers of a line too big for the fixed ones
+    breezy_line_stage_t stage_buf[BREEZY_LINE_MAX_STAGES];
+    char *word_buf[BREEZY_LINE_MAX_WORDS + BREEZY_LINE_MAX_STAGES];
+    char text_buf[BREEZY_LINE_MAX];
+} breezy_line_t;
+
+/**
+ * @brief Value of a variable: name is NAME, ?, #, @ or digits, len bytes,
+ *        not NUL-terminated
+ * @return The value, or NULL if unset. Used before the next lookup.
+ */
+typedef const char *(*breezy_parse_lookup_t)(void *ctx, const char *name, size_t len);
+
+typedef struct {
+    breezy_parse_lookup_t lookup;   // NULL: getenv()
+    void *ctx;
+    bool split;                 // Unquoted expansions split into words on
+                                // blanks (a `for` list)
+    bool syntax_only;           // Expansions are "", nothing is looked up
+                                // or divided: checks a script line
+} breezy_parse_opts_t;
+
+/**
+ * @brief Tokenize a command line into line
+ *
+ * On success, call breezy_line_free() once done with the words.
+ *
+ * @param opts  NULL for the prompt's rules
+ * @return 0, or -1 with line->error set (unterminated quote, empty
+ *         pipeline stage, missing redirect target, unsupported syntax,
+ *         bad arithmetic, out of memory)
+ */
+int breezy_parse_line(const char *src, breezy_line_t *line, const breezy_parse_opts_t *opts);
+
+/**
+ * @brief Release what a parsed line took from the heap, if anything
+ */
+void breezy_line_free(breezy_line_t *line);
+
+/**
+ * @brief Length of the start of src up to the first byte in stops that is
+ *        outside quotes, escapes and $((...)), or strlen(src)
+ */
+size_t breezy_parse_span(const char *src, const char *stops);
+
+/**
+ * @brief Source text that parses back to line's words, quoted so nothing
+ *        in them is expanded again (e.g. for a background job)
+ * @return Newly allocated string (caller frees), or NULL
+ */
+char *breezy_parse_format(const breezy_line_t *line);
+
+/**
+ * @brief Source text that parses back to exactly argv's words, quoted as
+ *        breezy_parse_format() does
+ * @return Newly allocated string (caller frees), or NULL
+ */
+char *breezy_parse_format_argv(int argc, char *const *argv);
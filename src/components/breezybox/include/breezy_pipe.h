@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stddef.h>
+
+/**
+ * @brief Create an in-memory pipe (bounded ring buffer in RAM)
+ *
+ * Returns two stdio streams sharing one ring buffer. Reads block while the
+ * buffer is empty and return EOF once the write end is closed and drained.
+ * Writes block while the buffer is full and fail with EPIPE once the read
+ * end is closed. Each end may be used from a different task.
+ *
+ * The pipe memory is released when both ends have been fclose()d.
+ *
+ * @param rd        Out: read end ("r" stream)
+ * @param wr        Out: write end ("w" stream)
+ * @param capacity  Ring buffer size in bytes (0 = default)
+ * @return 0 on success, -1 on failure (out of memory)
+ */
+int breezy_pipe_open(FILE **rd, FILE **wr, size_t capacity);
+
+/**
+ * @brief Break the pipe f is either end of, for a program being killed
+ *
+ * Blocked and later reads on it return EOF, writes fail with EPIPE. The
+ * ends must still be fclose()d as usual.
+ *
+ * @return false if f is not a pipe end
+ */
+bool breezy_pipe_break(FILE *f);
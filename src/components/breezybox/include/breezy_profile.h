@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Where a command's time and memory go, for `time`.
+ *
+ * A profile is attached to a task. While it is, the shell and the ELF
+ * runner add the cycles each phase of running a program took, and what
+ * the program allocated. Pipeline stages started by that task report to
+ * the same profile. Phase times come from the CPU cycle counter
+ * (elf_get_cycle_count); a program's run time, which can be longer than
+ * the 32-bit counter wraps in, from esp_timer.
+ */
+
+typedef enum {
+    BREEZY_PROFILE_LOOKUP,      // Finding the program on PATH
+    BREEZY_PROFILE_READ,        // Reading the file into memory
+    BREEZY_PROFILE_INIT,        // esp_elf_init
+    BREEZY_PROFILE_RELOCATE,    // esp_elf_relocate
+    BREEZY_PROFILE_RUN,         // The program's main(), in its own task
+    BREEZY_PROFILE_DEINIT,      // esp_elf_deinit, for images not cached
+    BREEZY_PROFILE_PHASES
+} breezy_profile_phase_t;
+
+typedef struct {
+    uint64_t cycles[BREEZY_PROFILE_PHASES];
+    uint32_t runs;              // Programs run
+    uint32_t cached;            // ...of which came from the image cache
+    size_t file_bytes;          // Bytes read from ELF files
+    size_t heap_bytes;          // Bytes the programs allocated, in total
+    size_t heap_peak;           // Most any one program had allocated at once
+    uint32_t heap_allocs;
+    size_t sram_free;           // Free internal RAM when the profile started
+    size_t psram_free;          // Free PSRAM when the profile started
+    size_t sram_peak;           // Largest drop below sram_free seen
+    size_t psram_peak;          // Largest drop below psram_free seen
+} breezy_profile_t;
+
+/**
+ * @brief Clear a profile and note the free heap to measure peaks from
+ */
+void breezy_profile_start(breezy_profile_t *p);
+
+/**
+ * @brief Attach a profile to the calling task, or detach with NULL
+ * @return 0 on success, -1 if too many tasks are being profiled
+ */
+int breezy_profile_attach(breezy_profile_t *p);
+
+/**
+ * @brief Profile attached to the calling task, or NULL
+ */
+breezy_profile_t *breezy_profile_current(void);
+
+/**
+ * @brief Add cycles to a phase of the calling task's profile, if any.
+ *        Also samples the free heap for the SRAM/PSRAM peaks.
+ */
+void breezy_profile_add(breezy_profile_phase_t phase, uint32_t cycles);
+
+/**
+ * @brief Like breezy_profile_add(), for a time measured in microseconds
+ */
+void breezy_profile_add_us(breezy_profile_phase_t phase, int64_t us);
+
+/**
+ * @brief Add the time taken to read (or map) an ELF file, and its size
+ */
+void breezy_profile_add_read(uint32_t cycles, size_t bytes);
+
+/**
+ * @brief Account one program run to the calling task's profile, if any
+ * @param cached      Image came from the cache
+ * @param heap_bytes  Bytes the program allocated over its run
+ * @param heap_peak   Most it had allocated at once
+ * @param allocs      Number of allocations
+ */
+void breezy_profile_add_run(bool cached, size_t heap_bytes, size_t heap_peak,
+                            uint32_t allocs);
+
+/**
+ * @brief Cycles to microseconds at the current CPU clock
+ */
+double breezy_profile_us(uint64_t cycles);
+
+/**
+ * @brief Short name of a phase ("lookup", "read", ...)
+ */
+const char *breezy_profile_phase_name(breezy_profile_phase_t phase);
@@ -0,0 +1,47 @@
+#pragma once
+
+/*
+ * Shell scripts (`sh`, init.sh).
+ *
+ * A script is compiled once into a list of operations and cached by path,
+ * size and mtime, so loops and repeated runs don't re-read or re-parse it.
+ *
+ * Supported:
+ *   cmd args...                Commands as at the prompt (|, <, >, &)
+ *   a; b                       Several commands on one line
+ *   NAME=value                 Variables: $NAME, ${NAME}, $?, $#, $0-$9, $@
+ *   $((expr))                  Integer arithmetic: + - * / % ( ) and
+ *                              comparisons, variables by name
+ *   if cmd; then ...; elif cmd; then ...; else ...; fi
+ *   while cmd; do ...; done    (until cmd: loop while it fails)
+ *   for NAME in words...; do ...; done
+ *   break, continue, exit [n], ! cmd
+ *
+ * Conditions are commands; exit status 0 is true (see `test`/`[`).
+ * Words are quoted, escaped and expanded as at the prompt (breezy_parse.h),
+ * unknown variables as getenv() or "". Only a `for` list splits unquoted
+ * expansions on blanks. $(cmd), && and || are compile errors.
+ */
+
+/**
+ * @brief Initialize the script cache (call once at startup)
+ */
+void breezy_script_init(void);
+
+/**
+ * @brief Run a script
+ * @param argc  Argument count; argv[0] is the script path ($0)
+ * @param argv  Arguments ($1...)
+ * @return Exit status of the last command, the `exit` status, or 2 if the
+ *         script can't be read or compiled
+ */
+int breezy_script_run(int argc, char **argv);
+
+/**
+ * @brief Compile and run a script held in memory, without caching it
+ * @param text  Script source; modified while compiling
+ * @param argc  Argument count; argv[0] names the script in errors ($0)
+ * @param argv  Arguments ($1...)
+ * @return As breezy_script_run()
+ */
+int breezy_script_run_text(char *text, int argc, char **argv);
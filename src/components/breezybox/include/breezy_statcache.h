@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+/*
+ * stat() results by canonical path, so listing a directory again or
+ * running du over a tree doesn't walk LittleFS once per entry. Entries are
+ * looked up by two independent 64-bit hashes of the path rather than the
+ * path itself.
+ *
+ * breezy_wrap.c fills it from stat() and keeps it current: creating,
+ * renaming or removing anything drops every entry (a directory rename
+ * moves a whole subtree), and a file open for writing is not cached until
+ * it is closed. Failed lookups are not cached.
+ */
+
+/**
+ * @brief Allocate the table (CONFIG_BREEZYBOX_STAT_CACHE_ENTRIES)
+ */
+void breezy_statcache_init(void);
+
+/**
+ * @brief Cached result for a canonical path
+ * @param epoch  Out: pass to breezy_statcache_put() after a miss
+ * @return true and st filled, or false on a miss
+ */
+bool breezy_statcache_get(const char *path, struct stat *st, uint32_t *epoch);
+
+/**
+ * @brief Remember a successful stat() of a canonical path, unless
+ *        something was invalidated since the get() that returned epoch
+ */
+void breezy_statcache_put(const char *path, const struct stat *st, uint32_t epoch);
+
+/**
+ * @brief Forget everything
+ */
+void breezy_statcache_clear(void);
+
+/**
+ * @brief fd was opened for writing path: forget path until the fd closes
+ */
+void breezy_statcache_writer_open(int fd, const char *path);
+
+/**
+ * @brief fd was closed; forgets its path if it was opened for writing
+ */
+void breezy_statcache_fd_closed(int fd);
+
+/**
+ * @brief Lookups served and missed since boot
+ */
+void breezy_statcache_counts(unsigned *hits, unsigned *misses);
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+
+/*
+ * Stopping a running app from outside, cooperatively.
+ *
+ * The app's stdio, file and sleep imports are bound to the wrappers below
+ * at load time, the way its allocator imports go to breezy_arena.h. Each
+ * one is a stop point: when a stop has been requested it longjmps back to
+ * the app task's setjmp instead of returning to the app. That only ever
+ * happens on entry to or return from such a call, when the task holds no
+ * firmware lock, so the app task then tears down like a normal return.
+ *
+ * The wrappers also remember the files and fds the app opened, so they
+ * can be closed at the end of a run however it ends.
+ *
+ * An app that only computes, without reaching a stop point, runs on until
+ * it does.
+ */
+
+#define BREEZY_STOP_FILES   8   // Open FILEs / fds remembered per run
+
+typedef struct {
+    volatile bool stop;
+    jmp_buf unwind;
+    FILE *files[BREEZY_STOP_FILES];
+    int fds[BREEZY_STOP_FILES];     // fd + 1; 0 is a free slot
+} breezy_stop_t;
+
+/**
+ * @brief Attach s (zeroed, or already asked to stop) to the calling task.
+ *        Call setjmp(s->unwind) right after, in a frame that outlives the app.
+ */
+void breezy_stop_begin(breezy_stop_t *s);
+
+/**
+ * @brief Detach s and close whatever the app left open
+ */
+void breezy_stop_end(breezy_stop_t *s);
+
+/**
+ * @brief Ask the app to stop at its next stop point; any task may call it
+ */
+void breezy_stop_request(breezy_stop_t *s);
+
+/**
+ * @brief Stop point wrapper for a function an app imports by name
+ * @return Replacement address, else NULL
+ */
+void *breezy_stop_symbol(const char *name);
+
+int breezy_stop_printf(const char *fmt, ...);
+int breezy_stop_fprintf(FILE *f, const char *fmt, ...);
+int breezy_stop_vprintf(const char *fmt, va_list ap);
+int breezy_stop_vfprintf(FILE *f, const char *fmt, va_list ap);
+int breezy_stop_puts(const char *s);
+int breezy_stop_fputs(const char *s, FILE *f);
+int breezy_stop_fputc(int c, FILE *f);
+char *breezy_stop_fgets(char *s, int size, FILE *f);
+int breezy_stop_fgetc(FILE *f);
+size_t breezy_stop_fread(void *ptr, size_t size, size_t n, FILE *f);
+size_t breezy_stop_fwrite(const void *ptr, size_t size, size_t n, FILE *f);
+int breezy_stop_fflush(FILE *f);
+FILE *breezy_stop_fopen(const char *path, const char *mode);
+FILE *breezy_stop_fdopen(int fd, const char *mode);
+FILE *breezy_stop_freopen(const char *path, const char *mode, FILE *f);
+int breezy_stop_fclose(FILE *f);
+int breezy_stop_open(const char *path, int flags, ...);
+ssize_t breezy_stop_read(int fd, void *buf, size_t n);
+ssize_t breezy_stop_write(int fd, const void *buf, size_t n);
+int breezy_stop_close(int fd);
+int breezy_stop_usleep(useconds_t us);
+unsigned breezy_stop_sleep(unsigned s);
+void breezy_stop_vTaskDelay(TickType_t ticks);
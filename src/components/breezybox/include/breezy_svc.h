@@ -0,0 +1,92 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Supervised services: `svc`.
+ *
+ * A service is either registered by code (httpd, or sshd from the host
+ * firmware), with start/stop/running callbacks, or a command line started
+ * with `svc run`, which runs in a task of its own like a background job.
+ * Either way the console stays free while it serves.
+ *
+ * A supervisor task checks every service twice a second. One that stops
+ * on its own - running() turns false, or its command exits non-zero - is
+ * restarted after a delay that doubles with each failure in a row (1 s to
+ * 30 s). A command that exits 0 is done and is not restarted.
+ *
+ * `svc stop` on a command service stops the ELF programs it runs, the way
+ * `kill` does for jobs; a built-in command it runs finishes on its own.
+ */
+
+#define BREEZY_SVC_MAX          8
+#define BREEZY_SVC_NAME_MAX     16
+
+// Job numbers of command services (breezy_jobs_enter()), above any real job
+#define BREEZY_SVC_JOB_BASE     100
+
+typedef struct {
+    const char *name;
+    /** Start serving and return; argv[0] is the service name */
+    esp_err_t (*start)(int argc, char **argv);
+    void (*stop)(void);
+    /** Still serving? NULL if the service can't tell */
+    bool (*running)(void);
+    /** Name prefix of the service's tasks, for CPU use (optional) */
+    const char *task;
+} breezy_svc_def_t;
+
+typedef enum {
+    BREEZY_SVC_STOPPED,
+    BREEZY_SVC_RUNNING,
+    BREEZY_SVC_STOPPING,        // Waiting for its command to return
+    BREEZY_SVC_BACKOFF,         // Failed; restarts when the delay is up
+} breezy_svc_state_t;
+
+typedef struct {
+    char name[BREEZY_SVC_NAME_MAX];
+    char cmd[48];               // Command line of a `svc run` service (truncated)
+    breezy_svc_state_t state;
+    int last_ret;               // Exit status of the last run that ended
+    uint32_t restarts;          // Automatic restarts so far
+    uint32_t uptime_s;          // Since the current run started
+    size_t mem;                 // Heap taken by start(), or arena peak of
+                                // the programs a command service ran
+    int cpu_permille;           // CPU of its tasks since start, -1 unknown
+} breezy_svc_info_t;
+
+/**
+ * @brief Add a service. Safe to call before BreezyBox starts, so init.sh
+ *        can start it.
+ * @return ESP_OK, ESP_ERR_INVALID_STATE if the name is taken,
+ *         ESP_ERR_NO_MEM if the table is full
+ */
+esp_err_t breezy_svc_register(const breezy_svc_def_t *def);
+
+/**
+ * @brief Start a registered service
+ * @param argc  Argument count; argv[0] is the service name
+ * @return 0 on success, 1 if unknown or start() failed
+ */
+int breezy_svc_start(int argc, char **argv);
+
+/**
+ * @brief Start a command line as a service called name
+ * @return 0 on success, 1 on error
+ */
+int breezy_svc_run(const char *name, const char *cmdline);
+
+/**
+ * @brief Stop a service and keep it stopped
+ * @return 0 on success, 1 if there is no such service
+ */
+int breezy_svc_stop(const char *name);
+
+/**
+ * @brief Copy out all services, in registration order
+ * @return Number written to out (at most max)
+ */
+size_t breezy_svc_list(breezy_svc_info_t *out, size_t max);
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Minimal perfect hash of the firmware symbols exported to ELF apps.
+ *
+ * tools/gen_symhash.py turns an elf_loader symbol table source (the
+ * ESP_ELFSYM_EXPORT() list written by elf_loader's symbols.py) into a
+ * table where every name has exactly one slot, found with two hashes and
+ * a single strcmp. The ELF loader's by-name lookup (elf_find_sym) is
+ * routed through it via linker wrap; names not in the table still go
+ * through elf_loader's own linear tables.
+ *
+ * Enable with CONFIG_BREEZYBOX_ELF_SYMHASH.
+ */
+
+typedef struct {
+    const char *name;
+    void *addr;
+} breezy_symhash_entry_t;
+
+typedef struct {
+    uint32_t size;                          // Number of slots == symbols
+    const int32_t *disp;                    // Per-bucket seed, or -(slot + 1)
+    const breezy_symhash_entry_t *table;
+} breezy_symhash_t;
+
+/**
+ * @brief Seeded string hash shared with tools/gen_symhash.py
+ */
+uint32_t breezy_symhash_fn(uint32_t seed, const char *s);
+
+/**
+ * @brief Look up a symbol in the perfect hash table
+ * @return Address, or NULL if not in the table (or no table built)
+ */
+void *breezy_symhash_find(const char *name);
+
+/**
+ * @brief Number of symbols in the table (0 if not built)
+ */
+uint32_t breezy_symhash_size(void);
+
+/**
+ * @brief Route lookups through the table (default) or only through
+ *        elf_loader's linear tables, for benchmarking
+ */
+void breezy_symhash_set_enabled(bool enabled);
+
+/**
+ * @brief Lookup counters since the last reset
+ * @param lookups  Out (optional): symbols the loader asked for
+ * @param hits     Out (optional): of those, answered by the hash table
+ */
+void breezy_symhash_stats(uint32_t *lookups, uint32_t *hits);
+
+void breezy_symhash_stats_reset(void);
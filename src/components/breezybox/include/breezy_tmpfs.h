@@ -0,0 +1,29 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+
+/*
+ * RAM filesystem at /tmp.
+ *
+ * Files live in PSRAM (internal RAM without it) and are gone after a
+ * reset. Directories, stat, rename, truncate and unlinking open files work
+ * as on LittleFS, without the flash writes: scratch files are cheap to
+ * create and throw away. The total size is capped at
+ * CONFIG_BREEZYBOX_TMPFS_KB; a write past the cap fails with ENOSPC.
+ *
+ * The shell sets TMPDIR to BREEZYBOX_TMP_DIR when it is mounted.
+ */
+
+#define BREEZYBOX_TMP_DIR "/tmp"
+
+/**
+ * @brief Register the filesystem at BREEZYBOX_TMP_DIR
+ * @return ESP_OK, or the esp_vfs_register() error
+ */
+esp_err_t breezy_tmpfs_init(void);
+
+/**
+ * @brief Size cap and bytes in use (allocated for file data)
+ */
+void breezy_tmpfs_info(size_t *total, size_t *used);
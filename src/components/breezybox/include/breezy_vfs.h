@@ -29,7 +29,15 @@ const char *breezybox_cwd(void);
 int breezybox_set_cwd(const char *path);
 
 /**
- * @brief Resolve a path (relative or absolute) to full path
- * @return pointer to buf on success, NULL on failure
+ * @brief Resolve a path (relative or absolute) to a canonical full path:
+ *        "." and ".." collapsed, no repeated or trailing slashes
+ * @return pointer to buf on success; NULL (and buf empty) if it doesn't fit
  */
-char *breezybox_resolve_path(const char *path, char *buf, size_t size);
\ No newline at end of file
+char *breezybox_resolve_path(const char *path, char *buf, size_t size);
+
+/**
+ * @brief Like breezybox_resolve_path(), but an already canonical path is
+ *        returned as is, without copying
+ * @return path, buf, or NULL
+ */
+const char *breezybox_canonical_path(const char *path, char *buf, size_t size);
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+/*
+ * Iterative directory tree walk for du, rm -r, cp -r and find.
+ *
+ * The open directories and the current path live on the heap, so the
+ * caller's stack use is the same at any depth. Each directory is seen
+ * twice: by pre before its contents and by post after them. Files are
+ * seen by pre only.
+ */
+
+// Longest path the walk builds; deeper entries are skipped
+#define BREEZY_WALK_PATH_MAX    512
+
+// Flags for breezy_walk()
+#define BREEZY_WALK_STAT        (1 << 0)    // Fill st for every entry
+#define BREEZY_WALK_STAT_FILES  (1 << 1)    // Fill st for all but directories
+
+typedef enum {
+    BREEZY_WALK_CONTINUE = 0,
+    BREEZY_WALK_SKIP,       // From pre: don't enter this directory, no post
+    BREEZY_WALK_STOP,       // End the walk
+} breezy_walk_ret_t;
+
+typedef struct {
+    const char *path;       // Root path, then "/" and the names below it
+    const char *name;       // Last component of path
+    size_t root_len;        // strlen() of the root path; path + root_len is
+                            // what lies below it, "" for the root itself
+    int depth;              // 0 for the root
+    bool is_dir;
+    const struct stat *st;  // As the flags ask, else NULL
+    uint64_t *dir_data;     // Directories: kept from pre to post, starts 0
+} breezy_walk_entry_t;
+
+typedef breezy_walk_ret_t (*breezy_walk_cb_t)(const breezy_walk_entry_t *e, void *ctx);
+
+/**
+ * @brief Walk root and everything below it, depth first
+ *
+ * Entries are stat()ed only when flags ask for it or readdir() can't tell
+ * a directory from a file. A directory that can't be opened still gets its
+ * post call.
+ *
+ * @param root  Resolved path of a file or directory
+ * @param pre   Called for each entry before a directory's contents; may be NULL
+ * @param post  Called for each directory after its contents; may be NULL
+ * @return 0 when done, 1 if a callback stopped it, -1 if root can't be
+ *         stat()ed or memory ran out (errno set)
+ */
+int breezy_walk(const char *root, breezy_walk_cb_t pre, breezy_walk_cb_t post,
+                unsigned flags, void *ctx);
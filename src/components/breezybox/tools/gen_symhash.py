@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+"""
+Generate a minimal perfect hash table of ELF loader symbols.
+
+Reads one or more elf_loader symbol table sources (files with
+ESP_ELFSYM_EXPORT(name) entries, as written by elf_loader's
+tool/symbols.py) and writes a C file defining g_breezy_symhash
+(see include/breezy_symhash.h).
+
+Algorithm: hash-and-displace. Names are bucketed by hash(0, name) % n.
+Buckets are placed largest first; each multi-name bucket gets the
+smallest seed d for which hash(d, name) % n lands every name in a free
+slot. Single-name buckets then take the remaining free slots directly,
+stored as -(slot + 1). Lookup is two hashes and one strcmp.
+
+Usage: gen_symhash.py -o out.c symbols.c [more_symbols.c ...]
+"""
+
+import argparse
+import re
+import sys
+
+EXPORT_RE = re.compile(r'ESP_ELFSYM_EXPORT\(\s*([A-Za-z_][A-Za-z0-9_]*)\s*\)')
+MASK = 0xFFFFFFFF
+
+
+def symhash(seed, name):
+    """Must match breezy_symhash_fn() in breezy_symhash.c"""
+    h = 2166136261 ^ seed
+    for c in name.encode():
+        h = ((h ^ c) * 16777619) & MASK
+    h ^= h >> 16
+    h = (h * 0x85EBCA6B) & MASK
+    h ^= h >> 13
+    h = (h * 0xC2B2AE35) & MASK
+    h ^= h >> 16
+    return h
+
+
+def read_symbols(paths):
+    names, seen = [], set()
+    for path in paths:
+        with open(path, encoding='utf-8') as f:
+            for name in EXPORT_RE.findall(f.read()):
+                if name not in seen:
+                    seen.add(name)
+                    names.append(name)
+    return names
+
+
+def build(names):
+    n = len(names)
+    buckets = [[] for _ in range(n)]
+    for name in names:
+        buckets[symhash(0, name) % n].append(name)
+
+    disp = [0] * n
+    slots = [None] * n
+    order = sorted(range(n), key=lambda b: len(buckets[b]), reverse=True)
+
+    i = 0
+    while i < n and len(buckets[order[i]]) > 1:
+        b = order[i]
+        d = 1
+        while True:
+            placed = [symhash(d, name) % n for name in buckets[b]]
+            if len(set(placed)) == len(placed) and all(slots[s] is None for s in placed):
+                break
+            d += 1
+        disp[b] = d
+        for name, s in zip(buckets[b], placed):
+            slots[s] = name
+        i += 1
+
+    free = [s for s in range(n) if slots[s] is None]
+    while i < n and len(buckets[order[i]]) == 1:
+        b = order[i]
+        s = free.pop()
+        disp[b] = -s - 1
+        slots[s] = buckets[b][0]
+        i += 1
+
+    return disp, slots
+
+
+def write(out, names, disp, slots, sources):
+    lines = [
+        '// Generated by breezybox/tools/gen_symhash.py - do not edit',
+        '// From: ' + ', '.join(sources),
+        '',
+        '#include <stddef.h>',
+        '#include "breezy_symhash.h"',
+        '',
+        '#pragma GCC diagnostic push',
+        '#pragma GCC diagnostic ignored "-Wbuiltin-declaration-mismatch"',
+    ]
+    lines += ['extern int %s;' % name for name in names]
+    lines += ['#pragma GCC diagnostic pop', '']
+
+    lines.append('static const int32_t s_disp[%d] = {' % max(len(disp), 1))
+    for i in range(0, len(disp), 12):
+        lines.append('    ' + ', '.join(str(d) for d in disp[i:i + 12]) + ',')
+    lines += ['};', '']
+
+    lines.append('static const breezy_symhash_entry_t s_table[%d] = {' % max(len(slots), 1))
+    for name in slots:
+        lines.append('    { "%s", &%s },' % (name, name))
+    lines += ['};', '']
+
+    lines += [
+        'const breezy_symhash_t g_breezy_symhash = {',
+        '    .size = %d,' % len(slots),
+        '    .disp = s_disp,',
+        '    .table = s_table,',
+        '};',
+        '',
+    ]
+    out.write('\n'.join(lines))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument('-o', '--output', required=True, help='C file to write')
+    parser.add_argument('sources', nargs='+', help='symbol table sources')
+    args = parser.parse_args()
+
+    names = read_symbols(args.sources)
+    if not names:
+        sys.exit('gen_symhash: no ESP_ELFSYM_EXPORT entries in ' + ', '.join(args.sources))
+
+    disp, slots = build(names)
+    with open(args.output, 'w', encoding='utf-8') as out:
+        write(out, names, disp, slots, args.sources)
+
+    print('gen_symhash: %d symbols -> %s' % (len(names), args.output))
+
+
+if __name__ == '__main__':
+    main()